@@ -162,6 +162,7 @@ if (WIN32)
     set(HAVE_LANGINFO_H 0 CACHE INTERNAL "")
     set(HAVE_LIBIO_H 0 CACHE INTERNAL "")
     set(HAVE_LINUX_FALLOC_H 0 CACHE INTERNAL "")
+    set(HAVE_LINUX_IO_URING_H 0 CACHE INTERNAL "")
     set(HAVE_MNTENT_H 0 CACHE INTERNAL "")
     set(HAVE_MNTTAB_H 0 CACHE INTERNAL "")
     set(HAVE_NDIR_H 0 CACHE INTERNAL "")
@@ -246,6 +247,7 @@ if (WIN32)
     set(HAVE_PTHREAD_MUTEX_CONSISTENT_NP 0 CACHE INTERNAL "")
     set(HAVE_PTHREAD_RWLOCKATTR_SETKIND_NP 0 CACHE INTERNAL "")
     set(HAVE_PWRITE 0 CACHE INTERNAL "")
+    set(HAVE_PWRITEV 0 CACHE INTERNAL "")
     set(HAVE_QSORT_R 0 CACHE INTERNAL "")
     set(HAVE_SEMTIMEDOP 0 CACHE INTERNAL "")
     set(HAVE_SETITIMER 0 CACHE INTERNAL "")
@@ -302,6 +304,7 @@ set(include_files_list
     langinfo.h
     libio.h
     linux/falloc.h
+    linux/io_uring.h
     limits.h
     locale.h
     math.h
@@ -385,7 +388,7 @@ set(functions_list
     nanosleep
     poll
     posix_fadvise
-    pread pwrite
+    pread pwrite pwritev
     pthread_cancel
     pthread_keycreate pthread_key_create
     pthread_mutexattr_setprotocol
@@ -69,6 +69,7 @@ const int DB_VERSION_DDL11_2	= 112; // ods11.2 db, FB2.5
 const int DB_VERSION_DDL12		= 120; // ods12.0 db, FB3.0
 const int DB_VERSION_DDL13		= 130; // ods13.0 db, FB4.0
 const int DB_VERSION_DDL13_1	= 131; // ods13.1 db, FB5.0
+const int DB_VERSION_DDL13_2	= 132; // ods13.2 db, FB5.x
 
 const int DB_VERSION_OLDEST_SUPPORTED = DB_VERSION_DDL8;  // IB4.0 is ods8
 
@@ -282,6 +282,7 @@ enum att_type {
 	att_relation_type,
 	att_relation_sql_security_deprecated,	// can be removed later
 	att_relation_sql_security,
+	att_relation_extent_size,
 
 	// Field attributes (used for both global and local fields)
 
@@ -519,6 +520,7 @@ enum att_type {
 	att_gen_sysflag,
 	att_gen_init_val,
 	att_gen_id_increment,
+	att_gen_cache,
 
 	// Stored procedure attributes
 
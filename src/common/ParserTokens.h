@@ -103,6 +103,7 @@ PARSER_TOKEN(TOK_BOOLEAN, "BOOLEAN", false)
 PARSER_TOKEN(TOK_BOTH, "BOTH", false)
 PARSER_TOKEN(TOK_BREAK, "BREAK", true)
 PARSER_TOKEN(TOK_BY, "BY", false)
+PARSER_TOKEN(TOK_CACHE, "CACHE", true)
 PARSER_TOKEN(TOK_CALLER, "CALLER", true)
 PARSER_TOKEN(TOK_CASCADE, "CASCADE", true)
 PARSER_TOKEN(TOK_CASE, "CASE", false)
@@ -205,6 +206,7 @@ PARSER_TOKEN(TOK_EXISTS, "EXISTS", false)
 PARSER_TOKEN(TOK_EXIT, "EXIT", true)
 PARSER_TOKEN(TOK_EXP, "EXP", true)
 PARSER_TOKEN(TOK_EXTENDED, "EXTENDED", true)
+PARSER_TOKEN(TOK_EXTENT, "EXTENT", true)
 PARSER_TOKEN(TOK_EXTERNAL, "EXTERNAL", false)
 PARSER_TOKEN(TOK_EXTRACT, "EXTRACT", false)
 PARSER_TOKEN(TOK_FALSE, "FALSE", false)
@@ -352,6 +354,7 @@ PARSER_TOKEN(TOK_PAD, "PAD", true)
 PARSER_TOKEN(TOK_PAGE, "PAGE", true)
 PARSER_TOKEN(TOK_PAGES, "PAGES", true)
 PARSER_TOKEN(TOK_PAGE_SIZE, "PAGE_SIZE", true)
+PARSER_TOKEN(TOK_PARALLEL, "PARALLEL", true)
 PARSER_TOKEN(TOK_PARAMETER, "PARAMETER", false)
 PARSER_TOKEN(TOK_PARTITION, "PARTITION", true)
 PARSER_TOKEN(TOK_PASSWORD, "PASSWORD", true)
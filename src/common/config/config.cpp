@@ -429,6 +429,25 @@ void Config::checkValues()
 
 	checkIntForLoBound(KEY_MAX_STATEMENT_CACHE_SIZE, 0, true);
 
+	checkIntForLoBound(KEY_READ_AHEAD_PAGES, 0, true);
+	checkIntForHiBound(KEY_READ_AHEAD_PAGES, 256, false);
+
+	checkIntForLoBound(KEY_PAGE_CACHE_PARTITIONS, 0, true);
+	checkIntForHiBound(KEY_PAGE_CACHE_PARTITIONS, 64, false);
+
+	checkIntForLoBound(KEY_CACHE_WRITERS, 0, true);
+	checkIntForHiBound(KEY_CACHE_WRITERS, 16, false);
+
+	checkIntForLoBound(KEY_PAGE_CACHE_SAVE_INTERVAL, 0, true);
+
+	checkIntForLoBound(KEY_GROUP_COMMIT_WINDOW, -1, true);
+	checkIntForHiBound(KEY_GROUP_COMMIT_WINDOW, 100000, false);
+
+	checkIntForLoBound(KEY_REDO_LOG_SIZE, 1, true);
+
+	checkIntForLoBound(KEY_TRANSACTION_ID_RESERVE, 1, true);
+	checkIntForHiBound(KEY_TRANSACTION_ID_RESERVE, 65536, false);
+
 	checkIntForLoBound(KEY_MAX_PARALLEL_WORKERS, 1, true);
 	checkIntForHiBound(KEY_MAX_PARALLEL_WORKERS, 64, false);	// todo: detect number of available cores
 
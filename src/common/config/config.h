@@ -195,6 +195,19 @@ enum ConfigKey
 	KEY_OUTER_JOIN_CONVERSION,
 	KEY_SUBQUERY_CONVERSION,
 	KEY_ALLOW_UPDATE_OVERWRITE,
+	KEY_READ_AHEAD_PAGES,
+	KEY_USE_IO_URING,
+	KEY_PAGE_CACHE_POLICY,
+	KEY_PAGE_CACHE_PARTITIONS,
+	KEY_PAGE_CACHE_HUGE_PAGES,
+	KEY_PAGE_CACHE_NUMA,
+	KEY_CACHE_WRITERS,
+	KEY_PAGE_CACHE_SAVE,
+	KEY_PAGE_CACHE_SAVE_INTERVAL,
+	KEY_GROUP_COMMIT_WINDOW,
+	KEY_REDO_LOG,
+	KEY_REDO_LOG_SIZE,
+	KEY_TRANSACTION_ID_RESERVE,
 	MAX_CONFIG_KEY		// keep it last
 };
 
@@ -316,7 +329,20 @@ constexpr ConfigEntry entries[MAX_CONFIG_KEY] =
 	{TYPE_BOOLEAN,	"OptimizeForFirstRows",		false,	false},
 	{TYPE_BOOLEAN,	"OuterJoinConversion",		false,	true},
 	{TYPE_BOOLEAN,	"SubQueryConversion",		false,	false},
-	{TYPE_BOOLEAN,	"AllowUpdateOverwrite",		false,	true}
+	{TYPE_BOOLEAN,	"AllowUpdateOverwrite",		false,	true},
+	{TYPE_INTEGER,	"ReadAheadPages",			false,	32},		// pages
+	{TYPE_BOOLEAN,	"UseIoUring",				false,	false},
+	{TYPE_STRING,	"PageCachePolicy",			false,	"LRU"},
+	{TYPE_INTEGER,	"PageCachePartitions",		false,	0},
+	{TYPE_BOOLEAN,	"PageCacheHugePages",		false,	false},
+	{TYPE_STRING,	"PageCacheNuma",			false,	"default"},
+	{TYPE_INTEGER,	"CacheWriters",				false,	1},
+	{TYPE_BOOLEAN,	"PageCacheSave",			false,	false},
+	{TYPE_INTEGER,	"PageCacheSaveInterval",	false,	0},		// seconds
+	{TYPE_INTEGER,	"GroupCommitWindow",		false,	-1},	// microseconds
+	{TYPE_BOOLEAN,	"RedoLog",					false,	false},
+	{TYPE_INTEGER,	"RedoLogSize",				false,	64},	// megabytes
+	{TYPE_INTEGER,	"TransactionIdReserve",		false,	1024}
 };
 
 
@@ -656,6 +682,32 @@ public:
 	CONFIG_GET_PER_DB_BOOL(getSubQueryConversion, KEY_SUBQUERY_CONVERSION);
 
 	CONFIG_GET_PER_DB_BOOL(getAllowUpdateOverwrite, KEY_ALLOW_UPDATE_OVERWRITE);
+
+	CONFIG_GET_PER_DB_INT(getReadAheadPages, KEY_READ_AHEAD_PAGES);
+
+	CONFIG_GET_PER_DB_BOOL(getUseIoUring, KEY_USE_IO_URING);
+
+	CONFIG_GET_PER_DB_STR(getPageCachePolicy, KEY_PAGE_CACHE_POLICY);
+
+	CONFIG_GET_PER_DB_INT(getPageCachePartitions, KEY_PAGE_CACHE_PARTITIONS);
+
+	CONFIG_GET_PER_DB_BOOL(getPageCacheHugePages, KEY_PAGE_CACHE_HUGE_PAGES);
+
+	CONFIG_GET_PER_DB_STR(getPageCacheNuma, KEY_PAGE_CACHE_NUMA);
+
+	CONFIG_GET_PER_DB_INT(getCacheWriters, KEY_CACHE_WRITERS);
+
+	CONFIG_GET_PER_DB_BOOL(getPageCacheSave, KEY_PAGE_CACHE_SAVE);
+
+	CONFIG_GET_PER_DB_INT(getPageCacheSaveInterval, KEY_PAGE_CACHE_SAVE_INTERVAL);
+
+	CONFIG_GET_PER_DB_INT(getGroupCommitWindow, KEY_GROUP_COMMIT_WINDOW);
+
+	CONFIG_GET_PER_DB_BOOL(getRedoLog, KEY_REDO_LOG);
+
+	CONFIG_GET_PER_DB_INT(getRedoLogSize, KEY_REDO_LOG_SIZE);
+
+	CONFIG_GET_PER_DB_INT(getTransactionIdReserve, KEY_TRANSACTION_ID_RESERVE);
 };
 
 // Implementation of interface to access master configuration file
@@ -83,6 +83,23 @@ namespace os_utils
 
 	bool getCurrentModulePath(char* buffer, size_t bufferSize);
 
+	// Allocate large memory block directly from OS, using huge (large) pages if
+	// requested and possible. Size is adjusted to the real size of the block.
+	// Returns NULL if there is not enough memory.
+	void* allocLargeBlock(size_t& size, bool hugePages);
+	void releaseLargeBlock(void* block, size_t size);
+
+	// Number of NUMA nodes in the system, 1 if NUMA is not supported
+	unsigned getNumaNodes();
+
+	// Place memory not touched yet on the given NUMA node, or interleave it
+	// between all nodes if node is negative. Returns false if not supported.
+	bool bindToNumaNode(void* block, size_t size, int node);
+
+	// Run the calling thread on the processors of the given NUMA node.
+	// Returns false if not supported.
+	bool bindThreadToNumaNode(unsigned node);
+
 	// force descriptor to have O_CLOEXEC set
 	int open(const char* pathname, int flags, mode_t mode = DEFAULT_OPEN_MODE);
 	void setCloseOnExec(int fd);	// posix only
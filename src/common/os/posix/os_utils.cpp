@@ -92,6 +92,10 @@
 
 #include <stdio.h>
 
+#ifdef LINUX
+#include <sys/syscall.h>
+#endif
+
 using namespace Firebird;
 
 namespace os_utils
@@ -434,6 +438,200 @@ void getUniqueFileId(const char* name, UCharBuffer& id)
 	makeUniqueFileId(statistics, id);
 }
 
+#if defined(MAP_ANON) && !defined(MAP_ANONYMOUS)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+#ifdef MAP_HUGETLB
+static size_t getHugePageSize()
+{
+	// Most of platforms use 2MB huge pages unless configured otherwise
+	size_t size = 2 * 1024 * 1024;
+
+	if (FILE* const file = os_utils::fopen("/proc/meminfo", "r"))
+	{
+		char line[128];
+		while (fgets(line, sizeof(line), file))
+		{
+			unsigned long kb;
+			if (sscanf(line, "Hugepagesize: %lu kB", &kb) == 1 && kb)
+			{
+				size = (size_t) kb * 1024;
+				break;
+			}
+		}
+
+		fclose(file);
+	}
+
+	return size;
+}
+#endif // MAP_HUGETLB
+
+void* allocLargeBlock(size_t& size, bool hugePages)
+{
+#ifdef MAP_ANONYMOUS
+#ifdef MAP_HUGETLB
+	if (hugePages)
+	{
+		// Block must be a multiple of the default huge page size, else munmap fails
+		static const size_t hugePageSize = getHugePageSize();
+		const size_t hugeSize = FB_ALIGN(size, hugePageSize);
+
+		void* const block = os_utils::mmap(NULL, hugeSize, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+		if (block != MAP_FAILED)
+		{
+			size = hugeSize;
+			return block;
+		}
+
+		// No huge pages reserved, fall back to regular pages
+	}
+#endif // MAP_HUGETLB
+
+	void* const block = os_utils::mmap(NULL, size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (block == MAP_FAILED)
+		return NULL;
+
+#ifdef MADV_HUGEPAGE
+	// Ask for transparent huge pages instead
+	if (hugePages)
+		madvise(block, size, MADV_HUGEPAGE);
+#endif
+
+	return block;
+#else // MAP_ANONYMOUS
+	return NULL;
+#endif // MAP_ANONYMOUS
+}
+
+void releaseLargeBlock(void* block, size_t size)
+{
+	munmap(block, size);
+}
+
+#if defined(LINUX) && defined(SYS_mbind)
+static unsigned countNumaNodes()
+{
+	unsigned count = 0;
+
+	if (DIR* const dir = opendir("/sys/devices/system/node"))
+	{
+		while (const struct dirent* const entry = os_utils::readdir(dir))
+		{
+			unsigned node;
+			if (sscanf(entry->d_name, "node%u", &node) == 1)
+				count++;
+		}
+
+		closedir(dir);
+	}
+
+	return MAX(count, 1);
+}
+#endif
+
+unsigned getNumaNodes()
+{
+#if defined(LINUX) && defined(SYS_mbind)
+	static const unsigned nodes = countNumaNodes();
+	return nodes;
+#else
+	return 1;
+#endif
+}
+
+bool bindToNumaNode(void* block, size_t size, int node)
+{
+#if defined(LINUX) && defined(SYS_mbind)
+	// Values of MPOL_PREFERRED and MPOL_INTERLEAVE from linux/mempolicy.h
+	const int MEMORY_POLICY_PREFERRED = 1;
+	const int MEMORY_POLICY_INTERLEAVE = 3;
+
+	const unsigned BITS_PER_MASK = sizeof(unsigned long) * 8;
+	const unsigned MAX_NODES = 1024;
+
+	const unsigned nodes = MIN(getNumaNodes(), MAX_NODES);
+	if (nodes <= 1 || node >= (int) nodes)
+		return false;
+
+	unsigned long mask[MAX_NODES / BITS_PER_MASK];
+	memset(mask, 0, sizeof(mask));
+
+	if (node < 0)
+	{
+		for (unsigned n = 0; n < nodes; n++)
+			mask[n / BITS_PER_MASK] |= 1UL << (n % BITS_PER_MASK);
+	}
+	else
+		mask[node / BITS_PER_MASK] |= 1UL << (node % BITS_PER_MASK);
+
+	const int mode = node < 0 ? MEMORY_POLICY_INTERLEAVE : MEMORY_POLICY_PREFERRED;
+	return syscall(SYS_mbind, block, size, mode, mask, MAX_NODES + 1, 0) == 0;
+#else
+	return false;
+#endif
+}
+
+bool bindThreadToNumaNode(unsigned node)
+{
+#if defined(LINUX) && defined(SYS_mbind) && defined(SYS_sched_setaffinity)
+	const unsigned BITS_PER_MASK = sizeof(unsigned long) * 8;
+	const unsigned MAX_CPUS = 4096;
+
+	if (getNumaNodes() <= 1)
+		return false;
+
+	// List of processors of the node looks like "0-15,32-47"
+
+	char name[64];
+	snprintf(name, sizeof(name), "/sys/devices/system/node/node%u/cpulist", node);
+
+	FILE* const file = os_utils::fopen(name, "r");
+	if (!file)
+		return false;
+
+	unsigned long mask[MAX_CPUS / BITS_PER_MASK];
+	memset(mask, 0, sizeof(mask));
+	bool found = false;
+
+	unsigned first, last;
+	while (fscanf(file, "%u", &first) == 1)
+	{
+		last = first;
+		int c = fgetc(file);
+
+		if (c == '-')
+		{
+			if (fscanf(file, "%u", &last) != 1)
+				break;
+
+			c = fgetc(file);
+		}
+
+		for (unsigned cpu = first; cpu <= last && cpu < MAX_CPUS; cpu++)
+		{
+			mask[cpu / BITS_PER_MASK] |= 1UL << (cpu % BITS_PER_MASK);
+			found = true;
+		}
+
+		if (c != ',')
+			break;
+	}
+
+	fclose(file);
+
+	// Zero pid stands for the calling thread
+	return found && syscall(SYS_sched_setaffinity, 0, sizeof(mask), mask) == 0;
+#else
+	return false;
+#endif
+}
+
 /// class CtrlCHandler
 
 bool CtrlCHandler::terminated = false;
@@ -621,6 +621,51 @@ void setDefaultAffinity()
 }
 
 
+void* allocLargeBlock(size_t& size, bool hugePages)
+{
+	if (hugePages)
+	{
+		// Requires SeLockMemoryPrivilege, fall back to regular pages if not granted
+		const size_t largePageSize = GetLargePageMinimum();
+
+		if (largePageSize)
+		{
+			const size_t largeSize = FB_ALIGN(size, largePageSize);
+			void* const block = VirtualAlloc(NULL, largeSize,
+				MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+
+			if (block)
+			{
+				size = largeSize;
+				return block;
+			}
+		}
+	}
+
+	return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+}
+
+void releaseLargeBlock(void* block, size_t /*size*/)
+{
+	VirtualFree(block, 0, MEM_RELEASE);
+}
+
+unsigned getNumaNodes()
+{
+	// Memory committed by VirtualAlloc can't be moved to other node
+	return 1;
+}
+
+bool bindToNumaNode(void* /*block*/, size_t /*size*/, int /*node*/)
+{
+	return false;
+}
+
+bool bindThreadToNumaNode(unsigned /*node*/)
+{
+	return false;
+}
+
 /// class CtrlCHandler
 
 bool CtrlCHandler::terminated = false;
@@ -48,6 +48,21 @@ using namespace Jrd;
 namespace Jrd {
 
 
+// Offset of the second state area within the partial state, see AggNode::partialInit()
+static const ULONG PARTIAL_AREA_OFFSET = FB_ALIGN(sizeof(impure_value_ex), FB_ALIGNMENT);
+
+// Value accumulated by the partial state. The state could be copied since it was
+// computed, so the descriptor is pointed to the copy.
+static dsc getPartialValue(const UCHAR* state)
+{
+	const impure_value_ex* const partial = reinterpret_cast<const impure_value_ex*>(state);
+
+	dsc desc = partial->vlu_desc;
+	desc.dsc_address = (UCHAR*) &partial->vlu_misc;
+	return desc;
+}
+
+
 static RegisterNode<AggNode> regAggNode({blr_agg_function});
 
 AggNode::Factory* AggNode::factories = NULL;
@@ -445,6 +460,31 @@ void AggNode::aggFinish(thread_db* /*tdbb*/, Request* request) const
 	}
 }
 
+bool AggNode::getStateAreas(thread_db* /*tdbb*/, CompilerScratch* /*csb*/, Array<StateArea>& areas)
+{
+	// DISTINCT values are collected by the sort
+	if (distinct)
+		return false;
+
+	areas.add({impureOffset, sizeof(impure_value_ex)});
+	return true;
+}
+
+void AggNode::partialInit(thread_db* /*tdbb*/, UCHAR* state) const
+{
+	memset(state, 0, sizeof(impure_value_ex));
+}
+
+void AggNode::partialPass(thread_db* /*tdbb*/, UCHAR* /*state*/, const dsc* /*desc*/) const
+{
+	fb_assert(false);
+}
+
+void AggNode::aggCombine(thread_db* /*tdbb*/, Request* /*request*/, const UCHAR* /*state*/) const
+{
+	fb_assert(false);
+}
+
 dsc* AggNode::execute(thread_db* tdbb, Request* request) const
 {
 	impure_value_ex* impure = request->getImpure<impure_value_ex>(impureOffset);
@@ -689,8 +729,59 @@ void AvgAggNode::aggInit(thread_db* tdbb, Request* request) const
 {
 	AggNode::aggInit(tdbb, request);
 
+	initValue(request->getImpure<impure_value_ex>(impureOffset));
+}
+
+void AvgAggNode::aggPass(thread_db* tdbb, Request* request, dsc* desc) const
+{
+	passValue(tdbb, request->getImpure<impure_value_ex>(impureOffset),
+		request->getImpure<impure_value_ex>(tempImpure), desc);
+}
+
+void AvgAggNode::partialInit(thread_db* tdbb, UCHAR* state) const
+{
+	AggNode::partialInit(tdbb, state);
+
+	memset(state + PARTIAL_AREA_OFFSET, 0, sizeof(impure_value_ex));
+	initValue(reinterpret_cast<impure_value_ex*>(state));
+}
+
+void AvgAggNode::partialPass(thread_db* tdbb, UCHAR* state, const dsc* desc) const
+{
+	passValue(tdbb, reinterpret_cast<impure_value_ex*>(state),
+		reinterpret_cast<impure_value_ex*>(state + PARTIAL_AREA_OFFSET), desc);
+}
+
+void AvgAggNode::aggCombine(thread_db* tdbb, Request* request, const UCHAR* state) const
+{
+	const impure_value_ex* const partial = reinterpret_cast<const impure_value_ex*>(state);
+
+	if (!partial->vlux_count)
+		return;
+
 	impure_value_ex* impure = request->getImpure<impure_value_ex>(impureOffset);
 
+	if (impure->vlux_count == 0)	// first partial state
+	{
+		const impure_value_ex* const partialTemp =
+			reinterpret_cast<const impure_value_ex*>(state + PARTIAL_AREA_OFFSET);
+
+		impure_value_ex* impureTemp = request->getImpure<impure_value_ex>(tempImpure);
+		impureTemp->vlu_desc = partialTemp->vlu_desc;
+	}
+
+	impure->vlux_count += partial->vlux_count;
+
+	const dsc desc = getPartialValue(state);
+
+	if (dialect1)
+		ArithmeticNode::add(tdbb, &desc, impure, this, blr_add);
+	else
+		ArithmeticNode::add2(tdbb, &desc, impure, this, blr_add);
+}
+
+void AvgAggNode::initValue(impure_value_ex* impure) const
+{
 	if (dialect1)
 	{
 		impure->vlu_desc.makeDouble(&impure->vlu_misc.vlu_double);
@@ -704,12 +795,11 @@ void AvgAggNode::aggInit(thread_db* tdbb, Request* request) const
 	}
 }
 
-void AvgAggNode::aggPass(thread_db* tdbb, Request* request, dsc* desc) const
+void AvgAggNode::passValue(thread_db* tdbb, impure_value_ex* impure, impure_value_ex* impureTemp,
+	const dsc* desc) const
 {
-	impure_value_ex* impure = request->getImpure<impure_value_ex>(impureOffset);
 	if (impure->vlux_count++ == 0)		// first call to aggPass()
 	{
-		impure_value_ex* impureTemp = request->getImpure<impure_value_ex>(tempImpure);
 		impureTemp->vlu_desc = *desc;
 		outputDesc(&impureTemp->vlu_desc);
 	}
@@ -781,6 +871,15 @@ dsc* AvgAggNode::aggExecute(thread_db* tdbb, Request* request) const
 	return &impureTemp->vlu_desc;
 }
 
+bool AvgAggNode::getStateAreas(thread_db* tdbb, CompilerScratch* csb, Array<StateArea>& areas)
+{
+	if (!AggNode::getStateAreas(tdbb, csb, areas))
+		return false;
+
+	areas.add({tempImpure, sizeof(impure_value_ex)});
+	return true;
+}
+
 AggNode* AvgAggNode::dsqlCopy(DsqlCompilerScratch* dsqlScratch) /*const*/
 {
 	return FB_NEW_POOL(dsqlScratch->getPool()) AvgAggNode(dsqlScratch->getPool(), distinct, dialect1,
@@ -916,6 +1015,12 @@ dsc* ListAggNode::aggExecute(thread_db* tdbb, Request* request) const
 	return &impure->vlu_desc;
 }
 
+bool ListAggNode::getStateAreas(thread_db* /*tdbb*/, CompilerScratch* /*csb*/, Array<StateArea>& /*areas*/)
+{
+	// The list is accumulated in a blob
+	return false;
+}
+
 AggNode* ListAggNode::dsqlCopy(DsqlCompilerScratch* dsqlScratch) /*const*/
 {
 	thread_db* tdbb = JRD_get_thread_data();
@@ -1018,6 +1123,35 @@ void CountAggNode::aggPass(thread_db* /*tdbb*/, Request* request, dsc* /*desc*/)
 		++impure->vlu_misc.vlu_int64;
 }
 
+void CountAggNode::partialInit(thread_db* tdbb, UCHAR* state) const
+{
+	AggNode::partialInit(tdbb, state);
+
+	impure_value_ex* impure = reinterpret_cast<impure_value_ex*>(state);
+	impure->make_int64(0);
+}
+
+void CountAggNode::partialPass(thread_db* /*tdbb*/, UCHAR* state, const dsc* /*desc*/) const
+{
+	impure_value_ex* impure = reinterpret_cast<impure_value_ex*>(state);
+
+	if (dialect1)
+		++impure->vlu_misc.vlu_long;
+	else
+		++impure->vlu_misc.vlu_int64;
+}
+
+void CountAggNode::aggCombine(thread_db* /*tdbb*/, Request* request, const UCHAR* state) const
+{
+	impure_value_ex* impure = request->getImpure<impure_value_ex>(impureOffset);
+	const impure_value_ex* const partial = reinterpret_cast<const impure_value_ex*>(state);
+
+	if (dialect1)
+		impure->vlu_misc.vlu_long += partial->vlu_misc.vlu_long;
+	else
+		impure->vlu_misc.vlu_int64 += partial->vlu_misc.vlu_int64;
+}
+
 dsc* CountAggNode::aggExecute(thread_db* /*tdbb*/, Request* request) const
 {
 	impure_value_ex* impure = request->getImpure<impure_value_ex>(impureOffset);
@@ -1257,8 +1391,46 @@ void SumAggNode::aggInit(thread_db* tdbb, Request* request) const
 {
 	AggNode::aggInit(tdbb, request);
 
+	initValue(request->getImpure<impure_value_ex>(impureOffset));
+}
+
+void SumAggNode::aggPass(thread_db* tdbb, Request* request, dsc* desc) const
+{
+	passValue(tdbb, request->getImpure<impure_value_ex>(impureOffset), desc);
+}
+
+void SumAggNode::partialInit(thread_db* tdbb, UCHAR* state) const
+{
+	AggNode::partialInit(tdbb, state);
+
+	initValue(reinterpret_cast<impure_value_ex*>(state));
+}
+
+void SumAggNode::partialPass(thread_db* tdbb, UCHAR* state, const dsc* desc) const
+{
+	passValue(tdbb, reinterpret_cast<impure_value_ex*>(state), desc);
+}
+
+void SumAggNode::aggCombine(thread_db* tdbb, Request* request, const UCHAR* state) const
+{
+	const impure_value_ex* const partial = reinterpret_cast<const impure_value_ex*>(state);
+
+	if (!partial->vlux_count)
+		return;
+
 	impure_value_ex* impure = request->getImpure<impure_value_ex>(impureOffset);
+	impure->vlux_count += partial->vlux_count;
+
+	const dsc desc = getPartialValue(state);
 
+	if (dialect1)
+		ArithmeticNode::add(tdbb, &desc, impure, this, blr_add);
+	else
+		ArithmeticNode::add2(tdbb, &desc, impure, this, blr_add);
+}
+
+void SumAggNode::initValue(impure_value_ex* impure) const
+{
 	if (dialect1)
 		impure->make_long(0);
 	else
@@ -1269,9 +1441,8 @@ void SumAggNode::aggInit(thread_db* tdbb, Request* request) const
 	}
 }
 
-void SumAggNode::aggPass(thread_db* tdbb, Request* request, dsc* desc) const
+void SumAggNode::passValue(thread_db* tdbb, impure_value_ex* impure, const dsc* desc) const
 {
-	impure_value_ex* impure = request->getImpure<impure_value_ex>(impureOffset);
 	++impure->vlux_count;
 
 	if (dialect1)
@@ -1358,6 +1529,33 @@ void MaxMinAggNode::aggPass(thread_db* tdbb, Request* request, dsc* desc) const
 	impure_value_ex* impure = request->getImpure<impure_value_ex>(impureOffset);
 	++impure->vlux_count;
 
+	passValue(tdbb, impure, desc);
+}
+
+void MaxMinAggNode::partialPass(thread_db* tdbb, UCHAR* state, const dsc* desc) const
+{
+	impure_value_ex* impure = reinterpret_cast<impure_value_ex*>(state);
+	++impure->vlux_count;
+
+	passValue(tdbb, impure, desc);
+}
+
+void MaxMinAggNode::aggCombine(thread_db* tdbb, Request* request, const UCHAR* state) const
+{
+	const impure_value_ex* const partial = reinterpret_cast<const impure_value_ex*>(state);
+
+	if (!partial->vlux_count)
+		return;
+
+	impure_value_ex* impure = request->getImpure<impure_value_ex>(impureOffset);
+	impure->vlux_count += partial->vlux_count;
+
+	const dsc desc = getPartialValue(state);
+	passValue(tdbb, impure, &desc);
+}
+
+void MaxMinAggNode::passValue(thread_db* tdbb, impure_value_ex* impure, const dsc* desc) const
+{
 	if (!impure->vlu_desc.dsc_dtype)
 	{
 		EVL_make_value(tdbb, desc, impure);
@@ -1380,6 +1578,18 @@ dsc* MaxMinAggNode::aggExecute(thread_db* /*tdbb*/, Request* request) const
 	return &impure->vlu_desc;
 }
 
+bool MaxMinAggNode::getStateAreas(thread_db* tdbb, CompilerScratch* csb, Array<StateArea>& areas)
+{
+	// Strings are kept outside of the impure area
+	dsc desc;
+	getDesc(tdbb, csb, &desc);
+
+	if (desc.isText() || desc.isDbKey() || desc.isBlob())
+		return false;
+
+	return AggNode::getStateAreas(tdbb, csb, areas);
+}
+
 AggNode* MaxMinAggNode::dsqlCopy(DsqlCompilerScratch* dsqlScratch) /*const*/
 {
 	return FB_NEW_POOL(dsqlScratch->getPool()) MaxMinAggNode(dsqlScratch->getPool(),
@@ -1476,9 +1686,59 @@ void StdDevAggNode::aggInit(thread_db* tdbb, Request* request) const
 {
 	AggNode::aggInit(tdbb, request);
 
+	initValue(request->getImpure<impure_value_ex>(impureOffset),
+		request->getImpure<StdDevImpure>(impure2Offset));
+}
+
+void StdDevAggNode::aggPass(thread_db* tdbb, Request* request, dsc* desc) const
+{
+	passValue(tdbb, request->getImpure<impure_value_ex>(impureOffset),
+		request->getImpure<StdDevImpure>(impure2Offset), desc);
+}
+
+void StdDevAggNode::partialInit(thread_db* tdbb, UCHAR* state) const
+{
+	AggNode::partialInit(tdbb, state);
+
+	initValue(reinterpret_cast<impure_value_ex*>(state),
+		reinterpret_cast<StdDevImpure*>(state + PARTIAL_AREA_OFFSET));
+}
+
+void StdDevAggNode::partialPass(thread_db* tdbb, UCHAR* state, const dsc* desc) const
+{
+	passValue(tdbb, reinterpret_cast<impure_value_ex*>(state),
+		reinterpret_cast<StdDevImpure*>(state + PARTIAL_AREA_OFFSET), desc);
+}
+
+void StdDevAggNode::aggCombine(thread_db* tdbb, Request* request, const UCHAR* state) const
+{
+	const impure_value_ex* const partial = reinterpret_cast<const impure_value_ex*>(state);
+	const StdDevImpure* const partial2 =
+		reinterpret_cast<const StdDevImpure*>(state + PARTIAL_AREA_OFFSET);
+
 	impure_value_ex* impure = request->getImpure<impure_value_ex>(impureOffset);
+	impure->vlux_count += partial->vlux_count;
+
 	StdDevImpure* impure2 = request->getImpure<StdDevImpure>(impure2Offset);
 
+	// Sums of the values and of their squares are simply added up
+
+	if (nodFlags & FLAG_DECFLOAT)
+	{
+		DecimalStatus decSt = tdbb->getAttachment()->att_dec_status;
+
+		impure2->dec.x = impure2->dec.x.add(decSt, partial2->dec.x);
+		impure2->dec.x2 = impure2->dec.x2.add(decSt, partial2->dec.x2);
+	}
+	else
+	{
+		impure2->dbl.x += partial2->dbl.x;
+		impure2->dbl.x2 += partial2->dbl.x2;
+	}
+}
+
+void StdDevAggNode::initValue(impure_value_ex* impure, StdDevImpure* impure2) const
+{
 	if (nodFlags & FLAG_DECFLOAT)
 	{
 		impure->make_decimal128(CDecimal128(0));
@@ -1491,12 +1751,11 @@ void StdDevAggNode::aggInit(thread_db* tdbb, Request* request) const
 	}
 }
 
-void StdDevAggNode::aggPass(thread_db* tdbb, Request* request, dsc* desc) const
+void StdDevAggNode::passValue(thread_db* tdbb, impure_value_ex* impure, StdDevImpure* impure2,
+	const dsc* desc) const
 {
-	impure_value_ex* impure = request->getImpure<impure_value_ex>(impureOffset);
 	++impure->vlux_count;
 
-	StdDevImpure* impure2 = request->getImpure<StdDevImpure>(impure2Offset);
 	if (nodFlags & FLAG_DECFLOAT)
 	{
 		DecimalStatus decSt = tdbb->getAttachment()->att_dec_status;
@@ -1589,6 +1848,15 @@ dsc* StdDevAggNode::aggExecute(thread_db* tdbb, Request* request) const
 	return &impure->vlu_desc;
 }
 
+bool StdDevAggNode::getStateAreas(thread_db* tdbb, CompilerScratch* csb, Array<StateArea>& areas)
+{
+	if (!AggNode::getStateAreas(tdbb, csb, areas))
+		return false;
+
+	areas.add({impure2Offset, sizeof(StdDevImpure)});
+	return true;
+}
+
 AggNode* StdDevAggNode::dsqlCopy(DsqlCompilerScratch* dsqlScratch) /*const*/
 {
 	return FB_NEW_POOL(dsqlScratch->getPool()) StdDevAggNode(dsqlScratch->getPool(),
@@ -1850,6 +2118,15 @@ dsc* CorrAggNode::aggExecute(thread_db* tdbb, Request* request) const
 	return &impure->vlu_desc;
 }
 
+bool CorrAggNode::getStateAreas(thread_db* tdbb, CompilerScratch* csb, Array<StateArea>& areas)
+{
+	if (!AggNode::getStateAreas(tdbb, csb, areas))
+		return false;
+
+	areas.add({impure2Offset, sizeof(CorrImpure)});
+	return true;
+}
+
 AggNode* CorrAggNode::dsqlCopy(DsqlCompilerScratch* dsqlScratch) /*const*/
 {
 	return FB_NEW_POOL(dsqlScratch->getPool()) CorrAggNode(dsqlScratch->getPool(), type,
@@ -2174,6 +2451,15 @@ dsc* RegrAggNode::aggExecute(thread_db* tdbb, Request* request) const
 	return &impure->vlu_desc;
 }
 
+bool RegrAggNode::getStateAreas(thread_db* tdbb, CompilerScratch* csb, Array<StateArea>& areas)
+{
+	if (!AggNode::getStateAreas(tdbb, csb, areas))
+		return false;
+
+	areas.add({impure2Offset, sizeof(RegrImpure)});
+	return true;
+}
+
 AggNode* RegrAggNode::dsqlCopy(DsqlCompilerScratch* dsqlScratch) /*const*/
 {
 	return FB_NEW_POOL(dsqlScratch->getPool()) RegrAggNode(dsqlScratch->getPool(), type,
@@ -56,11 +56,24 @@ public:
 	virtual void aggInit(thread_db* tdbb, Request* request) const;
 	virtual void aggPass(thread_db* tdbb, Request* request, dsc* desc) const;
 	virtual dsc* aggExecute(thread_db* tdbb, Request* request) const;
+	virtual bool getStateAreas(thread_db* tdbb, CompilerScratch* csb, Firebird::Array<StateArea>& areas);
+
+	virtual bool canCombine() const
+	{
+		return !distinct;
+	}
+
+	virtual void partialInit(thread_db* tdbb, UCHAR* state) const;
+	virtual void partialPass(thread_db* tdbb, UCHAR* state, const dsc* desc) const;
+	virtual void aggCombine(thread_db* tdbb, Request* request, const UCHAR* state) const;
 
 protected:
 	virtual AggNode* dsqlCopy(DsqlCompilerScratch* dsqlScratch) /*const*/;
 
 private:
+	void initValue(impure_value_ex* impure) const;
+	void passValue(thread_db* tdbb, impure_value_ex* impure, impure_value_ex* impureTemp,
+		const dsc* desc) const;
 	void outputDesc(dsc* desc) const;
 	ULONG tempImpure;
 };
@@ -94,6 +107,7 @@ public:
 	virtual void aggInit(thread_db* tdbb, Request* request) const;
 	virtual void aggPass(thread_db* tdbb, Request* request, dsc* desc) const;
 	virtual dsc* aggExecute(thread_db* tdbb, Request* request) const;
+	virtual bool getStateAreas(thread_db* tdbb, CompilerScratch* csb, Firebird::Array<StateArea>& areas);
 
 protected:
 	virtual AggNode* dsqlCopy(DsqlCompilerScratch* dsqlScratch) /*const*/;
@@ -124,6 +138,15 @@ public:
 	virtual void aggPass(thread_db* tdbb, Request* request, dsc* desc) const;
 	virtual dsc* aggExecute(thread_db* tdbb, Request* request) const;
 
+	virtual bool canCombine() const
+	{
+		return !distinct;
+	}
+
+	virtual void partialInit(thread_db* tdbb, UCHAR* state) const;
+	virtual void partialPass(thread_db* tdbb, UCHAR* state, const dsc* desc) const;
+	virtual void aggCombine(thread_db* tdbb, Request* request, const UCHAR* state) const;
+
 protected:
 	virtual AggNode* dsqlCopy(DsqlCompilerScratch* dsqlScratch) /*const*/;
 };
@@ -154,8 +177,21 @@ public:
 	virtual void aggPass(thread_db* tdbb, Request* request, dsc* desc) const;
 	virtual dsc* aggExecute(thread_db* tdbb, Request* request) const;
 
+	virtual bool canCombine() const
+	{
+		return !distinct;
+	}
+
+	virtual void partialInit(thread_db* tdbb, UCHAR* state) const;
+	virtual void partialPass(thread_db* tdbb, UCHAR* state, const dsc* desc) const;
+	virtual void aggCombine(thread_db* tdbb, Request* request, const UCHAR* state) const;
+
 protected:
 	virtual AggNode* dsqlCopy(DsqlCompilerScratch* dsqlScratch) /*const*/;
+
+private:
+	void initValue(impure_value_ex* impure) const;
+	void passValue(thread_db* tdbb, impure_value_ex* impure, const dsc* desc) const;
 };
 
 class MaxMinAggNode final : public AggNode
@@ -184,12 +220,24 @@ public:
 	virtual void aggInit(thread_db* tdbb, Request* request) const;
 	virtual void aggPass(thread_db* tdbb, Request* request, dsc* desc) const;
 	virtual dsc* aggExecute(thread_db* tdbb, Request* request) const;
+	virtual bool getStateAreas(thread_db* tdbb, CompilerScratch* csb, Firebird::Array<StateArea>& areas);
+
+	virtual bool canCombine() const
+	{
+		return !distinct;
+	}
+
+	virtual void partialPass(thread_db* tdbb, UCHAR* state, const dsc* desc) const;
+	virtual void aggCombine(thread_db* tdbb, Request* request, const UCHAR* state) const;
 
 protected:
 	virtual AggNode* dsqlCopy(DsqlCompilerScratch* dsqlScratch) /*const*/;
 
 public:
 	const MaxMinType type;
+
+private:
+	void passValue(thread_db* tdbb, impure_value_ex* impure, const dsc* desc) const;
 };
 
 class StdDevAggNode final : public AggNode
@@ -233,6 +281,16 @@ public:
 	virtual void aggInit(thread_db* tdbb, Request* request) const;
 	virtual void aggPass(thread_db* tdbb, Request* request, dsc* desc) const;
 	virtual dsc* aggExecute(thread_db* tdbb, Request* request) const;
+	virtual bool getStateAreas(thread_db* tdbb, CompilerScratch* csb, Firebird::Array<StateArea>& areas);
+
+	virtual bool canCombine() const
+	{
+		return !distinct;
+	}
+
+	virtual void partialInit(thread_db* tdbb, UCHAR* state) const;
+	virtual void partialPass(thread_db* tdbb, UCHAR* state, const dsc* desc) const;
+	virtual void aggCombine(thread_db* tdbb, Request* request, const UCHAR* state) const;
 
 protected:
 	virtual AggNode* dsqlCopy(DsqlCompilerScratch* dsqlScratch) /*const*/;
@@ -241,6 +299,10 @@ public:
 	const StdDevType type;
 
 private:
+	void initValue(impure_value_ex* impure, StdDevImpure* impure2) const;
+	void passValue(thread_db* tdbb, impure_value_ex* impure, StdDevImpure* impure2,
+		const dsc* desc) const;
+
 	ULONG impure2Offset;
 };
 
@@ -292,6 +354,7 @@ public:
 	virtual bool aggPass(thread_db* tdbb, Request* request) const;
 	virtual void aggPass(thread_db* tdbb, Request* request, dsc* desc) const;
 	virtual dsc* aggExecute(thread_db* tdbb, Request* request) const;
+	virtual bool getStateAreas(thread_db* tdbb, CompilerScratch* csb, Firebird::Array<StateArea>& areas);
 
 protected:
 	virtual AggNode* dsqlCopy(DsqlCompilerScratch* dsqlScratch) /*const*/;
@@ -357,6 +420,7 @@ public:
 	virtual bool aggPass(thread_db* tdbb, Request* request) const;
 	virtual void aggPass(thread_db* tdbb, Request* request, dsc* desc) const;
 	virtual dsc* aggExecute(thread_db* tdbb, Request* request) const;
+	virtual bool getStateAreas(thread_db* tdbb, CompilerScratch* csb, Firebird::Array<StateArea>& areas);
 
 protected:
 	virtual AggNode* dsqlCopy(DsqlCompilerScratch* dsqlScratch) /*const*/;
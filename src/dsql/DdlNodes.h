@@ -1121,6 +1121,7 @@ public:
 
 	static SSHORT store(thread_db* tdbb, jrd_tra* transaction, const MetaName& name,
 		fb_sysflag sysFlag, SINT64 value, SLONG step);
+	static void modifyCache(thread_db* tdbb, jrd_tra* transaction, SLONG id, SLONG cache);
 
 public:
 	virtual Firebird::string internalPrint(NodePrinter& printer) const;
@@ -1149,6 +1150,7 @@ public:
 	const MetaName name;
 	BaseNullable<SINT64> value;
 	Nullable<SLONG> step;
+	Nullable<SLONG> cache;	// 0 - NO CACHE
 };
 
 
@@ -1311,7 +1313,8 @@ public:
 			TYPE_DROP_COLUMN,
 			TYPE_DROP_CONSTRAINT,
 			TYPE_ALTER_SQL_SECURITY,
-			TYPE_ALTER_PUBLICATION
+			TYPE_ALTER_PUBLICATION,
+			TYPE_ALTER_EXTENT_SIZE
 		};
 
 		explicit Clause(MemoryPool& p, Type aType)
@@ -1389,6 +1392,7 @@ public:
 		Nullable<IdentityType> type;
 		Nullable<SINT64> startValue;
 		Nullable<SLONG> increment;
+		Nullable<SLONG> cache;
 		bool restart;	// used in ALTER
 	};
 
@@ -1508,6 +1512,8 @@ public:
 		const MetaName& tableName, const MetaName& pubTame);
 	static void dropFromPublication(thread_db* tdbb, jrd_tra* transaction,
 		const MetaName& tableName, const MetaName& pubTame);
+	static void modifyExtentSize(thread_db* tdbb, jrd_tra* transaction,
+		const MetaName& tableName, USHORT extentSize);
 
 protected:
 	virtual Firebird::string internalPrint(NodePrinter& printer) const
@@ -1553,6 +1559,7 @@ public:
 	Firebird::Array<NestConst<Clause> > clauses;
 	Nullable<bool> ssDefiner;
 	Nullable<bool> replicationState;
+	Nullable<USHORT> extentSize;	// 0 - drop relation-specific extent size
 };
 
 
@@ -36,6 +36,7 @@
 #include "../jrd/recsrc/RecordSource.h"
 #include "../jrd/recsrc/Cursor.h"
 #include "../jrd/optimizer/Optimizer.h"
+#include "../jrd/SequenceCache.h"
 #include "../jrd/recsrc/Cursor.h"
 #include "../jrd/blb_proto.h"
 #include "../jrd/cmp_proto.h"
@@ -5016,7 +5017,7 @@ ValueExprNode* DefaultNode::createFromField(thread_db* tdbb, CompilerScratch* cs
 			csb->csb_pool, (csb->blrVersion == 4), fld->fld_generator_name, NULL, true, true);
 
 		bool sysGen = false;
-		if (!MET_load_generator(tdbb, genNode->generator, &sysGen, &genNode->step))
+		if (!MET_load_generator(tdbb, genNode->generator, &sysGen, &genNode->step, &genNode->cache))
 			status_exception::raise(Arg::Gds(isc_gennotdef) << Arg::Str(fld->fld_generator_name));
 
 		if (sysGen)
@@ -7012,6 +7013,7 @@ GenIdNode::GenIdNode(MemoryPool& pool, bool aDialect1,
 	  generator(pool, name),
 	  arg(aArg),
 	  step(0),
+	  cache(0),
 	  dialect1(aDialect1),
 	  sysGen(false),
 	  implicit(aImplicit),
@@ -7038,7 +7040,7 @@ DmlNode* GenIdNode::parse(thread_db* tdbb, MemoryPool& pool, CompilerScratch* cs
 
 		node->generator.id = 0;
 	}
-	else if (!MET_load_generator(tdbb, node->generator, &node->sysGen, &node->step))
+	else if (!MET_load_generator(tdbb, node->generator, &node->sysGen, &node->step, &node->cache))
 		PAR_error(csb, Arg::Gds(isc_gennotdef) << Arg::Str(name));
 
 	if (csb->collectingDependencies())
@@ -7059,6 +7061,7 @@ string GenIdNode::internalPrint(NodePrinter& printer) const
 	NODE_PRINT(printer, generator);
 	NODE_PRINT(printer, arg);
 	NODE_PRINT(printer, step);
+	NODE_PRINT(printer, cache);
 	NODE_PRINT(printer, sysGen);
 	NODE_PRINT(printer, implicit);
 	NODE_PRINT(printer, identity);
@@ -7072,6 +7075,7 @@ ValueExprNode* GenIdNode::dsqlPass(DsqlCompilerScratch* dsqlScratch)
 		dialect1, generator.name, doDsqlPass(dsqlScratch, arg), implicit, identity);
 	node->generator = generator;
 	node->step = step;
+	node->cache = cache;
 	node->sysGen = sysGen;
 	return node;
 }
@@ -7212,7 +7216,11 @@ dsc* GenIdNode::execute(thread_db* tdbb, Request* request) const
 			status_exception::raise(Arg::Gds(isc_cant_modify_sysobj) << "generator" << generator.name);
 	}
 
-	const SINT64 new_val = DPM_gen_id(tdbb, generator.id, false, change);
+	// NEXT VALUE FOR of the sequence with CACHE serves values reserved in advance,
+	// GEN_ID() always works with the generator page
+	const SINT64 new_val = (implicit && cache > 1) ?
+		tdbb->getDatabase()->dbb_sequence_cache->nextValue(tdbb, generator.id, step, cache) :
+		DPM_gen_id(tdbb, generator.id, false, change);
 
 	if (dialect1)
 		impure->make_long((SLONG) new_val);
@@ -889,6 +889,7 @@ public:
 	GeneratorItem generator;
 	NestConst<ValueExprNode> arg;
 	SLONG step;
+	SLONG cache;
 	const bool dialect1;
 
 private:
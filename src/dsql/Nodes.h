@@ -1014,6 +1014,14 @@ public:
 		RegisterNode<T> registerNode;
 	};
 
+public:
+	// Part of the impure space keeping the aggregation state
+	struct StateArea
+	{
+		ULONG offset;
+		ULONG length;
+	};
+
 public:
 	explicit AggNode(MemoryPool& pool, const AggInfo& aAggInfo, bool aDistinct, bool aDialect1,
 		ValueExprNode* aArg = NULL);
@@ -1082,6 +1090,23 @@ public:
 	virtual void aggPass(thread_db* tdbb, Request* request, dsc* desc) const = 0;
 	virtual dsc* aggExecute(thread_db* tdbb, Request* request) const = 0;
 
+	// Impure areas keeping the aggregation state between aggPass calls. They're
+	// saved and restored by copying when many groups are aggregated at once, so
+	// false is returned if the state refers to sorts, blobs or strings.
+	virtual bool getStateAreas(thread_db* tdbb, CompilerScratch* csb, Firebird::Array<StateArea>& areas);
+
+	// Two-phase aggregation. The partial state has the layout of the state areas put one
+	// after another, each aligned to FB_ALIGNMENT. It's accumulated by partialPass calls
+	// outside of the request and then merged into the request state by aggCombine.
+	virtual bool canCombine() const
+	{
+		return false;
+	}
+
+	virtual void partialInit(thread_db* tdbb, UCHAR* state) const;
+	virtual void partialPass(thread_db* tdbb, UCHAR* state, const dsc* desc) const;
+	virtual void aggCombine(thread_db* tdbb, Request* request, const UCHAR* state) const;
+
 	virtual AggNode* dsqlPass(DsqlCompilerScratch* dsqlScratch);
 
 protected:
@@ -1120,6 +1145,12 @@ public:
 	{
 		return NULL;
 	}
+
+	virtual bool getStateAreas(thread_db* /*tdbb*/, CompilerScratch* /*csb*/,
+		Firebird::Array<StateArea>& /*areas*/)
+	{
+		return false;
+	}
 };
 
 
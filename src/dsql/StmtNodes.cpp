@@ -8324,6 +8324,7 @@ SelectNode* SelectNode::dsqlPass(DsqlCompilerScratch* dsqlScratch)
 	SelectNode* node = FB_NEW_POOL(dsqlScratch->getPool()) SelectNode(dsqlScratch->getPool());
 	node->dsqlForUpdate = dsqlForUpdate;
 	node->dsqlOptimizeForFirstRows = dsqlOptimizeForFirstRows;
+	node->dsqlParallelWorkers = dsqlParallelWorkers;
 
 	const DsqlContextStack::iterator base(*dsqlScratch->context);
 	node->dsqlRse = PASS1_rse(dsqlScratch, dsqlExpr, this);
@@ -1346,6 +1346,7 @@ public:
 	bool dsqlWithLock = false;
 	bool dsqlSkipLocked = false;
 	TriState dsqlOptimizeForFirstRows;
+	USHORT dsqlParallelWorkers = 0;
 };
 
 
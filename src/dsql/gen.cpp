@@ -611,6 +611,12 @@ void GEN_rse(DsqlCompilerScratch* dsqlScratch, RseNode* rse)
 		dsqlScratch->appendUChar(rse->firstRows.value);
 	}
 
+	if (rse->parallelWorkers)
+	{
+		dsqlScratch->appendUChar(blr_parallel);
+		dsqlScratch->appendUShort(rse->parallelWorkers);
+	}
+
 	dsqlScratch->appendUChar(blr_end);
 }
 
@@ -698,6 +698,9 @@ using namespace Firebird;
 %token <metaNamePtr> UNICODE_CHAR
 %token <metaNamePtr> UNICODE_VAL
 %token <metaNamePtr> RDB_RESET_CONTEXT
+%token <metaNamePtr> EXTENT
+%token <metaNamePtr> CACHE
+%token <metaNamePtr> PARALLEL
 
 // precedence declarations for expression evaluation
 
@@ -1818,6 +1821,7 @@ create_sequence_options($seqNode)
 create_seq_option($seqNode)
 	: start_with_opt($seqNode)
 	| step_option($seqNode)
+	| cache_option($seqNode)
 	;
 
 %type start_with_opt(<createAlterSequenceNode>)
@@ -1835,6 +1839,25 @@ step_option($seqNode)
 		{ setClause($seqNode->step, "INCREMENT BY", $3); }
 	;
 
+%type cache_option(<createAlterSequenceNode>)
+cache_option($seqNode)
+	: sequence_cache_clause
+		{ setClause($seqNode->cache, "CACHE", $1); }
+	;
+
+%type <int32Val> sequence_cache_clause
+sequence_cache_clause
+	: CACHE long_integer
+		{
+			if ($2 == 0)
+				yyabandon(YYPOSNARG(2), -842, isc_expec_positive);	// Positive number expected
+
+			$$ = $2;
+		}
+	| NO CACHE
+		{ $$ = 0; }
+	;
+
 by_noise
 	: // nothing
 	| BY
@@ -1850,7 +1873,7 @@ replace_sequence_clause
 	  replace_sequence_options($2)
 		{
 			// Remove this to implement CORE-5137
-			if (!$2->restartSpecified && !$2->step.specified)
+			if (!$2->restartSpecified && !$2->step.specified && !$2->cache.specified)
 				yyerrorIncompleteCmd(YYPOSNARG(3));
 			$$ = $2;
 		}
@@ -1870,6 +1893,7 @@ replace_seq_option($seqNode)
 		}
 	| start_with_opt($seqNode)
 	| step_option($seqNode)
+	| cache_option($seqNode)
 	;
 
 %type <createAlterSequenceNode> alter_sequence_clause
@@ -1883,7 +1907,8 @@ alter_sequence_clause
 		}
 	  alter_sequence_options($2)
 		{
-			if (!$2->restartSpecified && !$2->value.specified && !$2->step.specified)
+			if (!$2->restartSpecified && !$2->value.specified && !$2->step.specified &&
+				!$2->cache.specified)
 				yyerrorIncompleteCmd(YYPOSNARG(3));
 			$$ = $2;
 		}
@@ -1898,6 +1923,7 @@ alter_sequence_options($seqNode)
 alter_seq_option($seqNode)
 	: restart_option($seqNode)
 	| step_option($seqNode)
+	| cache_option($seqNode)
 	;
 
 
@@ -2251,6 +2277,8 @@ table_attribute($relationNode)
 		{ setClause($relationNode->ssDefiner, "SQL SECURITY", $1); }
 	| publication_state
 		{ setClause($relationNode->replicationState, "PUBLICATION", $1); }
+	| extent_size_clause
+		{ setClause($relationNode->extentSize, "EXTENT SIZE", (USHORT) $1); }
 	;
 
 %type <boolVal> sql_security_clause
@@ -2271,6 +2299,11 @@ publication_state
 	| DISABLE PUBLICATION		{ $$ = false; }
 	;
 
+%type <int32Val> extent_size_clause
+extent_size_clause
+	: EXTENT SIZE pos_short_integer		{ $$ = $3; }
+	;
+
 %type <createRelationNode> gtt_table_clause
 gtt_table_clause
 	: simple_table_name
@@ -2406,6 +2439,8 @@ identity_clause_option($identityOptions)
 		{ setClause($identityOptions->startValue, "START WITH", $3); }
 	| INCREMENT by_noise signed_long_integer
 		{ setClause($identityOptions->increment, "INCREMENT BY", $3); }
+	| sequence_cache_clause
+		{ setClause($identityOptions->cache, "CACHE", $1); }
 	;
 
 // value does allow parens around it, but there is a problem getting the source text.
@@ -4232,6 +4267,20 @@ alter_op($relationNode)
 				newNode<RelationNode::Clause>(RelationNode::Clause::TYPE_ALTER_PUBLICATION);
 			$relationNode->clauses.add(clause);
 		}
+	| SET extent_size_clause
+		{
+			setClause($relationNode->extentSize, "EXTENT SIZE", (USHORT) $2);
+			RelationNode::Clause* clause =
+				newNode<RelationNode::Clause>(RelationNode::Clause::TYPE_ALTER_EXTENT_SIZE);
+			$relationNode->clauses.add(clause);
+		}
+	| DROP EXTENT SIZE
+		{
+			setClause($relationNode->extentSize, "EXTENT SIZE", (USHORT) 0);
+			RelationNode::Clause* clause =
+				newNode<RelationNode::Clause>(RelationNode::Clause::TYPE_ALTER_EXTENT_SIZE);
+			$relationNode->clauses.add(clause);
+		}
 	;
 
 %type <metaNamePtr> alter_column_name
@@ -4388,6 +4437,8 @@ alter_identity_clause_option($identityOptions)
 		}
 	| SET INCREMENT by_noise signed_long_integer
 		{ setClause($identityOptions->increment, "SET INCREMENT BY", $4); }
+	| SET sequence_cache_clause
+		{ setClause($identityOptions->cache, "SET CACHE", $2); }
 	;
 
 %type <boolVal> drop_behaviour
@@ -5779,7 +5830,7 @@ ddl_desc
 
 %type <selectNode> select
 select
-	: select_expr for_update_clause lock_clause optimize_clause
+	: select_expr for_update_clause lock_clause optimize_clause parallel_clause
 		{
 			SelectNode* node = newNode<SelectNode>();
 			node->dsqlExpr = $1;
@@ -5787,6 +5838,7 @@ select
 			node->dsqlWithLock = $3.first;
 			node->dsqlSkipLocked = $3.second;
 			node->dsqlOptimizeForFirstRows = $4;
+			node->dsqlParallelWorkers = $5;
 			$$ = node;
 		}
 	;
@@ -5831,6 +5883,14 @@ optimize_mode
 		{ $$ = false; }
 	;
 
+%type <int32Val> parallel_clause
+parallel_clause
+	: // nothing
+		{ $$ = 0; }
+	| PARALLEL pos_short_integer
+		{ $$ = $2; }
+	;
+
 
 // SELECT expression
 
@@ -9228,6 +9288,9 @@ non_reserved_word
 	| TIMEZONE_NAME
 	| UNICODE_CHAR
 	| UNICODE_VAL
+	| EXTENT
+	| CACHE
+	| PARALLEL
 	;
 
 %%
@@ -593,7 +593,10 @@ RseNode* PASS1_rse(DsqlCompilerScratch* dsqlScratch,
 	dsqlScratch->scopeLevel--;
 
 	if (select)
+	{
 		node->firstRows = select->dsqlOptimizeForFirstRows;
+		node->parallelWorkers = select->dsqlParallelWorkers;
+	}
 
 	return node;
 }
@@ -81,7 +81,13 @@ struct PerformanceInfo
 		FETCHES = 0,
 		READS,
 		MARKS,
-		WRITES
+		WRITES,
+		PREFETCHES,
+		PREFETCH_WASTED,
+		HOT_HITS,
+		COLD_HITS,
+		PROMOTIONS,
+		WRITE_CALLS
 	};
 
 	ISC_INT64 pin_time;				// Total operation time in milliseconds
@@ -466,4 +466,6 @@
 
 #define blr_skip_locked				(unsigned char) 223
 
+#define blr_parallel				(unsigned char) 224
+
 #endif // FIREBIRD_IMPL_BLR_H
@@ -62,3 +62,4 @@ FB_IMPL_MSG_NO_SYMBOL(GSTAT, 61, "    Expected page inventory page @1")
 FB_IMPL_MSG_NO_SYMBOL(GSTAT, 62, "Generator pages: total @1, encrypted @2, non-crypted @3")
 FB_IMPL_MSG_NO_SYMBOL(GSTAT, 63, "    Table size: @1 bytes")
 FB_IMPL_MSG_NO_SYMBOL(GSTAT, 64, "        Level @1: @2, total length: @3, blob pages: @4")
+FB_IMPL_MSG_NO_SYMBOL(GSTAT, 65, "    Data page runs: @1, average run length: @2, fragmentation: @3")
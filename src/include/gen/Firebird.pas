@@ -5765,6 +5765,7 @@ const
 	 isc_sweep_attach_no_cleanup = 335545311;
 	 isc_no_user_att_while_restore = 335545318;
 	 isc_update_overwrite = 335545325;
+	 isc_bad_extent_size = 335545326;
 	 isc_gfix_db_name = 335740929;
 	 isc_gfix_invalid_sw = 335740930;
 	 isc_gfix_incmp_sw = 335740932;
@@ -307,6 +307,12 @@ public:
 		return cryptThread.isCurrent();
 	}
 
+	// Database is not encrypted and encryption is not in progress
+	bool isPlain() const
+	{
+		return !crypt && !process;
+	}
+
 private:
 	enum IoResult {SUCCESS_ALL, FAILED_CRYPT, FAILED_IO};
 	IoResult internalRead(thread_db* tdbb, FbStatusVector* sv, Ods::pag* page, IOCallback* io);
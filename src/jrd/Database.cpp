@@ -38,6 +38,7 @@
 #include "../jrd/tpc_proto.h"
 #include "../jrd/lck_proto.h"
 #include "../jrd/CryptoManager.h"
+#include "../jrd/SequenceCache.h"
 #include "../jrd/os/pio_proto.h"
 #include "../common/os/os_utils.h"
 //#include "../dsql/Parser.h"
@@ -178,6 +179,7 @@ namespace Jrd
 		delete dbb_monitoring_data;
 		delete dbb_backup_manager;
 		delete dbb_crypto_manager;
+		delete dbb_sequence_cache;
 	}
 
 	void Database::deletePool(MemoryPool* pool)
@@ -91,6 +91,7 @@ class MonitoringData;
 class GarbageCollector;
 class CryptoManager;
 class KeywordsMap;
+class SequenceCache;
 
 // general purpose vector
 template <class T, BlockType TYPE = type_vec>
@@ -454,6 +455,11 @@ public:
 	Lock*		dbb_shadow_lock;		// lock for synchronizing addition of shadows
 
 	Lock*		dbb_retaining_lock;		// lock for preserving commit retaining snapshot
+
+	Firebird::SyncObject	dbb_tra_start_sync;	// serializes allocation of transaction numbers
+	Lock*		dbb_tra_start_lock;		// the same among processes
+	TraNumber	dbb_reserved_transaction;	// last transaction number reserved on header page
+
 	PageManager dbb_page_manager;
 	BlobFilter*	dbb_blob_filters;		// known blob filters
 
@@ -483,10 +489,8 @@ public:
 	USHORT dbb_max_records;				// max record per data page
 	USHORT dbb_max_idx;					// max number of indexes on a root page
 
-#ifdef SUPERSERVER_V2
 	USHORT dbb_prefetch_sequence;		// sequence to pace frequency of prefetch requests
 	USHORT dbb_prefetch_pages;			// prefetch pages per request
-#endif
 
 	Firebird::PathName dbb_filename;	// filename string
 	Firebird::PathName dbb_database_name;	// database visible name (file name or alias)
@@ -533,6 +537,7 @@ public:
 	Firebird::RefPtr<const Firebird::Config> dbb_config;
 
 	CryptoManager* dbb_crypto_manager;
+	SequenceCache* dbb_sequence_cache;	// cached values of sequences
 	Firebird::RefPtr<ExistenceRefMutex> dbb_init_fini;
 	Firebird::XThreadMutex dbb_thread_mutex;		// special threads start/stop mutex
 	Firebird::RefPtr<Linger> dbb_linger_timer;
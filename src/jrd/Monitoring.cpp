@@ -1021,6 +1021,25 @@ void Monitoring::putDatabase(thread_db* tdbb, SnapshotData::DumpRecord& record)
 
 	record.storeInteger(f_mon_db_repl_mode, dbb->dbb_replica_mode);
 
+	// reload of saved page cache contents
+	BufferControl* const bcb = dbb->dbb_bcb;
+	if (bcb && bcb->bcb_load_total)
+	{
+		record.storeInteger(f_mon_db_cache_load_pages, bcb->bcb_load_total);
+		record.storeInteger(f_mon_db_cache_loaded_pages, bcb->bcb_load_done);
+	}
+
+	// group commit
+	if (bcb && bcb->bcb_commit_groups)
+	{
+		MutexLockGuard guard(bcb->bcb_commit_mutex, FB_FUNCTION);
+
+		record.storeInteger(f_mon_db_group_commits, bcb->bcb_commit_groups);
+		record.storeInteger(f_mon_db_group_commit_trans, bcb->bcb_commit_count);
+		record.storeInteger(f_mon_db_group_commit_max, bcb->bcb_commit_max_batch);
+		record.storeInteger(f_mon_db_group_commit_time, bcb->bcb_commit_latency.load());
+	}
+
 	// statistics
 	const int stat_id = fb_utils::genUniqueId();
 	record.storeGlobalId(f_mon_db_stat_id, getGlobalId(stat_id));
@@ -1409,6 +1428,10 @@ void Monitoring::putStatistics(SnapshotData::DumpRecord& record, const RuntimeSt
 	record.storeInteger(f_mon_io_page_writes, statistics.getValue(RuntimeStatistics::PAGE_WRITES));
 	record.storeInteger(f_mon_io_page_fetches, statistics.getValue(RuntimeStatistics::PAGE_FETCHES));
 	record.storeInteger(f_mon_io_page_marks, statistics.getValue(RuntimeStatistics::PAGE_MARKS));
+	record.storeInteger(f_mon_io_page_hot_hits, statistics.getValue(RuntimeStatistics::PAGE_HOT_HITS));
+	record.storeInteger(f_mon_io_page_cold_hits, statistics.getValue(RuntimeStatistics::PAGE_COLD_HITS));
+	record.storeInteger(f_mon_io_page_promotions, statistics.getValue(RuntimeStatistics::PAGE_PROMOTIONS));
+	record.storeInteger(f_mon_io_page_write_calls, statistics.getValue(RuntimeStatistics::PAGE_WRITE_CALLS));
 	record.write();
 
 	// logical I/O statistics (global)
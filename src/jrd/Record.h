@@ -26,6 +26,7 @@
 #include "../common/classes/array.h"
 #include "../jrd/pag.h"
 #include "../jrd/val.h"
+#include "../jrd/sqz.h"
 
 namespace Jrd
 {
@@ -35,14 +36,16 @@ namespace Jrd
 
 	public:
 		Record(MemoryPool& p, const Format* format, const bool temp_active = false)
-			: m_precedence(p), m_data(p), m_fake_nulls(false), m_temp_active(temp_active)
+			: m_precedence(p), m_data(p), m_packed(p), m_packed_offset(0), m_unpacked(0),
+			  m_fake_nulls(false), m_temp_active(temp_active)
 		{
 			m_data.resize(format->fmt_length);
 			m_format = format;
 		}
 
 		Record(MemoryPool& p, const Record* other)
-			: m_precedence(p), m_data(p, other->m_data),
+			: m_precedence(p), m_data(p, other->m_data), m_packed(p, other->m_packed),
+			  m_packed_offset(other->m_packed_offset), m_unpacked(other->m_unpacked),
 			  m_format(other->m_format), m_fake_nulls(other->m_fake_nulls), m_temp_active(false)
 		{}
 
@@ -54,6 +57,7 @@ namespace Jrd
 				m_format = format;
 			}
 
+			m_packed.clear();
 			m_fake_nulls = false;
 		}
 
@@ -74,13 +78,14 @@ namespace Jrd
 			if (m_fake_nulls)
 				return true;
 
-			return ((getData()[id >> 3] & (1 << (id & 7))) != 0);
+			return ((getData((id >> 3) + 1)[id >> 3] & (1 << (id & 7))) != 0);
 		}
 
 		void nullify()
 		{
 			// Zero the record buffer and initialize all fields to NULLs
 			const size_t null_bytes = (m_format->fmt_count + 7) >> 3;
+			m_packed.clear();
 			memset(getData(), 0xFF, null_bytes);
 			memset(getData() + null_bytes, 0, getLength() - null_bytes);
 
@@ -112,10 +117,14 @@ namespace Jrd
 				fb_assert(getLength() == other->getLength());
 
 			m_data.assign(other->m_data);
+			m_packed.assign(other->m_packed);
+			m_packed_offset = other->m_packed_offset;
+			m_unpacked = other->m_unpacked;
 		}
 
 		void copyDataFrom(const UCHAR* data)
 		{
+			m_packed.clear();
 			memcpy(getData(), data, getLength());
 		}
 
@@ -146,14 +155,39 @@ namespace Jrd
 
 		UCHAR* getData()
 		{
+			unpack(getLength());
 			return m_data.begin();
 		}
 
 		const UCHAR* getData() const
 		{
+			unpack(getLength());
 			return m_data.begin();
 		}
 
+		// Data valid at least up to the given length, the rest may still be packed
+
+		UCHAR* getData(ULONG length)
+		{
+			unpack(length);
+			return m_data.begin();
+		}
+
+		const UCHAR* getData(ULONG length) const
+		{
+			unpack(length);
+			return m_data.begin();
+		}
+
+		// Keep the packed image of the record, it's decoded on demand
+
+		void setPacked(ULONG length, const UCHAR* data)
+		{
+			m_packed.assign(data, length);
+			m_packed_offset = 0;
+			m_unpacked = 0;
+		}
+
 		bool isTempActive() const
 		{
 			return m_temp_active;
@@ -175,8 +209,23 @@ namespace Jrd
 		}
 
 	private:
+		void unpack(ULONG length) const
+		{
+			if (m_packed.hasData() && m_unpacked < length)
+			{
+				Compressor::unpack(m_packed.getCount(), m_packed.begin(), getLength(), m_data.begin(),
+					length, m_packed_offset, m_unpacked);
+
+				if (m_unpacked >= getLength())
+					m_packed.clear();
+			}
+		}
+
 		PageStack m_precedence;			// stack of higher precedence pages/transactions
-		Firebird::Array<UCHAR> m_data;	// space for record data
+		mutable Firebird::Array<UCHAR> m_data;	// space for record data
+		mutable Firebird::Array<UCHAR> m_packed;	// packed image of the data not decoded yet
+		mutable ULONG m_packed_offset;	// where the packed image is to be decoded from
+		mutable ULONG m_unpacked;		// length of the data decoded so far
 		const Format* m_format;			// what the data looks like
 		TraNumber m_transaction_nr;		// transaction number for a record
 		bool m_fake_nulls;				// all fields simulate being NULLs
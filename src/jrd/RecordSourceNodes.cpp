@@ -1836,12 +1836,63 @@ RecordSource* AggregateSourceNode::compile(thread_db* tdbb, Optimizer* opt, bool
 		rse->firstRows = true;
 	}
 
+	// Groups may be aggregated by hashing if the state of every aggregate can be
+	// copied aside, the optimizer decides whether the sort is avoided this way
+
+	Array<AggNode::StateArea> stateAreas(*tdbb->getDefaultPool());
+	rse->flags &= ~RseNode::FLAG_HASH_GROUPING;
+
+	if (group && !rse->rse_aggregate && !keepOrder)
+	{
+		bool hashable = true;
+
+		for (auto& source : map->sourceList)
+		{
+			const auto aggSource = nodeAs<AggNode>(source);
+
+			if (aggSource && !aggSource->getStateAreas(tdbb, csb, stateAreas))
+			{
+				hashable = false;
+				break;
+			}
+		}
+
+		if (hashable)
+			rse->flags |= RseNode::FLAG_HASH_GROUPING;
+	}
+
 	RecordSource* const nextRsb = opt->compile(rse, &deliverStack);
 
+	// Parallel scan of a single table may aggregate the records by itself,
+	// then its partial groups are combined instead of aggregating the records
+
+	ParallelTableScan* partialScan = nullptr;
+
+	if ((!group || (rse->flags & RseNode::FLAG_HASH_GROUPING)) && !rse->rse_aggregate)
+	{
+		partialScan = nextRsb->getPartialSource(nullptr);
+
+		if (partialScan && !partialScan->setAggregation(tdbb, csb,
+				group ? &group->expressions : nullptr, map))
+		{
+			partialScan = nullptr;
+		}
+	}
+
 	// allocate and optimize the record source block
 
-	AggregatedStream* const rsb = FB_NEW_POOL(*tdbb->getDefaultPool()) AggregatedStream(tdbb, csb,
-		stream, (group ? &group->expressions : NULL), map, nextRsb);
+	RecordSource* rsb;
+
+	if (rse->flags & RseNode::FLAG_HASH_GROUPING)
+	{
+		rsb = FB_NEW_POOL(*tdbb->getDefaultPool()) HashAggregatedStream(tdbb, csb,
+			stream, &group->expressions, map, nextRsb, stateAreas, partialScan);
+	}
+	else
+	{
+		rsb = FB_NEW_POOL(*tdbb->getDefaultPool()) AggregatedStream(tdbb, csb,
+			stream, (group ? &group->expressions : NULL), map, nextRsb, partialScan);
+	}
 
 	if (rse->rse_aggregate)
 	{
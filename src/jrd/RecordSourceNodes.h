@@ -538,7 +538,8 @@ public:
 		  group(NULL),
 		  map(NULL),
 		  rse(NULL),
-		  dsqlWindow(false)
+		  dsqlWindow(false),
+		  keepOrder(false)
 	{
 	}
 
@@ -588,6 +589,7 @@ private:
 
 public:
 	bool dsqlWindow;
+	bool keepOrder;		// parent relies on the groups being sorted
 };
 
 class UnionSourceNode final : public TypedNode<RecordSourceNode, RecordSourceNode::TYPE_UNION>
@@ -732,7 +734,8 @@ public:
 		FLAG_LATERAL			= 0x20,	// lateral derived table
 		FLAG_SKIP_LOCKED		= 0x40,	// skip locked
 		FLAG_SUB_QUERY			= 0x80,	// sub-query
-		FLAG_SPECIAL_JOIN		= 0x100	// special join (semi/anti)
+		FLAG_SPECIAL_JOIN		= 0x100,	// special join (semi/anti)
+		FLAG_HASH_GROUPING		= 0x200	// grouping may be done by hashing instead of sorting
 	};
 
 	bool isInvariant() const
@@ -831,6 +834,7 @@ public:
 		obj->flags = flags;
 		obj->rse_relations = rse_relations;
 		obj->firstRows = firstRows;
+		obj->parallelWorkers = parallelWorkers;
 
 		return obj;
 	}
@@ -917,6 +921,7 @@ public:
 	USHORT flags = 0;
 	USHORT rse_jointype = blr_inner;	// inner, left, full
 	TriState firstRows;					// optimize for first rows
+	USHORT parallelWorkers = 0;			// workers for table scans, 0 - not specified
 };
 
 class SelectExprNode final : public TypedNode<RecordSourceNode, RecordSourceNode::TYPE_SELECT_EXPR>
@@ -0,0 +1,470 @@
+/*
+ *	PROGRAM:	JRD Access Method
+ *	MODULE:		RedoLog.cpp
+ *	DESCRIPTION:	Redo log of committed page images
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.ibphoenix.com/main.nfs?a=ibphoenix&page=ibp_idpl.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by the Firebird Project
+ *  for the Firebird Open Source RDBMS project.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ *
+ */
+
+#include "firebird.h"
+#include "../common/classes/Hash.h"
+#include "../common/os/os_utils.h"
+#include "../jrd/jrd.h"
+#include "../jrd/cch.h"
+#include "../jrd/nbak.h"
+#include "../jrd/ods.h"
+#include "../jrd/CryptoManager.h"
+#include "../jrd/RedoLog.h"
+#include "../jrd/err_proto.h"
+#include "../jrd/os/pio_proto.h"
+#include "../yvalve/gds_proto.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef WIN_NT
+#include <io.h>
+#endif
+
+#include <fcntl.h>
+
+#ifndef O_BINARY
+#define O_BINARY	0
+#endif
+
+using namespace Firebird;
+using namespace Jrd;
+
+namespace
+{
+	const char REDO_SIGNATURE[8] = {'F', 'B', 'R', 'E', 'D', 'O', '0', '1'};
+	const ULONG BATCH_MAGIC = 0x4F444552;	// "REDO"
+
+	// Log starts with the header, followed by batches of page images. Every
+	// batch is written by single call and is ignored by recovery if not
+	// written completely.
+
+	struct FileHeader
+	{
+		char signature[sizeof(REDO_SIGNATURE)];
+		ULONG pageSize;
+		ULONG reserved;
+		ISC_TIMESTAMP creationDate;		// of database, identifies database the log belongs to
+	};
+
+	struct BatchHeader
+	{
+		ULONG magic;
+		ULONG count;		// number of page images
+		ULONG length;		// length of images including entries
+		ULONG checksum;		// of images including entries
+	};
+
+	// The latest image of page found by recovery
+	struct LatestImage
+	{
+		ULONG page;
+		FB_UINT64 sequence;
+		FB_UINT64 offset;
+
+		static const ULONG& generate(const LatestImage& item)
+		{
+			return item.page;
+		}
+	};
+
+	void flushFile(int handle)
+	{
+#ifdef WIN_NT
+		FlushFileBuffers((HANDLE) _get_osfhandle(handle));
+#else
+		fsync(handle);
+#endif
+	}
+
+	void raiseIOError(const char* syscall, const PathName& filename, ISC_STATUS operation)
+	{
+		(Arg::Gds(isc_io_error) << Arg::Str(syscall) << Arg::Str(filename) <<
+			Arg::Gds(operation) << SYS_ERR(ERRNO)).raise();
+	}
+
+	bool readFile(int handle, FB_UINT64 offset, void* buffer, ULONG length)
+	{
+		return os_utils::lseek(handle, offset, SEEK_SET) == (SINT64) offset &&
+			::read(handle, buffer, length) == (int) length;
+	}
+
+	bool writeFile(int handle, FB_UINT64 offset, const void* buffer, ULONG length)
+	{
+		return os_utils::lseek(handle, offset, SEEK_SET) == (SINT64) offset &&
+			::write(handle, buffer, length) == (int) length;
+	}
+}
+
+
+RedoLog::RedoLog(MemoryPool& pool, Database* dbb)
+	: m_database(dbb),
+	  m_fileName(pool, getFileName(dbb)),
+	  m_handle(-1),
+	  m_sequence(0),
+	  m_pages(pool),
+	  m_length(0),
+	  m_limit(0),
+	  m_active(0),
+	  m_checkpoint(false)
+{
+}
+
+RedoLog::~RedoLog()
+{
+	if (m_handle >= 0)
+		::close(m_handle);
+}
+
+PathName RedoLog::getFileName(const Database* dbb)
+{
+	return dbb->dbb_filename + ".redo";
+}
+
+// Open new empty log. Log left by previous run is processed by recover() already.
+void RedoLog::open(thread_db* tdbb)
+{
+	fb_assert(m_handle < 0);
+
+	m_handle = os_utils::open(m_fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY);
+	if (m_handle < 0)
+		raiseIOError("open", m_fileName, isc_io_create_err);
+
+	FileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.signature, REDO_SIGNATURE, sizeof(REDO_SIGNATURE));
+	header.pageSize = m_database->dbb_page_size;
+	header.creationDate = m_database->dbb_creation_date.utc_timestamp;
+
+	if (!writeFile(m_handle, 0, &header, sizeof(header)))
+		raiseIOError("write", m_fileName, isc_io_write_err);
+
+	flushFile(m_handle);
+
+	m_length = sizeof(header);
+	m_limit = (FB_UINT64) m_database->dbb_config->getRedoLogSize() * 1024 * 1024;
+}
+
+// Close the log at database shutdown, empty log is removed
+void RedoLog::close(thread_db* tdbb)
+{
+	MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+	if (m_handle < 0)
+		return;
+
+	::close(m_handle);
+	m_handle = -1;
+
+	if (m_length <= sizeof(FileHeader))
+		unlink(m_fileName.c_str());
+}
+
+bool RedoLog::enter(thread_db* tdbb)
+{
+	Database* const dbb = m_database;
+
+	CheckoutLockGuard guard(tdbb, m_mutex, FB_FUNCTION, true);
+
+	while (m_checkpoint)
+	{
+		EngineCheckout cout(tdbb, FB_FUNCTION, EngineCheckout::UNNECESSARY);
+		m_cond.wait(m_mutex);
+	}
+
+	// Log is replayed into main database file only, thus it's not used when
+	// writes go elsewhere too. Images are not encrypted, thus it's not used
+	// with encrypted database.
+
+	if (m_handle < 0 || dbb->dbb_shadow ||
+		dbb->dbb_backup_manager->getState() != Ods::hdr_nbak_normal ||
+		dbb->dbb_backup_manager->databaseFlushInProgress() ||
+		!dbb->dbb_crypto_manager->isPlain())
+	{
+		return false;
+	}
+
+	m_active++;
+	return true;
+}
+
+void RedoLog::leave()
+{
+	MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+	fb_assert(m_active);
+	if (!--m_active && m_checkpoint)
+		m_cond.notifyAll();
+}
+
+void RedoLog::registerPage(ULONG page)
+{
+	MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+	FB_SIZE_T pos;
+	if (!m_pages.find(page, pos))
+		m_pages.insert(pos, page);
+}
+
+bool RedoLog::isRegistered(ULONG page)
+{
+	MutexLockGuard guard(m_mutex, FB_FUNCTION);
+	return m_pages.exist(page);
+}
+
+void RedoLog::getRegistered(Array<ULONG>& pages)
+{
+	MutexLockGuard guard(m_mutex, FB_FUNCTION);
+	pages.assign(m_pages);
+}
+
+// Append batch of page images and flush the log to disk. Every record is
+// Entry followed by page image.
+void RedoLog::append(thread_db* tdbb, const UCHAR* records, ULONG length, ULONG count)
+{
+	fb_assert(length == count * (sizeof(Entry) + m_database->dbb_page_size));
+
+	BatchHeader header;
+	header.magic = BATCH_MAGIC;
+	header.count = count;
+	header.length = length;
+	header.checksum = InternalHash::hash(length, records);
+
+	EngineCheckout cout(tdbb, FB_FUNCTION, EngineCheckout::UNNECESSARY);
+	MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+	if (m_handle < 0)
+		raiseIOError("write", m_fileName, isc_io_write_err);
+
+	if (!writeFile(m_handle, m_length, &header, sizeof(header)) ||
+		::write(m_handle, records, length) != (int) length)
+	{
+		raiseIOError("write", m_fileName, isc_io_write_err);
+	}
+
+	flushFile(m_handle);
+
+	m_length += sizeof(header) + length;
+}
+
+// Wait for committers to finish their batches and stop new ones
+void RedoLog::beginCheckpoint(thread_db* tdbb)
+{
+	CheckoutLockGuard guard(tdbb, m_mutex, FB_FUNCTION, true);
+
+	while (m_checkpoint)
+	{
+		EngineCheckout cout(tdbb, FB_FUNCTION, EngineCheckout::UNNECESSARY);
+		m_cond.wait(m_mutex);
+	}
+
+	m_checkpoint = true;
+
+	while (m_active)
+	{
+		EngineCheckout cout(tdbb, FB_FUNCTION, EngineCheckout::UNNECESSARY);
+		m_cond.wait(m_mutex);
+	}
+}
+
+// Finish checkpoint, if all registered pages are written to database then the log is emptied
+void RedoLog::endCheckpoint(thread_db* tdbb, bool done)
+{
+	MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+	fb_assert(m_checkpoint);
+	m_checkpoint = false;
+	m_cond.notifyAll();
+
+	if (done && m_handle >= 0)
+		truncate();
+}
+
+void RedoLog::truncate()
+{
+#ifdef WIN_NT
+	LARGE_INTEGER newSize;
+	newSize.QuadPart = (ULONGLONG) sizeof(FileHeader);
+
+	const auto hndl = (HANDLE) _get_osfhandle(m_handle);
+	const auto ret = SetFilePointer(hndl, newSize.LowPart, &newSize.HighPart, FILE_BEGIN);
+	if (ret == INVALID_SET_FILE_POINTER || !SetEndOfFile(hndl))
+#else
+	if (os_utils::ftruncate(m_handle, sizeof(FileHeader)))
+#endif
+		raiseIOError("truncate", m_fileName, isc_io_write_err);
+
+	flushFile(m_handle);
+
+	m_pages.clear();
+	m_length = sizeof(FileHeader);
+}
+
+// Copy the latest logged images of pages back into database. Called at
+// database startup when database files are opened but no page is cached yet.
+void RedoLog::recover(thread_db* tdbb)
+{
+	Database* const dbb = tdbb->getDatabase();
+	const PathName fileName = getFileName(dbb);
+
+	const int handle = os_utils::open(fileName.c_str(), O_RDONLY | O_BINARY);
+	if (handle < 0)
+		return;
+
+	class AutoClose
+	{
+	public:
+		explicit AutoClose(int handle)
+			: m_handle(handle)
+		{ }
+
+		~AutoClose()
+		{
+			close();
+		}
+
+		void close()
+		{
+			if (m_handle >= 0)
+				::close(m_handle);
+			m_handle = -1;
+		}
+
+	private:
+		int m_handle;
+	} autoClose(handle);
+
+	const ULONG pageSize = dbb->dbb_page_size;
+
+	// Make sure the log belongs to this database
+
+	const ULONG ioBlockSize = dbb->getIOBlockSize();
+	const ULONG headerSize = MAX(RAW_HEADER_SIZE, ioBlockSize);
+
+	HalfStaticArray<UCHAR, RAW_HEADER_SIZE + PAGE_ALIGNMENT> temp;
+	UCHAR* const temp_page = temp.getAlignedBuffer(headerSize, ioBlockSize);
+
+	PIO_header(tdbb, temp_page, headerSize);
+	const Ods::header_page* const dbHeader = (Ods::header_page*) temp_page;
+
+	FileHeader header;
+	if (!readFile(handle, 0, &header, sizeof(header)) ||
+		memcmp(header.signature, REDO_SIGNATURE, sizeof(REDO_SIGNATURE)) ||
+		header.pageSize != pageSize ||
+		memcmp(&header.creationDate, dbHeader->hdr_creation_date, sizeof(header.creationDate)))
+	{
+		gds__log("Database: %s\n\tRedo log %s does not belong to database, ignored",
+			dbb->dbb_filename.c_str(), fileName.c_str());
+		return;
+	}
+
+	// Find the latest image of every page in batches written completely
+
+	const ULONG recordSize = sizeof(Entry) + pageSize;
+	SortedArray<LatestImage, EmptyStorage<LatestImage>, ULONG, LatestImage> latest;
+	Array<UCHAR> batch;
+	FB_UINT64 offset = sizeof(header);
+
+	while (true)
+	{
+		BatchHeader batchHeader;
+
+		if (!readFile(handle, offset, &batchHeader, sizeof(batchHeader)) ||
+			batchHeader.magic != BATCH_MAGIC ||
+			batchHeader.length != batchHeader.count * recordSize)
+		{
+			break;
+		}
+
+		UCHAR* const records = batch.getBuffer(batchHeader.length);
+
+		if (::read(handle, records, batchHeader.length) != (int) batchHeader.length ||
+			InternalHash::hash(batchHeader.length, records) != batchHeader.checksum)
+		{
+			break;
+		}
+
+		offset += sizeof(batchHeader);
+
+		for (ULONG i = 0; i < batchHeader.count; i++, offset += recordSize)
+		{
+			const Entry* const entry = (const Entry*) (records + i * recordSize);
+
+			LatestImage image;
+			image.page = entry->page;
+			image.sequence = entry->sequence;
+			image.offset = offset + sizeof(Entry);
+
+			FB_SIZE_T pos;
+			if (!latest.find(image.page, pos))
+				latest.insert(pos, image);
+			else if (image.sequence > latest[pos].sequence)
+				latest[pos] = image;
+		}
+	}
+
+	// Write images into database
+
+	if (latest.hasData())
+	{
+		PageSpace* const pageSpace = dbb->dbb_page_manager.findPageSpace(DB_PAGE_SPACE);
+		fb_assert(pageSpace);
+
+		Array<UCHAR> buffer;
+		Ods::pag* const page = (Ods::pag*) buffer.getAlignedBuffer(pageSize, ioBlockSize);
+
+		for (const auto& image : latest)
+		{
+			if (!readFile(handle, image.offset, page, pageSize))
+				raiseIOError("read", fileName, isc_io_read_err);
+
+			// page number is stamped by write_page(), image may be taken before
+			page->pag_pageno = image.page;
+
+			// fool PIO_write into writing the image into the correct place
+			BufferDesc temp_bdb(dbb->dbb_bcb);
+			temp_bdb.bdb_page = PageNumber(DB_PAGE_SPACE, image.page);
+			temp_bdb.bdb_buffer = page;
+
+			PIO_write(tdbb, pageSpace->file, &temp_bdb, page, NULL);
+		}
+
+		PIO_flush(tdbb, pageSpace->file);
+
+		gds__log("Database: %s\n\t%u page(s) restored from redo log %s",
+			dbb->dbb_filename.c_str(), (unsigned) latest.getCount(), fileName.c_str());
+	}
+
+	// Images are in database now, don't replay them again if the log is not
+	// used by next run
+
+	autoClose.close();
+
+	if (unlink(fileName.c_str()))
+		raiseIOError("unlink", fileName, isc_io_delete_err);
+}
@@ -0,0 +1,118 @@
+/*
+ *	PROGRAM:	JRD Access Method
+ *	MODULE:		RedoLog.h
+ *	DESCRIPTION:	Redo log of committed page images
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.ibphoenix.com/main.nfs?a=ibphoenix&page=ibp_idpl.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by the Firebird Project
+ *  for the Firebird Open Source RDBMS project.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ *
+ */
+
+#ifndef JRD_REDO_LOG_H
+#define JRD_REDO_LOG_H
+
+#include "../common/classes/alloc.h"
+#include "../common/classes/array.h"
+#include "../common/classes/condition.h"
+#include "../common/classes/fb_string.h"
+#include "../common/classes/locks.h"
+#include <atomic>
+
+namespace Jrd {
+
+class thread_db;
+class Database;
+
+// RedoLog -- sequential log of page images, see RedoLog setting in firebird.conf.
+//
+// On commit, images of the pages modified by transaction are appended to the
+// log and the log alone is flushed to disk. Pages themselves are written later
+// by cache writers and by checkpoint, which truncates the log when all pages
+// are written. After crash the latest image of every logged page is copied back
+// into the database before the database is used.
+//
+// The rule which makes it safe: once page is registered in the log, it's never
+// written to the database before its current image is in the log, see
+// write_page() in cch.cpp. Thus the latest logged image is never older than
+// the page on disk. Images of the same page are taken under its shared page
+// latch, so no writer changes the page meanwhile, and numbered in order they
+// are taken.
+
+class RedoLog
+{
+public:
+	// Describes page image in the log, image follows the entry
+	struct Entry
+	{
+		FB_UINT64 sequence;
+		ULONG page;
+		ULONG reserved;
+	};
+
+	RedoLog(Firebird::MemoryPool& pool, Database* dbb);
+	~RedoLog();
+
+	static Firebird::PathName getFileName(const Database* dbb);
+	static void recover(thread_db* tdbb);
+
+	void open(thread_db* tdbb);
+	void close(thread_db* tdbb);
+
+	// Committers call enter() before and leave() after logging their pages,
+	// enter() returns false if page images can't be logged now
+	bool enter(thread_db* tdbb);
+	void leave();
+
+	void registerPage(ULONG page);
+	bool isRegistered(ULONG page);
+	void getRegistered(Firebird::Array<ULONG>& pages);
+
+	FB_UINT64 nextSequence()
+	{
+		return ++m_sequence;
+	}
+
+	void append(thread_db* tdbb, const UCHAR* records, ULONG length, ULONG count);
+
+	bool needCheckpoint() const
+	{
+		return m_length >= m_limit && !m_checkpoint;
+	}
+
+	void beginCheckpoint(thread_db* tdbb);
+	void endCheckpoint(thread_db* tdbb, bool done);
+
+private:
+	void truncate();
+
+	Database* const m_database;
+	const Firebird::PathName m_fileName;
+	int m_handle;
+	std::atomic<FB_UINT64> m_sequence;		// numbers page images
+
+	Firebird::Mutex m_mutex;				// protects all below
+	Firebird::Condition m_cond;				// signalled by leave() and endCheckpoint()
+	Firebird::SortedArray<ULONG> m_pages;	// registered pages
+	FB_UINT64 m_length;						// current log length
+	FB_UINT64 m_limit;						// log length to start checkpoint
+	ULONG m_active;							// committers between enter() and leave()
+	bool m_checkpoint;						// checkpoint is in progress
+};
+
+} // namespace Jrd
+
+#endif // JRD_REDO_LOG_H
@@ -263,6 +263,7 @@ public:
 	prim		rel_primary_dpnds;		// foreign dependencies on this relation's primary key
 	frgn		rel_foreign_refs;		// foreign references to other relations' primary keys
 	Nullable<bool>	rel_ss_definer;
+	USHORT		rel_extent_size;		// pages per data page extent, 0 - default
 
 	TriState	rel_repl_state;			// replication state
 
@@ -408,7 +409,7 @@ inline jrd_rel::jrd_rel(MemoryPool& p)
 	: rel_pool(&p), rel_flags(REL_gc_lockneed),
 	  rel_name(p), rel_owner_name(p), rel_security_name(p),
 	  rel_view_contexts(p), rel_gc_records(p), rel_ss_definer(false),
-	  rel_pages_base(p)
+	  rel_extent_size(0), rel_pages_base(p)
 {
 }
 
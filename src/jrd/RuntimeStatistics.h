@@ -57,6 +57,12 @@ public:
 		PAGE_READS,
 		PAGE_MARKS,
 		PAGE_WRITES,
+		PAGE_PREFETCHES,
+		PAGE_PREFETCH_WASTED,
+		PAGE_HOT_HITS,
+		PAGE_COLD_HITS,
+		PAGE_PROMOTIONS,
+		PAGE_WRITE_CALLS,
 		RECORD_FIRST_ITEM,
 		RECORD_SEQ_READS = RECORD_FIRST_ITEM,
 		RECORD_IDX_READS,
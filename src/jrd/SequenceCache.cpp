@@ -0,0 +1,177 @@
+/*
+ *	PROGRAM:	JRD Access Method
+ *	MODULE:		SequenceCache.cpp
+ *	DESCRIPTION:	Cache of sequence values reserved by blocks
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.ibphoenix.com/main.nfs?a=ibphoenix&page=ibp_idpl.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by the Firebird Project
+ *  for the Firebird Open Source RDBMS project.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ *
+ */
+
+#include "firebird.h"
+#include "../jrd/jrd.h"
+#include "../jrd/lck.h"
+#include "../jrd/tra.h"
+#include "../jrd/SequenceCache.h"
+#include "../jrd/dpm_proto.h"
+#include "../jrd/lck_proto.h"
+
+using namespace Firebird;
+using namespace Jrd;
+
+
+SequenceCache::SequenceCache(Database* dbb)
+	: m_dbb(dbb),
+	  m_blocks(*dbb->dbb_permanent)
+{
+}
+
+SequenceCache::~SequenceCache()
+{
+	for (Block** iter = m_blocks.begin(); iter != m_blocks.end(); ++iter)
+	{
+		if (*iter)
+		{
+			delete (*iter)->lock;
+			delete *iter;
+		}
+	}
+}
+
+SINT64 SequenceCache::nextValue(thread_db* tdbb, SLONG id, SLONG step, SLONG cache)
+{
+	fb_assert(step && cache > 1);
+
+	// Sequence created or reset by the current transaction keeps its value
+	// in the transaction until commit, let DPM_gen_id() deal with it
+
+	jrd_tra* const transaction = tdbb->getTransaction();
+	SINT64 value;
+
+	if (transaction && transaction->tra_gen_ids && transaction->tra_gen_ids->get(id, value))
+		return DPM_gen_id(tdbb, id, false, step);
+
+	Block* const block = getBlock(tdbb, id);
+	MutexLockGuard guard(block->mutex, FB_FUNCTION);
+
+	if (!block->left || block->step != step)
+	{
+		// The lock must be held before the block is reserved, otherwise
+		// we could miss the invalidation
+
+		if (block->lock->lck_logical == LCK_none)
+			LCK_lock(tdbb, block->lock, LCK_SR, LCK_WAIT);
+
+		const SINT64 last = DPM_gen_id(tdbb, id, false, (SINT64) step * cache);
+
+		block->next = last - (SINT64) step * (cache - 1);
+		block->step = step;
+		block->left = cache;
+	}
+
+	value = block->next;
+	block->next += step;
+	block->left--;
+
+	return value;
+}
+
+void SequenceCache::invalidate(thread_db* tdbb, SLONG id)
+{
+	Block* const block = getBlock(tdbb, id);
+	MutexLockGuard guard(block->mutex, FB_FUNCTION);
+
+	block->left = 0;
+
+	// Signal other processes to discard their values
+
+	if (block->lock->lck_logical == LCK_none)
+		LCK_lock(tdbb, block->lock, LCK_EX, LCK_WAIT);
+	else
+		LCK_convert(tdbb, block->lock, LCK_EX, LCK_WAIT);
+
+	LCK_release(tdbb, block->lock);
+}
+
+void SequenceCache::shutdown(thread_db* tdbb)
+{
+	MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+	for (Block** iter = m_blocks.begin(); iter != m_blocks.end(); ++iter)
+	{
+		Block* const block = *iter;
+
+		if (block)
+		{
+			MutexLockGuard blockGuard(block->mutex, FB_FUNCTION);
+
+			block->left = 0;
+			LCK_release(tdbb, block->lock);
+		}
+	}
+}
+
+SequenceCache::Block* SequenceCache::getBlock(thread_db* tdbb, SLONG id)
+{
+	fb_assert(id >= 0);
+
+	MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+	if ((FB_SIZE_T) id >= m_blocks.getCount())
+		m_blocks.resize(id + 1, NULL);
+
+	Block* block = m_blocks[id];
+
+	if (!block)
+	{
+		MemoryPool& pool = *m_dbb->dbb_permanent;
+
+		block = FB_NEW_POOL(pool) Block;
+		block->next = 0;
+		block->step = 0;
+		block->left = 0;
+
+		block->lock = FB_NEW_RPT(pool, 0)
+			Lock(tdbb, sizeof(SLONG), LCK_sequence, block, blockingAst);
+		block->lock->setKey(id);
+
+		m_blocks[id] = block;
+	}
+
+	return block;
+}
+
+int SequenceCache::blockingAst(void* ast_object)
+{
+	Block* const block = static_cast<Block*>(ast_object);
+
+	try
+	{
+		Database* const dbb = block->lock->lck_dbb;
+
+		AsyncContextHolder tdbb(dbb, FB_FUNCTION);
+
+		MutexLockGuard guard(block->mutex, FB_FUNCTION);
+
+		block->left = 0;
+		LCK_release(tdbb, block->lock);
+	}
+	catch (const Exception&)
+	{} // no-op
+
+	return 0;
+}
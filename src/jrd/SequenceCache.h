@@ -0,0 +1,80 @@
+/*
+ *	PROGRAM:	JRD Access Method
+ *	MODULE:		SequenceCache.h
+ *	DESCRIPTION:	Cache of sequence values reserved by blocks
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.ibphoenix.com/main.nfs?a=ibphoenix&page=ibp_idpl.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by the Firebird Project
+ *  for the Firebird Open Source RDBMS project.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ *
+ */
+
+#ifndef JRD_SEQUENCE_CACHE_H
+#define JRD_SEQUENCE_CACHE_H
+
+#include "../common/classes/alloc.h"
+#include "../common/classes/array.h"
+#include "../common/classes/locks.h"
+
+namespace Jrd {
+
+class thread_db;
+class Database;
+class Lock;
+
+// SequenceCache -- values of sequences declared with CACHE <n>.
+//
+// NEXT VALUE FOR such sequence advances the generator page by <n> steps at once
+// and serves the reserved values from memory, so the page is latched once per
+// block instead of once per value. The cache lives in the Database object, hence
+// it's shared by all attachments in SuperServer and is per-process otherwise.
+// Values not used before shutdown or crash are lost.
+//
+// While values of a sequence are cached, its LCK_sequence lock is held in SR mode.
+// Setting the generator value takes the lock in EX mode, which makes every owner
+// of cached values to discard them.
+
+class SequenceCache
+{
+public:
+	explicit SequenceCache(Database* dbb);
+	~SequenceCache();
+
+	SINT64 nextValue(thread_db* tdbb, SLONG id, SLONG step, SLONG cache);
+	void invalidate(thread_db* tdbb, SLONG id);
+	void shutdown(thread_db* tdbb);
+
+private:
+	struct Block
+	{
+		Firebird::Mutex mutex;		// protects all below
+		Lock* lock;
+		SINT64 next;				// next value to return
+		SLONG step;
+		SLONG left;					// values left in the block
+	};
+
+	Block* getBlock(thread_db* tdbb, SLONG id);
+	static int blockingAst(void* ast_object);
+
+	Database* const m_dbb;
+	Firebird::Mutex m_mutex;		// protects m_blocks
+	Firebird::Array<Block*> m_blocks;	// indexed by generator id
+};
+
+} // namespace Jrd
+
+#endif // JRD_SEQUENCE_CACHE_H
@@ -188,6 +188,11 @@ Statement::Statement(thread_db* tdbb, MemoryPool* p, CompilerScratch* csb)
 			if (!tail->csb_fields && !(tail->csb_flags & csb_update))
 				 rpb->rpb_stream_flags |= RPB_s_no_data;
 
+			// records of a stream that is never changed or locked keep their packed
+			// image, fields are decoded only when referenced
+			if (!(tail->csb_flags & (csb_update | csb_unstable | csb_skip_locked)))
+				rpb->rpb_stream_flags |= RPB_s_lazy;
+
 			if (tail->csb_flags & csb_unstable)
 				rpb->rpb_stream_flags |= RPB_s_unstable;
 
@@ -255,5 +255,6 @@ static const struct
 	{"outer_map", outer_map},
 	{NULL, NULL},	// blr_json_function
 	{"skip_locked", zero},
+	{"parallel", one_word},
 	{0, 0}
 };
@@ -30,6 +30,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
 #include "../jrd/jrd.h"
 #include "../jrd/que.h"
 #include "../jrd/lck.h"
@@ -62,7 +65,9 @@
 #include "../common/classes/MsgPrint.h"
 #include "../jrd/CryptoManager.h"
 #include "../common/utils_proto.h"
+#include "../common/os/os_utils.h"
 #include "../jrd/PageToBufferMap.h"
+#include "../jrd/RedoLog.h"
 
 // Use lock-free lists in hash table implementation
 #define HASH_USE_CDS_LIST
@@ -88,10 +93,6 @@ using namespace Firebird;
 IMPLEMENT_TRACE_ROUTINE(cch_trace, "CCH")
 #endif
 
-#ifdef SUPERSERVER_V2
-#define CACHE_READER
-#endif
-
 
 static inline void PAGE_LOCK_RELEASE(thread_db* tdbb, BufferControl* bcb, Lock* lock)
 {
@@ -126,23 +127,21 @@ enum LatchState
 
 static void adjust_scan_count(WIN* window, bool mustRead);
 static int blocking_ast_bdb(void*);
-#ifdef CACHE_READER
-static void prefetch_epilogue(Prefetch*, FbStatusVector *);
-static void prefetch_init(Prefetch*, thread_db*);
-static void prefetch_io(Prefetch*, FbStatusVector *);
-static void prefetch_prologue(Prefetch*, SLONG *);
-#endif
 static void cacheBuffer(Attachment* att, BufferDesc* bdb);
 static void check_precedence(thread_db*, WIN*, PageNumber);
 static void clear_precedence(thread_db*, BufferDesc*);
 static void down_grade(thread_db*, BufferDesc*, int high = 0);
 static bool expand_buffers(thread_db*, ULONG);
+static void fetch_page(thread_db*, WIN*, const bool, const bool);
+static bool find_buffer(BufferControl*, const PageNumber&);
 static BufferDesc* get_buffer(thread_db*, const PageNumber, SyncType, int);
 static int get_related(BufferDesc*, PagesArray&, int, const ULONG);
 static ULONG get_prec_walk_mark(BufferControl*);
 static LockState lock_buffer(thread_db*, BufferDesc*, const SSHORT, const SCHAR);
 static ULONG memory_init(thread_db*, BufferControl*, ULONG);
+static void setup_partitions(BufferControl*);
 static void page_validation_error(thread_db*, win*, SSHORT);
+static FB_SIZE_T prefetch_pages(thread_db*, const PageNumber*, FB_SIZE_T);
 static void purgePrecedence(BufferControl*, BufferDesc*);
 static SSHORT related(BufferDesc*, const BufferDesc*, SSHORT, const ULONG);
 static int write_buffer(thread_db*, BufferDesc*, const PageNumber, const bool, FbStatusVector* const,
@@ -150,8 +149,20 @@ static int write_buffer(thread_db*, BufferDesc*, const PageNumber, const bool, F
 static bool write_page(thread_db*, BufferDesc*, FbStatusVector* const, const bool);
 static bool set_diff_page(thread_db*, BufferDesc*);
 static void clear_dirty_flag_and_nbak_state(thread_db*, BufferDesc*);
-
-static BufferDesc* get_dirty_buffer(thread_db*);
+static void page_written(thread_db*, BufferDesc*, const bool);
+static bool run_candidate(const BufferDesc*, const PageNumber&);
+static int write_buffer_run(thread_db*, BufferDesc*, FbStatusVector* const, Array<UCHAR>&);
+static ULONG get_dirty_backlog(const BufferControl*);
+static void run_writer(BufferControl*, const bool);
+static void start_writer_helpers(thread_db*, BufferControl*);
+static void stop_writer_helpers(BufferControl*);
+static void save_cache(thread_db*, BufferControl*);
+static void load_saved_cache(thread_db*, BufferControl*);
+static FB_SIZE_T get_saved_pages(BufferControl*, FB_SIZE_T, HalfStaticArray<PageNumber, PREFETCH_MAX_PAGES>&);
+static void finish_cache_load(thread_db*, BufferControl*);
+
+static BufferDesc* get_dirty_buffer(thread_db*, int node = -1);
+static void free_pending(BufferControl*, BufferPartition*);
 
 
 static inline void insertDirty(BufferControl* bcb, BufferDesc* bdb)
@@ -159,14 +170,16 @@ static inline void insertDirty(BufferControl* bcb, BufferDesc* bdb)
 	if (bdb->bdb_dirty.que_forward != &bdb->bdb_dirty)
 		return;
 
-	Sync dirtySync(&bcb->bcb_syncDirtyBdbs, "insertDirty");
+	BufferPartition* const part = bdb->bdb_partition;
+
+	Sync dirtySync(&part->bcp_syncDirtyBdbs, "insertDirty");
 	dirtySync.lock(SYNC_EXCLUSIVE);
 
 	if (bdb->bdb_dirty.que_forward != &bdb->bdb_dirty)
 		return;
 
-	bcb->bcb_dirty_count++;
-	QUE_INSERT(bcb->bcb_dirty, bdb->bdb_dirty);
+	part->bcp_dirty_count++;
+	QUE_INSERT(part->bcp_dirty, bdb->bdb_dirty);
 }
 
 static inline void removeDirty(BufferControl* bcb, BufferDesc* bdb)
@@ -174,25 +187,40 @@ static inline void removeDirty(BufferControl* bcb, BufferDesc* bdb)
 	if (bdb->bdb_dirty.que_forward == &bdb->bdb_dirty)
 		return;
 
-	Sync dirtySync(&bcb->bcb_syncDirtyBdbs, "removeDirty");
+	BufferPartition* const part = bdb->bdb_partition;
+
+	Sync dirtySync(&part->bcp_syncDirtyBdbs, "removeDirty");
 	dirtySync.lock(SYNC_EXCLUSIVE);
 
 	if (bdb->bdb_dirty.que_forward == &bdb->bdb_dirty)
 		return;
 
-	fb_assert(bcb->bcb_dirty_count > 0);
+	fb_assert(part->bcp_dirty_count > 0);
 
-	bcb->bcb_dirty_count--;
+	part->bcp_dirty_count--;
 	QUE_DELETE(bdb->bdb_dirty);
 	QUE_INIT(bdb->bdb_dirty);
 }
 
+static void collectDirty(BufferControl* bcb, SLONG transaction_mask, const bool sys_only,
+	HalfStaticArray<BufferDesc*, 1024>& flush);
 static void flushDirty(thread_db* tdbb, SLONG transaction_mask, const bool sys_only);
 static void flushAll(thread_db* tdbb, USHORT flush_flag);
 static void flushPages(thread_db* tdbb, USHORT flush_flag, BufferDesc** begin, FB_SIZE_T count);
+static void flushFiles(thread_db* tdbb, USHORT flush_flag, ULONG commits);
+static void groupFlush(thread_db* tdbb, SLONG transaction_mask);
+static bool logDirty(thread_db* tdbb, SLONG transaction_mask);
+static bool logBuffers(thread_db* tdbb, BufferDesc** begin, FB_SIZE_T count);
+static void logPages(thread_db* tdbb, BufferDesc** begin, FB_SIZE_T count);
+static bool logBeforeWrite(thread_db* tdbb, BufferDesc* bdb, FbStatusVector* const status);
+static void checkpoint(thread_db* tdbb, USHORT flush_flag);
 
 static void recentlyUsed(BufferDesc* bdb);
-static void requeueRecentlyUsed(BufferControl* bcb);
+static void requeueRecentlyUsed(BufferPartition* part);
+static void leastRecentlyUsed(BufferPartition* part, BufferDesc* bdb);
+static void removeFromLRU(BufferPartition* part, BufferDesc* bdb);
+static void placeIntoLRU(thread_db* tdbb, BufferPartition* part, BufferDesc* bdb, const PageNumber& oldPage);
+static void bumpHitStats(thread_db* tdbb, const BufferDesc* bdb);
 
 
 const ULONG MIN_BUFFER_SEGMENT = 65536;
@@ -247,9 +275,10 @@ class BCBHashTable
 #endif
 
 public:
-	BCBHashTable(MemoryPool& pool, ULONG count) :
+	BCBHashTable(MemoryPool& pool, ULONG count, ULONG partitions) :
 		m_pool(pool),
 		m_count(0),
+		m_partitions(partitions),
 		m_chains(nullptr)
 	{
 		resize(count);
@@ -272,13 +301,18 @@ public:
 
 	void remove(BufferDesc* bdb);
 private:
+	// Chains are grouped by cache partitions, see BufferControl::getPartition(),
+	// thus pages of the same partition never share the chain with other ones
 	ULONG hash(const PageNumber& pageno) const
 	{
-		return pageno.getPageNum() % m_count;
+		const ULONG num = pageno.getPageNum();
+		const ULONG chains = m_count / m_partitions;
+		return (num % m_partitions) * chains + (num / m_partitions) % chains;
 	}
 
 	MemoryPool& m_pool;
 	ULONG m_count;
+	const ULONG m_partitions;
 	chain_type* m_chains;
 };
 
@@ -349,14 +383,15 @@ void CCH_clean_page(thread_db* tdbb, PageNumber page)
 	}
 
 	{
-		Sync lruSync(&bcb->bcb_syncLRU, "CCH_release");
+		BufferPartition* const part = bdb->bdb_partition;
+
+		Sync lruSync(&part->bcp_syncLRU, "CCH_release");
 		lruSync.lock(SYNC_EXCLUSIVE);
 
 		if (bdb->bdb_flags & BDB_lru_chained)
-			requeueRecentlyUsed(bcb);
+			requeueRecentlyUsed(part);
 
-		QUE_DELETE(bdb->bdb_in_use);
-		QUE_APPEND(bcb->bcb_in_use, bdb->bdb_in_use);
+		leastRecentlyUsed(part, bdb);
 	}
 
 	bdb->release(tdbb, true);
@@ -910,6 +945,24 @@ void CCH_fetch_page(thread_db* tdbb, WIN* window, const bool read_shadow)
  * 	the checksum of the page.  When it is 2, compute
  *	the checksum only when the page type is nonzero.
  *
+ **************************************/
+	fetch_page(tdbb, window, read_shadow, false);
+}
+
+
+static void fetch_page(thread_db* tdbb, WIN* window, const bool read_shadow, const bool preread)
+{
+/**************************************
+ *
+ *	f e t c h _ p a g e
+ *
+ **************************************
+ *
+ * Functional description
+ *	Read a page into the buffer latched by window.
+ *	If preread is set, the raw page image from the
+ *	database file is already in the buffer.
+ *
  **************************************/
 	SET_TDBB(tdbb);
 	Database* dbb = tdbb->getDatabase();
@@ -952,13 +1005,20 @@ void CCH_fetch_page(thread_db* tdbb, WIN* window, const bool read_shadow)
 	class Pio : public CryptoManager::IOCallback
 	{
 	public:
-		Pio(jrd_file* f, BufferDesc* b, bool tp, bool rs, PageSpace* ps)
+		Pio(jrd_file* f, BufferDesc* b, bool tp, bool rs, PageSpace* ps, bool pr = false)
 			: file(f), bdb(b), isTempPage(tp),
-			  read_shadow(rs), pageSpace(ps)
+			  read_shadow(rs), pageSpace(ps), preread(pr)
 		{ }
 
 		bool callback(thread_db* tdbb, FbStatusVector* status, Ods::pag* page)
 		{
+			// Page image is already read by batched I/O, use it once
+			if (preread)
+			{
+				preread = false;
+				return true;
+			}
+
 			Database *dbb = tdbb->getDatabase();
 			int retryCount = 0;
 
@@ -990,6 +1050,7 @@ void CCH_fetch_page(thread_db* tdbb, WIN* window, const bool read_shadow)
 		bool isTempPage;
 		bool read_shadow;
 		PageSpace* pageSpace;
+		bool preread;
 	};
 
 	BackupManager* bm = dbb->dbb_backup_manager;
@@ -1015,7 +1076,7 @@ void CCH_fetch_page(thread_db* tdbb, WIN* window, const bool read_shadow)
 			bdb->bdb_page.getPageSpaceID(), bdb->bdb_page.getPageNum(), bak_state, diff_page));
 
 		// Read page from disk as normal
-		Pio io(file, bdb, isTempPage, read_shadow, pageSpace);
+		Pio io(file, bdb, isTempPage, read_shadow, pageSpace, preread);
 		if (!dbb->dbb_crypto_manager->read(tdbb, status, page, &io))
 		{
 			if (read_shadow && !isTempPage)
@@ -1099,11 +1160,13 @@ void CCH_forget_page(thread_db* tdbb, WIN* window)
 
 	removeDirty(bcb, bdb);
 
+	BufferPartition* const part = bdb->bdb_partition;
+
 	// remove from LRU list
 	{
-		SyncLockGuard lruSync(&bcb->bcb_syncLRU, SYNC_EXCLUSIVE, FB_FUNCTION);
-		requeueRecentlyUsed(bcb);
-		QUE_DELETE(bdb->bdb_in_use);
+		SyncLockGuard lruSync(&part->bcp_syncLRU, SYNC_EXCLUSIVE, FB_FUNCTION);
+		requeueRecentlyUsed(part);
+		removeFromLRU(part, bdb);
 	}
 
 	// remove from hash table and put into empty list
@@ -1111,16 +1174,16 @@ void CCH_forget_page(thread_db* tdbb, WIN* window)
 	{
 		SyncLockGuard bcbSync(&bcb->bcb_syncObject, SYNC_EXCLUSIVE, FB_FUNCTION);
 		bcb->bcb_hashTable->remove(bdb);
-		QUE_INSERT(bcb->bcb_empty, bdb->bdb_que);
-		bcb->bcb_inuse--;
+		QUE_INSERT(part->bcp_empty, bdb->bdb_que);
+		part->bcp_inuse--;
 	}
 #else
 	bcb->bcb_hashTable->remove(bdb);
 
 	{
-		SyncLockGuard syncEmpty(&bcb->bcb_syncEmpty, SYNC_EXCLUSIVE, FB_FUNCTION);
-		QUE_INSERT(bcb->bcb_empty, bdb->bdb_que);
-		bcb->bcb_inuse--;
+		SyncLockGuard syncEmpty(&part->bcp_syncEmpty, SYNC_EXCLUSIVE, FB_FUNCTION);
+		QUE_INSERT(part->bcp_empty, bdb->bdb_que);
+		part->bcp_inuse--;
 	}
 #endif
 
@@ -1153,6 +1216,7 @@ void CCH_fini(thread_db* tdbb)
 	if (!bcb)
 		return;
 
+	delete bcb->bcb_redo_log;
 	delete bcb->bcb_hashTable;
 
 	for (auto blk : bcb->bcb_bdbBlocks)
@@ -1170,8 +1234,14 @@ void CCH_fini(thread_db* tdbb)
 	bcb->bcb_bdbBlocks.clear();
 	bcb->bcb_count = 0;
 
-	while (bcb->bcb_memory.hasData())
-		bcb->bcb_bufferpool->deallocate(bcb->bcb_memory.pop());
+	for (const auto& mem : bcb->bcb_memory)
+	{
+		if (mem.m_size)
+			os_utils::releaseLargeBlock(mem.m_memory, mem.m_size);
+		else
+			bcb->bcb_bufferpool->deallocate(mem.m_memory);
+	}
+	bcb->bcb_memory.clear();
 
 	BufferControl::destroy(bcb);
 	dbb->dbb_bcb = NULL;
@@ -1217,75 +1287,29 @@ void CCH_flush(thread_db* tdbb, USHORT flush_flag, TraNumber tra_number)
 		}
 		else
 #endif
-			flushDirty(tdbb, transaction_mask, sys_only);
-	}
-	else
-		flushAll(tdbb, flush_flag);
-
-	//
-	// Check if flush needed
-	//
-	const int max_unflushed_writes = dbb->dbb_config->getMaxUnflushedWrites();
-	const time_t max_unflushed_write_time = dbb->dbb_config->getMaxUnflushedWriteTime();
-	bool max_num = (max_unflushed_writes >= 0);
-	bool max_time = (max_unflushed_write_time >= 0);
-
-	bool doFlush = false;
-
-	PageSpace* pageSpaceID = dbb->dbb_page_manager.findPageSpace(DB_PAGE_SPACE);
-	jrd_file* main_file = pageSpaceID->file;
-
-	// Avoid flush while creating and restoring database
-
-	const Jrd::Attachment* att = tdbb->getAttachment();
-	const bool dontFlush = (dbb->dbb_flags & DBB_creating) ||
-		((dbb->dbb_ast_flags & DBB_shutdown) &&
-			att && (att->att_flags & (ATT_creator | ATT_system)));
-
-	if (!(main_file->fil_flags & FIL_force_write) && (max_num || max_time) && !dontFlush)
-	{
-		const time_t now = time(0);
-
-		SyncLockGuard guard(&dbb->dbb_flush_count_mutex, SYNC_EXCLUSIVE, FB_FUNCTION);
-
-		// If this is the first commit set last_flushed_write to now
-		if (!dbb->last_flushed_write)
-			dbb->last_flushed_write = now;
-
-		const bool forceFlush = (flush_flag & FLUSH_ALL);
-
-		// test max_num condition and max_time condition
-		max_num = max_num && (dbb->unflushed_writes == max_unflushed_writes);
-		max_time = max_time && (now - dbb->last_flushed_write > max_unflushed_write_time);
-
-		if (forceFlush || max_num || max_time)
+		if (transaction_mask && dbb->dbb_config->getGroupCommitWindow() >= 0 &&
+			!(dbb->dbb_flags & DBB_creating))
 		{
-			doFlush = true;
-			dbb->unflushed_writes = 0;
-			dbb->last_flushed_write = now;
+			// Data pages and file flush are done by the group leader
+			groupFlush(tdbb, transaction_mask);
+			SDW_check(tdbb);
+			return;
 		}
-		else
+		else if (transaction_mask && logDirty(tdbb, transaction_mask))
 		{
-			dbb->unflushed_writes++;
+			// Page images are in redo log, no need to flush database files
+			SDW_check(tdbb);
+			return;
 		}
+		else
+			flushDirty(tdbb, transaction_mask, sys_only);
 	}
+	else if ((flush_flag & FLUSH_ALL) && dbb->dbb_bcb->bcb_redo_log)
+		checkpoint(tdbb, flush_flag);
+	else
+		flushAll(tdbb, flush_flag);
 
-	if (doFlush)
-	{
-		PIO_flush(tdbb, main_file);
-
-		for (Shadow* shadow = dbb->dbb_shadow; shadow; shadow = shadow->sdw_next)
-			PIO_flush(tdbb, shadow->sdw_file);
-
-		BackupManager* bm = dbb->dbb_backup_manager;
-		if (bm && !bm->isShutDown())
-		{
-			BackupManager::StateReadGuard stateGuard(tdbb);
-			const int backup_state = bm->getState();
-			if (backup_state == Ods::hdr_nbak_stalled || backup_state == Ods::hdr_nbak_merge)
-				bm->flushDifference(tdbb);
-		}
-	}
+	flushFiles(tdbb, flush_flag, 1);
 
 	// take the opportunity when we know there are no pages
 	// in cache to check that the shadow(s) have not been
@@ -1577,14 +1601,37 @@ void CCH_init(thread_db* tdbb, ULONG number)
 
 	const ULONG count = number;
 
+	// Split shared cache into partitions to let concurrent attachments
+	// look up and preempt buffers without contention on the common latches
+
+	ULONG partitions = 1;
+
+	if (shared)
+	{
+		partitions = dbb->dbb_config->getPageCachePartitions();
+
+		if (!partitions)
+		{
+			partitions = MIN(std::thread::hardware_concurrency(), number / MIN_PARTITION_BUFFERS);
+			partitions = MIN(partitions, MAX_CACHE_PARTITIONS);
+		}
+
+		partitions = MIN(partitions, number / MIN_PAGE_BUFFERS);
+		partitions = MAX(partitions, 1);
+	}
+
 	// Allocate and initialize buffers control block
 	BufferControl* bcb = BufferControl::create(dbb);
+
+	for (ULONG i = 0; i < partitions; i++)
+		bcb->bcb_partitions.add();
+
 	while (true)
 	{
 		try
 		{
 			bcb->bcb_hashTable = FB_NEW_POOL(*bcb->bcb_bufferpool)
-				BCBHashTable(*bcb->bcb_bufferpool, number);
+				BCBHashTable(*bcb->bcb_bufferpool, number, partitions);
 			break;
 		}
 		catch (const Firebird::Exception& ex)
@@ -1604,15 +1651,42 @@ void CCH_init(thread_db* tdbb, ULONG number)
 	bcb->bcb_flags = shared ? BCB_exclusive : 0;
 	//bcb->bcb_flags = BCB_exclusive;	// TODO detect real state using LM
 
-	QUE_INIT(bcb->bcb_in_use);
-	QUE_INIT(bcb->bcb_dirty);
-	bcb->bcb_dirty_count = 0;
-	QUE_INIT(bcb->bcb_empty);
+	// Setup replacement policy
+
+	const char* const policy = dbb->dbb_config->getPageCachePolicy();
+
+	if (policy && !fb_utils::stricmp(policy, "2Q"))
+		bcb->bcb_flags |= BCB_two_queues;
+	else if (policy && fb_utils::stricmp(policy, "LRU"))
+	{
+		gds__log("Database: %s\n\tUnknown PageCachePolicy \"%s\", LRU is used",
+			 tdbb->getAttachment()->att_filename.c_str(), policy);
+	}
+
+	// Setup placement of page buffers in memory
+
+	if (dbb->dbb_config->getPageCacheHugePages())
+		bcb->bcb_flags |= BCB_huge_pages;
+
+	const char* const numa = dbb->dbb_config->getPageCacheNuma();
+
+	if (numa && !fb_utils::stricmp(numa, "interleave"))
+		bcb->bcb_flags |= BCB_numa_interleave;
+	else if (numa && !fb_utils::stricmp(numa, "partition"))
+		bcb->bcb_flags |= BCB_numa_partition;
+	else if (numa && fb_utils::stricmp(numa, "default"))
+	{
+		gds__log("Database: %s\n\tUnknown PageCacheNuma \"%s\", default is used",
+			 tdbb->getAttachment()->att_filename.c_str(), numa);
+	}
+
+	if (os_utils::getNumaNodes() <= 1)
+		bcb->bcb_flags &= ~(BCB_numa_interleave | BCB_numa_partition);
 
 	// initialization of memory is system-specific
 
 	bcb->bcb_count = memory_init(tdbb, bcb, number);
-	bcb->bcb_free_minimum = (SSHORT) MIN(bcb->bcb_count / 4, 128);
+	setup_partitions(bcb);
 
 	if (bcb->bcb_count < MIN_PAGE_BUFFERS)
 		ERR_post(Arg::Gds(isc_cache_too_small));
@@ -1639,28 +1713,57 @@ void CCH_init2(thread_db* tdbb)
 	Firebird::MutexEnsureUnlock guard(bcb->bcb_threadStartup, FB_FUNCTION);
 	guard.enter();
 
-	if (!(bcb->bcb_flags & BCB_exclusive) || (bcb->bcb_flags & (BCB_cache_writer | BCB_writer_start)))
+	if (!(bcb->bcb_flags & BCB_exclusive))
+		return;
+
+	const Attachment* att = tdbb->getAttachment();
+	if (att->att_flags & ATT_security_db)
 		return;
 
-#ifdef CACHE_READER
-	if (gds__thread_start(cache_reader, dbb, THREAD_high, 0, 0))
+	// Pages of committed transactions are logged instead of being written at commit
+
+	if (!bcb->bcb_redo_log && dbb->dbb_config->getRedoLog() &&
+		!(dbb->dbb_flags & (DBB_read_only | DBB_creating)))
 	{
-		ERR_bugcheck_msg("cannot start thread");
+		AutoPtr<RedoLog> redo(FB_NEW_POOL(*dbb->dbb_permanent) RedoLog(*dbb->dbb_permanent, dbb));
+		redo->open(tdbb);
+		bcb->bcb_redo_log = redo.release();
 	}
 
-	{ // scope
-		Database::Checkout dcoHolder(dbb, FB_FUNCTION);
-		dbb->dbb_reader_init.enter();
-	}
-#endif
+	// Cache reader also reloads and saves page cache contents
+	const bool startReader = (dbb->dbb_prefetch_pages || dbb->dbb_config->getPageCacheSave()) &&
+		!(bcb->bcb_flags & (BCB_cache_reader | BCB_reader_start));
 
-	const Attachment* att = tdbb->getAttachment();
-	if (!(dbb->dbb_flags & DBB_read_only) && !(att->att_flags & ATT_security_db))
-	{
-		// writer startup in progress
+	const bool startWriter = !(dbb->dbb_flags & DBB_read_only) &&
+		!(bcb->bcb_flags & (BCB_cache_writer | BCB_writer_start));
+
+	if (!startReader && !startWriter)
+		return;
+
+	// reader and/or writer startup in progress
+	if (startReader)
+		bcb->bcb_flags |= BCB_reader_start;
+	if (startWriter)
 		bcb->bcb_flags |= BCB_writer_start;
-		guard.leave();
+	guard.leave();
+
+	if (startReader)
+	{
+		try
+		{
+			bcb->bcb_reader_fini.run(bcb);
+		}
+		catch (const Exception&)
+		{
+			bcb->bcb_flags &= ~BCB_reader_start;
+			ERR_bugcheck_msg("cannot start cache reader thread");
+		}
+
+		bcb->bcb_reader_init.enter();
+	}
 
+	if (startWriter)
+	{
 		try
 		{
 			bcb->bcb_writer_fini.run(bcb);
@@ -1760,6 +1863,7 @@ void CCH_mark(thread_db* tdbb, WIN* window, bool mark_system, bool must_write)
 		insertDirty(bcb, bdb);
 
 	bdb->bdb_flags |= BDB_marked | BDB_dirty;
+	bdb->bdb_flags &= ~BDB_redo_logged;
 }
 
 
@@ -1845,8 +1949,7 @@ void CCH_precedence(thread_db* tdbb, WIN* window, PageNumber page)
 }
 
 
-#ifdef CACHE_READER
-void CCH_prefetch(thread_db* tdbb, SLONG* pages, SSHORT count)
+void CCH_prefetch(thread_db* tdbb, USHORT pageSpaceId, const ULONG* pages, FB_SIZE_T count)
 {
 /**************************************
  *
@@ -1855,76 +1958,64 @@ void CCH_prefetch(thread_db* tdbb, SLONG* pages, SSHORT count)
  **************************************
  *
  * Functional description
- *	Given a vector of pages, set corresponding bits
- *	in global prefetch bitmap. Initiate an asynchronous
- *	I/O and get the cache reader reading in our behalf
- *	as well.
+ *	Given a vector of pages, queue those which are not
+ *	in cache yet to the cache reader and wake it up.
+ *	The pages are read asynchronously on our behalf,
+ *	in page number order, into free or least recently
+ *	used buffers.
  *
  **************************************/
 	SET_TDBB(tdbb);
-	Database* dbb = tdbb->getDatabase();
-	BufferControl* bcb = dbb->dbb_bcb;
+	Database* const dbb = tdbb->getDatabase();
+	BufferControl* const bcb = dbb->dbb_bcb;
 
-	if (!count || !(bcb->bcb_flags & BCB_cache_reader))
+	if (!count || !(bcb->bcb_flags & BCB_cache_reader) || PageSpace::isTemporary(pageSpaceId))
 	{
 		// Caller isn't really serious.
 		return;
 	}
 
-	// Switch default pool to permanent pool for setting bits in prefetch bitmap.
-	Jrd::ContextPoolHolder context(tdbb, bcb->bcb_bufferpool);
+	// Don't bother the cache reader with pages which are already in cache
 
-	// The global prefetch bitmap is the key to the I/O coalescense mechanism which dovetails
-	// all thread prefetch requests to minimize sequential I/O requests.
-	// It also enables multipage I/O by implicitly sorting page vector requests.
+	HalfStaticArray<PageNumber, PREFETCH_MAX_PAGES> queue;
 
-	SLONG first_page = 0;
-	for (const SLONG* const end = pages + count; pages < end;)
+	for (const ULONG* const end = pages + count; pages < end; pages++)
 	{
-		const SLONG page = *pages++;
-		if (page)
-		{
-			SBM_set(tdbb, &bcb->bcb_prefetch, page);
-			if (!first_page)
-				first_page = page;
-		}
-	}
+		const PageNumber page(pageSpaceId, *pages);
 
-	// Not likely that the caller's page vector was empty but check anyway.
+		if (*pages && !find_buffer(bcb, page))
+			queue.add(page);
+	}
 
-	if (first_page)
-	{
-		prf prefetch;
+	if (queue.isEmpty())
+		return;
 
-		prefetch_init(&prefetch, tdbb);
-		prefetch_prologue(&prefetch, &first_page);
-		prefetch_io(&prefetch, tdbb->tdbb_status_vector);
-		prefetch_epilogue(&prefetch, tdbb->tdbb_status_vector);
-	}
-}
+	FB_SIZE_T queued = 0;
+	bool wakeup = false;
+	{	// scope
+		MutexLockGuard guard(bcb->bcb_prefetch_mutex, FB_FUNCTION);
 
+		for (const PageNumber* page = queue.begin(); page < queue.end(); page++)
+		{
+			if (bcb->bcb_prefetch.getCount() >= PREFETCH_MAX_QUEUE)
+				break;
 
-bool CCH_prefetch_pages(thread_db* tdbb)
-{
-/**************************************
- *
- *	C C H _ p r e f e t c h _ p a g e s
- *
- **************************************
- *
- * Functional description
- *	Check the prefetch bitmap for a set
- *	of pages and read them into the cache.
- *
- **************************************/
+			FB_SIZE_T pos;
+			if (!bcb->bcb_prefetch.find(*page, pos))
+			{
+				bcb->bcb_prefetch.insert(pos, *page);
+				queued++;
+			}
+		}
 
-	// Placeholder to be implemented when predictive prefetch is
-	// enabled. This is called by VIO/garbage_collector() when it
-	// is idle to help satisfy the prefetch demand.
+		// Cache reader resets BCB_reader_active holding the same mutex,
+		// thus wakeup can't be lost
+		wakeup = queued && !(bcb->bcb_flags & BCB_reader_active);
+	}
 
-	return false;
+	if (wakeup)
+		bcb->bcb_reader_sem.release();
 }
-#endif // CACHE_READER
 
 
 bool set_diff_page(thread_db* tdbb, BufferDesc* bdb)
@@ -2070,7 +2161,15 @@ void CCH_release(thread_db* tdbb, WIN* window, const bool release_tail)
 
 			bdb->downgrade(SYNC_SHARED);
 
-			if (!write_buffer(tdbb, bdb, bdb->bdb_page, false, tdbb->tdbb_status_vector, true))
+			// Transaction state written at commit is made durable by redo log
+			// if it's used
+
+			BufferDesc* buffer = bdb;
+			const bool logged = (bdb->bdb_buffer->pag_type == pag_transactions) &&
+				logBuffers(tdbb, &buffer, 1);
+
+			if (!logged &&
+				!write_buffer(tdbb, bdb, bdb->bdb_page, false, tdbb->tdbb_status_vector, true))
 			{
 				insertDirty(bcb, bdb);
 				CCH_unwind(tdbb, true);
@@ -2116,29 +2215,25 @@ void CCH_release(thread_db* tdbb, WIN* window, const bool release_tail)
 				if (window->win_flags & WIN_garbage_collector)
 					bdb->bdb_flags &= ~BDB_garbage_collect;
 
-				{ // bcb_syncLRU scope
-					Sync lruSync(&bcb->bcb_syncLRU, "CCH_release");
+				BufferPartition* const part = bdb->bdb_partition;
+
+				{ // bcp_syncLRU scope
+					Sync lruSync(&part->bcp_syncLRU, "CCH_release");
 					lruSync.lock(SYNC_EXCLUSIVE);
 
 					if (bdb->bdb_flags & BDB_lru_chained)
 					{
-						requeueRecentlyUsed(bcb);
+						requeueRecentlyUsed(part);
 					}
 
-					QUE_DELETE(bdb->bdb_in_use);
-					QUE_APPEND(bcb->bcb_in_use, bdb->bdb_in_use);
+					leastRecentlyUsed(part, bdb);
 				}
 
 				if ((bcb->bcb_flags & BCB_cache_writer) &&
 					(bdb->bdb_flags & (BDB_dirty | BDB_db_dirty)) )
 				{
 					insertDirty(bcb, bdb);
-
-					bcb->bcb_flags |= BCB_free_pending;
-					if (!(bcb->bcb_flags & BCB_writer_active))
-					{
-						bcb->bcb_writer_sem.release();
-					}
+					free_pending(bcb, part);
 				}
 			}
 		}
@@ -2225,16 +2320,19 @@ void CCH_shutdown(thread_db* tdbb)
 	if (!bcb)
 		return;
 
-#ifdef CACHE_READER
+	// Wait for cache reader startup to complete
+
+	while (bcb->bcb_flags & BCB_reader_start)
+		Thread::yield();
+
 	// Shutdown the dedicated cache reader for this database
 
 	if (bcb->bcb_flags & BCB_cache_reader)
 	{
 		bcb->bcb_flags &= ~BCB_cache_reader;
-		dbb->dbb_reader_sem.release();
-		dbb->dbb_reader_fini.enter();
+		bcb->bcb_reader_sem.release(); // Wake up running thread
+		bcb->bcb_reader_fini.waitForCompletion();
 	}
-#endif
 
 	// Wait for cache writer startup to complete
 
@@ -2262,6 +2360,13 @@ void CCH_shutdown(thread_db* tdbb)
 				LongJump::raise();
 
 			CCH_flush(tdbb, FLUSH_FINI, 0);
+
+			// All pages are written, redo log is not needed anymore
+			if (bcb->bcb_redo_log)
+				bcb->bcb_redo_log->close(tdbb);
+
+			if ((bcb->bcb_flags & BCB_exclusive) && dbb->dbb_config->getPageCacheSave())
+				save_cache(tdbb, bcb);
 		}
 		catch (const Exception&)
 		{
@@ -2586,6 +2691,11 @@ static void adjust_scan_count(WIN* window, bool mustRead)
 		if (bdb->bdb_flags & BDB_garbage_collect)
 			bdb->bdb_flags &= ~BDB_garbage_collect;
 	}
+
+	// The first reference consumes the read-ahead
+
+	if (bdb->bdb_flags & BDB_prefetch)
+		bdb->bdb_flags &= ~BDB_prefetch;
 }
 
 
@@ -2678,12 +2788,22 @@ static void flushDirty(thread_db* tdbb, SLONG transaction_mask, const bool sys_o
 	BufferControl* bcb = dbb->dbb_bcb;
 	Firebird::HalfStaticArray<BufferDesc*, 1024> flush;
 
+	collectDirty(bcb, transaction_mask, sys_only, flush);
+	flushPages(tdbb, FLUSH_TRAN, flush.begin(), flush.getCount());
+}
+
+
+// Collect pages modified by given or system transaction.
+static void collectDirty(BufferControl* bcb, SLONG transaction_mask, const bool sys_only,
+	HalfStaticArray<BufferDesc*, 1024>& flush)
+{
+	for (auto& part : bcb->bcb_partitions)
 	{  // dirtySync scope
-		Sync dirtySync(&bcb->bcb_syncDirtyBdbs, "flushDirty");
+		Sync dirtySync(&part.bcp_syncDirtyBdbs, "collectDirty");
 		dirtySync.lock(SYNC_EXCLUSIVE);
 
-		QUE que_inst = bcb->bcb_dirty.que_forward, next;
-		for (; que_inst != &bcb->bcb_dirty; que_inst = next)
+		QUE que_inst = part.bcp_dirty.que_forward, next;
+		for (; que_inst != &part.bcp_dirty; que_inst = next)
 		{
 			next = que_inst->que_forward;
 			BufferDesc* bdb = BLOCK(que_inst, BufferDesc, bdb_dirty);
@@ -2703,74 +2823,510 @@ static void flushDirty(thread_db* tdbb, SLONG transaction_mask, const bool sys_o
 			}
 		}
 	}
-
-	flushPages(tdbb, FLUSH_TRAN, flush.begin(), flush.getCount());
 }
 
 
-// Collect pages modified by garbage collector or all dirty pages or release page
-// locks - depending of flush_flag, and write it to disk.
-// See also comments in flushPages.
-static void flushAll(thread_db* tdbb, USHORT flush_flag)
+// Flush database files to disk if forced writes are off and enough writes
+// (commits) or time accumulated since the last flush, see MaxUnflushedWrites
+// and MaxUnflushedWriteTime.
+static void flushFiles(thread_db* tdbb, USHORT flush_flag, ULONG commits)
 {
 	SET_TDBB(tdbb);
 	Database* dbb = tdbb->getDatabase();
-	BufferControl* bcb = dbb->dbb_bcb;
-	Firebird::HalfStaticArray<BufferDesc*, 1024> flush(bcb->bcb_dirty_count);
 
-	const bool all_flag = (flush_flag & FLUSH_ALL) != 0;
-	const bool sweep_flag = (flush_flag & FLUSH_SWEEP) != 0;
-	const bool release_flag = (flush_flag & FLUSH_RLSE) != 0;
-	const bool write_thru = release_flag;
+	const int max_unflushed_writes = dbb->dbb_config->getMaxUnflushedWrites();
+	const time_t max_unflushed_write_time = dbb->dbb_config->getMaxUnflushedWriteTime();
+	bool max_num = (max_unflushed_writes >= 0);
+	bool max_time = (max_unflushed_write_time >= 0);
 
-	{
-		Sync bcbSync(&bcb->bcb_syncObject, FB_FUNCTION);
-		if (!bcb->bcb_syncObject.ourExclusiveLock())
-			bcbSync.lock(SYNC_SHARED);
+	bool doFlush = false;
 
-		for (auto blk : bcb->bcb_bdbBlocks)
-		{
-			for (ULONG i = 0; i < blk.m_count; i++)
-			{
-				BufferDesc* bdb = &blk.m_bdbs[i];
+	PageSpace* pageSpaceID = dbb->dbb_page_manager.findPageSpace(DB_PAGE_SPACE);
+	jrd_file* main_file = pageSpaceID->file;
 
-				if (bdb->bdb_flags & (BDB_db_dirty | BDB_dirty))
-				{
-					if (bdb->bdb_flags & BDB_dirty)
-						flush.add(bdb);
-					else if (bdb->bdb_flags & BDB_db_dirty)
-					{
-						// pages modified by sweep\garbage collector are not in dirty list
-						const bool dirty_list = (bdb->bdb_dirty.que_forward != &bdb->bdb_dirty);
+	// Avoid flush while creating and restoring database
 
-						if (all_flag || (sweep_flag && !dirty_list))
-							flush.add(bdb);
-					}
-				}
-				else if (release_flag)
-				{
-					bdb->addRef(tdbb, SYNC_EXCLUSIVE);
+	const Jrd::Attachment* att = tdbb->getAttachment();
+	const bool dontFlush = (dbb->dbb_flags & DBB_creating) ||
+		((dbb->dbb_ast_flags & DBB_shutdown) &&
+			att && (att->att_flags & (ATT_creator | ATT_system)));
 
-					if (bdb->bdb_use_count > 1)
-						BUGCHECK(210);	// msg 210 page in use during flush
+	if (!(main_file->fil_flags & FIL_force_write) && (max_num || max_time) && !dontFlush)
+	{
+		const time_t now = time(0);
 
-					PAGE_LOCK_RELEASE(tdbb, bcb, bdb->bdb_lock);
-					bdb->release(tdbb, false);
-				}
-			}
-		}
-	}
+		SyncLockGuard guard(&dbb->dbb_flush_count_mutex, SYNC_EXCLUSIVE, FB_FUNCTION);
 
-	flushPages(tdbb, flush_flag, flush.begin(), flush.getCount());
-}
+		// If this is the first commit set last_flushed_write to now
+		if (!dbb->last_flushed_write)
+			dbb->last_flushed_write = now;
 
+		const bool forceFlush = (flush_flag & FLUSH_ALL);
 
-// Used in qsort below
-extern "C" {
-	static int cmpBdbs(const void* a, const void* b)
-	{
-		const BufferDesc* bdbA = *(BufferDesc**) a;
-		const BufferDesc* bdbB = *(BufferDesc**) b;
+		// test max_num condition and max_time condition
+		max_num = max_num && (dbb->unflushed_writes >= max_unflushed_writes);
+		max_time = max_time && (now - dbb->last_flushed_write > max_unflushed_write_time);
+
+		if (forceFlush || max_num || max_time)
+		{
+			doFlush = true;
+			dbb->unflushed_writes = 0;
+			dbb->last_flushed_write = now;
+		}
+		else
+		{
+			dbb->unflushed_writes += commits;
+		}
+	}
+
+	if (doFlush)
+	{
+		PIO_flush(tdbb, main_file);
+
+		for (Shadow* shadow = dbb->dbb_shadow; shadow; shadow = shadow->sdw_next)
+			PIO_flush(tdbb, shadow->sdw_file);
+
+		BackupManager* bm = dbb->dbb_backup_manager;
+		if (bm && !bm->isShutDown())
+		{
+			BackupManager::StateReadGuard stateGuard(tdbb);
+			const int backup_state = bm->getState();
+			if (backup_state == Ods::hdr_nbak_stalled || backup_state == Ods::hdr_nbak_merge)
+				bm->flushDifference(tdbb);
+		}
+	}
+}
+
+
+// Flush pages of committing transaction together with other transactions
+// committing concurrently. First committer becomes the group leader: it waits
+// up to GroupCommitWindow microseconds for others to join, then writes dirty
+// pages of all transactions of the group and flushes files. Other committers
+// wait until the leader finishes. Committers arrived while the flush is in
+// progress form the next group. Any committer returns only after its pages
+// are written, as without grouping.
+static void groupFlush(thread_db* tdbb, SLONG transaction_mask)
+{
+	SET_TDBB(tdbb);
+	Database* dbb = tdbb->getDatabase();
+	BufferControl* bcb = dbb->dbb_bcb;
+
+	const SINT64 started = fb_utils::query_performance_counter();
+
+	CheckoutLockGuard guard(tdbb, bcb->bcb_commit_mutex, FB_FUNCTION, true);
+
+	const FB_UINT64 ticket = ++bcb->bcb_commit_requested;
+	bcb->bcb_commit_mask |= transaction_mask;
+	bcb->bcb_commit_waiting++;
+
+	while (bcb->bcb_commit_done < ticket)
+	{
+		if (bcb->bcb_commit_leader)
+		{
+			EngineCheckout cout(tdbb, FB_FUNCTION, EngineCheckout::UNNECESSARY);
+			bcb->bcb_commit_cond.wait(bcb->bcb_commit_mutex);
+			continue;
+		}
+
+		bcb->bcb_commit_leader = true;
+
+		// Wait for more committers if there is a chance they come: someone
+		// already waits or previous group was not alone
+
+		const int window = dbb->dbb_config->getGroupCommitWindow();
+		if (window > 0 && (bcb->bcb_commit_waiting > 1 || bcb->bcb_commit_last_batch > 1))
+		{
+			MutexUnlockGuard unlock(bcb->bcb_commit_mutex, FB_FUNCTION);
+			EngineCheckout cout(tdbb, FB_FUNCTION, EngineCheckout::UNNECESSARY);
+			std::this_thread::sleep_for(std::chrono::microseconds(window));
+		}
+
+		const SLONG mask = bcb->bcb_commit_mask;
+		const ULONG batch = bcb->bcb_commit_waiting;
+		const FB_UINT64 last = bcb->bcb_commit_requested;
+
+		bcb->bcb_commit_mask = 0;
+		bcb->bcb_commit_waiting = 0;
+
+		try
+		{
+			MutexUnlockGuard unlock(bcb->bcb_commit_mutex, FB_FUNCTION);
+
+			if (!logDirty(tdbb, mask))
+			{
+				flushDirty(tdbb, mask, false);
+				flushFiles(tdbb, FLUSH_TRAN, batch);
+			}
+		}
+		catch (const Exception&)
+		{
+			// Let the rest of group retry with the next leader
+			bcb->bcb_commit_mask |= mask;
+			bcb->bcb_commit_waiting += batch - 1;
+			bcb->bcb_commit_leader = false;
+			bcb->bcb_commit_cond.notifyAll();
+			throw;
+		}
+
+		bcb->bcb_commit_done = last;
+		bcb->bcb_commit_leader = false;
+		bcb->bcb_commit_last_batch = batch;
+
+		bcb->bcb_commit_groups++;
+		bcb->bcb_commit_count += batch;
+		if (bcb->bcb_commit_max_batch < batch)
+			bcb->bcb_commit_max_batch = batch;
+
+		bcb->bcb_commit_cond.notifyAll();
+	}
+
+	const SINT64 elapsed = fb_utils::query_performance_counter() - started;
+	bcb->bcb_commit_latency += elapsed * 1000000 / fb_utils::query_performance_frequency();
+}
+
+
+// Put images of pages modified by given transactions into redo log instead of
+// writing pages to database. Returns false if redo log is not used.
+static bool logDirty(thread_db* tdbb, SLONG transaction_mask)
+{
+	SET_TDBB(tdbb);
+	Database* dbb = tdbb->getDatabase();
+	BufferControl* bcb = dbb->dbb_bcb;
+
+	if (!bcb->bcb_redo_log || (dbb->dbb_flags & DBB_creating))
+		return false;
+
+	Firebird::HalfStaticArray<BufferDesc*, 1024> flush;
+	collectDirty(bcb, transaction_mask, false, flush);
+
+	return logBuffers(tdbb, flush.begin(), flush.getCount());
+}
+
+
+// Put images of given pages into redo log if it's used now
+static bool logBuffers(thread_db* tdbb, BufferDesc** begin, FB_SIZE_T count)
+{
+	SET_TDBB(tdbb);
+	Database* dbb = tdbb->getDatabase();
+	BufferControl* bcb = dbb->dbb_bcb;
+	RedoLog* const redo = bcb->bcb_redo_log;
+
+	if (!redo || !redo->enter(tdbb))
+		return false;
+
+	try
+	{
+		logPages(tdbb, begin, count);
+	}
+	catch (const Exception&)
+	{
+		redo->leave();
+		throw;
+	}
+
+	redo->leave();
+
+	// Let cache writer do checkpoint
+
+	if (redo->needCheckpoint() && (bcb->bcb_flags & BCB_cache_writer))
+		bcb->bcb_writer_sem.release();
+
+	return true;
+}
+
+
+// Append current images of given pages, and of pages which must be written
+// before them, to redo log by single batch. Pages are registered in the log
+// before their images are taken, since then they can't be written until the
+// images are logged, see logBeforeWrite(). Header page is read at startup
+// before the log is replayed, thus it's written as usual.
+static void logPages(thread_db* tdbb, BufferDesc** begin, FB_SIZE_T count)
+{
+	SET_TDBB(tdbb);
+	Database* dbb = tdbb->getDatabase();
+	BufferControl* bcb = dbb->dbb_bcb;
+	RedoLog* const redo = bcb->bcb_redo_log;
+	const ULONG pageSize = dbb->dbb_page_size;
+
+	Firebird::HalfStaticArray<BufferDesc*, 1024> pages;
+	Firebird::SortedArray<BufferDesc*, Firebird::InlineStorage<BufferDesc*, 1024> > seen;
+
+	for (BufferDesc** ptr = begin; ptr < begin + count; ptr++)
+	{
+		if (!seen.exist(*ptr))
+		{
+			seen.add(*ptr);
+			pages.add(*ptr);
+		}
+	}
+
+	{	// precSync scope
+		Sync precSync(&bcb->bcb_syncPrecedence, "logPages");
+		precSync.lock(SYNC_SHARED);
+
+		for (FB_SIZE_T i = 0; i < pages.getCount(); i++)
+		{
+			const BufferDesc* const bdb = pages[i];
+
+			for (const que* que_inst = bdb->bdb_higher.que_forward; que_inst != &bdb->bdb_higher;
+				 que_inst = que_inst->que_forward)
+			{
+				const Precedence* const precedence = BLOCK(que_inst, Precedence, pre_higher);
+
+				if (!(precedence->pre_flags & PRE_cleared) && !seen.exist(precedence->pre_hi))
+				{
+					seen.add(precedence->pre_hi);
+					pages.add(precedence->pre_hi);
+				}
+			}
+		}
+	}
+
+	struct Logged
+	{
+		BufferDesc* bdb;
+		PageNumber page;
+		ULONG incarnation;
+	};
+
+	Firebird::HalfStaticArray<Logged, 64> logged;
+	Array<UCHAR> records;
+
+	for (BufferDesc* const bdb : pages)
+	{
+		// Page latch keeps writers away while the image is taken, I/O latch
+		// keeps the flags stable
+
+		bdb->addRef(tdbb, SYNC_SHARED);
+		bdb->lockIO(tdbb);
+
+		const PageNumber page = bdb->bdb_page;
+
+		// Page is written already, or it's temporary and not needed after restart,
+		// or its current image is logged already
+
+		if (!(bdb->bdb_flags & BDB_dirty) || page.getPageSpaceID() != DB_PAGE_SPACE ||
+			((bdb->bdb_flags & BDB_redo_logged) && redo->isRegistered(page.getPageNum())))
+		{
+			bdb->unLockIO(tdbb);
+			bdb->release(tdbb, false);
+			continue;
+		}
+
+		if (page == HEADER_PAGE_NUMBER)
+		{
+			bdb->unLockIO(tdbb);
+
+			if (!write_buffer(tdbb, bdb, page, false, tdbb->tdbb_status_vector, true))
+				CCH_unwind(tdbb, true);
+
+			bdb->release(tdbb, false);
+			continue;
+		}
+
+		redo->registerPage(page.getPageNum());
+
+		RedoLog::Entry entry;
+		entry.sequence = redo->nextSequence();
+		entry.page = page.getPageNum();
+		entry.reserved = 0;
+
+		records.add(reinterpret_cast<const UCHAR*>(&entry), sizeof(entry));
+		records.add(reinterpret_cast<const UCHAR*>(bdb->bdb_buffer), pageSize);
+
+		Logged item;
+		item.bdb = bdb;
+		item.page = page;
+		item.incarnation = bdb->bdb_incarnation;
+		logged.add(item);
+
+		bdb->unLockIO(tdbb);
+		bdb->release(tdbb, false);
+	}
+
+	if (logged.isEmpty())
+		return;
+
+	redo->append(tdbb, records.begin(), records.getCount(), logged.getCount());
+
+	// Remember buffers not modified since their images were taken, request
+	// to write them at release is satisfied by the log too
+
+	for (const auto& item : logged)
+	{
+		BufferDesc* const bdb = item.bdb;
+
+		bdb->lockIO(tdbb);
+
+		if (bdb->bdb_page == item.page && bdb->bdb_incarnation == item.incarnation &&
+			(bdb->bdb_flags & BDB_dirty))
+		{
+			bdb->bdb_flags |= BDB_redo_logged;
+			bdb->bdb_flags &= ~BDB_must_write;
+		}
+
+		bdb->unLockIO(tdbb);
+	}
+}
+
+
+// Put current image of the page, registered in redo log, into the log before
+// the page is written to database. Called by write_page with I/O latch held.
+static bool logBeforeWrite(thread_db* tdbb, BufferDesc* bdb, FbStatusVector* const status)
+{
+	RedoLog* const redo = bdb->bdb_bcb->bcb_redo_log;
+	const PageNumber page = bdb->bdb_page;
+
+	if (!redo || (bdb->bdb_flags & BDB_redo_logged) || page.getPageSpaceID() != DB_PAGE_SPACE ||
+		!redo->isRegistered(page.getPageNum()))
+	{
+		return true;
+	}
+
+	try
+	{
+		const ULONG pageSize = tdbb->getDatabase()->dbb_page_size;
+
+		RedoLog::Entry entry;
+		entry.sequence = redo->nextSequence();
+		entry.page = page.getPageNum();
+		entry.reserved = 0;
+
+		Array<UCHAR> record;
+		UCHAR* const ptr = record.getBuffer(sizeof(entry) + pageSize);
+		memcpy(ptr, &entry, sizeof(entry));
+		memcpy(ptr + sizeof(entry), bdb->bdb_buffer, pageSize);
+
+		redo->append(tdbb, ptr, record.getCount(), 1);
+	}
+	catch (const Exception& ex)
+	{
+		ex.stuffException(status);
+		return false;
+	}
+
+	bdb->bdb_flags |= BDB_redo_logged;
+	return true;
+}
+
+
+// Write all dirty pages to database and empty redo log. Registered pages
+// modified since their images were logged are logged by single batch first,
+// otherwise each of them is logged separately before it's written.
+static void checkpoint(thread_db* tdbb, USHORT flush_flag)
+{
+	SET_TDBB(tdbb);
+	Database* dbb = tdbb->getDatabase();
+	BufferControl* bcb = dbb->dbb_bcb;
+	RedoLog* const redo = bcb->bcb_redo_log;
+
+	redo->beginCheckpoint(tdbb);
+
+	try
+	{
+		Array<ULONG> registered;
+		redo->getRegistered(registered);
+
+		Firebird::HalfStaticArray<BufferDesc*, 1024> pages;
+
+		for (const ULONG pageNum : registered)
+		{
+			BufferDesc* bdb;
+			{
+#ifndef HASH_USE_CDS_LIST
+				SyncLockGuard bcbSync(&bcb->bcb_syncObject, SYNC_SHARED, FB_FUNCTION);
+#endif
+				bdb = bcb->bcb_hashTable->find(PageNumber(DB_PAGE_SPACE, pageNum));
+			}
+
+			if (bdb && (bdb->bdb_flags & BDB_dirty) && !(bdb->bdb_flags & BDB_redo_logged))
+				pages.add(bdb);
+		}
+
+		logPages(tdbb, pages.begin(), pages.getCount());
+
+		flushAll(tdbb, flush_flag);
+
+		PageSpace* const pageSpace = dbb->dbb_page_manager.findPageSpace(DB_PAGE_SPACE);
+		PIO_flush(tdbb, pageSpace->file);
+	}
+	catch (const Exception&)
+	{
+		redo->endCheckpoint(tdbb, false);
+		throw;
+	}
+
+	redo->endCheckpoint(tdbb, true);
+}
+
+
+// Collect pages modified by garbage collector or all dirty pages or release page
+// locks - depending of flush_flag, and write it to disk.
+// See also comments in flushPages.
+static void flushAll(thread_db* tdbb, USHORT flush_flag)
+{
+	SET_TDBB(tdbb);
+	Database* dbb = tdbb->getDatabase();
+	BufferControl* bcb = dbb->dbb_bcb;
+	SLONG dirty_count = 0;
+	for (const auto& part : bcb->bcb_partitions)
+		dirty_count += part.bcp_dirty_count;
+
+	Firebird::HalfStaticArray<BufferDesc*, 1024> flush(dirty_count);
+
+	const bool all_flag = (flush_flag & FLUSH_ALL) != 0;
+	const bool sweep_flag = (flush_flag & FLUSH_SWEEP) != 0;
+	const bool release_flag = (flush_flag & FLUSH_RLSE) != 0;
+	const bool write_thru = release_flag;
+
+	{
+		Sync bcbSync(&bcb->bcb_syncObject, FB_FUNCTION);
+		if (!bcb->bcb_syncObject.ourExclusiveLock())
+			bcbSync.lock(SYNC_SHARED);
+
+		for (auto blk : bcb->bcb_bdbBlocks)
+		{
+			for (ULONG i = 0; i < blk.m_count; i++)
+			{
+				BufferDesc* bdb = &blk.m_bdbs[i];
+
+				if (bdb->bdb_flags & (BDB_db_dirty | BDB_dirty))
+				{
+					if (bdb->bdb_flags & BDB_dirty)
+						flush.add(bdb);
+					else if (bdb->bdb_flags & BDB_db_dirty)
+					{
+						// pages modified by sweep\garbage collector are not in dirty list
+						const bool dirty_list = (bdb->bdb_dirty.que_forward != &bdb->bdb_dirty);
+
+						if (all_flag || (sweep_flag && !dirty_list))
+							flush.add(bdb);
+					}
+				}
+				else if (release_flag)
+				{
+					bdb->addRef(tdbb, SYNC_EXCLUSIVE);
+
+					if (bdb->bdb_use_count > 1)
+						BUGCHECK(210);	// msg 210 page in use during flush
+
+					PAGE_LOCK_RELEASE(tdbb, bcb, bdb->bdb_lock);
+					bdb->release(tdbb, false);
+				}
+			}
+		}
+	}
+
+	flushPages(tdbb, flush_flag, flush.begin(), flush.getCount());
+}
+
+
+// Used in qsort below
+extern "C" {
+	static int cmpBdbs(const void* a, const void* b)
+	{
+		const BufferDesc* bdbA = *(BufferDesc**) a;
+		const BufferDesc* bdbB = *(BufferDesc**) b;
 
 		if (bdbA->bdb_page > bdbB->bdb_page)
 			return 1;
@@ -2861,7 +3417,6 @@ static void flushPages(thread_db* tdbb, USHORT flush_flag, BufferDesc** begin, F
 }
 
 
-#ifdef CACHE_READER
 void BufferControl::cache_reader(BufferControl* bcb)
 {
 /**************************************
@@ -2871,148 +3426,171 @@ void BufferControl::cache_reader(BufferControl* bcb)
  **************************************
  *
  * Functional description
- *	Prefetch pages into cache for sequential scans.
- *	Use asynchronous I/O to keep two prefetch requests
- *	busy at a time.
+ *	Read ahead pages queued by CCH_prefetch on behalf of
+ *	sequential and bitmap scans. Queued pages are taken
+ *	in page number order and read in batches into free
+ *	or least recently used buffers, see PIO_read_batch.
  *
  **************************************/
-	Database* dbb = bcb->bcb_database;
-	Database::SyncGuard dsGuard(dbb);
-
 	FbLocalStatus status_vector;
+	Database* const dbb = bcb->bcb_database;
 
-	// Establish a thread context.
-	ThreadContextHolder tdbb(status_vector);
-
-	// Dummy attachment needed for lock owner identification.
-	tdbb->setDatabase(dbb);
-	Jrd::Attachment* const attachment = Attachment::create(dbb, nullptr);
-	tdbb->setAttachment(attachment);
-	attachment->att_filename = dbb->dbb_filename;
-	Jrd::ContextPoolHolder context(tdbb, bcb->bcb_bufferpool);
-
-	// This try block is specifically to protect the LCK_init call: if
-	// LCK_init fails we won't be able to accomplish anything anyway, so
-	// return, unlike the other try blocks further down the page.
-
-	BufferControl* bcb = NULL;
+	try
+	{
+		UserId user;
+		user.setUserName("Cache Reader");
 
-	try {
+		Jrd::Attachment* const attachment = Jrd::Attachment::create(dbb, nullptr);
+		RefPtr<SysStableAttachment> sAtt(FB_NEW SysStableAttachment(attachment));
+		attachment->setStable(sAtt);
+		attachment->att_filename = dbb->dbb_filename;
+		attachment->att_user = &user;
 
-		LCK_init(tdbb, LCK_OWNER_attachment);
-		TRA_init(attachment);
-		bcb = dbb->dbb_bcb;
-		bcb->bcb_flags |= BCB_cache_reader;
-		dbb->dbb_reader_init.post();	// Notify our creator that we have started
-	}
-	catch (const Firebird::Exception& ex)
-	{
-		ex.stuffException(status_vector);
-		iscDbLogStatus(dbb->dbb_filename.c_str(), status_vector);
-		return 0;
-	}
+		BackgroundContextHolder tdbb(dbb, attachment, &status_vector, FB_FUNCTION);
+		Jrd::Attachment::UseCountHolder use(attachment);
 
-	try {
+		try
+		{
+			LCK_init(tdbb, LCK_OWNER_attachment);
+			PAG_header(tdbb, true);
+			PAG_attachment_id(tdbb);
+			TRA_init(attachment);
 
-	// Set up dual prefetch control blocks to keep multiple prefetch
-	// requests active at a time. Also helps to prevent the cache reader
-	// from becoming dedicated or locked into a single request's prefetch demands.
+			Monitoring::publishAttachment(tdbb);
 
-	prf prefetch1, prefetch2;
-	prefetch_init(&prefetch1, tdbb);
-	prefetch_init(&prefetch2, tdbb);
+			sAtt->initDone();
 
-	while (bcb->bcb_flags & BCB_cache_reader)
-	{
-		bcb->bcb_flags |= BCB_reader_active;
-		bool found = false;
-		SLONG starting_page = -1;
-		prf* next_prefetch = &prefetch1;
+			bcb->bcb_flags |= BCB_cache_reader;
+			bcb->bcb_flags &= ~BCB_reader_start;
 
-		if (dbb->dbb_flags & DBB_suspend_bgio)
-		{
-			Database::Checkout dcoHolder(dbb, FB_FUNCTION);
-			dbb->dbb_reader_sem.tryEnter(10);
-			continue;
-		}
+			// Notify our creator that we have started
+			bcb->bcb_reader_init.release();
 
-		// Make a pass thru the global prefetch bitmap looking for something
-		// to read. When the entire bitmap has been scanned and found to be
-		// empty then wait for new requests.
+			const bool saveCache = dbb->dbb_config->getPageCacheSave();
+			const time_t saveInterval = dbb->dbb_config->getPageCacheSaveInterval();
 
-		do {
-			if (!(prefetch1.prf_flags & PRF_active) &&
-				SBM_next(bcb->bcb_prefetch, &starting_page, RSE_get_forward))
+			if (saveCache)
 			{
-				found = true;
-				prefetch_prologue(&prefetch1, &starting_page);
-				prefetch_io(&prefetch1, status_vector);
+				load_saved_cache(tdbb, bcb);
+				bcb->bcb_save_time = time(NULL);
 			}
 
-			if (!(prefetch2.prf_flags & PRF_active) &&
-				SBM_next(bcb->bcb_prefetch, &starting_page, RSE_get_forward))
+			HalfStaticArray<PageNumber, PREFETCH_MAX_PAGES> pages;
+			FB_SIZE_T loadPos = 0;
+
+			while (bcb->bcb_flags & BCB_cache_reader)
 			{
-				found = true;
-				prefetch_prologue(&prefetch2, &starting_page);
-				prefetch_io(&prefetch2, status_vector);
-			}
+				bcb->bcb_flags |= BCB_reader_active;
 
-			prf* post_prefetch = next_prefetch;
-			next_prefetch = (post_prefetch == &prefetch1) ? &prefetch2 : &prefetch1;
+				if (dbb->dbb_flags & DBB_suspend_bgio)
+				{
+					EngineCheckout cout(tdbb, FB_FUNCTION);
+					bcb->bcb_reader_sem.tryEnter(10);
+					continue;
+				}
 
-			if (post_prefetch->prf_flags & PRF_active)
-				prefetch_epilogue(post_prefetch, status_vector);
+				// Take the next batch of queued pages. The queue is sorted, thus
+				// pages are read in ascending order as far as possible.
 
-			if (found)
-			{
-				// If the cache writer or garbage collector is idle, put
-				// them to work prefetching pages.
-#ifdef CACHE_WRITER
-				if ((bcb->bcb_flags & BCB_cache_writer) && !(bcb->bcb_flags & BCB_writer_active))
-					dbb_writer_sem.release();
-#endif
-#ifdef GARBAGE_THREAD
-				if ((dbb->dbb_flags & DBB_garbage_collector) && !(dbb->dbb_flags & DBB_gc_active))
-					dbb->dbb_gc_sem.release();
-#endif
-			}
-		} while (prefetch1.prf_flags & PRF_active || prefetch2.prf_flags & PRF_active);
+				pages.clear();
+				{	// scope
+					MutexLockGuard guard(bcb->bcb_prefetch_mutex, FB_FUNCTION);
 
-		// If there's more work to do voluntarily ask to be rescheduled.
-		// Otherwise, wait for event notification.
-		BufferDesc* bdb;
-		if (found)
-			JRD_reschedule(tdbb, true);
-		else if (bcb->bcb_flags & BCB_free_pending && (bdb = get_dirty_buffer(tdbb)))
-		{
-			// In our spare time, help writer clean the cache.
+					const FB_SIZE_T count = MIN(bcb->bcb_prefetch.getCount(), PREFETCH_MAX_PAGES);
+					pages.add(bcb->bcb_prefetch.begin(), count);
+					bcb->bcb_prefetch.removeCount(0, count);
+
+					if (!count)
+						bcb->bcb_flags &= ~BCB_reader_active;
+				}
+
+				if (saveInterval && time(NULL) - bcb->bcb_save_time >= saveInterval)
+				{
+					save_cache(tdbb, bcb);
+					bcb->bcb_save_time = time(NULL);
+				}
+
+				// Without pages to read ahead, continue to reload saved cache contents
+
+				const bool load = pages.isEmpty() && loadPos < bcb->bcb_load.getCount();
+
+				if (load)
+				{
+					loadPos = get_saved_pages(bcb, loadPos, pages);
+
+					if (loadPos >= bcb->bcb_load.getCount())
+						finish_cache_load(tdbb, bcb);
+				}
+
+				if (pages.isEmpty())
+				{
+					EngineCheckout cout(tdbb, FB_FUNCTION);
+					bcb->bcb_reader_sem.tryEnter(10);
+					continue;
+				}
+
+				// Reloaded pages were hot before restart, don't treat them as read ahead
+				AutoSetRestoreFlag<ULONG> loadFlag(&tdbb->tdbb_flags, TDBB_cache_load, load);
+
+				for (const PageNumber* page = pages.begin(); page < pages.end();)
+				{
+					if (!(bcb->bcb_flags & BCB_cache_reader))
+						break;
 
-			write_buffer(tdbb, bdb, bdb->bdb_page, true, status_vector, true);
+					try
+					{
+						page += prefetch_pages(tdbb, page, pages.end() - page);
+					}
+					catch (const Firebird::Exception& ex)
+					{
+						// Read-ahead is just a hint, the page will be read
+						// again (and error reported) by the actual consumer.
+						// Rest of the batch is released by the failed fetch.
+
+						ex.stuffException(&status_vector);
+						iscDbLogStatus(dbb->dbb_filename.c_str(), &status_vector);
+						status_vector->init();
+						break;
+					}
+				}
+
+				attachment->mergeStats();
+				JRD_reschedule(tdbb, true);
+			}
 		}
-		else
+		catch (const Firebird::Exception& ex)
 		{
-			bcb->bcb_flags &= ~BCB_reader_active;
-			Database::Checkout dcoHolder(dbb, FB_FUNCTION);
-			dbb->dbb_reader_sem.tryEnter(10);
+			ex.stuffException(&status_vector);
+			iscDbLogStatus(dbb->dbb_filename.c_str(), &status_vector);
+			// continue execution to clean up
 		}
-		bcb = dbb->dbb_bcb;
+
+		Monitoring::cleanupAttachment(tdbb);
+		attachment->releaseLocks(tdbb);
+		LCK_fini(tdbb, LCK_OWNER_attachment);
+
+		attachment->releaseRelations(tdbb);
+	}	// try
+	catch (const Firebird::Exception& ex)
+	{
+		bcb->exceptionHandler(ex, cache_reader);
 	}
 
-	LCK_fini(tdbb, LCK_OWNER_attachment);
-	Jrd::Attachment::destroy(attachment);	// no need saving warning error strings here
-	tdbb->setAttachment(NULL);
 	bcb->bcb_flags &= ~BCB_cache_reader;
-	dbb->dbb_reader_fini.post();
 
-	}	// try
+	try
+	{
+		if (bcb->bcb_flags & BCB_reader_start)
+		{
+			bcb->bcb_flags &= ~BCB_reader_start;
+			bcb->bcb_reader_init.release();
+		}
+	}
 	catch (const Firebird::Exception& ex)
 	{
-		ex.stuffException(status_vector);
-		iscDbLogStatus(dbb->dbb_filename.c_str(), status_vector);
+		bcb->exceptionHandler(ex, cache_reader);
 	}
-	return 0;
 }
-#endif
 
 
 void BufferControl::cache_writer(BufferControl* bcb)
@@ -3026,9 +3604,45 @@ void BufferControl::cache_writer(BufferControl* bcb)
  * Functional description
  *	Write dirty pages to database to maintain an adequate supply of free pages.
  *
+ **************************************/
+	run_writer(bcb, true);
+}
+
+
+void BufferControl::cache_writer_helper(BufferControl* bcb)
+{
+/**************************************
+ *
+ *	c a c h e _ w r i t e r _ h e l p e r
+ *
+ **************************************
+ *
+ * Functional description
+ *	Additional cache writer, shares the work with the main one.
+ *
+ **************************************/
+	run_writer(bcb, false);
+}
+
+
+static void run_writer(BufferControl* bcb, const bool mainWriter)
+{
+/**************************************
+ *
+ *	r u n _ w r i t e r
+ *
+ **************************************
+ *
+ * Functional description
+ *	Body of cache writer thread. The main writer
+ *	owns the writer state flags and starts and stops
+ *	the additional writers.
+ *
  **************************************/
 	FbLocalStatus status_vector;
 	Database* const dbb = bcb->bcb_database;
+	BufferControl::BcbThreadSync::ThreadRoutine* const routine =
+		mainWriter ? BufferControl::cache_writer : BufferControl::cache_writer_helper;
 
 	try
 	{
@@ -3044,6 +3658,24 @@ void BufferControl::cache_writer(BufferControl* bcb)
 		BackgroundContextHolder tdbb(dbb, attachment, &status_vector, FB_FUNCTION);
 		Jrd::Attachment::UseCountHolder use(attachment);
 
+		// Staging area for encrypted images of coalesced pages
+		Array<UCHAR> stage;
+		ULONG maxBacklog = 0;
+
+		// Pair the writer with the cache partitions placed on its NUMA node.
+		// Main writer starts before the helpers, so it gets the first node.
+
+		int node = -1;
+
+		if (bcb->bcb_flags & BCB_numa_partition)
+		{
+			if (mainWriter)
+				bcb->bcb_writer_seq = 0;
+
+			node = bcb->bcb_writer_seq++ % os_utils::getNumaNodes();
+			os_utils::bindThreadToNumaNode(node);
+		}
+
 		try
 		{
 			LCK_init(tdbb, LCK_OWNER_attachment);
@@ -3055,18 +3687,20 @@ void BufferControl::cache_writer(BufferControl* bcb)
 
 			sAtt->initDone();
 
-			bcb->bcb_flags |= BCB_cache_writer;
-			bcb->bcb_flags &= ~BCB_writer_start;
+			if (mainWriter)
+			{
+				bcb->bcb_flags |= BCB_cache_writer;
+				bcb->bcb_flags &= ~BCB_writer_start;
 
-			// Notify our creator that we have started
-			bcb->bcb_writer_init.release();
+				// Notify our creator that we have started
+				bcb->bcb_writer_init.release();
+
+				start_writer_helpers(tdbb, bcb);
+			}
 
 			while (bcb->bcb_flags & BCB_cache_writer)
 			{
 				bcb->bcb_flags |= BCB_writer_active;
-#ifdef CACHE_READER
-				SLONG starting_page = -1;
-#endif
 
 				if (dbb->dbb_flags & DBB_suspend_bgio)
 				{
@@ -3078,7 +3712,8 @@ void BufferControl::cache_writer(BufferControl* bcb)
 #ifdef SUPERSERVER_V2
 				// Flush buffers for lazy commit
 				SLONG commit_mask;
-				if (!(dbb->dbb_flags & DBB_force_write) && (commit_mask = dbb->dbb_flush_cycle))
+				if (mainWriter && !(dbb->dbb_flags & DBB_force_write) &&
+					(commit_mask = dbb->dbb_flush_cycle))
 				{
 					dbb->dbb_flush_cycle = 0;
 					btc_flush(tdbb, commit_mask, false, status_vector);
@@ -3087,12 +3722,36 @@ void BufferControl::cache_writer(BufferControl* bcb)
 
 				if (bcb->bcb_flags & BCB_free_pending)
 				{
-					BufferDesc* const bdb = get_dirty_buffer(tdbb);
+					BufferDesc* const bdb = get_dirty_buffer(tdbb, node);
 					if (bdb)
 					{
-						write_buffer(tdbb, bdb, bdb->bdb_page, true, &status_vector, true);
+						maxBacklog = MAX(maxBacklog, get_dirty_backlog(bcb));
+
+						write_buffer_run(tdbb, bdb, &status_vector, stage);
 						attachment->mergeStats();
 					}
+
+					// Wake up idle writer to help with the rest of work
+
+					if ((bcb->bcb_flags & BCB_free_pending) && bcb->bcb_writer_helpers.hasData())
+						bcb->bcb_writer_sem.release();
+				}
+
+				// Write pages logged by committers when redo log grows too long
+
+				RedoLog* const redo = bcb->bcb_redo_log;
+				if (mainWriter && redo && redo->needCheckpoint())
+				{
+					try
+					{
+						checkpoint(tdbb, FLUSH_ALL);
+					}
+					catch (const Firebird::Exception& ex)
+					{
+						ex.stuffException(&status_vector);
+						iscDbLogStatus(dbb->dbb_filename.c_str(), &status_vector);
+						status_vector->init();
+					}
 				}
 
 				// If there's more work to do voluntarily ask to be rescheduled.
@@ -3100,19 +3759,6 @@ void BufferControl::cache_writer(BufferControl* bcb)
 
 				if ((bcb->bcb_flags & BCB_free_pending) || dbb->dbb_flush_cycle)
 					JRD_reschedule(tdbb, true);
-#ifdef CACHE_READER
-				else if (SBM_next(bcb->bcb_prefetch, &starting_page, RSE_get_forward))
-				{
-					// Prefetch some pages in our spare time and in the process
-					// garbage collect the prefetch bitmap.
-					prf prefetch;
-
-					prefetch_init(&prefetch, tdbb);
-					prefetch_prologue(&prefetch, &starting_page);
-					prefetch_io(&prefetch, status_vector);
-					prefetch_epilogue(&prefetch, status_vector);
-				}
-#endif
 				else
 				{
 					bcb->bcb_flags &= ~BCB_writer_active;
@@ -3128,6 +3774,26 @@ void BufferControl::cache_writer(BufferControl* bcb)
 			// continue execution to clean up
 		}
 
+		// Helpers exist only if more than one writer was running
+
+		const bool severalWriters = !mainWriter || bcb->bcb_writer_helpers.hasData();
+
+		if (mainWriter)
+			stop_writer_helpers(bcb);
+
+		// Report per-writer throughput to help tuning of CacheWriters and MaxUnflushedWrites
+
+		if (severalWriters)
+		{
+			const RuntimeStatistics& stats = attachment->att_stats;
+
+			gds__log("Database: %s\n\tCache writer %" UQUADFORMAT " wrote %" SQUADFORMAT
+				" pages using %" SQUADFORMAT " write calls, maximum backlog %" ULONGFORMAT " dirty pages",
+				dbb->dbb_filename.c_str(), attachment->att_attachment_id,
+				stats.getValue(RuntimeStatistics::PAGE_WRITES),
+				stats.getValue(RuntimeStatistics::PAGE_WRITE_CALLS), maxBacklog);
+		}
+
 		Monitoring::cleanupAttachment(tdbb);
 		attachment->releaseLocks(tdbb);
 		LCK_fini(tdbb, LCK_OWNER_attachment);
@@ -3136,23 +3802,110 @@ void BufferControl::cache_writer(BufferControl* bcb)
 	}	// try
 	catch (const Firebird::Exception& ex)
 	{
-		bcb->exceptionHandler(ex, cache_writer);
+		bcb->exceptionHandler(ex, routine);
+	}
+
+	if (!mainWriter)
+		return;
+
+	bcb->bcb_flags &= ~BCB_cache_writer;
+
+	try
+	{
+		if (bcb->bcb_flags & BCB_writer_start)
+		{
+			bcb->bcb_flags &= ~BCB_writer_start;
+			bcb->bcb_writer_init.release();
+		}
+	}
+	catch (const Firebird::Exception& ex)
+	{
+		bcb->exceptionHandler(ex, routine);
+	}
+}
+
+
+static void start_writer_helpers(thread_db* tdbb, BufferControl* bcb)
+{
+/**************************************
+ *
+ *	s t a r t _ w r i t e r _ h e l p e r s
+ *
+ **************************************
+ *
+ * Functional description
+ *	Start additional cache writers. Their number is
+ *	configured or chosen by the request queue depth
+ *	of the device holding the database.
+ *
+ **************************************/
+	Database* const dbb = tdbb->getDatabase();
+
+	ULONG writers = dbb->dbb_config->getCacheWriters();
+
+	if (!writers)
+	{
+		const PageSpace* const pageSpace = dbb->dbb_page_manager.findPageSpace(DB_PAGE_SPACE);
+
+		writers = PIO_queue_depth(pageSpace->file) / WRITER_QUEUE_DEPTH;
+
+		// Every NUMA node holding cache partitions needs its own writer
+		if (bcb->bcb_flags & BCB_numa_partition)
+			writers = MAX(writers, os_utils::getNumaNodes());
+
+		writers = MIN(writers, MAX_CACHE_WRITERS);
+		writers = MIN(writers, bcb->bcb_partitions.getCount());
+	}
+
+	MemoryPool& pool = *bcb->bcb_bufferpool;
+
+	for (ULONG i = 1; i < writers; i++)
+	{
+		BufferControl::BcbThreadSync* const helper = FB_NEW_POOL(pool)
+			BufferControl::BcbThreadSync(pool, BufferControl::cache_writer_helper, THREAD_medium);
+
+		try
+		{
+			helper->run(bcb);
+		}
+		catch (const Exception& ex)
+		{
+			delete helper;
+			bcb->exceptionHandler(ex, BufferControl::cache_writer_helper);
+			break;
+		}
+
+		bcb->bcb_writer_helpers.add(helper);
 	}
+}
+
+
+static void stop_writer_helpers(BufferControl* bcb)
+{
+/**************************************
+ *
+ *	s t o p _ w r i t e r _ h e l p e r s
+ *
+ **************************************
+ *
+ * Functional description
+ *	Stop additional cache writers and wait for them.
+ *
+ **************************************/
+	if (bcb->bcb_writer_helpers.isEmpty())
+		return;
 
 	bcb->bcb_flags &= ~BCB_cache_writer;
 
-	try
-	{
-		if (bcb->bcb_flags & BCB_writer_start)
-		{
-			bcb->bcb_flags &= ~BCB_writer_start;
-			bcb->bcb_writer_init.release();
-		}
-	}
-	catch (const Firebird::Exception& ex)
+	bcb->bcb_writer_sem.release(bcb->bcb_writer_helpers.getCount());
+
+	for (auto helper : bcb->bcb_writer_helpers)
 	{
-		bcb->exceptionHandler(ex, cache_writer);
+		helper->waitForCompletion();
+		delete helper;
 	}
+
+	bcb->bcb_writer_helpers.clear();
 }
 
 
@@ -3602,129 +4355,232 @@ static bool expand_buffers(thread_db* tdbb, ULONG number)
 	if ((tdbb->getAttachment()->att_flags & ATT_exclusive) || !(bcb->bcb_flags & BCB_exclusive))
 		bcb->bcb_hashTable->resize(number);
 
-	SyncLockGuard syncEmpty(&bcb->bcb_syncEmpty, SYNC_EXCLUSIVE, FB_FUNCTION);
 	ULONG allocated = memory_init(tdbb, bcb, number - bcb->bcb_count);
 
 	bcb->bcb_count += allocated;
-	bcb->bcb_free_minimum = (SSHORT) MIN(bcb->bcb_count / 4, 128);	// 25% clean page reserve
+	setup_partitions(bcb);
 
 	return true;
 }
 
 
-static BufferDesc* get_dirty_buffer(thread_db* tdbb)
+static bool find_buffer(BufferControl* bcb, const PageNumber& page)
 {
-	// This code is only used by the background I/O threads:
-	// cache writer, cache reader and garbage collector.
+/**************************************
+ *
+ *	f i n d _ b u f f e r
+ *
+ **************************************
+ *
+ * Functional description
+ *	Check if page is present in cache. Buffer is
+ *	not latched, thus result is just a hint.
+ *
+ **************************************/
+#ifndef HASH_USE_CDS_LIST
+	SyncLockGuard bcbSync(&bcb->bcb_syncObject, SYNC_SHARED, FB_FUNCTION);
+#endif
+	return bcb->bcb_hashTable->find(page) != nullptr;
+}
 
-	SET_TDBB(tdbb);
-	Database* dbb = tdbb->getDatabase();
-	BufferControl* bcb = dbb->dbb_bcb;
-	int walk = bcb->bcb_free_minimum;
+
+static void free_pending(BufferControl* bcb, BufferPartition* part)
+{
+/**************************************
+ *
+ *	f r e e _ p e n d i n g
+ *
+ **************************************
+ *
+ * Functional description
+ *	Ask cache writer to free some buffers of given partition.
+ *
+ **************************************/
+	part->bcp_free_pending = true;
+	bcb->bcb_flags |= BCB_free_pending;
+
+	if (!(bcb->bcb_flags & BCB_writer_active))
+		bcb->bcb_writer_sem.release();
+}
+
+
+static BufferDesc* get_dirty_buffer(thread_db* tdbb, BufferPartition* part)
+{
+	int walk = part->bcp_free_minimum;
 	int chained = walk;
 
-	Sync lruSync(&bcb->bcb_syncLRU, FB_FUNCTION);
+	Sync lruSync(&part->bcp_syncLRU, FB_FUNCTION);
 	lruSync.lock(SYNC_SHARED);
 
-	for (QUE que_inst = bcb->bcb_in_use.que_backward;
-		 que_inst != &bcb->bcb_in_use; que_inst = que_inst->que_backward)
+	// Cold que is empty unless 2Q policy is used. Its buffers are preempted
+	// first, thus write them first too.
+
+	que* const queues[] = {&part->bcp_cold, &part->bcp_in_use};
+
+	for (FB_SIZE_T i = 0; i < FB_NELEM(queues) && walk && chained; i++)
 	{
-		BufferDesc* bdb = BLOCK(que_inst, BufferDesc, bdb_in_use);
+		que* const lru = queues[i];
 
-		if (bdb->bdb_flags & BDB_lru_chained)
+		for (QUE que_inst = lru->que_backward; que_inst != lru; que_inst = que_inst->que_backward)
 		{
-			if (!--chained)
-				break;
-			continue;
-		}
+			BufferDesc* bdb = BLOCK(que_inst, BufferDesc, bdb_in_use);
 
-		if (bdb->bdb_use_count || (bdb->bdb_flags & BDB_free_pending))
-			continue;
+			if (bdb->bdb_flags & BDB_lru_chained)
+			{
+				if (!--chained)
+					break;
+				continue;
+			}
 
-		if (bdb->bdb_flags & BDB_db_dirty)
-		{
-			//tdbb->bumpStats(RuntimeStatistics::PAGE_FETCHES); shouldn't it be here?
-			return bdb;
-		}
+			if (bdb->bdb_use_count || (bdb->bdb_flags & BDB_free_pending))
+				continue;
 
-		if (!--walk)
-			break;
+			if (bdb->bdb_flags & BDB_db_dirty)
+			{
+				//tdbb->bumpStats(RuntimeStatistics::PAGE_FETCHES); shouldn't it be here?
+				return bdb;
+			}
+
+			if (!--walk)
+				break;
+		}
 	}
 
 	if (!chained)
 	{
 		lruSync.unlock();
 		lruSync.lock(SYNC_EXCLUSIVE);
-		requeueRecentlyUsed(bcb);
+		requeueRecentlyUsed(part);
 	}
 	else
-		bcb->bcb_flags &= ~BCB_free_pending;
+		part->bcp_free_pending = false;
 
 	return NULL;
 }
 
 
-static BufferDesc* get_oldest_buffer(thread_db* tdbb, BufferControl* bcb)
+static BufferDesc* get_dirty_buffer(thread_db* tdbb, int node)
+{
+	// This code is only used by the background I/O threads:
+	// cache writer, cache reader and garbage collector.
+
+	SET_TDBB(tdbb);
+	Database* dbb = tdbb->getDatabase();
+	BufferControl* bcb = dbb->dbb_bcb;
+
+	// Clear the request first, partitions that still have no free
+	// buffers will raise it again
+
+	bcb->bcb_flags &= ~BCB_free_pending;
+
+	// Start from the next partition every time to serve all of them evenly
+
+	const FB_SIZE_T count = bcb->bcb_partitions.getCount();
+	const FB_SIZE_T start = bcb->bcb_dirty_partition++ % count;
+	const ULONG nodes = os_utils::getNumaNodes();
+	BufferDesc* bdb = NULL;
+
+	for (FB_SIZE_T n = 0; n < count; n++)
+	{
+		const FB_SIZE_T part_no = (start + n) % count;
+		BufferPartition* const part = &bcb->bcb_partitions[part_no];
+
+		// Writer paired with a NUMA node serves the partitions placed on it,
+		// see memory_init()
+
+		if (part->bcp_free_pending && !bdb && (node < 0 || part_no % nodes == (ULONG) node))
+			bdb = get_dirty_buffer(tdbb, part);
+
+		if (part->bcp_free_pending)
+			bcb->bcb_flags |= BCB_free_pending;
+	}
+
+	// Nothing to write on our node, help the writers of other nodes
+
+	if (!bdb && node >= 0 && (bcb->bcb_flags & BCB_free_pending))
+		return get_dirty_buffer(tdbb);
+
+	return bdb;
+}
+
+
+static BufferDesc* get_oldest_buffer(thread_db* tdbb, BufferControl* bcb, BufferPartition* part)
 {
 /**************************************
  * Function description:
- *       Get candidate for preemption
+ *       Get candidate for preemption from given cache partition
  *       Found page buffer must have SYNC_EXCLUSIVE lock.
  **************************************/
 
-	int walk = bcb->bcb_free_minimum;
+	int walk = part->bcp_free_minimum;
 	BufferDesc* bdb = nullptr;
 
-	Sync lruSync(&bcb->bcb_syncLRU, FB_FUNCTION);
-	if (bcb->bcb_lru_chain.load() != NULL)
+	Sync lruSync(&part->bcp_syncLRU, FB_FUNCTION);
+	if (part->bcp_lru_chain.load() != NULL)
 	{
 		lruSync.lock(SYNC_EXCLUSIVE);
-		requeueRecentlyUsed(bcb);
+		requeueRecentlyUsed(part);
 		lruSync.downgrade(SYNC_SHARED);
 	}
 	else
 		lruSync.lock(SYNC_SHARED);
 
-	for (QUE que_inst = bcb->bcb_in_use.que_backward;
-		 que_inst != &bcb->bcb_in_use;
-		 que_inst = que_inst->que_backward)
+	// get the oldest buffer as the least recently used -- note
+	// that since there are no empty buffers these queues cannot be empty
+
+	if (QUE_EMPTY(part->bcp_in_use) && QUE_EMPTY(part->bcp_cold))
+		BUGCHECK(213);	// msg 213 insufficient cache size
+
+	// With 2Q policy, preempt buffers from the cold que while it exceeds its
+	// limit, from the main LRU que otherwise. Cold que is empty with LRU policy.
+
+	que* queues[] = {&part->bcp_in_use, &part->bcp_cold};
+	if (part->bcp_cold_count > part->bcp_cold_limit)
+		std::swap(queues[0], queues[1]);
+
+	bool found = false;
+	for (FB_SIZE_T i = 0; i < FB_NELEM(queues) && !found; i++)
 	{
-		bdb = nullptr;
+		que* const lru = queues[i];
 
-		// get the oldest buffer as the least recently used -- note
-		// that since there are no empty buffers this queue cannot be empty
+		for (QUE que_inst = lru->que_backward; que_inst != lru; que_inst = que_inst->que_backward)
+		{
+			bdb = nullptr;
 
-		if (bcb->bcb_in_use.que_forward == &bcb->bcb_in_use)
-			BUGCHECK(213);	// msg 213 insufficient cache size
+			BufferDesc* oldest = BLOCK(que_inst, BufferDesc, bdb_in_use);
 
-		BufferDesc* oldest = BLOCK(que_inst, BufferDesc, bdb_in_use);
+			if (oldest->bdb_flags & BDB_lru_chained)
+				continue;
 
-		if (oldest->bdb_flags & BDB_lru_chained)
-			continue;
+			if (oldest->bdb_use_count || !oldest->addRefConditional(tdbb, SYNC_EXCLUSIVE))
+				continue;
 
-		if (oldest->bdb_use_count || !oldest->addRefConditional(tdbb, SYNC_EXCLUSIVE))
-			continue;
+			// Read-ahead uses clean buffers only
+			if ((tdbb->tdbb_flags & TDBB_prefetch) && (oldest->bdb_flags & (BDB_dirty | BDB_db_dirty)))
+			{
+				oldest->release(tdbb, true);
+				continue;
+			}
 
-		/*if (!writeable(oldest))
-		{
-			oldest->release(tdbb, true);
-			continue;
-		}*/
+			/*if (!writeable(oldest))
+			{
+				oldest->release(tdbb, true);
+				continue;
+			}*/
 
-		bdb = oldest;
-		if (!(bdb->bdb_flags & (BDB_dirty | BDB_db_dirty)) || !walk)
-			break;
+			bdb = oldest;
+			found = !(bdb->bdb_flags & (BDB_dirty | BDB_db_dirty)) || !walk ||
+				!(bcb->bcb_flags & BCB_cache_writer);
 
-		if (!(bcb->bcb_flags & BCB_cache_writer))
-			break;
+			if (found)
+				break;
 
-		bcb->bcb_flags |= BCB_free_pending;
-		if (!(bcb->bcb_flags & BCB_writer_active))
-			bcb->bcb_writer_sem.release();
+			free_pending(bcb, part);
 
-		bdb->release(tdbb, true);
-		bdb = nullptr;
-		--walk;
+			bdb->release(tdbb, true);
+			bdb = nullptr;
+			--walk;
+		}
 	}
 
 	lruSync.unlock();
@@ -3806,6 +4662,7 @@ static BufferDesc* get_buffer(thread_db* tdbb, const PageNumber page, SyncType s
 	SET_TDBB(tdbb);
 	Database* dbb = tdbb->getDatabase();
 	BufferControl* bcb = dbb->dbb_bcb;
+	BufferPartition* const part = &bcb->getPartition(page);
 	Attachment* att = tdbb->getAttachment();
 
 	if (att && att->att_bdb_cache)
@@ -3817,6 +4674,7 @@ static BufferDesc* get_buffer(thread_db* tdbb, const PageNumber page, SyncType s
 				if (bdb->bdb_page == page)
 				{
 					recentlyUsed(bdb);
+					bumpHitStats(tdbb, bdb);
 					tdbb->bumpStats(RuntimeStatistics::PAGE_FETCHES);
 					return bdb;
 				}
@@ -3860,6 +4718,7 @@ static BufferDesc* get_buffer(thread_db* tdbb, const PageNumber page, SyncType s
 				if (bdb->bdb_page == page)
 				{
 					recentlyUsed(bdb);
+					bumpHitStats(tdbb, bdb);
 					tdbb->bumpStats(RuntimeStatistics::PAGE_FETCHES);
 					cacheBuffer(att, bdb);
 					return bdb;
@@ -3872,17 +4731,17 @@ static BufferDesc* get_buffer(thread_db* tdbb, const PageNumber page, SyncType s
 			}
 
 			// try empty list
-			if (QUE_NOT_EMPTY(bcb->bcb_empty))
+			if (QUE_NOT_EMPTY(part->bcp_empty))
 			{
-				SyncLockGuard bcbSync(&bcb->bcb_syncEmpty, SYNC_EXCLUSIVE, FB_FUNCTION);
-				if (QUE_NOT_EMPTY(bcb->bcb_empty))
+				SyncLockGuard bcbSync(&part->bcp_syncEmpty, SYNC_EXCLUSIVE, FB_FUNCTION);
+				if (QUE_NOT_EMPTY(part->bcp_empty))
 				{
-					QUE que_inst = bcb->bcb_empty.que_forward;
+					QUE que_inst = part->bcp_empty.que_forward;
 					QUE_DELETE(*que_inst);
 					QUE_INIT(*que_inst);
 					bdb = BLOCK(que_inst, BufferDesc, bdb_que);
 
-					bcb->bcb_inuse++;
+					part->bcp_inuse++;
 					is_empty = true;
 				}
 			}
@@ -3891,15 +4750,23 @@ static BufferDesc* get_buffer(thread_db* tdbb, const PageNumber page, SyncType s
 				bdb->addRef(tdbb, SYNC_EXCLUSIVE);
 			else
 			{
-				bdb = get_oldest_buffer(tdbb, bcb);
+				bdb = get_oldest_buffer(tdbb, bcb, part);
 				if (!bdb)
 				{
+					// Read-ahead doesn't wait for the cache writer
+					if (tdbb->tdbb_flags & TDBB_prefetch)
+					{
+						fb_assert(wait != 1);
+						return nullptr;
+					}
+
 					Thread::yield();
 				}
 				else if (bdb->bdb_page == page)
 				{
 					bdb->downgrade(syncType);
 					recentlyUsed(bdb);
+					bumpHitStats(tdbb, bdb);
 					tdbb->bumpStats(RuntimeStatistics::PAGE_FETCHES);
 					cacheBuffer(att, bdb);
 					return bdb;
@@ -3922,6 +4789,11 @@ static BufferDesc* get_buffer(thread_db* tdbb, const PageNumber page, SyncType s
 				bdb2 = bcb->bcb_hashTable->emplace(bdb, page, !is_empty);
 				if (!bdb2)
 				{
+					// Preempted buffer was read ahead but never referenced
+					if (bdb->bdb_flags & BDB_prefetch)
+						tdbb->bumpStats(RuntimeStatistics::PAGE_PREFETCH_WASTED);
+
+					const PageNumber oldPage = bdb->bdb_page;
 					bdb->bdb_page = page;
 					bdb->bdb_flags &= BDB_lru_chained; // yes, clear all except BDB_lru_chained
 					bdb->bdb_flags |= BDB_read_pending;
@@ -3933,13 +4805,25 @@ static BufferDesc* get_buffer(thread_db* tdbb, const PageNumber page, SyncType s
 					bcbSync.unlock();
 #endif
 
-					if (!(bdb->bdb_flags & BDB_lru_chained))
+					fb_assert(bdb->bdb_partition == part);
+
+					if (bcb->bcb_flags & BCB_two_queues)
+					{
+						// Placement depends on the page history, thus don't defer it
+						SyncLockGuard syncLRU(&part->bcp_syncLRU, SYNC_EXCLUSIVE, FB_FUNCTION);
+
+						if (bdb->bdb_flags & BDB_lru_chained)
+							requeueRecentlyUsed(part);
+
+						placeIntoLRU(tdbb, part, bdb, is_empty ? PageNumber(0, 0) : oldPage);
+					}
+					else if (!(bdb->bdb_flags & BDB_lru_chained))
 					{
-						Sync syncLRU(&bcb->bcb_syncLRU, FB_FUNCTION);
+						Sync syncLRU(&part->bcp_syncLRU, FB_FUNCTION);
 						if (syncLRU.lockConditional(SYNC_EXCLUSIVE))
 						{
 							QUE_DELETE(bdb->bdb_in_use);
-							QUE_INSERT(bcb->bcb_in_use, bdb->bdb_in_use);
+							QUE_INSERT(part->bcp_in_use, bdb->bdb_in_use);
 						}
 						else
 							recentlyUsed(bdb);
@@ -3962,6 +4846,7 @@ static BufferDesc* get_buffer(thread_db* tdbb, const PageNumber page, SyncType s
 					continue;
 				}
 				recentlyUsed(bdb2);
+				bumpHitStats(tdbb, bdb2);
 				tdbb->bumpStats(RuntimeStatistics::PAGE_FETCHES);
 				cacheBuffer(att, bdb2);
 			}
@@ -3971,9 +4856,9 @@ static BufferDesc* get_buffer(thread_db* tdbb, const PageNumber page, SyncType s
 			bdb->release(tdbb, true);
 			if (is_empty)
 			{
-				SyncLockGuard syncEmpty(&bcb->bcb_syncEmpty, SYNC_EXCLUSIVE, FB_FUNCTION);
-				QUE_INSERT(bcb->bcb_empty, bdb->bdb_que);
-				bcb->bcb_inuse--;
+				SyncLockGuard syncEmpty(&part->bcp_syncEmpty, SYNC_EXCLUSIVE, FB_FUNCTION);
+				QUE_INSERT(part->bcp_empty, bdb->bdb_que);
+				part->bcp_inuse--;
 			}
 
 			if (!bdb2 && wait > 0)
@@ -4241,6 +5126,12 @@ static ULONG memory_init(thread_db* tdbb, BufferControl* bcb, ULONG number)
 	UCHAR* lock_memory = nullptr;
 	const UCHAR* memory_end = nullptr;
 	BufferDesc* tail = nullptr;
+	ULONG block_buffers = 0;
+	ULONG block_index = 0;
+
+	const bool huge_pages = (bcb->bcb_flags & BCB_huge_pages);
+	const bool raw_memory = huge_pages || (bcb->bcb_flags & (BCB_numa_interleave | BCB_numa_partition));
+	const ULONG partitions = bcb->bcb_partitions.getCount();
 
 	const size_t lock_key_extra = PageNumber::getLockLen() > Lock::KEY_STATIC_SIZE ?
 		PageNumber::getLockLen() - Lock::KEY_STATIC_SIZE : 0;
@@ -4267,11 +5158,23 @@ static ULONG memory_init(thread_db* tdbb, BufferControl* bcb, ULONG number)
 					return buffers;
 				}
 
+				BufferControl::MemoryBlock mem;
+				mem.m_size = 0;
+
 				try
 				{
-					memory = (UCHAR*) bcb->bcb_bufferpool->allocate(memory_size ALLOC_ARGS);
+					if (raw_memory)
+					{
+						// Get memory directly from OS to control its placement
+						mem.m_size = memory_size;
+						memory = (UCHAR*) os_utils::allocLargeBlock(mem.m_size, huge_pages);
+						if (!memory)
+							Firebird::BadAlloc::raise();
+					}
+					else
+						memory = (UCHAR*) bcb->bcb_bufferpool->allocate(memory_size ALLOC_ARGS);
+
 					memory_end = memory + memory_size;
-					break;
 				}
 				catch (Firebird::BadAlloc&)
 				{
@@ -4280,9 +5183,17 @@ static ULONG memory_init(thread_db* tdbb, BufferControl* bcb, ULONG number)
 					// cutting the size in half to see if the buffers can be
 					// scattered over the remaining virtual address space.
 					to_alloc >>= 1;
+					continue;
 				}
+
+				mem.m_memory = memory;
+				bcb->bcb_memory.push(mem);
+
+				if (bcb->bcb_flags & BCB_numa_interleave)
+					os_utils::bindToNumaNode(memory, mem.m_size, -1);
+
+				break;
 			}
-			bcb->bcb_memory.push(memory);
 
 			tail = (BufferDesc*) FB_ALIGN(memory, alignof(BufferDesc));
 
@@ -4303,9 +5214,38 @@ static ULONG memory_init(thread_db* tdbb, BufferControl* bcb, ULONG number)
 			memory = FB_ALIGN(memory, page_size);
 
 			fb_assert(memory_end >= memory + page_size * to_alloc);
+
+			block_buffers = to_alloc;
+			block_index = 0;
+
+			// Place page buffers of every partition on the node of its writer,
+			// see get_dirty_buffer()
+
+			if (bcb->bcb_flags & BCB_numa_partition)
+			{
+				const ULONG nodes = os_utils::getNumaNodes();
+
+				for (ULONG n = 0; n < partitions; n++)
+				{
+					const ULONG first = block_buffers * n / partitions;
+					const ULONG last = block_buffers * (n + 1) / partitions;
+
+					os_utils::bindToNumaNode(memory + first * page_size,
+						(last - first) * page_size, n % nodes);
+				}
+			}
 		}
 
-		tail = ::new(tail) BufferDesc(bcb);
+		// Distribute buffers between partitions evenly. If partitions are bound
+		// to NUMA nodes, every partition gets a contiguous range of the block.
+
+		const ULONG part_no = (bcb->bcb_flags & BCB_numa_partition) ?
+			MIN(block_index * partitions / block_buffers, partitions - 1) :
+			(bcb->bcb_count + buffers) % partitions;
+
+		BufferPartition& part = bcb->bcb_partitions[part_no];
+		tail = ::new(tail) BufferDesc(bcb, &part);
+		block_index++;
 
 		if (!(bcb->bcb_flags & BCB_exclusive))
 		{
@@ -4318,7 +5258,11 @@ static ULONG memory_init(thread_db* tdbb, BufferControl* bcb, ULONG number)
 		tail->bdb_buffer = (pag*) memory;
 		memory += bcb->bcb_page_size;
 
-		QUE_INSERT(bcb->bcb_empty, tail->bdb_que);
+		{
+			SyncLockGuard syncEmpty(&part.bcp_syncEmpty, SYNC_EXCLUSIVE, FB_FUNCTION);
+			QUE_INSERT(part.bcp_empty, tail->bdb_que);
+			part.bcp_count++;
+		}
 		tail++;
 
 		buffers++;				// Allocated buffers
@@ -4353,6 +5297,39 @@ static ULONG memory_init(thread_db* tdbb, BufferControl* bcb, ULONG number)
 }
 
 
+static void setup_partitions(BufferControl* bcb)
+{
+/**************************************
+ *
+ *	s e t u p _ p a r t i t i o n s
+ *
+ **************************************
+ *
+ * Functional description
+ *	Adjust thresholds of cache partitions to the
+ *	number of buffers they own.
+ *
+ **************************************/
+	for (auto& part : bcb->bcb_partitions)
+	{
+		SyncLockGuard lruSync(&part.bcp_syncLRU, SYNC_EXCLUSIVE, FB_FUNCTION);
+
+		part.bcp_free_minimum = (SSHORT) MIN(part.bcp_count / 4, 128);	// 25% clean page reserve
+
+		// 2Q keeps a quarter of buffers in the cold que and remembers
+		// twice as many evicted pages as the cold que may hold.
+		// Remembered pages are forgotten when the cache is expanded.
+
+		if (bcb->bcb_flags & BCB_two_queues)
+		{
+			part.bcp_cold_limit = MAX(part.bcp_count / 4, 1);
+			part.bcp_ghosts.clear();
+			part.bcp_ghosts.grow(MAX(part.bcp_count / 2, 1));
+		}
+	}
+}
+
+
 static void page_validation_error(thread_db* tdbb, WIN* window, SSHORT type)
 {
 /**************************************
@@ -4388,198 +5365,335 @@ static void page_validation_error(thread_db* tdbb, WIN* window, SSHORT type)
 }
 
 
-#ifdef CACHE_READER
-static void prefetch_epilogue(Prefetch* prefetch, FbStatusVector* status_vector)
+static FB_SIZE_T prefetch_pages(thread_db* tdbb, const PageNumber* pages, FB_SIZE_T count)
 {
 /**************************************
  *
- *	p r e f e t c h _ e p i l o g u e
+ *	p r e f e t c h _ p a g e s
  *
  **************************************
  *
  * Functional description
- *	Stall on asynchronous I/O completion.
- *	Move data from prefetch buffer to database
- *	buffers, compute the checksum, and release
- *	the latch.
+ *	Read pages into cache on behalf of cache reader
+ *	using batched I/O: latch buffers for pages not in
+ *	cache, then read all of them at once. Don't wait
+ *	for busy buffers - if page is latched by somebody,
+ *	it is already in cache or will be read by the latch
+ *	owner. Batch stops at the page space boundary.
+ *	Return number of pages processed.
  *
  **************************************/
-	if (!(prefetch->prf_flags & PRF_active))
-		return;
+	Database* const dbb = tdbb->getDatabase();
+	BufferControl* const bcb = dbb->dbb_bcb;
 
-	thread_db* tdbb = prefetch->prf_tdbb;
-	Database* dbb = tdbb->getDatabase();
+	// Buffers of the batch stay latched until all pages are read, thus don't
+	// write dirty buffers to get free ones - it could wait for somebody who
+	// is waiting for a page of our batch
+
+	AutoSetRestoreFlag<ULONG> noWrite(&tdbb->tdbb_flags, TDBB_prefetch, true);
+
+	const USHORT pageSpaceId = pages->getPageSpaceID();
 
-	prefetch->prf_piob.piob_wait = TRUE;
-	const bool async_status = PIO_status(dbb, &prefetch->prf_piob, status_vector);
+	win_for_array windows[PREFETCH_BATCH];
+	PioRequest requests[PREFETCH_BATCH];
+	FB_SIZE_T latched = 0;
+	FB_SIZE_T n = 0;
 
-	// If there was an I/O error release all buffer latches acquired for the prefetch request.
+	while (n < count && latched < PREFETCH_BATCH && pages[n].getPageSpaceID() == pageSpaceId)
+	{
+		const PageNumber& page = pages[n++];
+
+		if (find_buffer(bcb, page))
+			continue;
+
+		WIN& window = windows[latched];
+		window.win_page = page;
 
-	if (!async_status)
+		const LockState state = CCH_fetch_lock(tdbb, &window, LCK_read, LCK_NO_WAIT, pag_undefined);
+
+		if (state == lsLocked)
+			requests[latched++].pior_bdb = window.win_bdb;
+		else if (state == lsLockedHavePage)
+			CCH_RELEASE(tdbb, &window);
+		else if (state == lsLatchTimeout)
+			break;	// no clean buffers left
+	}
+
+	if (latched)
 	{
-		BufferDesc** next_bdb = prefetch->prf_bdbs;
-		for (USHORT i = 0; i < prefetch->prf_max_prefetch; i++)
+		const PageSpace* const pageSpace = dbb->dbb_page_manager.findPageSpace(pageSpaceId);
+		PIO_read_batch(tdbb, pageSpace->file, requests, latched);
+
+		for (FB_SIZE_T i = 0; i < latched; i++)
 		{
-			if (*next_bdb)
-				release_bdb(tdbb, *next_bdb, true, false, false);
+			// Page not read completely by the batch is read again (and
+			// error reported) the usual way, by fetch_page itself
 
-			next_bdb++;
+			fetch_page(tdbb, &windows[i], true, requests[i].pior_done);
+
+			if (!(tdbb->tdbb_flags & TDBB_cache_load))
+			{
+				windows[i].win_bdb->bdb_flags |= BDB_prefetch;
+				tdbb->bumpStats(RuntimeStatistics::PAGE_PREFETCHES);
+			}
+
+			CCH_RELEASE(tdbb, &windows[i]);
 		}
-		prefetch->prf_flags &= ~PRF_active;
-		return;
 	}
 
-	const SCHAR* next_buffer = prefetch->prf_io_buffer;
-	BufferDesc** next_bdb = prefetch->prf_bdbs;
+	return n;
+}
+
+
+// File with saved page cache contents: header followed by numbers of pages
+// of the main database page space, most recently used first
+
+const char* const CACHE_SAVE_SUFFIX = ".pgc";
+const ULONG CACHE_SAVE_MAGIC = 0x43504246;	// "FBPC"
+const USHORT CACHE_SAVE_VERSION = 1;
+
+struct CacheSaveHeader
+{
+	ULONG csh_magic;
+	USHORT csh_version;
+	USHORT csh_spare;
+	ULONG csh_page_size;
+	ULONG csh_count;		// Number of pages saved
+	Guid csh_guid;			// Database GUID
+};
+
+
+static void save_cache(thread_db* tdbb, BufferControl* bcb)
+{
+/**************************************
+ *
+ *	s a v e _ c a c h e
+ *
+ **************************************
+ *
+ * Functional description
+ *	Save numbers of cached pages, most recently used first,
+ *	to let them be reloaded after restart. Pages of every
+ *	partition are interleaved to keep the global order
+ *	roughly. Errors are logged and otherwise ignored.
+ *
+ **************************************/
+	Database* const dbb = tdbb->getDatabase();
+	MemoryPool& pool = *tdbb->getDefaultPool();
+
+	ObjectsArray<Array<ULONG> > partPages(pool);
+	FB_SIZE_T maxCount = 0;
 
-	for (USHORT i = 0; i < prefetch->prf_max_prefetch; i++)
+	for (auto& part : bcb->bcb_partitions)
 	{
-		if (*next_bdb)
+		Array<ULONG>& list = partPages.add();
+
+		Sync lruSync(&part.bcp_syncLRU, FB_FUNCTION);
+		lruSync.lock(SYNC_SHARED);
+
+		// Main que goes first, it holds pages referenced more than once
+
+		que* const queues[] = {&part.bcp_in_use, &part.bcp_cold};
+
+		for (FB_SIZE_T i = 0; i < FB_NELEM(queues); i++)
 		{
-			pag* page = (*next_bdb)->bdb_buffer;
-			if (next_buffer != reinterpret_cast<char*>(page))
-				memcpy(page, next_buffer, (ULONG) dbb->dbb_page_size);
+			que* const lru = queues[i];
 
-			if (page->pag_pageno == (*next_bdb)->bdb_page.getPageNum())
+			for (QUE que_inst = lru->que_forward; que_inst != lru; que_inst = que_inst->que_forward)
 			{
-				(*next_bdb)->bdb_flags &= ~(BDB_read_pending | BDB_not_valid);
-				(*next_bdb)->bdb_flags |= BDB_prefetch;
+				const BufferDesc* const bdb = BLOCK(que_inst, BufferDesc, bdb_in_use);
+				const PageNumber page = bdb->bdb_page;
+
+				if (page.getPageSpaceID() == DB_PAGE_SPACE && !(bdb->bdb_flags & BDB_not_valid))
+					list.add(page.getPageNum());
 			}
+		}
 
-			release_bdb(tdbb, *next_bdb, true, false, false);
+		maxCount = MAX(maxCount, list.getCount());
+	}
+
+	Array<ULONG> pages(pool);
+
+	for (FB_SIZE_T i = 0; i < maxCount; i++)
+	{
+		for (const auto& list : partPages)
+		{
+			if (i < list.getCount())
+				pages.add(list[i]);
 		}
+	}
+
+	CacheSaveHeader header;
+	memset(&header, 0, sizeof(header));
+	header.csh_magic = CACHE_SAVE_MAGIC;
+	header.csh_version = CACHE_SAVE_VERSION;
+	header.csh_page_size = dbb->dbb_page_size;
+	header.csh_count = pages.getCount();
+	header.csh_guid = dbb->dbb_guid;
+
+	const PathName fileName = dbb->dbb_filename + CACHE_SAVE_SUFFIX;
+	const PathName tempName = fileName + ".tmp";
+
+	EngineCheckout cout(tdbb, FB_FUNCTION, EngineCheckout::UNNECESSARY);
+
+	// Write new list aside and replace old one only when it's complete
+
+	bool done = false;
+	FILE* const file = os_utils::fopen(tempName.c_str(), "wb");
+
+	if (file)
+	{
+		done = fwrite(&header, sizeof(header), 1, file) == 1 &&
+			fwrite(pages.begin(), sizeof(ULONG), pages.getCount(), file) == pages.getCount();
+
+		done = !fclose(file) && done;
+
+#ifdef WIN_NT
+		if (done)
+			remove(fileName.c_str());
+#endif
 
-		next_buffer += dbb->dbb_page_size;
-		next_bdb++;
+		done = done && !rename(tempName.c_str(), fileName.c_str());
+
+		if (!done)
+			remove(tempName.c_str());
 	}
 
-	prefetch->prf_flags &= ~PRF_active;
+	if (!done)
+	{
+		gds__log("Database: %s\n\tCannot save page cache contents into %s, error %d",
+			dbb->dbb_filename.c_str(), fileName.c_str(), errno);
+	}
 }
 
 
-static void prefetch_init(Prefetch* prefetch, thread_db* tdbb)
+static void load_saved_cache(thread_db* tdbb, BufferControl* bcb)
 {
 /**************************************
  *
- *	p r e f e t c h _ i n i t
+ *	l o a d _ s a v e d _ c a c h e
  *
  **************************************
  *
  * Functional description
- *	Initialize prefetch data structure.
- *	Most systems that allow access to "raw" I/O
- *	interfaces want the buffer address aligned.
+ *	Read the list of pages saved by save_cache() and
+ *	prepare them to be reloaded by cache reader: take
+ *	as many most recently used pages as fit into the
+ *	cache and sort them to read in page number order.
  *
  **************************************/
-	Database* dbb = tdbb->getDatabase();
+	Database* const dbb = tdbb->getDatabase();
+	const PathName fileName = dbb->dbb_filename + CACHE_SAVE_SUFFIX;
+
+	FILE* const file = os_utils::fopen(fileName.c_str(), "rb");
+	if (!file)
+		return;
+
+	CacheSaveHeader header;
+	bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+		header.csh_magic == CACHE_SAVE_MAGIC &&
+		header.csh_version == CACHE_SAVE_VERSION &&
+		header.csh_page_size == dbb->dbb_page_size &&
+		!memcmp(&header.csh_guid, &dbb->dbb_guid, sizeof(Guid));
+
+	if (valid)
+	{
+		const ULONG count = MIN(header.csh_count, bcb->bcb_count);
+		valid = fread(bcb->bcb_load.getBuffer(count), sizeof(ULONG), count, file) == count;
+	}
+
+	fclose(file);
+
+	if (!valid)
+	{
+		bcb->bcb_load.clear();
+		gds__log("Database: %s\n\tSaved page cache contents in %s don't match the database, ignored",
+			dbb->dbb_filename.c_str(), fileName.c_str());
+		return;
+	}
 
-	prefetch->prf_tdbb = tdbb;
-	prefetch->prf_flags = 0;
-	prefetch->prf_max_prefetch = PREFETCH_MAX_TRANSFER / dbb->dbb_page_size;
-	prefetch->prf_aligned_buffer =
-		(SCHAR*) (((U_IPTR) &prefetch->prf_unaligned_buffer + MIN_PAGE_SIZE - 1) &
-		~((U_IPTR) MIN_PAGE_SIZE - 1));
+	ULONG* const begin = bcb->bcb_load.begin();
+	ULONG* end = bcb->bcb_load.end();
+
+	std::sort(begin, end);
+	end = std::unique(begin, end);
+
+	// Database could be shrunk since the list was saved
+
+	const ULONG maxPage = PageSpace::maxAlloc(dbb);
+	end = std::lower_bound(begin, end, maxPage);
+
+	bcb->bcb_load.shrink(end - begin);
+	bcb->bcb_load_total = bcb->bcb_load.getCount();
+	bcb->bcb_load_done = 0;
 }
 
 
-static void prefetch_io(Prefetch* prefetch, FbStatusVector* status_vector)
+static FB_SIZE_T get_saved_pages(BufferControl* bcb, FB_SIZE_T pos,
+	HalfStaticArray<PageNumber, PREFETCH_MAX_PAGES>& pages)
 {
 /**************************************
  *
- *	p r e f e t c h _ i o
+ *	g e t _ s a v e d _ p a g e s
  *
  **************************************
  *
  * Functional description
- *	Queue an asynchronous I/O to read
- *	multiple pages into prefetch buffer.
+ *	Take the next portion of saved pages to reload starting
+ *	at given position. Reload shouldn't preempt pages used by
+ *	the current workload, thus pages of partitions without
+ *	never used buffers are skipped. Return the new position,
+ *	or the end of list if no partition has such buffers.
  *
  **************************************/
-	thread_db* tdbb = prefetch->prf_tdbb;
-	Database* dbb = tdbb->getDatabase();
+	bool empty = false;
 
-	if (!prefetch->prf_page_count)
-		prefetch->prf_flags &= ~PRF_active;
-	else
-	{
-		// Get the cache reader working on our behalf too
+	for (const auto& part : bcb->bcb_partitions)
+		empty = empty || QUE_NOT_EMPTY(part.bcp_empty);
 
-		if (!(dbb->dbb_bcb->bcb_flags & BCB_reader_active))
-			dbb->dbb_reader_sem.post();
+	const FB_SIZE_T count = bcb->bcb_load.getCount();
 
-		const bool async_status =
-			PIO_read_ahead(dbb, prefetch->prf_start_page, prefetch->prf_io_buffer,
-						   prefetch->prf_page_count, &prefetch->prf_piob, status_vector);
-		if (!async_status)
-		{
-			BufferDesc** next_bdb = prefetch->prf_bdbs;
-			for (USHORT i = 0; i < prefetch->prf_max_prefetch; i++)
-			{
-				if (*next_bdb)
-					release_bdb(tdbb, *next_bdb, true, false, false);
+	if (!empty)
+		return count;
 
-				next_bdb++;
-			}
-			prefetch->prf_flags &= ~PRF_active;
-		}
+	for (; pos < count && pages.getCount() < PREFETCH_MAX_PAGES; pos++)
+	{
+		const PageNumber page(DB_PAGE_SPACE, bcb->bcb_load[pos]);
+
+		// Queues are checked without latch, it's just a hint
+		if (QUE_NOT_EMPTY(bcb->getPartition(page).bcp_empty))
+			pages.add(page);
 	}
+
+	bcb->bcb_load_done = pos;
+	return pos;
 }
 
 
-static void prefetch_prologue(Prefetch* prefetch, SLONG* start_page)
+static void finish_cache_load(thread_db* tdbb, BufferControl* bcb)
 {
 /**************************************
  *
- *	p r e f e t c h _ p r o l o g u e
+ *	f i n i s h _ c a c h e _ l o a d
  *
  **************************************
  *
  * Functional description
- *	Search for consecutive pages to be prefetched
- *	and latch them for I/O.
+ *	Release the list of saved pages when all of them are
+ *	processed. Progress counters are left for monitoring.
  *
  **************************************/
-	thread_db* tdbb = prefetch->prf_tdbb;
-	Database* dbb = tdbb->getDatabase();
-	BufferControl* bcb = dbb->dbb_bcb;
-
-	prefetch->prf_start_page = *start_page;
-	prefetch->prf_page_count = 0;
-	prefetch->prf_flags |= PRF_active;
+	Database* const dbb = tdbb->getDatabase();
 
-	BufferDesc** next_bdb = prefetch->prf_bdbs;
-	for (USHORT i = 0; i < prefetch->prf_max_prefetch; i++)
+	if (bcb->bcb_load_done < bcb->bcb_load_total)
 	{
-		*next_bdb = 0;
-		if (SBM_clear(bcb->bcb_prefetch, *start_page) &&
-			(*next_bdb = get_buffer(tdbb, *start_page, LATCH_shared, 0)))
-		{
-			if ((*next_bdb)->bdb_flags & BDB_read_pending)
-				prefetch->prf_page_count = i + 1;
-			else
-			{
-				release_bdb(tdbb, *next_bdb, true, false, false);
-				*next_bdb = 0;
-			}
-		}
-
-		next_bdb++;
-		(*start_page)++;
+		gds__log("Database: %s\n\tPage cache is full, reload of saved contents stopped after %"
+			ULONGFORMAT " of %" ULONGFORMAT " pages",
+			dbb->dbb_filename.c_str(), (ULONG) bcb->bcb_load_done, (ULONG) bcb->bcb_load_total);
 	}
 
-	// Optimize non-sequential list prefetching to transfer directly to database buffers.
-
-	BufferDesc* bdb;
-	if (prefetch->prf_page_count == 1 && (bdb = prefetch->prf_bdbs[0]))
-		prefetch->prf_io_buffer = reinterpret_cast<char*>(bdb->bdb_buffer);
-	else
-		prefetch->prf_io_buffer = prefetch->prf_aligned_buffer;
-
-	// Reset starting page for next bitmap walk
-
-	--(*start_page);
+	bcb->bcb_load.free();
 }
-#endif // CACHE_READER
 
 
 static SSHORT related(BufferDesc* low, const BufferDesc* high, SSHORT limit, const ULONG mark)
@@ -4860,6 +5974,213 @@ static int write_buffer(thread_db* tdbb,
 }
 
 
+static bool run_candidate(const BufferDesc* bdb, const PageNumber& page)
+{
+/**************************************
+ *
+ *	r u n _ c a n d i d a t e
+ *
+ **************************************
+ *
+ * Functional description
+ *	Check if buffer latched for I/O could be written as part
+ *	of coalesced run. It must hold the expected dirty page
+ *	and must not wait for other pages to be written first.
+ *
+ **************************************/
+	return (bdb->bdb_page == page) &&
+		(bdb->bdb_flags & (BDB_dirty | BDB_db_dirty)) &&
+		!(bdb->bdb_flags & (BDB_marked | BDB_not_valid)) &&
+		QUE_EMPTY(bdb->bdb_higher);
+}
+
+
+static int write_buffer_run(thread_db* tdbb, BufferDesc* bdb, FbStatusVector* const status,
+	Array<UCHAR>& stage)
+{
+/**************************************
+ *
+ *	w r i t e _ b u f f e r _ r u n
+ *
+ **************************************
+ *
+ * Functional description
+ *	Write a dirty buffer on behalf of cache writer together
+ *	with dirty buffers holding the following pages, using
+ *	single I/O call. Buffers waiting for others due to
+ *	precedence stop the run. Cases not handled here, such
+ *	as shadows, backup in progress and redo log, are passed
+ *	to write_buffer().
+ *
+ *	Return value is the same as of write_buffer().
+ *
+ **************************************/
+	Database* const dbb = tdbb->getDatabase();
+	BufferControl* const bcb = bdb->bdb_bcb;
+	const PageNumber page = bdb->bdb_page;
+
+	if (page == HEADER_PAGE_NUMBER || dbb->dbb_shadow || bcb->bcb_redo_log ||
+		dbb->dbb_backup_manager->getState() != Ods::hdr_nbak_normal)
+	{
+		return write_buffer(tdbb, bdb, page, true, status, true);
+	}
+
+	bdb->lockIO(tdbb);
+	if (!run_candidate(bdb, page))
+	{
+		bdb->unLockIO(tdbb);
+		return write_buffer(tdbb, bdb, page, true, status, true);
+	}
+
+	HalfStaticArray<BufferDesc*, MAX_WRITE_RUN> run;
+	run.add(bdb);
+
+	// Buffers are latched in ascending page order and without waiting,
+	// thus concurrent writers can't deadlock
+
+	while (run.getCount() < MAX_WRITE_RUN)
+	{
+		const PageNumber next(page.getPageSpaceID(), page.getPageNum() + run.getCount());
+		BufferDesc* nextBdb;
+		{
+#ifndef HASH_USE_CDS_LIST
+			SyncLockGuard bcbSync(&bcb->bcb_syncObject, SYNC_SHARED, FB_FUNCTION);
+#endif
+			nextBdb = bcb->bcb_hashTable->find(next);
+		}
+
+		if (!nextBdb || !(nextBdb->bdb_flags & (BDB_dirty | BDB_db_dirty)))
+			break;
+
+		if (!nextBdb->lockIOConditional(tdbb))
+			break;
+
+		if (!run_candidate(nextBdb, next))
+		{
+			nextBdb->unLockIO(tdbb);
+			break;
+		}
+
+		run.add(nextBdb);
+	}
+
+	// Prepare page images to be written. Encrypted images are created by the
+	// crypto manager in temporary buffer and should be copied into stage.
+
+	class RunIo : public CryptoManager::IOCallback
+	{
+	public:
+		RunIo(Array<UCHAR>& stage, ULONG pageSize)
+			: m_stage(stage), m_pageSize(pageSize), m_slot(0), m_page(NULL), m_image(NULL)
+		{ }
+
+		void setPage(FB_SIZE_T slot, pag* page)
+		{
+			m_slot = slot;
+			m_page = page;
+			m_image = NULL;
+		}
+
+		pag* getImage() const
+		{
+			return m_image;
+		}
+
+		bool callback(thread_db* tdbb, FbStatusVector* status, pag* page)
+		{
+			if (page != m_page)
+			{
+				UCHAR* const buffer = m_stage.getBuffer((MAX_WRITE_RUN + 1) * m_pageSize);
+				UCHAR* const aligned = FB_ALIGN(buffer, m_pageSize);
+
+				m_image = (pag*) (aligned + m_slot * m_pageSize);
+				memcpy(m_image, page, m_pageSize);
+			}
+			else
+				m_image = page;
+
+			return true;
+		}
+
+	private:
+		Array<UCHAR>& m_stage;
+		const ULONG m_pageSize;
+		FB_SIZE_T m_slot;
+		pag* m_page;
+		pag* m_image;
+	};
+
+	RunIo io(stage, dbb->dbb_page_size);
+	HalfStaticArray<pag*, MAX_WRITE_RUN> images;
+	bool result = true;
+
+	for (FB_SIZE_T i = 0; i < run.getCount(); i++)
+	{
+		BufferDesc* const runBdb = run[i];
+		pag* const runPage = runBdb->bdb_buffer;
+
+		CCH_TRACE(("WRITE   %d:%06d", runBdb->bdb_page.getPageSpaceID(), runBdb->bdb_page.getPageNum()));
+
+		runPage->pag_generation++;
+		runPage->pag_pageno = runBdb->bdb_page.getPageNum();
+		tdbb->bumpStats(RuntimeStatistics::PAGE_WRITES);
+
+		io.setPage(i, runPage);
+		if (!dbb->dbb_crypto_manager->write(tdbb, status, runPage, &io))
+		{
+			result = false;
+			break;
+		}
+
+		images.add(io.getImage());
+	}
+
+	if (result)
+	{
+		const PageSpace* const pageSpace = dbb->dbb_page_manager.findPageSpace(page.getPageSpaceID());
+		fb_assert(pageSpace);
+
+		tdbb->bumpStats(RuntimeStatistics::PAGE_WRITE_CALLS);
+		result = PIO_write_batch(tdbb, pageSpace->file, run.begin(), images.begin(), run.getCount(), status);
+	}
+
+	for (FB_SIZE_T i = 0; i < run.getCount(); i++)
+	{
+		BufferDesc* const runBdb = run[i];
+
+		page_written(tdbb, runBdb, result);
+		runBdb->unLockIO(tdbb);
+
+		if (result)
+			clear_precedence(tdbb, runBdb);
+	}
+
+	return result ? 1 : 0;
+}
+
+
+static ULONG get_dirty_backlog(const BufferControl* bcb)
+{
+/**************************************
+ *
+ *	g e t _ d i r t y _ b a c k l o g
+ *
+ **************************************
+ *
+ * Functional description
+ *	Return number of dirty buffers waiting to be written.
+ *	Counters are read without latches, result is just a hint.
+ *
+ **************************************/
+	ULONG backlog = 0;
+
+	for (const auto& part : bcb->bcb_partitions)
+		backlog += part.bcp_dirty_count;
+
+	return backlog;
+}
+
+
 static bool write_page(thread_db* tdbb, BufferDesc* bdb, FbStatusVector* const status, const bool inAst)
 {
 /**************************************
@@ -4910,6 +6231,13 @@ static bool write_page(thread_db* tdbb, BufferDesc* bdb, FbStatusVector* const s
 	}
 
 	page->pag_generation++;
+
+	if (!logBeforeWrite(tdbb, bdb, status))
+	{
+		page_written(tdbb, bdb, false);
+		return false;
+	}
+
 	bool result = true;
 
 	//if (!dbb->dbb_wal || write_thru) becomes
@@ -4994,6 +6322,8 @@ static bool write_page(thread_db* tdbb, BufferDesc* bdb, FbStatusVector* const s
 					{
 						Database* dbb = tdbb->getDatabase();
 
+						tdbb->bumpStats(RuntimeStatistics::PAGE_WRITE_CALLS);
+
 						while (!PIO_write(tdbb, file, bdb, page, status))
 						{
 							if (isTempPage || !CCH_rollover_to_shadow(tdbb, dbb, file, inAst))
@@ -5032,11 +6362,30 @@ static bool write_page(thread_db* tdbb, BufferDesc* bdb, FbStatusVector* const s
 
 			}
 		}
-
-		if (result)
-			bdb->bdb_flags &= ~BDB_db_dirty;
 	}
 
+	page_written(tdbb, bdb, result);
+	return result;
+}
+
+
+static void page_written(thread_db* tdbb, BufferDesc* bdb, const bool result)
+{
+/**************************************
+ *
+ *	p a g e _ w r i t t e n
+ *
+ **************************************
+ *
+ * Functional description
+ *	Update buffer state after attempt to write its page.
+ *
+ **************************************/
+	Database* const dbb = tdbb->getDatabase();
+
+	if (result)
+		bdb->bdb_flags &= ~BDB_db_dirty;
+
 	if (!result)
 	{
 		// If there was a write error then idle background threads
@@ -5074,8 +6423,6 @@ static bool write_page(thread_db* tdbb, BufferDesc* bdb, FbStatusVector* const s
 			dbb->dbb_flags &= ~DBB_suspend_bgio;
 		}
 	}
-
-	return result;
 }
 
 static void clear_dirty_flag_and_nbak_state(thread_db* tdbb, BufferDesc* bdb)
@@ -5100,10 +6447,10 @@ void recentlyUsed(BufferDesc* bdb)
 	if (oldFlags & BDB_lru_chained)
 		return;
 
-	BufferControl* bcb = bdb->bdb_bcb;
+	BufferPartition* const part = bdb->bdb_partition;
 
 #ifdef DEV_BUILD
-	volatile BufferDesc* chain = bcb->bcb_lru_chain;
+	volatile BufferDesc* chain = part->bcp_lru_chain;
 	for (; chain; chain = chain->bdb_lru_chain)
 	{
 		if (chain == bdb)
@@ -5112,14 +6459,14 @@ void recentlyUsed(BufferDesc* bdb)
 #endif
 	for (;;)
 	{
-		bdb->bdb_lru_chain = bcb->bcb_lru_chain;
-		if (bcb->bcb_lru_chain.compare_exchange_strong(bdb->bdb_lru_chain, bdb))
+		bdb->bdb_lru_chain = part->bcp_lru_chain;
+		if (part->bcp_lru_chain.compare_exchange_strong(bdb->bdb_lru_chain, bdb))
 			break;
 	}
 }
 
 
-void requeueRecentlyUsed(BufferControl* bcb)
+void requeueRecentlyUsed(BufferPartition* part)
 {
 	BufferDesc* chain = NULL;
 
@@ -5127,8 +6474,8 @@ void requeueRecentlyUsed(BufferControl* bcb)
 
 	for (;;)
 	{
-		chain = bcb->bcb_lru_chain;
-		if (bcb->bcb_lru_chain.compare_exchange_strong(chain, NULL))
+		chain = part->bcp_lru_chain;
+		if (part->bcp_lru_chain.compare_exchange_strong(chain, NULL))
 			break;
 	}
 
@@ -5150,14 +6497,135 @@ void requeueRecentlyUsed(BufferControl* bcb)
 	while ((bdb = reversed) != NULL)
 	{
 		reversed = bdb->bdb_lru_chain;
-		QUE_DELETE(bdb->bdb_in_use);
-		QUE_INSERT(bcb->bcb_in_use, bdb->bdb_in_use);
+
+		// 2Q: references to the buffer in cold FIFO que don't change its position
+		if (!bdb->bdb_cold)
+		{
+			QUE_DELETE(bdb->bdb_in_use);
+			QUE_INSERT(part->bcp_in_use, bdb->bdb_in_use);
+		}
 
 		bdb->bdb_lru_chain = NULL;
 		bdb->bdb_flags &= ~BDB_lru_chained;
 	}
 
-	chain = bcb->bcb_lru_chain;
+	chain = part->bcp_lru_chain;
+}
+
+
+static void leastRecentlyUsed(BufferPartition* part, BufferDesc* bdb)
+{
+/**************************************
+ *
+ *	l e a s t R e c e n t l y U s e d
+ *
+ **************************************
+ *
+ * Functional description
+ *	Make buffer the first candidate for preemption in its
+ *	LRU que. Caller must hold bcp_syncLRU exclusively.
+ *
+ **************************************/
+	QUE_DELETE(bdb->bdb_in_use);
+	QUE_APPEND(bdb->bdb_cold ? part->bcp_cold : part->bcp_in_use, bdb->bdb_in_use);
+}
+
+
+static void removeFromLRU(BufferPartition* part, BufferDesc* bdb)
+{
+/**************************************
+ *
+ *	r e m o v e F r o m L R U
+ *
+ **************************************
+ *
+ * Functional description
+ *	Remove buffer from its LRU que.
+ *	Caller must hold bcp_syncLRU exclusively.
+ *
+ **************************************/
+	QUE_DELETE(bdb->bdb_in_use);
+	QUE_INIT(bdb->bdb_in_use);
+
+	if (bdb->bdb_cold)
+	{
+		fb_assert(part->bcp_cold_count > 0);
+		part->bcp_cold_count--;
+		bdb->bdb_cold = false;
+	}
+}
+
+
+static inline FB_UINT64 ghostKey(const PageNumber& page)
+{
+	// Page space ID is never zero, thus zero key marks an empty slot
+	return ((FB_UINT64) page.getPageSpaceID() << 32) | page.getPageNum();
+}
+
+
+static inline FB_SIZE_T ghostSlot(const BufferPartition* part, FB_UINT64 key)
+{
+	return (FB_SIZE_T) (((key * FB_CONST64(0x9E3779B97F4A7C15)) >> 32) % part->bcp_ghosts.getCount());
+}
+
+
+static void placeIntoLRU(thread_db* tdbb, BufferPartition* part, BufferDesc* bdb, const PageNumber& oldPage)
+{
+/**************************************
+ *
+ *	p l a c e I n t o L R U
+ *
+ **************************************
+ *
+ * Functional description
+ *	2Q replacement policy: put buffer just assigned to a new page
+ *	into the proper LRU que. Page evicted from the cold que is
+ *	remembered in the ghost table. Page found in the ghost table
+ *	was referenced again recently and is promoted to the main que,
+ *	all others go to the cold que.
+ *	Caller must hold bcp_syncLRU exclusively.
+ *
+ **************************************/
+	fb_assert(!(bdb->bdb_flags & BDB_lru_chained));
+
+	const bool wasCold = bdb->bdb_cold;
+	removeFromLRU(part, bdb);
+
+	// Reloaded saved cache contents were hot before restart
+
+	if (part->bcp_ghosts.isEmpty() || (tdbb->tdbb_flags & TDBB_cache_load))
+	{
+		QUE_INSERT(part->bcp_in_use, bdb->bdb_in_use);
+		return;
+	}
+
+	if (wasCold && oldPage.getPageSpaceID())
+	{
+		const FB_UINT64 oldKey = ghostKey(oldPage);
+		part->bcp_ghosts[ghostSlot(part, oldKey)] = oldKey;
+	}
+
+	const FB_UINT64 key = ghostKey(bdb->bdb_page);
+	FB_UINT64& ghost = part->bcp_ghosts[ghostSlot(part, key)];
+
+	if (ghost == key)
+	{
+		ghost = 0;
+		QUE_INSERT(part->bcp_in_use, bdb->bdb_in_use);
+		tdbb->bumpStats(RuntimeStatistics::PAGE_PROMOTIONS);
+		return;
+	}
+
+	QUE_INSERT(part->bcp_cold, bdb->bdb_in_use);
+	bdb->bdb_cold = true;
+	part->bcp_cold_count++;
+}
+
+
+static inline void bumpHitStats(thread_db* tdbb, const BufferDesc* bdb)
+{
+	// Buffer que may change concurrently, it's just a statistics
+	tdbb->bumpStats(bdb->bdb_cold ? RuntimeStatistics::PAGE_COLD_HITS : RuntimeStatistics::PAGE_HOT_HITS);
 }
 
 
@@ -5281,6 +6749,22 @@ void BufferDesc::lockIO(thread_db* tdbb)
 }
 
 
+bool BufferDesc::lockIOConditional(thread_db* tdbb)
+{
+	if (!bdb_syncIO.lockConditional(SYNC_EXCLUSIVE, FB_FUNCTION))
+		return false;
+
+	fb_assert(!bdb_io_locks && bdb_io != tdbb || bdb_io_locks && bdb_io == tdbb);
+
+	bdb_io = tdbb;
+	bdb_io->registerBdb(this);
+	++bdb_io_locks;
+	++bdb_use_count;
+
+	return true;
+}
+
+
 void BufferDesc::unLockIO(thread_db* tdbb)
 {
 	fb_assert(bdb_io && bdb_io == tdbb);
@@ -5304,6 +6788,9 @@ namespace Jrd {
 
 void BCBHashTable::resize(ULONG count)
 {
+	// Every partition gets the same number of chains
+	count = (MAX(count, m_partitions) + m_partitions - 1) / m_partitions * m_partitions;
+
 	const ULONG old_count = m_count;
 	chain_type* const old_chains = m_chains;
 
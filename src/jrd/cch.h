@@ -27,13 +27,11 @@
 #include "../include/fb_blk.h"
 #include "../common/classes/alloc.h"
 #include "../common/classes/RefCounted.h"
+#include "../common/classes/condition.h"
 #include "../common/classes/semaphore.h"
 #include "../common/classes/SyncObject.h"
+#include "../common/classes/objects_array.h"
 #include "../common/ThreadStart.h"
-#ifdef SUPERSERVER_V2
-#include "../jrd/sbm.h"
-#include "../jrd/pag.h"
-#endif
 
 #include "../jrd/que.h"
 #include "../jrd/lls.h"
@@ -63,6 +61,7 @@ struct que;
 class BufferDesc;
 class Database;
 class BCBHashTable;
+class RedoLog;
 
 // Page buffer cache size constraints.
 
@@ -73,6 +72,79 @@ const ULONG MAX_PAGE_BUFFERS = 131072;
 const ULONG MAX_PAGE_BUFFERS = MAX_SLONG - 1;
 #endif
 
+// Constants used by read-ahead mechanism
+
+const ULONG PREFETCH_MAX_PAGES	= 256;	// maximum pages allowed per prefetch request
+const ULONG PREFETCH_MAX_QUEUE	= 4096;	// maximum pages waiting for the cache reader
+const ULONG PREFETCH_BATCH		= 32;	// maximum pages read by cache reader at once
+
+typedef Firebird::SortedArray<PageNumber, Firebird::EmptyStorage<PageNumber> > PrefetchQueue;
+
+// Constants used by cache partitioning
+
+const ULONG MAX_CACHE_PARTITIONS		= 64;
+const ULONG MIN_PARTITION_BUFFERS	= 512;	// minimum buffers per partition if chosen automatically
+
+// Constants used by cache writers
+
+const ULONG MAX_CACHE_WRITERS	= 16;
+const ULONG WRITER_QUEUE_DEPTH	= 32;	// device queue depth per writer if chosen automatically
+const ULONG MAX_WRITE_RUN		= 32;	// maximum adjacent pages written by cache writer at once
+
+// BufferPartition -- independent part of the page cache. Every page is served
+// by the partition selected by its page number, the partition has its own
+// replacement queues, free list and dirty list.
+
+class BufferPartition
+{
+public:
+	explicit BufferPartition(MemoryPool& p)
+		: bcp_ghosts(p)
+	{
+		QUE_INIT(bcp_in_use);
+		QUE_INIT(bcp_cold);
+		QUE_INIT(bcp_empty);
+		QUE_INIT(bcp_dirty);
+		bcp_lru_chain = nullptr;
+		bcp_cold_count = 0;
+		bcp_cold_limit = 0;
+		bcp_dirty_count = 0;
+		bcp_count = 0;
+		bcp_inuse = 0;
+		bcp_free_minimum = 0;
+		bcp_free_pending = false;
+	}
+
+	que			bcp_in_use;			// Que of buffers in use, main LRU que
+	que			bcp_empty;			// Que of empty buffers
+
+	// Recently used buffer put there without locking common LRU que (bcp_in_use).
+	// When bcp_syncLRU is locked this chain is merged into bcp_in_use. See also
+	// requeueRecentlyUsed() and recentlyUsed()
+	std::atomic<BufferDesc*>	bcp_lru_chain;
+
+	// Used by 2Q replacement policy only (see BCB_two_queues). Newly read pages
+	// are put into bcp_cold FIFO que, page numbers evicted from it are remembered
+	// in bcp_ghosts, and pages read again while remembered go into bcp_in_use.
+	// Protected by bcp_syncLRU.
+	que			bcp_cold;			// FIFO que of buffers referenced once
+	ULONG		bcp_cold_count;		// Number of buffers in bcp_cold
+	ULONG		bcp_cold_limit;		// Preferred maximum of bcp_cold_count
+	Firebird::Array<FB_UINT64>	bcp_ghosts;	// Pages recently evicted from bcp_cold
+
+	que			bcp_dirty;			// que of dirty buffers
+	SLONG		bcp_dirty_count;	// count of pages in dirty page btree
+
+	ULONG		bcp_count;			// Number of buffers allocated
+	ULONG		bcp_inuse;			// Number of buffers in use
+	SSHORT		bcp_free_minimum;	// Threshold to activate cache writer
+	std::atomic<bool>	bcp_free_pending;	// cache writer should free pages of this partition
+
+	Firebird::SyncObject	bcp_syncDirtyBdbs;
+	Firebird::SyncObject	bcp_syncEmpty;
+	Firebird::SyncObject	bcp_syncLRU;
+};
+
 // BufferControl -- Buffer control block -- one per system
 
 class BufferControl : public pool_alloc<type_bcb>
@@ -81,27 +153,39 @@ class BufferControl : public pool_alloc<type_bcb>
 		: bcb_bufferpool(&p),
 		  bcb_memory_stats(&parentStats),
 		  bcb_memory(p),
+		  bcb_partitions(p),
 		  bcb_writer_fini(p, cache_writer, THREAD_medium),
+		  bcb_writer_helpers(p),
+		  bcb_reader_fini(p, cache_reader, THREAD_medium),
+		  bcb_prefetch(p),
+		  bcb_load(p),
 		  bcb_bdbBlocks(p)
 	{
 		bcb_database = NULL;
-		QUE_INIT(bcb_in_use);
 		QUE_INIT(bcb_pending);
-		QUE_INIT(bcb_empty);
-		QUE_INIT(bcb_dirty);
-		bcb_dirty_count = 0;
 		bcb_free = NULL;
 		bcb_flags = 0;
-		bcb_free_minimum = 0;
 		bcb_count = 0;
-		bcb_inuse = 0;
+		bcb_dirty_partition = 0;
+		bcb_writer_seq = 0;
 		bcb_prec_walk_mark = 0;
 		bcb_page_size = 0;
 		bcb_page_incarnation = 0;
 		bcb_hashTable = nullptr;
-#ifdef SUPERSERVER_V2
-		bcb_prefetch = NULL;
-#endif
+		bcb_load_total = 0;
+		bcb_load_done = 0;
+		bcb_save_time = 0;
+		bcb_commit_leader = false;
+		bcb_commit_mask = 0;
+		bcb_commit_waiting = 0;
+		bcb_commit_last_batch = 0;
+		bcb_commit_requested = 0;
+		bcb_commit_done = 0;
+		bcb_commit_groups = 0;
+		bcb_commit_count = 0;
+		bcb_commit_max_batch = 0;
+		bcb_commit_latency = 0;
+		bcb_redo_log = NULL;
 	}
 
 public:
@@ -114,33 +198,27 @@ public:
 	Firebird::MemoryPool* bcb_bufferpool;
 	Firebird::MemoryStats bcb_memory_stats;
 
-	UCharStack	bcb_memory;			// Large block partitioned into buffers
-	que			bcb_in_use;			// Que of buffers in use, main LRU que
+	// Large block partitioned into buffers
+	struct MemoryBlock
+	{
+		UCHAR* m_memory;
+		size_t m_size;		// non-zero if allocated directly from OS
+	};
+	Firebird::Array<MemoryBlock>	bcb_memory;
 	que			bcb_pending;		// Que of buffers which are going to be freed and reassigned
-	que			bcb_empty;			// Que of empty buffers
-
-	// Recently used buffer put there without locking common LRU que (bcb_in_use).
-	// When bcb_syncLRU is locked this chain is merged into bcb_in_use. See also
-	// requeueRecentlyUsed() and recentlyUsed()
-	std::atomic<BufferDesc*>	bcb_lru_chain;
 
-	que			bcb_dirty;			// que of dirty buffers
-	SLONG		bcb_dirty_count;	// count of pages in dirty page btree
+	Firebird::ObjectsArray<BufferPartition>	bcb_partitions;	// see BufferPartition
+	std::atomic<ULONG>	bcb_dirty_partition;	// next partition to look for dirty buffers
 
 	Precedence*	bcb_free;			// Free precedence blocks
 	Firebird::AtomicCounter	bcb_flags;	// see below
-	SSHORT		bcb_free_minimum;	// Threshold to activate cache writer
 	ULONG		bcb_count;			// Number of buffers allocated
-	ULONG		bcb_inuse;			// Number of buffers in use
 	ULONG		bcb_prec_walk_mark;	// mark value used in precedence graph walk
 	ULONG		bcb_page_size;		// Database page size in bytes
 	ULONG		bcb_page_incarnation;	// Cache page incarnation counter
 
 	Firebird::SyncObject	bcb_syncObject;
-	Firebird::SyncObject	bcb_syncDirtyBdbs;
-	Firebird::SyncObject	bcb_syncEmpty;
 	Firebird::SyncObject	bcb_syncPrecedence;
-	Firebird::SyncObject	bcb_syncLRU;
 
 	// If we make bcb_flags atomic this mutex will become unneeded: XCHG of bcb_flags is enough
 	Firebird::Mutex			bcb_threadStartup;
@@ -151,18 +229,49 @@ public:
 	Firebird::Semaphore bcb_writer_sem;		// Wake up cache writer
 	Firebird::Semaphore bcb_writer_init;	// Cache writer initialization
 	BcbThreadSync bcb_writer_fini;			// Cache writer finalization
-#ifdef SUPERSERVER_V2
+
+	// Additional cache writers, started and stopped by the main one
+	static void cache_writer_helper(BufferControl* bcb);
+	Firebird::Array<BcbThreadSync*> bcb_writer_helpers;
+	std::atomic<ULONG> bcb_writer_seq;		// Started writers, assigns their NUMA nodes
+
 	static void cache_reader(BufferControl* bcb);
-	// the code in cch.cpp is not tested for semaphore instead event !!!
 	Firebird::Semaphore bcb_reader_sem;		// Wake up cache reader
 	Firebird::Semaphore bcb_reader_init;	// Cache reader initialization
 	BcbThreadSync bcb_reader_fini;			// Cache reader finalization
 
-	PageBitmap*	bcb_prefetch;		// Bitmap of pages to prefetch
-#endif
+	Firebird::Mutex	bcb_prefetch_mutex;		// Protects bcb_prefetch
+	PrefetchQueue	bcb_prefetch;			// Pages waiting to be read ahead
+
+	// Saved cache contents reloaded by cache reader after restart
+	Firebird::Array<ULONG>	bcb_load;		// Pages to reload in ascending order, cache reader only
+	std::atomic<ULONG>	bcb_load_total;		// Number of pages to reload
+	std::atomic<ULONG>	bcb_load_done;		// Number of pages processed so far
+	time_t		bcb_save_time;				// Last time cache contents were saved
+
+	// Group commit: concurrent committers share a single flush, see GroupCommitWindow
+	Firebird::Mutex		bcb_commit_mutex;	// Protects bcb_commit_* members
+	Firebird::Condition	bcb_commit_cond;	// Signalled when a group flush is finished
+	bool		bcb_commit_leader;			// Group flush is in progress
+	SLONG		bcb_commit_mask;			// Transactions waiting for the next group flush
+	ULONG		bcb_commit_waiting;			// Number of transactions waiting for the next group flush
+	ULONG		bcb_commit_last_batch;		// Number of transactions in the last group flush
+	FB_UINT64	bcb_commit_requested;		// Last commit request number
+	FB_UINT64	bcb_commit_done;			// Last commit request number flushed
+	FB_UINT64	bcb_commit_groups;			// Number of group flushes done
+	FB_UINT64	bcb_commit_count;			// Number of transactions flushed by groups
+	ULONG		bcb_commit_max_batch;		// Largest number of transactions in a group
+	std::atomic<FB_UINT64>	bcb_commit_latency;	// Total time spent by committers in group flushes, us
+
+	RedoLog*	bcb_redo_log;				// Log of committed page images, see RedoLog setting
 
 	void exceptionHandler(const Firebird::Exception& ex, BcbThreadSync::ThreadRoutine* routine);
 
+	BufferPartition& getPartition(const PageNumber& page)
+	{
+		return bcb_partitions[page.getPageNum() % bcb_partitions.getCount()];
+	}
+
 	BCBHashTable* bcb_hashTable;
 
 	// block of allocated BufferDesc's
@@ -178,12 +287,15 @@ const int BCB_keep_pages	= 1;	// set during btc_flush(), pages not removed from
 const int BCB_cache_writer	= 2;	// cache writer thread has been started
 const int BCB_writer_start  = 4;    // cache writer thread is starting now
 const int BCB_writer_active	= 8;	// no need to post writer event count
-#ifdef SUPERSERVER_V2
 const int BCB_cache_reader	= 16;	// cache reader thread has been started
 const int BCB_reader_active	= 32;	// cache reader not blocked on event
-#endif
-const int BCB_free_pending	= 64;	// request cache writer to free pages
+const int BCB_free_pending	= 64;	// request cache writer to free pages, see also bcp_free_pending
 const int BCB_exclusive		= 128;	// there is only BCB in whole system
+const int BCB_reader_start	= 256;	// cache reader thread is starting now
+const int BCB_two_queues	= 512;	// 2Q replacement policy is used
+const int BCB_huge_pages	= 1024;	// use huge pages for page buffers
+const int BCB_numa_interleave	= 2048;	// interleave page buffers between NUMA nodes
+const int BCB_numa_partition	= 4096;	// bind page buffers of every partition and its writer to one NUMA node
 
 
 // BufferDesc -- Buffer descriptor block
@@ -191,8 +303,9 @@ const int BCB_exclusive		= 128;	// there is only BCB in whole system
 class BufferDesc : public pool_alloc<type_bdb>
 {
 public:
-	explicit BufferDesc(BufferControl* bcb)
+	BufferDesc(BufferControl* bcb, BufferPartition* partition = NULL)
 		: bdb_bcb(bcb),
+		  bdb_partition(partition),
 		  bdb_page(0, 0)
 	{
 		bdb_lock = NULL;
@@ -200,6 +313,7 @@ public:
 		QUE_INIT(bdb_in_use);
 		QUE_INIT(bdb_dirty);
 		bdb_lru_chain = NULL;
+		bdb_cold = false;
 		bdb_buffer = NULL;
 		bdb_incarnation = 0;
 		bdb_transactions = 0;
@@ -221,6 +335,7 @@ public:
 	void release(thread_db* tdbb, bool repost);
 
 	void lockIO(thread_db*);
+	bool lockIOConditional(thread_db*);
 	void unLockIO(thread_db*);
 
 	bool isLocked() const
@@ -239,12 +354,14 @@ public:
 	}
 
 	BufferControl*	bdb_bcb;
+	BufferPartition*	bdb_partition;		// Cache partition the buffer belongs to
 	Firebird::SyncObject	bdb_syncPage;
 	Lock*		bdb_lock;				// Lock block for buffer
-	que			bdb_que;				// Either mod que in hash table or bcb_empty que if never used
+	que			bdb_que;				// Either mod que in hash table or bcp_empty que if never used
 	que			bdb_in_use;				// queue of buffers in use
 	que			bdb_dirty;				// dirty pages LRU queue
 	BufferDesc*	bdb_lru_chain;			// pending LRU chain
+	bool		bdb_cold;				// buffer is in bcp_cold que, protected by bcp_syncLRU
 	Ods::pag*	bdb_buffer;				// Actual buffer
 	PageNumber	bdb_page;				// Database page number in buffer
 	ULONG		bdb_incarnation;
@@ -291,6 +408,7 @@ const int BDB_prefetch			= 0x4000;	// page has been prefetched but not yet refer
 const int BDB_no_blocking_ast	= 0x8000;	// No blocking AST registered with page lock
 const int BDB_lru_chained		= 0x10000;	// buffer is in pending LRU chain
 const int BDB_nbak_state_lock	= 0x20000;	// nbak state lock should be released after buffer is written
+const int BDB_redo_logged		= 0x40000;	// current page image is in redo log
 
 // bdb_ast_flags
 
@@ -347,36 +465,6 @@ enum LATCH
 };
 
 
-
-#ifdef SUPERSERVER_V2
-#include "../jrd/os/pio.h"
-
-// Constants used by prefetch mechanism
-
-const int PREFETCH_MAX_TRANSFER	= 16384;	// maximum block I/O transfer (bytes)
-// maximum pages allowed per prefetch request
-const int PREFETCH_MAX_PAGES	= (2 * PREFETCH_MAX_TRANSFER / MIN_PAGE_SIZE);
-
-// Prefetch block
-
-class Prefetch : public pool_alloc<type_prf>
-{
-public:
-	thread_db*	prf_tdbb;			// thread database context
-	SLONG		prf_start_page;		// starting page of multipage prefetch
-	USHORT		prf_max_prefetch;	// maximum no. of pages to prefetch
-	USHORT		prf_page_count;		// actual no. of pages being prefetched
-	phys_io_blk	prf_piob;			// physical I/O status block
-	SCHAR*		prf_aligned_buffer;	// buffer address aligned for raw (OS cache bypass) I/O
-	SCHAR*		prf_io_buffer;		// I/O buffer address
-	UCHAR		prf_flags;
-	BufferDesc*	prf_bdbs[PREFETCH_MAX_TRANSFER / MIN_PAGE_SIZE];
-	SCHAR		prf_unaligned_buffer[PREFETCH_MAX_TRANSFER + MIN_PAGE_SIZE];
-};
-
-const int PRF_active	= 1;		// prefetch block currently in use
-#endif // SUPERSERVER_V2
-
 typedef Firebird::SortedArray<SLONG, Firebird::InlineStorage<SLONG, 256>, SLONG> PagesArray;
 
 
@@ -63,10 +63,7 @@ void		CCH_must_write(Jrd::thread_db*, Jrd::win*);
 void		CCH_precedence(Jrd::thread_db*, Jrd::win*, ULONG);
 void		CCH_precedence(Jrd::thread_db*, Jrd::win*, Jrd::PageNumber);
 void		CCH_tra_precedence(Jrd::thread_db*, Jrd::win*, TraNumber traNum);
-#ifdef SUPERSERVER_V2
-void		CCH_prefetch(Jrd::thread_db*, SLONG*, SSHORT);
-bool		CCH_prefetch_pages(Jrd::thread_db*);
-#endif
+void		CCH_prefetch(Jrd::thread_db*, USHORT, const ULONG*, FB_SIZE_T);
 void		CCH_release(Jrd::thread_db*, Jrd::win*, const bool);
 void		CCH_release_exclusive(Jrd::thread_db*);
 bool		CCH_rollover_to_shadow(Jrd::thread_db* tdbb, Jrd::Database* dbb, Jrd::jrd_file*, const bool);
@@ -134,13 +131,6 @@ inline void CCH_MARK_MUST_WRITE(Jrd::thread_db* tdbb, Jrd::win* window)
 	CCH_mark(tdbb, window, 0, 1);
 }
 
-#ifdef SUPERSERVER_V2
-inline void CCH_PREFETCH(Jrd::thread_db* tdbb, SLONG* pages, SSHORT count)
-{
-	CCH_prefetch (tdbb, pages, count);
-}
-#endif
-
 //#define CCH_FETCH(tdbb, window, lock, type)		  CCH_fetch (tdbb, window, lock, type, 1, true)
 //#define CCH_FETCH_NO_SHADOW(tdbb, window, lock, type)		  CCH_fetch (tdbb, window, lock, type, 1, false)
 //#define CCH_FETCH_TIMEOUT(tdbb, window, lock, type, latch_wait)   CCH_fetch (tdbb, window, lock, type, latch_wait, true)
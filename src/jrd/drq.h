@@ -246,6 +246,8 @@ enum drq_type_t
 	drq_l_pub_rel_name,		// lookup relation by name
 	drq_l_pub_all_rels,		// iterate through all user relations
 	drq_e_pub_tab_all,		// erase relation from all publication
+	drq_m_rel_extent,		// modify relation extent size
+	drq_m_gen_cache,		// modify generator cache size
 
 	drq_MAX
 };
@@ -451,7 +451,10 @@ bool EVL_field(jrd_rel* relation, Record* record, USHORT id, dsc* desc)
 	if (!desc->dsc_address)
 		return false;
 
-	desc->dsc_address = record->getData() + (IPTR) desc->dsc_address;
+	// Only the record data up to the end of the field needs to be decoded
+
+	const ULONG offset = (IPTR) desc->dsc_address;
+	desc->dsc_address = record->getData(offset + desc->dsc_length) + offset;
 
 	if (record->isNull(id))
 	{
@@ -234,3 +234,5 @@
 	FIELD(fld_integer		, nam_integer		, dtype_long	, sizeof(SLONG)				, 0							, NULL		, true		, ODS_13_1)
 
 	FIELD(fld_par_workers	, nam_par_workers	, dtype_long	, sizeof(SLONG)				, 0							, NULL		, true		, ODS_13_1)
+	FIELD(fld_extent_size	, nam_extent_size	, dtype_short	, sizeof(SSHORT)			, 0							, NULL		, true		, ODS_13_2)
+	FIELD(fld_gen_cache		, nam_gen_cache		, dtype_long	, sizeof(SLONG)				, 0							, NULL		, true		, ODS_13_2)
@@ -185,6 +185,8 @@ enum irq_type_t
 	irq_out_proc_param_dep,	// check output procedure parameter dependency
 	irq_l_pub_tab_state,	// lookup publication state for a table
 	irq_l_index_cnstrt,     // lookup index for constraint
+	irq_l_extent_size,		// lookup relation extent size
+	irq_l_gen_cache,		// lookup generator cache size
 
 	irq_MAX
 };
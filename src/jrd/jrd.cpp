@@ -132,6 +132,7 @@
 #include "../common/utils_proto.h"
 #include "../jrd/DebugInterface.h"
 #include "../jrd/CryptoManager.h"
+#include "../jrd/SequenceCache.h"
 #include "../jrd/DbCreators.h"
 
 #include "../dsql/dsql.h"
@@ -1843,6 +1844,7 @@ JAttachment* JProvider::internalAttach(CheckStatusWrapper* user_status, const ch
 				dbb->dbb_backup_manager->initializeAlloc(tdbb);
 				dbb->dbb_crypto_manager = FB_NEW_POOL(*dbb->dbb_permanent) CryptoManager(tdbb);
 				dbb->dbb_monitoring_data = FB_NEW_POOL(*dbb->dbb_permanent) MonitoringData(dbb);
+				dbb->dbb_sequence_cache = FB_NEW_POOL(*dbb->dbb_permanent) SequenceCache(dbb);
 
 				PAG_init2(tdbb, 0);
 				PAG_header(tdbb, false);
@@ -3100,6 +3102,7 @@ JAttachment* JProvider::createDatabase(CheckStatusWrapper* user_status, const ch
 			dbb->dbb_backup_manager->dbCreating = true;
 			dbb->dbb_crypto_manager = FB_NEW_POOL(*dbb->dbb_permanent) CryptoManager(tdbb);
 			dbb->dbb_monitoring_data = FB_NEW_POOL(*dbb->dbb_permanent) MonitoringData(dbb);
+			dbb->dbb_sequence_cache = FB_NEW_POOL(*dbb->dbb_permanent) SequenceCache(dbb);
 
 			PAG_format_header(tdbb);
 			PAG_format_pip(tdbb, *pageSpace);
@@ -8071,6 +8074,12 @@ bool JRD_shutdown_database(Database* dbb, const unsigned flags)
 	if (dbb->dbb_retaining_lock)
 		LCK_release(tdbb, dbb->dbb_retaining_lock);
 
+	if (dbb->dbb_sequence_cache)
+		dbb->dbb_sequence_cache->shutdown(tdbb);
+
+	if (dbb->dbb_tra_start_lock)
+		LCK_release(tdbb, dbb->dbb_tra_start_lock);
+
 	if (dbb->dbb_sweep_lock)
 		LCK_release(tdbb, dbb->dbb_sweep_lock);
 
@@ -500,6 +500,8 @@ const ULONG TDBB_repl_in_progress		= 8192;		// Prevent recursion in replication
 const ULONG TDBB_replicator				= 16384;	// Replicator
 const ULONG TDBB_async					= 32768;	// Async context (set in AST)
 const ULONG TDBB_no_security_class		= 65536;	// don't assign a security class to the object being created
+const ULONG TDBB_prefetch				= 131072;	// reading ahead a batch of pages, don't write dirty buffers
+const ULONG TDBB_cache_load				= 262144;	// reloading saved cache contents, pages are known to be hot
 
 class thread_db : public Firebird::ThreadData
 {
@@ -559,6 +559,8 @@ static lck_owner_t get_owner_type(enum lck_t lock_type)
 	case LCK_tpc_init:
 	case LCK_tpc_block:
 	case LCK_repl_state:
+	case LCK_tra_start:
+	case LCK_sequence:
 		owner_type = LCK_OWNER_database;
 		break;
 
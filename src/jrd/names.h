@@ -473,3 +473,15 @@ NAME("RDB$VARBINARY_MAX", nam_varbinary_max)
 NAME("RDB$INTEGER", nam_integer)
 
 NAME("MON$PARALLEL_WORKERS", nam_par_workers)
+NAME("MON$PAGE_HOT_HITS", nam_mon_page_hot_hits)
+NAME("MON$PAGE_COLD_HITS", nam_mon_page_cold_hits)
+NAME("MON$PAGE_PROMOTIONS", nam_mon_page_promotions)
+NAME("MON$PAGE_WRITE_CALLS", nam_mon_page_write_calls)
+NAME("MON$CACHE_LOAD_PAGES", nam_mon_cache_load_pages)
+NAME("MON$CACHE_LOADED_PAGES", nam_mon_cache_loaded_pages)
+NAME("RDB$EXTENT_SIZE", nam_extent_size)
+NAME("RDB$GENERATOR_CACHE", nam_gen_cache)
+NAME("MON$GROUP_COMMITS", nam_mon_group_commits)
+NAME("MON$GROUP_COMMIT_TRANSACTIONS", nam_mon_group_commit_trans)
+NAME("MON$GROUP_COMMIT_MAX_SIZE", nam_mon_group_commit_max)
+NAME("MON$GROUP_COMMIT_TIME", nam_mon_group_commit_time)
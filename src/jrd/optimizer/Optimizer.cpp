@@ -582,6 +582,13 @@ namespace
 		}
 	}
 
+	// Check that FIRST/SKIP value is the same every time it's evaluated during the open
+	bool isStableLimit(const ValueExprNode* node)
+	{
+		return !node || nodeIs<LiteralNode>(node) || nodeIs<ParameterNode>(node) ||
+			nodeIs<VariableNode>(node);
+	}
+
 } // namespace
 
 
@@ -589,10 +596,12 @@ namespace
 // Constructor
 //
 
-Optimizer::Optimizer(thread_db* aTdbb, CompilerScratch* aCsb, RseNode* aRse, bool parentFirstRows)
+Optimizer::Optimizer(thread_db* aTdbb, CompilerScratch* aCsb, RseNode* aRse,
+					 bool parentFirstRows, unsigned parentParallelWorkers)
 	: PermanentStorage(*aTdbb->getDefaultPool()),
 	  tdbb(aTdbb), csb(aCsb), rse(aRse),
 	  firstRows(rse->firstRows.orElse(parentFirstRows)),
+	  parallelWorkers(rse->parallelWorkers ? rse->parallelWorkers : parentParallelWorkers),
 	  compileStreams(getPool()),
 	  bedStreams(getPool()),
 	  keyStreams(getPool()),
@@ -679,7 +688,7 @@ RecordSource* Optimizer::compile(RseNode* subRse, BoolExprNodeStack* parentStack
 	//			if we're going to sort/aggregate the resultset afterwards
 	const bool subFirstRows = firstRows && !rse->rse_sorted && !rse->rse_aggregate;
 
-	Optimizer subOpt(tdbb, csb, subRse, subFirstRows);
+	Optimizer subOpt(tdbb, csb, subRse, subFirstRows, parallelWorkers);
 	const auto rsb = subOpt.compile(parentStack);
 
 	if (parentStack && subOpt.isInnerJoin())
@@ -1121,6 +1130,26 @@ RecordSource* Optimizer::compile(BoolExprNodeStack* parentStack)
 
 	checkIndices();
 
+	// GROUP BY may be done by hashing the unsorted stream if the groups
+	// are expected to fit the memory. Otherwise sorting is cheaper than
+	// multiple passes of the hash aggregation over the buffered rows.
+
+	if (rse->flags & RseNode::FLAG_HASH_GROUPING)
+	{
+		double groups = rsb->getCardinality();
+
+		for (auto count = sort ? sort->expressions.getCount() : 0; count; count--)
+			groups *= REDUCE_SELECTIVITY_FACTOR_EQUALITY;
+
+		if (sort && sort == rse->rse_sorted && !project &&
+			groups <= HashAggregatedStream::maxCapacity())
+		{
+			sort = nullptr;
+		}
+		else
+			rse->flags &= ~RseNode::FLAG_HASH_GROUPING;
+	}
+
 	if (project || sort)
 	{
 		// Eliminate any duplicate dbkey streams
@@ -1137,7 +1166,20 @@ RecordSource* Optimizer::compile(BoolExprNodeStack* parentStack)
 
 		// Handle sort clause if present
 		if (sort)
-			rsb = generateSort(bedStreams, &keyStreams, rsb, sort, favorFirstRows(), false);
+		{
+			const auto sortRsb = generateSort(bedStreams, &keyStreams, rsb, sort, favorFirstRows(), false);
+
+			// If FIRST is applied to the sorted records directly, the sort needs
+			// to keep only FIRST + SKIP records. Locking could skip some of them.
+
+			if (rse->rse_first && !rse->hasWriteLock() && !rse->hasSkipLocked() &&
+				isStableLimit(rse->rse_first) && isStableLimit(rse->rse_skip))
+			{
+				sortRsb->setLimit(rse->rse_first, rse->rse_skip);
+			}
+
+			rsb = sortRsb;
+		}
 	}
 
 	// Add invariant booleans, if any. They should be evaluated before
@@ -1908,6 +1950,7 @@ void Optimizer::checkSorts()
 			{
 				setDirection(project, group);
 				project = rse->rse_projection = nullptr;
+				aggregate->keepOrder = true;
 			}
 		}
 
@@ -1938,6 +1981,7 @@ void Optimizer::checkSorts()
 				setDirection(sort, group);
 				setPosition(sort, group, map);
 				sort = rse->rse_sorted = nullptr;
+				aggregate->keepOrder = true;
 			}
 		}
 	}
@@ -2519,7 +2563,7 @@ void Optimizer::formRivers(const StreamList& streams,
 
 //
 // We've got a set of rivers that may or may not be amenable to
-// a hash join or a sort/merge join, and it's time to find out.
+// a hash join, and it's time to find out.
 // If there are, build an appropriate join RecordSource,
 // push it on the rsb stack, and update rivers accordingly.
 // If two or more rivers were successfully joined, return true.
@@ -2667,7 +2711,7 @@ bool Optimizer::generateEquiJoin(RiverList& rivers, JoinType joinType)
 	RiverList joinedRivers;
 	HalfStaticArray<NestValueArray*, OPT_STATIC_ITEMS> keys;
 	unsigned position = 0, maxCardinalityPosition = 0, lowestPosition = MAX_ULONG;
-	double maxCardinality1 = 0, maxCardinality2 = 0;
+	double maxCardinality = 0;
 
 	for (auto iter = orgRivers.begin(); iter < orgRivers.end(); position++)
 	{
@@ -2689,14 +2733,11 @@ bool Optimizer::generateEquiJoin(RiverList& rivers, JoinType joinType)
 		const auto rsb = river->getRecordSource();
 		const auto cardinality = rsb->getCardinality();
 
-		if (cardinality > maxCardinality1)
+		if (cardinality > maxCardinality)
 		{
-			maxCardinality2 = maxCardinality1;
-			maxCardinality1 = cardinality;
+			maxCardinality = cardinality;
 			maxCardinalityPosition = joinedRivers.getCount();
 		}
-		else if (cardinality > maxCardinality2)
-			maxCardinality2 = cardinality;
 
 		streams.join(river->getStreams());
 		joinedRivers.add(river);
@@ -2710,66 +2751,30 @@ bool Optimizer::generateEquiJoin(RiverList& rivers, JoinType joinType)
 			keys.back()->add(eq_class[position]);
 	}
 
-	const bool hashOverflow = (maxCardinality2 > HashJoin::maxCapacity());
-
-	// If any of to-be-hashed rivers is too large to be hashed efficiently,
-	// then prefer a merge join instead of a hash join.
-
-	const bool useMergeJoin = hashOverflow;
-
-	// Build a join stream
-
-	HalfStaticArray<RecordSource*, OPT_STATIC_ITEMS> rsbs;
-	RecordSource* finalRsb = nullptr;
+	// Build a join stream. Hash join spills to the temporary space
+	// if the hashed rivers don't fit the memory, so it's always used.
 
-	// MERGE JOIN does not support other join types yet
-	if (useMergeJoin && joinType == INNER_JOIN)
+	if (joinType == INNER_JOIN)
 	{
-		position = 0;
-		for (const auto river : joinedRivers)
-		{
-			const auto sort = FB_NEW_POOL(getPool()) SortNode(getPool());
+		// Ensure that the largest river is placed at the first position.
+		// It's important for a hash join to be efficient.
 
-			for (const auto key : *keys[position++])
-			{
-				fb_assert(river->isReferenced(key));
+		const auto maxCardinalityRiver = joinedRivers[maxCardinalityPosition];
+		joinedRivers[maxCardinalityPosition] = joinedRivers[0];
+		joinedRivers[0] = maxCardinalityRiver;
 
-				sort->direction.add(ORDER_ASC);	// ascending sort
-				sort->nullOrder.add(NULLS_DEFAULT);	// default nulls placement
-				sort->expressions.add(key);
-			}
-
-			const auto rsb = generateSort(river->getStreams(), nullptr,
-				river->getRecordSource(), sort, favorFirstRows(), false);
-
-			rsbs.add(rsb);
-		}
-
-		finalRsb = FB_NEW_POOL(getPool())
-			MergeJoin(csb, rsbs.getCount(), (SortedStream**) rsbs.begin(), keys.begin());
+		const auto maxCardinalityKey = keys[maxCardinalityPosition];
+		keys[maxCardinalityPosition] = keys[0];
+		keys[0] = maxCardinalityKey;
 	}
-	else
-	{
-		if (joinType == INNER_JOIN)
-		{
-			// Ensure that the largest river is placed at the first position.
-			// It's important for a hash join to be efficient.
-
-			const auto maxCardinalityRiver = joinedRivers[maxCardinalityPosition];
-			joinedRivers[maxCardinalityPosition] = joinedRivers[0];
-			joinedRivers[0] = maxCardinalityRiver;
 
-			const auto maxCardinalityKey = keys[maxCardinalityPosition];
-			keys[maxCardinalityPosition] = keys[0];
-			keys[0] = maxCardinalityKey;
-		}
+	HalfStaticArray<RecordSource*, OPT_STATIC_ITEMS> rsbs;
 
-		for (const auto river : joinedRivers)
-			rsbs.add(river->getRecordSource());
+	for (const auto river : joinedRivers)
+		rsbs.add(river->getRecordSource());
 
-		finalRsb = FB_NEW_POOL(getPool())
-			HashJoin(tdbb, csb, joinType, rsbs.getCount(), rsbs.begin(), keys.begin());
-	}
+	RecordSource* finalRsb = FB_NEW_POOL(getPool())
+		HashJoin(tdbb, csb, joinType, rsbs.getCount(), rsbs.begin(), keys.begin());
 
 	// Pick up any boolean that may apply
 	finalRsb = applyLocalBoolean(finalRsb, streams, iter);
@@ -3189,7 +3194,33 @@ RecordSource* Optimizer::generateRetrieval(StreamType stream,
 		}
 		else
 		{
-			rsb = FB_NEW_POOL(getPool()) FullTableScan(csb, alias, stream, relation, dbkeyRanges);
+			const auto scan = FB_NEW_POOL(getPool()) FullTableScan(csb, alias, stream, relation, dbkeyRanges);
+			rsb = scan;
+
+			// Simple conjuncts are checked by the scan over batches of records read ahead,
+			// unless the stream is going to be updated, locked or read by an unstable cursor
+
+			if (boolean && !rse->hasWriteLock() &&
+				!(tail->csb_flags & (csb_update | csb_unstable | csb_skip_locked)))
+			{
+				scan->setBatchBoolean(BatchBoolean::create(csb, stream, boolean));
+			}
+
+			// Read a big table in parallel unless the stream is going to be updated.
+			// Whether it's really worth it is decided at runtime.
+
+			const auto attachment = tdbb->getAttachment();
+
+			if (dbkeyRanges.isEmpty() &&
+				!(tail->csb_flags & csb_update) &&
+				!(csb->csb_g_flags & csb_internal) &&
+				!relation->isTemporary() && !relation->isSystem() &&
+				(parallelWorkers > 1 ||
+					(!parallelWorkers && attachment && attachment->att_parallel_workers > 1)))
+			{
+				rsb = FB_NEW_POOL(getPool()) ParallelTableScan(csb, alias, stream, relation, rsb,
+					boolean, parallelWorkers, (rse->rse_first || rse->rse_skip));
+			}
 
 			if (boolean)
 				csb->csb_rpt[stream].csb_flags |= csb_unmatched;
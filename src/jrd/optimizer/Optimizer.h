@@ -493,7 +493,7 @@ public:
 			firstRows = attachment->att_opt_first_rows.orElse(defaultFirstRows);
 		}
 
-		return Optimizer(tdbb, csb, rse, firstRows).compile(nullptr);
+		return Optimizer(tdbb, csb, rse, firstRows, 0).compile(nullptr);
 	}
 
 	~Optimizer();
@@ -567,7 +567,8 @@ public:
 	void printf(const char* format, ...);
 
 private:
-	Optimizer(thread_db* aTdbb, CompilerScratch* aCsb, RseNode* aRse, bool parentFirstRows);
+	Optimizer(thread_db* aTdbb, CompilerScratch* aCsb, RseNode* aRse,
+			  bool parentFirstRows, unsigned parentParallelWorkers);
 	Optimizer(thread_db* aTdbb, CompilerScratch* aCsb, RseNode* aRse, const BoolExprNodeStack& stack);
 
 	RecordSource* compile(BoolExprNodeStack* parentStack);
@@ -609,6 +610,7 @@ private:
 	RseNode* const rse;
 
 	bool firstRows = false;					// optimize for first rows
+	unsigned parallelWorkers = 0;			// workers requested for table scans, 0 - not specified
 	double cardinality = 0;					// self or parent cardinality
 
 	FILE* debugFile = nullptr;
@@ -90,6 +90,16 @@ const USHORT FIL_sh_write			= 8;	// file opened in shared write mode
 const USHORT FIL_no_fast_extend		= 16;	// file not supports fast extending
 const USHORT FIL_raw_device			= 32;	// file is raw device
 
+// Page read request for batched I/O
+
+class BufferDesc;
+
+struct PioRequest
+{
+	BufferDesc* pior_bdb;		// buffer to read page into
+	bool pior_done;				// page is read completely
+};
+
 // Physical IO trace events
 
 const SSHORT trace_create	= 1;
@@ -30,6 +30,7 @@ namespace Jrd {
 	class jrd_file;
 	class Database;
 	class BufferDesc;
+	struct PioRequest;
 }
 
 namespace Ods {
@@ -37,6 +38,7 @@ namespace Ods {
 }
 
 int		PIO_add_file(Jrd::thread_db*, Jrd::jrd_file*, const Firebird::PathName&, SLONG);
+bool	PIO_batch_io(Jrd::thread_db*);
 void	PIO_close(Jrd::jrd_file*);
 Jrd::jrd_file*	PIO_create(Jrd::thread_db*, const Firebird::PathName&,
 							const bool, const bool);
@@ -49,7 +51,9 @@ void	PIO_header(Jrd::thread_db*, UCHAR*, int);
 USHORT	PIO_init_data(Jrd::thread_db*, Jrd::jrd_file*, Jrd::FbStatusVector*, ULONG, USHORT);
 Jrd::jrd_file*	PIO_open(Jrd::thread_db*, const Firebird::PathName&,
 						 const Firebird::PathName&);
+ULONG	PIO_queue_depth(const Jrd::jrd_file*);
 bool	PIO_read(Jrd::thread_db*, Jrd::jrd_file*, Jrd::BufferDesc*, Ods::pag*, Jrd::FbStatusVector*);
+void	PIO_read_batch(Jrd::thread_db*, Jrd::jrd_file*, Jrd::PioRequest*, FB_SIZE_T);
 
 #ifdef SUPERSERVER_V2
 bool	PIO_read_ahead(Jrd::thread_db*, SLONG, SCHAR*, SLONG,
@@ -67,6 +71,8 @@ inline bool PIO_on_raw_device(const Firebird::PathName&)
 }
 #endif
 bool	PIO_write(Jrd::thread_db*, Jrd::jrd_file*, Jrd::BufferDesc*, Ods::pag*, Jrd::FbStatusVector*);
+bool	PIO_write_batch(Jrd::thread_db*, Jrd::jrd_file*, Jrd::BufferDesc* const*, Ods::pag* const*,
+						FB_SIZE_T, Jrd::FbStatusVector*);
 
 #endif // JRD_PIO_PROTO_H
 
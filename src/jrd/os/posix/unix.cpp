@@ -48,6 +48,18 @@
 #ifdef HAVE_LINUX_FALLOC_H
 #include <linux/falloc.h>
 #endif
+#ifdef HAVE_LINUX_IO_URING_H
+#include <atomic>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#ifdef HAVE_PWRITEV
+#include <sys/uio.h>
+#endif
+#ifdef LINUX
+#include <sys/sysmacros.h>
+#endif
 
 #ifdef SUPPORT_RAW_DEVICES
 #include <sys/ioctl.h>
@@ -90,6 +102,10 @@ using namespace Firebird;
 
 #define IO_RETRY	20
 
+#ifdef HAVE_PWRITEV
+const FB_SIZE_T MAX_WRITE_IOV = 64;	// pages written by single pwritev() call
+#endif
+
 #ifdef O_SYNC
 #define SYNC		O_SYNC
 #endif
@@ -140,6 +156,257 @@ static int  raw_devices_unlink_database (const PathName&);
 static int	openFile(const Firebird::PathName&, const bool, const bool, const bool);
 static void	maybeCloseFile(int&);
 
+#ifdef HAVE_LINUX_IO_URING_H
+namespace
+{
+	// Minimal io_uring wrapper used to read batches of pages.
+	// Every thread has its own ring, therefore no locking is needed.
+
+	class IoRing
+	{
+	public:
+		static const unsigned RING_SIZE = 64;
+
+		~IoRing()
+		{
+			close();
+		}
+
+		bool init();
+		void close();
+
+		bool isFull() const
+		{
+			return queued + pending == RING_SIZE;
+		}
+
+		void addRead(int fd, void* buffer, unsigned length, FB_UINT64 offset, ULONG tag);
+
+		// Submit queued requests and wait for all of them to complete.
+		// Function is called with tag and result of every completed request.
+		template <typename F>
+		bool submitAndWait(F complete);
+
+	private:
+		// Pass completed requests to the function
+		template <typename F>
+		void reap(F complete);
+
+		// Wait for all submitted requests to complete
+		template <typename F>
+		void drain(F complete);
+
+		int ringFd = -1;
+		bool failed = false;
+		unsigned queued = 0;
+		unsigned pending = 0;
+
+		void* sqRing = MAP_FAILED;
+		void* cqRing = MAP_FAILED;
+		size_t sqRingSize = 0;
+		size_t cqRingSize = 0;
+		io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+
+		unsigned* sqTail = nullptr;
+		unsigned* sqMask = nullptr;
+		unsigned* sqArray = nullptr;
+		unsigned* cqHead = nullptr;
+		unsigned* cqTail = nullptr;
+		unsigned* cqMask = nullptr;
+		io_uring_cqe* cqes = nullptr;
+
+		iovec vectors[RING_SIZE];
+	};
+
+	thread_local IoRing threadRing;
+
+	// Set when kernel doesn't support io_uring, to not try it again
+	std::atomic<bool> ioUringUnavailable(false);
+
+	bool IoRing::init()
+	{
+		if (ringFd >= 0)
+			return true;
+
+		if (failed || ioUringUnavailable)
+			return false;
+
+		io_uring_params params;
+		memset(&params, 0, sizeof(params));
+
+		ringFd = syscall(__NR_io_uring_setup, RING_SIZE, &params);
+		if (ringFd < 0)
+		{
+			if (errno == ENOSYS || errno == EPERM)
+			{
+				if (!ioUringUnavailable.exchange(true))
+					gds__log("io_uring is not available (errno %d), using synchronous I/O", errno);
+			}
+			else
+				gds__log("io_uring setup failed (errno %d), using synchronous I/O", errno);
+
+			failed = true;
+			return false;
+		}
+
+		sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+		if (params.features & IORING_FEAT_SINGLE_MMAP)
+			sqRingSize = cqRingSize = MAX(sqRingSize, cqRingSize);
+
+		sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+
+		if (sqRing != MAP_FAILED)
+		{
+			cqRing = (params.features & IORING_FEAT_SINGLE_MMAP) ? sqRing :
+				mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE,
+					MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+		}
+
+		if (cqRing != MAP_FAILED)
+		{
+			sqes = static_cast<io_uring_sqe*>(mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe),
+				PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES));
+		}
+
+		if (sqes == MAP_FAILED)
+		{
+			gds__log("io_uring mmap failed (errno %d), using synchronous I/O", errno);
+			close();
+			failed = true;
+			return false;
+		}
+
+		UCHAR* const sq = static_cast<UCHAR*>(sqRing);
+		sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+		sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+		sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+		UCHAR* const cq = static_cast<UCHAR*>(cqRing);
+		cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+		cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+		cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+		cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+		return true;
+	}
+
+	void IoRing::close()
+	{
+		if (sqes != MAP_FAILED)
+			munmap(sqes, RING_SIZE * sizeof(io_uring_sqe));
+
+		if (cqRing != MAP_FAILED && cqRing != sqRing)
+			munmap(cqRing, cqRingSize);
+
+		if (sqRing != MAP_FAILED)
+			munmap(sqRing, sqRingSize);
+
+		if (ringFd >= 0)
+			::close(ringFd);
+
+		ringFd = -1;
+		sqRing = cqRing = MAP_FAILED;
+		sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+		queued = pending = 0;
+	}
+
+	void IoRing::addRead(int fd, void* buffer, unsigned length, FB_UINT64 offset, ULONG tag)
+	{
+		fb_assert(!isFull());
+
+		const unsigned tail = *sqTail;
+		const unsigned index = tail & *sqMask;
+
+		iovec& vector = vectors[index];
+		vector.iov_base = buffer;
+		vector.iov_len = length;
+
+		io_uring_sqe* const sqe = &sqes[index];
+		memset(sqe, 0, sizeof(io_uring_sqe));
+		sqe->opcode = IORING_OP_READV;
+		sqe->fd = fd;
+		sqe->off = offset;
+		sqe->addr = (IPTR) &vector;
+		sqe->len = 1;
+		sqe->user_data = tag;
+
+		sqArray[index] = index;
+		__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+		queued++;
+	}
+
+	template <typename F>
+	bool IoRing::submitAndWait(F complete)
+	{
+		while (queued || pending)
+		{
+			const int ret = syscall(__NR_io_uring_enter, ringFd, queued, queued + pending,
+				IORING_ENTER_GETEVENTS, nullptr, 0);
+
+			if (ret < 0)
+			{
+				if (SYSCALL_INTERRUPTED(errno) || errno == EAGAIN || errno == EBUSY)
+					continue;
+
+				// Don't use the ring anymore. Requests in flight still fill the buffers,
+				// so wait for them before it's closed, requests not submitted yet are
+				// just dropped. Caller reads pages not completed synchronously.
+				gds__log("io_uring_enter failed (errno %d), using synchronous I/O", errno);
+				drain(complete);
+				close();
+				failed = true;
+				return false;
+			}
+
+			queued -= ret;
+			pending += ret;
+
+			reap(complete);
+		}
+
+		return true;
+	}
+
+	template <typename F>
+	void IoRing::reap(F complete)
+	{
+		unsigned head = *cqHead;
+		const unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+
+		for (; head != tail; head++)
+		{
+			const io_uring_cqe* const cqe = &cqes[head & *cqMask];
+			complete(static_cast<ULONG>(cqe->user_data), cqe->res);
+			pending--;
+		}
+
+		__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+	}
+
+	template <typename F>
+	void IoRing::drain(F complete)
+	{
+		reap(complete);
+
+		while (pending)
+		{
+			// Completions are posted to the ring even if waiting for them fails,
+			// poll it then
+			if (syscall(__NR_io_uring_enter, ringFd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+				!SYSCALL_INTERRUPTED(errno))
+			{
+				Thread::sleep(1);
+			}
+
+			reap(complete);
+		}
+	}
+} // anonymous namespace
+#endif // HAVE_LINUX_IO_URING_H
+
 int PIO_add_file(thread_db* tdbb, jrd_file* main_file, const PathName& file_name, SLONG start)
 {
 /**************************************
@@ -175,6 +442,29 @@ int PIO_add_file(thread_db* tdbb, jrd_file* main_file, const PathName& file_name
 }
 
 
+bool PIO_batch_io(thread_db* tdbb)
+{
+/**************************************
+ *
+ *	P I O _ b a t c h _ i o
+ *
+ **************************************
+ *
+ * Functional description
+ *	Check if batched page I/O could be used
+ *	by the current thread.
+ *
+ **************************************/
+#ifdef HAVE_LINUX_IO_URING_H
+	const Database* const dbb = tdbb->getDatabase();
+
+	return dbb->dbb_config->getUseIoUring() && threadRing.init();
+#else
+	return false;
+#endif
+}
+
+
 void PIO_close(jrd_file* main_file)
 {
 /**************************************
@@ -790,6 +1080,83 @@ bool PIO_read(thread_db* tdbb, jrd_file* file, BufferDesc* bdb, Ods::pag* page,
 }
 
 
+void PIO_read_batch(thread_db* tdbb, jrd_file* file, PioRequest* requests, FB_SIZE_T count)
+{
+/**************************************
+ *
+ *	P I O _ r e a d _ b a t c h
+ *
+ **************************************
+ *
+ * Functional description
+ *	Read a batch of data pages, submitting all the
+ *	requests at once and waiting for their completion.
+ *	Pages not read completely are not reported as errors,
+ *	caller is expected to read them again using PIO_read.
+ *	Without io_uring the pages are just requested to be
+ *	read ahead into the file system cache.
+ *
+ **************************************/
+	for (FB_SIZE_T n = 0; n < count; n++)
+		requests[n].pior_done = false;
+
+	Database* const dbb = tdbb->getDatabase();
+	const SLONG size = dbb->dbb_page_size;
+
+	EngineCheckout cout(tdbb, FB_FUNCTION, EngineCheckout::UNNECESSARY);
+
+#ifdef HAVE_LINUX_IO_URING_H
+	if (PIO_batch_io(tdbb))
+	{
+		IoRing& ring = threadRing;
+
+		for (FB_SIZE_T n = 0; n < count; )
+		{
+			for (; n < count && !ring.isFull(); n++)
+			{
+				// Errors are reported when page is read again
+				FbLocalStatus status;
+				FB_UINT64 offset;
+
+				const jrd_file* const pageFile = seek_file(file, requests[n].pior_bdb, &offset, &status);
+				if (pageFile && pageFile->fil_desc != -1)
+					ring.addRead(pageFile->fil_desc, requests[n].pior_bdb->bdb_buffer, size, offset, n);
+			}
+
+			const bool success = ring.submitAndWait([requests, size](ULONG tag, int result)
+			{
+				requests[tag].pior_done = (result == size);
+			});
+
+			if (!success)
+				break;
+
+			if (n == count)
+				return;
+		}
+	}
+#endif
+
+#ifdef POSIX_FADV_WILLNEED
+	// Let the kernel read the rest of pages asynchronously, all at once,
+	// so the following synchronous reads find them in the file system cache
+
+	for (FB_SIZE_T n = 0; n < count; n++)
+	{
+		if (requests[n].pior_done)
+			continue;
+
+		FbLocalStatus status;
+		FB_UINT64 offset;
+
+		const jrd_file* const pageFile = seek_file(file, requests[n].pior_bdb, &offset, &status);
+		if (pageFile && pageFile->fil_desc != -1)
+			os_utils::posix_fadvise(pageFile->fil_desc, offset, size, POSIX_FADV_WILLNEED);
+	}
+#endif
+}
+
+
 bool PIO_write(thread_db* tdbb, jrd_file* file, BufferDesc* bdb, Ods::pag* page, FbStatusVector* status_vector)
 {
 /**************************************
@@ -834,6 +1201,168 @@ bool PIO_write(thread_db* tdbb, jrd_file* file, BufferDesc* bdb, Ods::pag* page,
 }
 
 
+bool PIO_write_batch(thread_db* tdbb, jrd_file* file, BufferDesc* const* bdbs, Ods::pag* const* pages,
+	FB_SIZE_T count, FbStatusVector* status_vector)
+{
+/**************************************
+ *
+ *	P I O _ w r i t e _ b a t c h
+ *
+ **************************************
+ *
+ * Functional description
+ *	Write a run of pages with adjacent numbers.
+ *	Page image pages[i] is written into page of bdbs[i].
+ *	Pages are written with a single call where possible.
+ *
+ **************************************/
+	fb_assert(count);
+
+	if (file->fil_desc == -1)
+		return unix_error("write", file, isc_io_write_err, status_vector);
+
+#ifdef HAVE_PWRITEV
+	Database* const dbb = tdbb->getDatabase();
+	const SLONG size = dbb->dbb_page_size;
+
+	FB_SIZE_T done = 0;
+
+	while (done < count)
+	{
+		FB_UINT64 offset;
+		jrd_file* const pageFile = seek_file(file, bdbs[done], &offset, status_vector);
+
+		if (!pageFile)
+			return false;
+
+		// Run may span the boundary between files of multi-file database
+
+		const ULONG firstPage = bdbs[done]->bdb_page.getPageNum();
+		FB_SIZE_T n = MIN(count - done, (FB_SIZE_T) (pageFile->fil_max_page - firstPage + 1));
+		n = MIN(n, MAX_WRITE_IOV);
+
+		struct iovec iov[MAX_WRITE_IOV];
+		for (FB_SIZE_T i = 0; i < n; i++)
+		{
+			fb_assert(bdbs[done + i]->bdb_page.getPageNum() == firstPage + i);
+			iov[i].iov_base = pages[done + i];
+			iov[i].iov_len = size;
+		}
+
+		EngineCheckout cout(tdbb, FB_FUNCTION, EngineCheckout::UNNECESSARY);
+
+		struct iovec* vector = iov;
+		int vecCount = (int) n;
+		int retry = 0;
+
+		while (vecCount)
+		{
+			const ssize_t bytes = pwritev(pageFile->fil_desc, vector, vecCount, LSEEK_OFFSET_CAST offset);
+
+			if (bytes < 0)
+			{
+				if (SYSCALL_INTERRUPTED(errno) && ++retry < IO_RETRY)
+					continue;
+
+				return unix_error("pwritev", pageFile, isc_io_write_err, status_vector);
+			}
+
+			// Skip what is written and continue with the rest of run
+
+			offset += bytes;
+
+			for (size_t written = bytes; written && vecCount; )
+			{
+				if (written >= vector->iov_len)
+				{
+					written -= vector->iov_len;
+					vector++;
+					vecCount--;
+				}
+				else
+				{
+					vector->iov_base = (char*) vector->iov_base + written;
+					vector->iov_len -= written;
+					written = 0;
+				}
+			}
+
+			if (!bytes && ++retry >= IO_RETRY)
+				return unix_error("write_retry", pageFile, isc_io_write_err, status_vector);
+		}
+
+		done += n;
+	}
+
+	return true;
+#else
+	for (FB_SIZE_T i = 0; i < count; i++)
+	{
+		if (!PIO_write(tdbb, file, bdbs[i], pages[i], status_vector))
+			return false;
+	}
+
+	return true;
+#endif
+}
+
+
+ULONG PIO_queue_depth(const jrd_file* file)
+{
+/**************************************
+ *
+ *	P I O _ q u e u e _ d e p t h
+ *
+ **************************************
+ *
+ * Functional description
+ *	Return the number of requests the device holding
+ *	the file can keep in flight, or zero if unknown.
+ *	Rotational devices are reported as having a single
+ *	request queue, concurrent writes don't help them.
+ *
+ **************************************/
+#ifdef LINUX
+	struct STAT statistics;
+	if (file->fil_desc == -1 || os_utils::fstat(file->fil_desc, &statistics))
+		return 0;
+
+	const dev_t device = S_ISBLK(statistics.st_mode) ? statistics.st_rdev : statistics.st_dev;
+
+	string base;
+	base.printf("/sys/dev/block/%u:%u/", major(device), minor(device));
+
+	const auto readValue = [](const string& name) -> ULONG
+	{
+		ULONG value = 0;
+
+		FILE* const f = os_utils::fopen(name.c_str(), "r");
+		if (f)
+		{
+			if (fscanf(f, "%u", &value) != 1)
+				value = 0;
+			fclose(f);
+		}
+
+		return value;
+	};
+
+	// Partitions have no queue of their own, look at the whole disk then
+
+	string queue = base + "queue/";
+	if (access(queue.c_str(), F_OK))
+		queue = base + "../queue/";
+
+	if (readValue(queue + "rotational"))
+		return 1;
+
+	return readValue(queue + "nr_requests");
+#else
+	return 0;
+#endif
+}
+
+
 static jrd_file* seek_file(jrd_file* file, BufferDesc* bdb, FB_UINT64* offset,
 	FbStatusVector* status_vector)
 {
@@ -161,6 +161,23 @@ int PIO_add_file(thread_db* tdbb, jrd_file* main_file, const Firebird::PathName&
 }
 
 
+bool PIO_batch_io(thread_db* tdbb)
+{
+/**************************************
+ *
+ *	P I O _ b a t c h _ i o
+ *
+ **************************************
+ *
+ * Functional description
+ *	Check if batched page I/O could be used
+ *	by the current thread. Not implemented yet.
+ *
+ **************************************/
+	return false;
+}
+
+
 void PIO_close(jrd_file* main_file)
 {
 /**************************************
@@ -562,6 +579,22 @@ jrd_file* PIO_open(thread_db* tdbb,
 }
 
 
+ULONG PIO_queue_depth(const jrd_file* file)
+{
+/**************************************
+ *
+ *	P I O _ q u e u e _ d e p t h
+ *
+ **************************************
+ *
+ * Functional description
+ *	Device queue depth is not known.
+ *
+ **************************************/
+	return 0;
+}
+
+
 bool PIO_read(thread_db* tdbb, jrd_file* file, BufferDesc* bdb, Ods::pag* page, FbStatusVector* status_vector)
 {
 /**************************************
@@ -602,6 +635,24 @@ bool PIO_read(thread_db* tdbb, jrd_file* file, BufferDesc* bdb, Ods::pag* page,
 }
 
 
+void PIO_read_batch(thread_db* tdbb, jrd_file* file, PioRequest* requests, FB_SIZE_T count)
+{
+/**************************************
+ *
+ *	P I O _ r e a d _ b a t c h
+ *
+ **************************************
+ *
+ * Functional description
+ *	Batched I/O is not implemented yet, let
+ *	caller read pages one by one.
+ *
+ **************************************/
+	for (FB_SIZE_T n = 0; n < count; n++)
+		requests[n].pior_done = false;
+}
+
+
 #ifdef SUPERSERVER_V2
 bool PIO_read_ahead(thread_db*	tdbb,
 				   SLONG	start_page,
@@ -780,6 +831,30 @@ bool PIO_write(thread_db* tdbb, jrd_file* file, BufferDesc* bdb, Ods::pag* page,
 }
 
 
+bool PIO_write_batch(thread_db* tdbb, jrd_file* file, BufferDesc* const* bdbs, Ods::pag* const* pages,
+	FB_SIZE_T count, FbStatusVector* status_vector)
+{
+/**************************************
+ *
+ *	P I O _ w r i t e _ b a t c h
+ *
+ **************************************
+ *
+ * Functional description
+ *	Gathered writes are not implemented yet,
+ *	write pages of the run one by one.
+ *
+ **************************************/
+	for (FB_SIZE_T i = 0; i < count; i++)
+	{
+		if (!PIO_write(tdbb, file, bdbs[i], pages[i], status_vector))
+			return false;
+	}
+
+	return true;
+}
+
+
 ULONG PIO_get_number_of_pages(const jrd_file* file, const USHORT pagesize)
 {
 /**************************************
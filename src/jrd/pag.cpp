@@ -94,6 +94,7 @@
 #include "../jrd/extds/ExtDS.h"
 #include "../common/classes/DbImplementation.h"
 #include "../jrd/CryptoManager.h"
+#include "../jrd/RedoLog.h"
 
 namespace Ods
 {
@@ -1373,13 +1374,11 @@ void PAG_init(thread_db* tdbb)
 	dbb->dbb_max_records = Ods::maxRecsPerDP(dbb->dbb_page_size);
 	dbb->dbb_max_idx = Ods::maxIndices(dbb->dbb_page_size);
 
-	// Compute prefetch constants from database page size and maximum prefetch
-	// transfer size. Double pages per prefetch request so that cache reader
-	// can overlap prefetch I/O with database computation over previously prefetched pages.
-#ifdef SUPERSERVER_V2
-	dbb->dbb_prefetch_sequence = PREFETCH_MAX_TRANSFER / dbb->dbb_page_size;
-	dbb->dbb_prefetch_pages = dbb->dbb_prefetch_sequence * 2;
-#endif
+	// Compute prefetch constants. Issue next prefetch request when half of the
+	// previously requested pages is consumed, so that cache reader can overlap
+	// prefetch I/O with database computation over previously prefetched pages.
+	dbb->dbb_prefetch_pages = (USHORT) dbb->dbb_config->getReadAheadPages();
+	dbb->dbb_prefetch_sequence = MAX(dbb->dbb_prefetch_pages / 2, 1);
 }
 
 
@@ -1528,6 +1527,11 @@ void PAG_init2(thread_db* tdbb, USHORT shadow_number)
 		file->fil_min_page = last_page + 1;
 		file->fil_sequence = sequence++;
 	}
+
+	// All database files are open now, restore pages left in redo log by crash
+
+	if (!shadow_number)
+		RedoLog::recover(tdbb);
 }
 
 
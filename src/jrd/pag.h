@@ -66,6 +66,7 @@ const USHORT TRANS_PAGE_SPACE	= 255;
 const USHORT TEMP_PAGE_SPACE	= 256;
 
 const USHORT PAGES_IN_EXTENT	= 8;
+const USHORT MAX_PAGES_IN_EXTENT	= 64;	// largest extent size configurable per relation
 
 class jrd_file;
 class Database;
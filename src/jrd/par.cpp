@@ -1415,6 +1415,10 @@ RseNode* PAR_rse(thread_db* tdbb, CompilerScratch* csb, SSHORT rse_op)
 			rse->firstRows = (csb->csb_blr_reader.getByte() != 0);
 			break;
 
+		case blr_parallel:
+			rse->parallelWorkers = csb->csb_blr_reader.getWord();
+			break;
+
 		default:
 			if (op == (UCHAR) blr_end)
 			{
@@ -260,6 +260,26 @@ bool BaseAggWinStream<ThisType, NextType>::aggPass(thread_db* tdbb, Request* req
 	return ret;
 }
 
+// Merge the partial group computed by the parallel scan into the aggregates
+template <typename ThisType, typename NextType>
+void BaseAggWinStream<ThisType, NextType>::aggCombine(thread_db* tdbb, Request* request,
+	const ParallelTableScan* scan, const NestValueArray& sourceList,
+	const NestValueArray& targetList, const UCHAR* state) const
+{
+	const NestConst<ValueExprNode>* const sourceEnd = sourceList.end();
+
+	for (const NestConst<ValueExprNode>* source = sourceList.begin(),
+			*target = targetList.begin();
+		 source != sourceEnd;
+		 ++source, ++target)
+	{
+		if (!nodeIs<AggNode>(*source))
+			EXE_assignment(tdbb, *source, *target);
+	}
+
+	scan->combine(tdbb, request, state);
+}
+
 template <typename ThisType, typename NextType>
 void BaseAggWinStream<ThisType, NextType>::aggExecute(thread_db* tdbb, Request* request,
 	const NestValueArray& sourceList, const NestValueArray& targetList) const
@@ -369,14 +389,17 @@ bool BaseAggWinStream<ThisType, NextType>::getNextRecord(thread_db* tdbb, Reques
 		return m_next->getRecord(tdbb);
 }
 
-// Export the template for WindowedStream::WindowStream.
+// Export the template for WindowedStream::WindowStream and HashAggregatedStream.
 template class Jrd::BaseAggWinStream<WindowedStream::WindowStream, BaseBufferedStream>;
+template class Jrd::BaseAggWinStream<HashAggregatedStream, RecordSource>;
 
 // ------------------------------
 
 AggregatedStream::AggregatedStream(thread_db* tdbb, CompilerScratch* csb, StreamType stream,
-			const NestValueArray* group, MapNode* map, RecordSource* next)
-	: BaseAggWinStream(tdbb, csb, stream, group, map, !group, next)
+			const NestValueArray* group, MapNode* map, RecordSource* next,
+			ParallelTableScan* partialScan)
+	: BaseAggWinStream(tdbb, csb, stream, group, map, !group, next),
+	  m_partialScan(group ? nullptr : partialScan)
 {
 	fb_assert(map);
 }
@@ -412,7 +435,15 @@ bool AggregatedStream::internalGetRecord(thread_db* tdbb) const
 		return false;
 	}
 
-	if (!evaluateGroup(tdbb))
+	if (m_partialScan && m_partialScan->isAggregating(tdbb))
+	{
+		if (!combinePartialGroups(tdbb))
+		{
+			rpb->rpb_number.setValid(false);
+			return false;
+		}
+	}
+	else if (!evaluateGroup(tdbb))
 	{
 		rpb->rpb_number.setValid(false);
 		return false;
@@ -421,3 +452,27 @@ bool AggregatedStream::internalGetRecord(thread_db* tdbb) const
 	rpb->rpb_number.setValid(true);
 	return true;
 }
+
+// Records were aggregated by the workers of the parallel scan,
+// the single group is got by combining their partial groups
+bool AggregatedStream::combinePartialGroups(thread_db* tdbb) const
+{
+	Request* const request = tdbb->getRequest();
+	Impure* const impure = getImpure(request);
+
+	if (impure->state == STATE_EOF)
+		return false;
+
+	aggInit(tdbb, request, m_groupMap);
+
+	while (const UCHAR* const group = m_partialScan->getPartialGroup(tdbb))
+	{
+		const UCHAR* const state = m_partialScan->loadPartialGroup(tdbb, group);
+		aggCombine(tdbb, request, m_partialScan, m_groupMap->sourceList, m_groupMap->targetList, state);
+	}
+
+	aggExecute(tdbb, request, m_groupMap->sourceList, m_groupMap->targetList);
+
+	impure->state = STATE_EOF;
+	return true;
+}
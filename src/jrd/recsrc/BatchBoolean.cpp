@@ -0,0 +1,830 @@
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.ibphoenix.com/main.nfs?a=ibphoenix&page=ibp_idpl.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by the Firebird Project
+ *  for the Firebird Open Source RDBMS project.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "firebird.h"
+#include "../common/classes/timestamp.h"
+#include "../jrd/jrd.h"
+#include "../jrd/req.h"
+#include "../jrd/intl.h"
+#include "../dsql/BoolNodes.h"
+#include "../dsql/ExprNodes.h"
+#include "../jrd/evl_proto.h"
+#include "../jrd/met_proto.h"
+#include "../jrd/mov_proto.h"
+#include "../jrd/vio_proto.h"
+
+#include "RecordSource.h"
+
+using namespace Firebird;
+using namespace Jrd;
+
+// ----------------------------------------------
+// Data access: batch evaluation of scan booleans
+// ----------------------------------------------
+
+namespace
+{
+	// Records read at once. The batch starts small, so short scans
+	// and scans stopped early don't read ahead much.
+	const ULONG MIN_BATCH_ROWS = 16;
+	const ULONG MAX_BATCH_ROWS = 1024;
+
+	// Memory used by the records of a batch
+	const ULONG MAX_BATCH_MEMORY = 1024 * 1024;
+
+	// Longer lists are left to the lookup of InListBoolNode
+	const FB_SIZE_T MAX_LIST_ITEMS = 64;
+
+	// How the field values are compared
+	enum ValueClass : UCHAR
+	{
+		CLASS_NONE,		// not checked
+		CLASS_INTEGER,	// exact numerics, dates and times as 64-bit integers
+		CLASS_TEXT		// fixed length strings compared binary
+	};
+
+	ValueClass getValueClass(const dsc* desc)
+	{
+		switch (desc->dsc_dtype)
+		{
+			case dtype_short:
+			case dtype_long:
+			case dtype_int64:
+			case dtype_sql_date:
+			case dtype_sql_time:
+			case dtype_timestamp:
+				return CLASS_INTEGER;
+
+			case dtype_text:
+			{
+				// Only the default collations of these character sets compare binary
+				const USHORT ttype = desc->getTextType();
+
+				if (ttype == ttype_none || ttype == ttype_ascii || ttype == ttype_binary)
+					return CLASS_TEXT;
+
+				break;
+			}
+		}
+
+		return CLASS_NONE;
+	}
+
+	SINT64 getTimeStampKey(const ISC_TIMESTAMP* timestamp)
+	{
+		return (SINT64) timestamp->timestamp_date * TimeStamp::ISC_TICKS_PER_DAY +
+			timestamp->timestamp_time;
+	}
+
+	// Convert the value into the key comparable with the keys of the field values.
+	// False is returned if the value can't be represented exactly.
+
+	bool makeKey(thread_db* tdbb, const dsc* field, const dsc* value, SINT64& key)
+	{
+		if (field->isExact())
+		{
+			if (!value->isExact() || value->isInt128() || value->dsc_scale < field->dsc_scale)
+				return false;
+
+			key = MOV_get_int64(tdbb, value, value->dsc_scale);
+
+			for (SSHORT scale = value->dsc_scale; scale > field->dsc_scale; scale--)
+			{
+				if (key > MAX_SINT64 / 10 || key < MIN_SINT64 / 10)
+					return false;
+
+				key *= 10;
+			}
+
+			return true;
+		}
+
+		if (value->dsc_dtype != field->dsc_dtype)
+			return false;
+
+		switch (value->dsc_dtype)
+		{
+			case dtype_sql_date:
+				key = *(const ISC_DATE*) value->dsc_address;
+				return true;
+
+			case dtype_sql_time:
+				key = *(const ISC_TIME*) value->dsc_address;
+				return true;
+
+			case dtype_timestamp:
+				key = getTimeStampKey((const ISC_TIMESTAMP*) value->dsc_address);
+				return true;
+		}
+
+		fb_assert(false);
+		return false;
+	}
+
+	// Pad the string value to the length of the field
+
+	bool makeText(thread_db* tdbb, const dsc* field, const dsc* value, UCHAR* text)
+	{
+		if (!value->isText() || value->getCharSet() != field->getCharSet())
+			return false;
+
+		const UCHAR pad = (field->getCharSet() == ttype_binary) ? 0 : ' ';
+
+		UCHAR* address;
+		ULONG length = MOV_get_string(tdbb, value, &address, nullptr, 0);
+
+		if (length > field->dsc_length)
+		{
+			for (ULONG i = field->dsc_length; i < length; i++)
+			{
+				if (address[i] != pad)
+					return false;
+			}
+
+			length = field->dsc_length;
+		}
+
+		memcpy(text, address, length);
+		memset(text + length, pad, field->dsc_length - length);
+
+		return true;
+	}
+
+	// Keep the records satisfying the predicate. Records not judged (of other formats)
+	// are kept, they're checked by the complete boolean. The loops are kept trivial
+	// to let the compiler vectorize them.
+
+	template <typename Predicate>
+	void selectRecords(ULONG count, const UCHAR* judged, const UCHAR* present, UCHAR* selected,
+		const Predicate& predicate)
+	{
+		for (ULONG i = 0; i < count; i++)
+			selected[i] &= (UCHAR) ((judged[i] ^ 1) | (present[i] & (UCHAR) predicate(i)));
+	}
+
+	void compare(UCHAR blrOp, ULONG count, const SINT64* keys, SINT64 value,
+		const UCHAR* judged, const UCHAR* present, UCHAR* selected)
+	{
+		switch (blrOp)
+		{
+			case blr_eql:
+				selectRecords(count, judged, present, selected, [=](ULONG i) { return keys[i] == value; });
+				break;
+
+			case blr_neq:
+				selectRecords(count, judged, present, selected, [=](ULONG i) { return keys[i] != value; });
+				break;
+
+			case blr_gtr:
+				selectRecords(count, judged, present, selected, [=](ULONG i) { return keys[i] > value; });
+				break;
+
+			case blr_geq:
+				selectRecords(count, judged, present, selected, [=](ULONG i) { return keys[i] >= value; });
+				break;
+
+			case blr_lss:
+				selectRecords(count, judged, present, selected, [=](ULONG i) { return keys[i] < value; });
+				break;
+
+			case blr_leq:
+				selectRecords(count, judged, present, selected, [=](ULONG i) { return keys[i] <= value; });
+				break;
+
+			default:
+				fb_assert(false);
+		}
+	}
+}
+
+
+// Records of the scan read ahead
+
+class BatchBoolean::Batch
+{
+public:
+	// Position of the record, restored when the record becomes the record of the stream
+	struct Row
+	{
+		RecordNumber number;
+		TraNumber transaction;
+		ULONG page;
+		ULONG fPage;
+		ULONG bPage;
+		USHORT line;
+		USHORT fLine;
+		USHORT bLine;
+		USHORT format;
+		USHORT flags;
+		USHORT runtimeFlags;
+	};
+
+	// Condition with its values evaluated for the batch
+	struct Check
+	{
+		bool active;
+		bool never;			// no record may satisfy it
+		ValueClass valueClass;
+		FB_SIZE_T first;	// first value in keys or offset in texts
+		FB_SIZE_T count;
+	};
+
+	explicit Batch(MemoryPool& pool)
+		: records(pool), rows(pool), checks(pool), keys(pool), texts(pool),
+		  values(pool), judged(pool), present(pool), matched(pool), selected(pool),
+		  format(nullptr), maxRows(0), capacity(0), count(0), next(0), eof(false)
+	{}
+
+	~Batch()
+	{
+		// The first record is the own record of the stream
+
+		for (FB_SIZE_T i = 1; i < records.getCount(); i++)
+			delete records[i];
+	}
+
+	void save(const record_param* rpb, ULONG i)
+	{
+		Row& row = rows[i];
+		row.number = rpb->rpb_number;
+		row.transaction = rpb->rpb_transaction_nr;
+		row.page = rpb->rpb_page;
+		row.fPage = rpb->rpb_f_page;
+		row.bPage = rpb->rpb_b_page;
+		row.line = rpb->rpb_line;
+		row.fLine = rpb->rpb_f_line;
+		row.bLine = rpb->rpb_b_line;
+		row.format = rpb->rpb_format_number;
+		row.flags = rpb->rpb_flags;
+		row.runtimeFlags = rpb->rpb_runtime_flags;
+	}
+
+	void load(record_param* rpb, ULONG i) const
+	{
+		const Row& row = rows[i];
+		rpb->rpb_record = records[i];
+		rpb->rpb_number = row.number;
+		rpb->rpb_number.setValid(true);
+		rpb->rpb_transaction_nr = row.transaction;
+		rpb->rpb_page = row.page;
+		rpb->rpb_f_page = row.fPage;
+		rpb->rpb_b_page = row.bPage;
+		rpb->rpb_line = row.line;
+		rpb->rpb_f_line = row.fLine;
+		rpb->rpb_b_line = row.bLine;
+		rpb->rpb_format_number = row.format;
+		rpb->rpb_flags = row.flags;
+		rpb->rpb_runtime_flags = row.runtimeFlags;
+	}
+
+	Array<Record*> records;
+	Array<Row> rows;
+
+	Array<Check> checks;
+	Array<SINT64> keys;			// values of the checks
+	Array<UCHAR> texts;
+
+	Array<SINT64> values;		// keys of the field values
+	Array<UCHAR> judged;		// record of the current format
+	Array<UCHAR> present;		// field is not NULL
+	Array<UCHAR> matched;
+	Array<UCHAR> selected;
+
+	const Format* format;		// current format of the relation
+	ULONG maxRows;
+	ULONG capacity;
+	ULONG count;
+	ULONG next;
+	RecordNumber position;		// of the scan
+	bool eof;
+};
+
+
+BatchBoolean::BatchBoolean(MemoryPool& pool, StreamType stream)
+	: m_stream(stream),
+	  m_conditions(pool),
+	  m_values(pool)
+{
+}
+
+BatchBoolean* BatchBoolean::create(CompilerScratch* csb, StreamType stream, BoolExprNode* boolean)
+{
+	BatchBoolean* const batchBoolean = FB_NEW_POOL(csb->csb_pool) BatchBoolean(csb->csb_pool, stream);
+	batchBoolean->addConjuncts(boolean);
+
+	if (batchBoolean->m_conditions.isEmpty())
+	{
+		delete batchBoolean;
+		return nullptr;
+	}
+
+	return batchBoolean;
+}
+
+// Collect the conjuncts which could be checked over a batch
+
+void BatchBoolean::addConjuncts(BoolExprNode* boolean)
+{
+	if (const auto binaryNode = nodeAs<BinaryBoolNode>(boolean))
+	{
+		if (binaryNode->blrOp == blr_and)
+		{
+			addConjuncts(binaryNode->arg1);
+			addConjuncts(binaryNode->arg2);
+		}
+
+		return;
+	}
+
+	if (const auto cmpNode = nodeAs<ComparativeBoolNode>(boolean))
+	{
+		switch (cmpNode->blrOp)
+		{
+			case blr_between:
+			{
+				const ValueExprNode* const values[] = {cmpNode->arg2, cmpNode->arg3};
+				addCondition(KIND_BETWEEN, blr_between, cmpNode->arg1, values, 2);
+				break;
+			}
+
+			case blr_eql:
+			case blr_neq:
+			case blr_gtr:
+			case blr_geq:
+			case blr_lss:
+			case blr_leq:
+			{
+				const ValueExprNode* value = cmpNode->arg2;
+
+				if (addCondition(KIND_COMPARE, cmpNode->blrOp, cmpNode->arg1, &value, 1))
+					break;
+
+				UCHAR blrOp = cmpNode->blrOp;
+
+				switch (blrOp)
+				{
+					case blr_gtr:
+						blrOp = blr_lss;
+						break;
+
+					case blr_geq:
+						blrOp = blr_leq;
+						break;
+
+					case blr_lss:
+						blrOp = blr_gtr;
+						break;
+
+					case blr_leq:
+						blrOp = blr_geq;
+						break;
+				}
+
+				value = cmpNode->arg1;
+				addCondition(KIND_COMPARE, blrOp, cmpNode->arg2, &value, 1);
+				break;
+			}
+		}
+
+		return;
+	}
+
+	if (const auto listNode = nodeAs<InListBoolNode>(boolean))
+	{
+		const NestValueArray& items = listNode->list->items;
+
+		if (items.getCount() <= MAX_LIST_ITEMS)
+		{
+			HalfStaticArray<const ValueExprNode*, MAX_LIST_ITEMS> values;
+
+			for (const auto& item : items)
+				values.add(item);
+
+			addCondition(KIND_IN_LIST, blr_in_list, listNode->arg, values.begin(), values.getCount());
+		}
+
+		return;
+	}
+
+	if (const auto missingNode = nodeAs<MissingBoolNode>(boolean))
+	{
+		addCondition(KIND_MISSING, blr_missing, missingNode->arg, nullptr, 0);
+		return;
+	}
+
+	if (const auto notNode = nodeAs<NotBoolNode>(boolean))
+	{
+		if (const auto missingNode = nodeAs<MissingBoolNode>(notNode->arg))
+			addCondition(KIND_NOT_MISSING, blr_missing, missingNode->arg, nullptr, 0);
+	}
+}
+
+// The condition should test a field of the stream against literals or parameters,
+// they don't change while the stream is open
+
+bool BatchBoolean::addCondition(Kind kind, UCHAR blrOp, const ValueExprNode* field,
+	const ValueExprNode* const* values, FB_SIZE_T count)
+{
+	const auto fieldNode = nodeAs<FieldNode>(field);
+
+	if (!fieldNode || fieldNode->fieldStream != m_stream || fieldNode->cursorNumber.specified)
+		return false;
+
+	for (FB_SIZE_T i = 0; i < count; i++)
+	{
+		if (!nodeIs<LiteralNode>(values[i]) && !nodeIs<ParameterNode>(values[i]))
+			return false;
+	}
+
+	Condition condition;
+	condition.kind = kind;
+	condition.blrOp = blrOp;
+	condition.fieldId = fieldNode->fieldId;
+	condition.firstValue = m_values.getCount();
+	condition.valueCount = count;
+
+	m_values.add(values, count);
+	m_conditions.add(condition);
+
+	return true;
+}
+
+BatchBoolean::Batch* BatchBoolean::open(thread_db* tdbb, jrd_rel* relation, record_param* rpb) const
+{
+	MemoryPool& pool = *tdbb->getRequest()->req_pool;
+
+	Batch* const batch = FB_NEW_POOL(pool) Batch(pool);
+	batch->format = MET_current(tdbb, relation);
+	batch->maxRows = MIN(MAX_BATCH_ROWS, MAX(MAX_BATCH_MEMORY / batch->format->fmt_length, 1u));
+	batch->capacity = MIN(MIN_BATCH_ROWS, batch->maxRows);
+	batch->position = rpb->rpb_number;
+
+	// Records of the batch become the record of the stream in turn,
+	// its own record is kept as the first one
+
+	batch->records.add(rpb->rpb_record);
+
+	return batch;
+}
+
+void BatchBoolean::close(record_param* rpb, Batch* batch)
+{
+	rpb->rpb_record = batch->records[0];
+	delete batch;
+}
+
+// Return the next record satisfying the conditions, reading the next batch when needed
+
+bool BatchBoolean::getRecord(thread_db* tdbb, Batch* batch, record_param* rpb,
+	const RecordNumber* upper) const
+{
+	Request* const request = tdbb->getRequest();
+
+	while (true)
+	{
+		while (batch->next < batch->count)
+		{
+			const ULONG i = batch->next++;
+
+			if (batch->selected[i])
+			{
+				batch->load(rpb, i);
+				return true;
+			}
+		}
+
+		if (batch->eof)
+			return false;
+
+		// Continue the scan where the previous batch stopped
+
+		rpb->rpb_number = batch->position;
+
+		batch->count = batch->next = 0;
+		batch->rows.grow(batch->capacity);
+
+		while (batch->count < batch->capacity)
+		{
+			JRD_reschedule(tdbb);
+
+			if (batch->count == batch->records.getCount())
+				batch->records.add(nullptr);
+
+			rpb->rpb_record = batch->records[batch->count];
+
+			const bool found = VIO_next_record(tdbb, rpb, request->req_transaction,
+				request->req_pool, DPM_next_all, upper);
+
+			batch->records[batch->count] = rpb->rpb_record;
+
+			if (!found)
+			{
+				batch->eof = true;
+				break;
+			}
+
+			batch->save(rpb, batch->count++);
+		}
+
+		batch->position = rpb->rpb_number;
+		batch->capacity = MIN(batch->capacity * 2, batch->maxRows);
+
+		if (batch->count)
+		{
+			prepare(tdbb, batch);
+			evaluate(batch);
+		}
+	}
+}
+
+// Evaluate the values of the conditions. It's done for every batch,
+// as parameters of PSQL blocks may be changed while the stream is open.
+
+void BatchBoolean::prepare(thread_db* tdbb, Batch* batch) const
+{
+	Request* const request = tdbb->getRequest();
+	const Format* const format = batch->format;
+
+	batch->checks.clear();
+	batch->keys.clear();
+	batch->texts.clear();
+
+	for (const auto& condition : m_conditions)
+	{
+		Batch::Check check;
+		check.active = false;
+		check.never = false;
+		check.valueClass = CLASS_NONE;
+		check.first = 0;
+		check.count = 0;
+
+		const dsc* const field = (condition.fieldId < format->fmt_count) ?
+			&format->fmt_desc[condition.fieldId] : nullptr;
+
+		if (!field || field->isUnknown())
+		{
+			batch->checks.add(check);
+			continue;
+		}
+
+		if (condition.kind == KIND_MISSING || condition.kind == KIND_NOT_MISSING)
+		{
+			check.active = true;
+			batch->checks.add(check);
+			continue;
+		}
+
+		check.valueClass = getValueClass(field);
+		check.active = (check.valueClass != CLASS_NONE);
+		check.first = (check.valueClass == CLASS_TEXT) ?
+			batch->texts.getCount() : batch->keys.getCount();
+
+		for (FB_SIZE_T i = 0; check.active && i < condition.valueCount; i++)
+		{
+			const dsc* const value = EVL_expr(tdbb, request, m_values[condition.firstValue + i]);
+
+			// NULL never matches, but other items of the list still could
+
+			if (!value || (request->req_flags & req_null))
+			{
+				if (condition.kind != KIND_IN_LIST)
+				{
+					check.never = true;
+					break;
+				}
+
+				continue;
+			}
+
+			if (check.valueClass == CLASS_TEXT)
+			{
+				UCHAR* const text = batch->texts.getBuffer(batch->texts.getCount() + field->dsc_length) +
+					check.first + check.count * field->dsc_length;
+
+				check.active = makeText(tdbb, field, value, text);
+			}
+			else
+			{
+				SINT64 key;
+				check.active = makeKey(tdbb, field, value, key);
+
+				if (check.active)
+					batch->keys.add(key);
+			}
+
+			check.count++;
+		}
+
+		if (check.active && condition.kind == KIND_IN_LIST && !check.count)
+			check.never = true;
+
+		batch->checks.add(check);
+	}
+}
+
+// Check the conditions over the batch, one condition over all the records at a time
+
+void BatchBoolean::evaluate(Batch* batch) const
+{
+	const ULONG count = batch->count;
+	const Format* const format = batch->format;
+	Record* const* const records = batch->records.begin();
+
+	UCHAR* const judged = batch->judged.getBuffer(count, false);
+	UCHAR* const present = batch->present.getBuffer(count, false);
+	UCHAR* const matched = batch->matched.getBuffer(count, false);
+	UCHAR* const selected = batch->selected.getBuffer(count, false);
+	SINT64* const values = batch->values.getBuffer(count, false);
+
+	// Only records of the current format are judged
+
+	for (ULONG i = 0; i < count; i++)
+	{
+		judged[i] = (records[i]->getFormat() == format);
+		selected[i] = 1;
+	}
+
+	for (FB_SIZE_T n = 0; n < m_conditions.getCount(); n++)
+	{
+		const Condition& condition = m_conditions[n];
+		const Batch::Check& check = batch->checks[n];
+
+		if (!check.active)
+			continue;
+
+		if (check.never)
+		{
+			for (ULONG i = 0; i < count; i++)
+				selected[i] &= (UCHAR) (judged[i] ^ 1);
+
+			continue;
+		}
+
+		const USHORT id = condition.fieldId;
+
+		for (ULONG i = 0; i < count; i++)
+			present[i] = (UCHAR) (judged[i] && !records[i]->isNull(id));
+
+		if (condition.kind == KIND_MISSING)
+		{
+			selectRecords(count, judged, judged, selected, [=](ULONG i) { return !present[i]; });
+			continue;
+		}
+
+		if (condition.kind == KIND_NOT_MISSING)
+		{
+			selectRecords(count, judged, present, selected, [](ULONG) { return true; });
+			continue;
+		}
+
+		// Records keep their tails packed, only the data up to the field is decoded
+
+		const dsc* const field = &format->fmt_desc[id];
+		const ULONG offset = (IPTR) field->dsc_address;
+		const ULONG end = offset + field->dsc_length;
+
+		if (check.valueClass == CLASS_TEXT)
+		{
+			// Strings are compared by memcmp, the integer keys are its results
+
+			const ULONG length = field->dsc_length;
+			const UCHAR* const texts = batch->texts.begin() + check.first;
+
+			const auto getData = [=](ULONG i)
+			{
+				return present[i] ? records[i]->getData(end) + offset : texts;
+			};
+
+			switch (condition.kind)
+			{
+				case KIND_COMPARE:
+					for (ULONG i = 0; i < count; i++)
+						values[i] = memcmp(getData(i), texts, length);
+
+					compare(condition.blrOp, count, values, 0, judged, present, selected);
+					break;
+
+				case KIND_BETWEEN:
+					for (ULONG i = 0; i < count; i++)
+					{
+						const UCHAR* const data = getData(i);
+						matched[i] = (UCHAR) (memcmp(data, texts, length) >= 0 &&
+							memcmp(data, texts + length, length) <= 0);
+					}
+
+					selectRecords(count, judged, present, selected, [=](ULONG i) { return matched[i]; });
+					break;
+
+				case KIND_IN_LIST:
+					memset(matched, 0, count);
+
+					for (FB_SIZE_T j = 0; j < check.count; j++)
+					{
+						const UCHAR* const text = texts + j * length;
+
+						for (ULONG i = 0; i < count; i++)
+							matched[i] |= (UCHAR) !memcmp(getData(i), text, length);
+					}
+
+					selectRecords(count, judged, present, selected, [=](ULONG i) { return matched[i]; });
+					break;
+
+				default:
+					fb_assert(false);
+			}
+
+			continue;
+		}
+
+		// Extract the keys of the field values, NULLs and records of other formats get zeroes
+
+		switch (field->dsc_dtype)
+		{
+			case dtype_short:
+				for (ULONG i = 0; i < count; i++)
+					values[i] = present[i] ? *(const SSHORT*) (records[i]->getData(end) + offset) : 0;
+				break;
+
+			case dtype_long:
+				for (ULONG i = 0; i < count; i++)
+					values[i] = present[i] ? *(const SLONG*) (records[i]->getData(end) + offset) : 0;
+				break;
+
+			case dtype_int64:
+				for (ULONG i = 0; i < count; i++)
+					values[i] = present[i] ? *(const SINT64*) (records[i]->getData(end) + offset) : 0;
+				break;
+
+			case dtype_sql_date:
+				for (ULONG i = 0; i < count; i++)
+					values[i] = present[i] ? *(const ISC_DATE*) (records[i]->getData(end) + offset) : 0;
+				break;
+
+			case dtype_sql_time:
+				for (ULONG i = 0; i < count; i++)
+					values[i] = present[i] ? *(const ISC_TIME*) (records[i]->getData(end) + offset) : 0;
+				break;
+
+			case dtype_timestamp:
+				for (ULONG i = 0; i < count; i++)
+				{
+					values[i] = present[i] ?
+						getTimeStampKey((const ISC_TIMESTAMP*) (records[i]->getData(end) + offset)) : 0;
+				}
+				break;
+
+			default:
+				fb_assert(false);
+		}
+
+		const SINT64* const keys = batch->keys.begin() + check.first;
+
+		switch (condition.kind)
+		{
+			case KIND_COMPARE:
+				compare(condition.blrOp, count, values, keys[0], judged, present, selected);
+				break;
+
+			case KIND_BETWEEN:
+			{
+				const SINT64 lower = keys[0], upper = keys[1];
+				selectRecords(count, judged, present, selected,
+					[=](ULONG i) { return values[i] >= lower && values[i] <= upper; });
+				break;
+			}
+
+			case KIND_IN_LIST:
+				memset(matched, 0, count);
+
+				for (FB_SIZE_T j = 0; j < check.count; j++)
+				{
+					const SINT64 key = keys[j];
+
+					for (ULONG i = 0; i < count; i++)
+						matched[i] |= (UCHAR) (values[i] == key);
+				}
+
+				selectRecords(count, judged, present, selected, [=](ULONG i) { return matched[i]; });
+				break;
+
+			default:
+				fb_assert(false);
+		}
+	}
+}
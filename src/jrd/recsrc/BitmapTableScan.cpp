@@ -22,6 +22,7 @@
 #include "../jrd/btr.h"
 #include "../jrd/req.h"
 #include "../jrd/cmp_proto.h"
+#include "../jrd/dpm_proto.h"
 #include "../jrd/evl_proto.h"
 #include "../jrd/vio_proto.h"
 #include "../jrd/rlck_proto.h"
@@ -54,6 +55,7 @@ void BitmapTableScan::internalOpen(thread_db* tdbb) const
 
 	impure->irsb_flags = irsb_open;
 	impure->irsb_bitmap = EVL_bitmap(tdbb, m_inversion, NULL);
+	impure->irsb_prefetch_number = RecordNumber(0);
 
 	record_param* const rpb = &request->req_rpb[m_stream];
 	RLCK_reserve_relation(tdbb, request->req_transaction, m_relation, false);
@@ -110,9 +112,23 @@ bool BitmapTableScan::internalGetRecord(thread_db* tdbb) const
 		{
 			rpb->rpb_number.setValue(bitmap->current());
 
+			// Keep data pages of the following records being read ahead
+
+			RecordNumber& prefetchNumber = impure->irsb_prefetch_number;
+
+			if (prefetchNumber.isValid() && rpb->rpb_number >= prefetchNumber)
+			{
+				prefetchNumber = rpb->rpb_number;
+				prefetchNumber.setValid(DPM_prefetch_bitmap(tdbb, m_relation, bitmap, prefetchNumber));
+			}
+
 			if (VIO_get(tdbb, rpb, request->req_transaction, request->req_pool))
 			{
 				rpb->rpb_number.setValid(true);
+
+				if (m_filter && !m_filter->getRecord(tdbb))
+					continue;
+
 				return true;
 			}
 		} while (bitmap->getNext());
@@ -124,6 +140,8 @@ bool BitmapTableScan::internalGetRecord(thread_db* tdbb) const
 
 void BitmapTableScan::getChildren(Array<const RecordSource*>& children) const
 {
+	if (m_filter)
+		children.add(m_filter);
 }
 
 void BitmapTableScan::print(thread_db* tdbb, string& plan,
@@ -136,6 +154,9 @@ void BitmapTableScan::print(thread_db* tdbb, string& plan,
 
 		printOptInfo(plan);
 		printInversion(tdbb, m_inversion, plan, true, level);
+
+		if (recurse && m_filter)
+			m_filter->print(tdbb, plan, true, level, recurse);
 	}
 	else
 	{
@@ -151,3 +172,12 @@ void BitmapTableScan::print(thread_db* tdbb, string& plan,
 			plan += ")";
 	}
 }
+
+bool BitmapTableScan::pushFilter(StreamType stream, RecordSource* filter)
+{
+	if (stream != m_stream || m_filter)
+		return false;
+
+	m_filter = filter;
+	return true;
+}
@@ -144,6 +144,9 @@ WriteLockResult FilteredStream::lockRecord(thread_db* tdbb) const
 void FilteredStream::getChildren(Array<const RecordSource*>& children) const
 {
 	children.add(m_next);
+
+	if (m_filter)
+		children.add(m_filter);
 }
 
 void FilteredStream::print(thread_db* tdbb, string& plan, bool detailed, unsigned level, bool recurse) const
@@ -159,7 +162,12 @@ void FilteredStream::print(thread_db* tdbb, string& plan, bool detailed, unsigne
 	}
 
 	if (recurse)
+	{
 		m_next->print(tdbb, plan, detailed, level, recurse);
+
+		if (detailed && m_filter)
+			m_filter->print(tdbb, plan, true, level, recurse);
+	}
 }
 
 void FilteredStream::markRecursive()
@@ -190,6 +198,43 @@ void FilteredStream::nullRecords(thread_db* tdbb) const
 	m_next->nullRecords(tdbb);
 }
 
+bool FilteredStream::pushFilter(StreamType stream, RecordSource* filter)
+{
+	// Rows of the stream must pass our boolean before the filter sees them,
+	// so it's never pushed below the boolean referencing the stream
+
+	if (!m_boolean->containsStream(stream) &&
+		!(m_anyBoolean && m_anyBoolean->containsStream(stream)) &&
+		m_next->pushFilter(stream, filter))
+	{
+		return true;
+	}
+
+	// Otherwise check the filter after our own boolean
+
+	if (m_invariant || m_anyBoolean || m_filter)
+		return false;
+
+	StreamList streams;
+	m_next->findUsedStreams(streams);
+
+	if (!streams.exist(stream))
+		return false;
+
+	m_filter = filter;
+	return true;
+}
+
+ParallelTableScan* FilteredStream::getPartialSource(const BoolExprNode* boolean)
+{
+	if (boolean || m_anyBoolean || m_filter)
+		return nullptr;
+
+	// Invariant boolean is checked once on open, otherwise the scan should check our boolean
+
+	return m_next->getPartialSource(m_invariant ? nullptr : m_boolean.getObject());
+}
+
 bool FilteredStream::evaluateBoolean(thread_db* tdbb) const
 {
 	Request* const request = tdbb->getRequest();
@@ -404,6 +449,9 @@ bool FilteredStream::evaluateBoolean(thread_db* tdbb) const
 	{
 		if (m_boolean->execute(tdbb, request))
 		{
+			if (m_filter && !m_filter->getRecord(tdbb))
+				continue;
+
 			result = true;
 			break;
 		}
@@ -109,6 +109,14 @@ void FullTableScan::internalOpen(thread_db* tdbb) const
 			rpb->rpb_number.setValue(number - 1); // position prior to the starting one
 		}
 	}
+
+	if (m_batchBoolean)
+	{
+		if (impure->irsb_batch)
+			BatchBoolean::close(rpb, impure->irsb_batch);
+
+		impure->irsb_batch = m_batchBoolean->open(tdbb, m_relation, rpb);
+	}
 }
 
 void FullTableScan::close(thread_db* tdbb) const
@@ -129,6 +137,12 @@ void FullTableScan::close(thread_db* tdbb) const
 		{
 			m_relation->rel_scan_count--;
 		}
+
+		if (impure->irsb_batch)
+		{
+			BatchBoolean::close(rpb, impure->irsb_batch);
+			impure->irsb_batch = nullptr;
+		}
 	}
 }
 
@@ -148,9 +162,27 @@ bool FullTableScan::internalGetRecord(thread_db* tdbb) const
 
 	const RecordNumber* upper = impure->irsb_upper.isValid() ? &impure->irsb_upper : nullptr;
 
-	if (VIO_next_record(tdbb, rpb, request->req_transaction, request->req_pool, DPM_next_all, upper))
+	if (impure->irsb_batch)
+	{
+		while (m_batchBoolean->getRecord(tdbb, impure->irsb_batch, rpb, upper))
+		{
+			if (m_filter && !m_filter->getRecord(tdbb))
+				continue;
+
+			return true;
+		}
+
+		rpb->rpb_number.setValid(false);
+		return false;
+	}
+
+	while (VIO_next_record(tdbb, rpb, request->req_transaction, request->req_pool, DPM_next_all, upper))
 	{
 		rpb->rpb_number.setValid(true);
+
+		if (m_filter && !m_filter->getRecord(tdbb))
+			continue;
+
 		return true;
 	}
 
@@ -160,6 +192,8 @@ bool FullTableScan::internalGetRecord(thread_db* tdbb) const
 
 void FullTableScan::getChildren(Array<const RecordSource*>& children) const
 {
+	if (m_filter)
+		children.add(m_filter);
 }
 
 void FullTableScan::print(thread_db* tdbb, string& plan, bool detailed, unsigned level, bool recurse) const
@@ -187,6 +221,9 @@ void FullTableScan::print(thread_db* tdbb, string& plan, bool detailed, unsigned
 		plan += printIndent(++level) + "Table " +
 			printName(tdbb, m_relation->rel_name.c_str(), m_alias) + " Full Scan" + bounds;
 		printOptInfo(plan);
+
+		if (recurse && m_filter)
+			m_filter->print(tdbb, plan, true, level, recurse);
 	}
 	else
 	{
@@ -199,3 +236,12 @@ void FullTableScan::print(thread_db* tdbb, string& plan, bool detailed, unsigned
 			plan += ")";
 	}
 }
+
+bool FullTableScan::pushFilter(StreamType stream, RecordSource* filter)
+{
+	if (stream != m_stream || m_filter)
+		return false;
+
+	m_filter = filter;
+	return true;
+}
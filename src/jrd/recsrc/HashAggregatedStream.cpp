@@ -0,0 +1,762 @@
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.ibphoenix.com/main.nfs?a=ibphoenix&page=ibp_idpl.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by the Firebird Project
+ *  for the Firebird Open Source RDBMS project.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "firebird.h"
+#include "../common/classes/Hash.h"
+#include "../jrd/jrd.h"
+#include "../jrd/req.h"
+#include "../dsql/Nodes.h"
+#include "../jrd/evl_proto.h"
+#include "../jrd/vio_proto.h"
+#include "../jrd/TempSpace.h"
+
+#include "RecordSource.h"
+
+using namespace Firebird;
+using namespace Jrd;
+
+// -----------------------------------
+// Data access: hash-based aggregation
+// -----------------------------------
+
+static const char* const SCRATCH = "fb_hashagg_";
+
+// Memory used by the groups during a single pass. Rows of the groups
+// not fitting it are buffered and aggregated by the next passes.
+static const ULONG MAX_MEMORY = 64 * 1024 * 1024;
+static const ULONG MIN_GROUPS = 1024;
+static const ULONG BLOCK_SIZE = 64 * 1024;
+
+static const ULONG MIN_TABLE_SIZE = 64;
+
+// Buffered rows are distributed between partitions by the bits of their hash value,
+// a partition having too many groups is split using the next bits
+static const ULONG PARTITION_BITS = 4;
+static const ULONG PARTITION_COUNT = 1 << PARTITION_BITS;
+
+static const ULONG SPILL_CHUNK_SIZE = 4096;		// positions written at once
+
+
+class HashAggregatedStream::GroupTable : public PermanentStorage
+{
+	// Every group is a fixed length chunk of memory starting with the group key.
+	// Groups are allocated by blocks and indexed by the open-addressing table
+	// keeping their hash values.
+
+	struct Slot
+	{
+		ULONG hash;
+		ULONG group;	// group number + 1, zero for a free slot
+	};
+
+	// Positions of the buffered rows belonging to a partition. They're written
+	// to the temporary space by chunks, the last incomplete chunk stays in memory.
+
+	class PositionList
+	{
+	public:
+		explicit PositionList(MemoryPool& pool)
+			: m_buffer(pool), m_chunks(pool)
+		{}
+
+		void add(TempSpace* space, FB_UINT64 position)
+		{
+			m_buffer.add(position);
+
+			if (m_buffer.getCount() == SPILL_CHUNK_SIZE)
+			{
+				const FB_SIZE_T length = SPILL_CHUNK_SIZE * sizeof(FB_UINT64);
+				const offset_t offset = space->allocateSpace(length);
+				space->write(offset, m_buffer.begin(), length);
+
+				m_chunks.add(offset);
+				m_buffer.clear();
+			}
+		}
+
+		bool isEmpty() const
+		{
+			return m_chunks.isEmpty() && m_buffer.isEmpty();
+		}
+
+		bool read(TempSpace* space, ULONG chunk, Array<FB_UINT64>& positions) const
+		{
+			if (chunk < m_chunks.getCount())
+			{
+				const FB_SIZE_T length = SPILL_CHUNK_SIZE * sizeof(FB_UINT64);
+				space->read(m_chunks[chunk], positions.getBuffer(SPILL_CHUNK_SIZE, false), length);
+				return true;
+			}
+
+			if (chunk == m_chunks.getCount() && m_buffer.hasData())
+			{
+				positions.assign(m_buffer);
+				return true;
+			}
+
+			return false;
+		}
+
+		void release(TempSpace* space)
+		{
+			for (const auto offset : m_chunks)
+				space->releaseSpace(offset, SPILL_CHUNK_SIZE * sizeof(FB_UINT64));
+
+			m_chunks.free();
+			m_buffer.free();
+		}
+
+	private:
+		Array<FB_UINT64> m_buffer;
+		Array<offset_t> m_chunks;
+	};
+
+	struct Partition
+	{
+		Partition(MemoryPool& pool, ULONG aLevel)
+			: positions(pool), level(aLevel)
+		{}
+
+		PositionList positions;
+		const ULONG level;
+	};
+
+public:
+	GroupTable(MemoryPool& pool, ULONG groupLength, ULONG keyLength)
+		: PermanentStorage(pool), m_groupLength(groupLength), m_keyLength(keyLength),
+		  m_maxGroups(MAX(MAX_MEMORY / groupLength, MIN_GROUPS)),
+		  m_blockGroups(MAX(BLOCK_SIZE / groupLength, 1u)),
+		  m_key(pool), m_blocks(pool), m_slots(pool), m_shift(0), m_count(0), m_iterator(0),
+		  m_partitions(pool), m_pending(pool), m_current(nullptr), m_level(0),
+		  m_positions(pool), m_chunk(0), m_index(0), m_partial(pool)
+	{
+		m_key.getBuffer(m_keyLength);
+		resize(MIN_TABLE_SIZE);
+	}
+
+	~GroupTable()
+	{
+		for (auto block : m_blocks)
+			delete[] block;
+
+		for (auto partition : m_partitions)
+			delete partition;
+
+		for (auto partition : m_pending)
+			delete partition;
+
+		delete m_current;
+	}
+
+	UCHAR* getKey()
+	{
+		return m_key.begin();
+	}
+
+	// Find the group having the current key
+
+	UCHAR* find(ULONG hash)
+	{
+		const ULONG mask = m_slots.getCount() - 1;
+
+		for (ULONG i = getSlot(hash); m_slots[i].group; i = (i + 1) & mask)
+		{
+			const Slot& slot = m_slots[i];
+
+			if (slot.hash == hash)
+			{
+				UCHAR* const group = getGroup(slot.group - 1);
+
+				if (!memcmp(group, m_key.begin(), m_keyLength))
+					return group;
+			}
+		}
+
+		return nullptr;
+	}
+
+	// Add the group having the current key, unless the memory is exhausted
+
+	UCHAR* add(ULONG hash)
+	{
+		if (m_count == m_maxGroups)
+			return nullptr;
+
+		// Keep the table at most half full
+
+		if ((m_count + 1) * 2 > m_slots.getCount())
+			resize(m_slots.getCount() * 2);
+
+		if (m_count / m_blockGroups == m_blocks.getCount())
+			m_blocks.add(FB_NEW_POOL(getPool()) UCHAR[m_blockGroups * m_groupLength]);
+
+		UCHAR* const group = getGroup(m_count++);
+		memcpy(group, m_key.begin(), m_keyLength);
+
+		insert(hash, m_count);
+
+		return group;
+	}
+
+	// Return the groups aggregated by the current pass
+
+	UCHAR* getNext()
+	{
+		if (m_iterator < m_count)
+			return getGroup(m_iterator++);
+
+		return nullptr;
+	}
+
+	// Buffered row belongs to the group to be aggregated by the later pass
+
+	void defer(ULONG hash, FB_UINT64 position)
+	{
+		if (m_partitions.isEmpty())
+		{
+			MemoryPool& pool = getPool();
+
+			for (ULONG i = 0; i < PARTITION_COUNT; i++)
+				m_partitions.add(FB_NEW_POOL(pool) Partition(pool, m_level));
+		}
+
+		m_partitions[getPartition(hash, m_level)]->positions.add(getSpace(), position);
+	}
+
+	// Partial groups computed by the parallel scan are buffered by the table itself,
+	// their offsets in the temporary space are used as positions
+
+	FB_UINT64 storePartial(const UCHAR* group, ULONG length)
+	{
+		TempSpace* const space = getSpace();
+
+		const offset_t offset = space->allocateSpace(length);
+		space->write(offset, group, length);
+
+		return offset;
+	}
+
+	const UCHAR* readPartial(FB_UINT64 position, ULONG length)
+	{
+		m_space->read(position, m_partial.getBuffer(length, false), length);
+		return m_partial.begin();
+	}
+
+	bool isReplaying() const
+	{
+		return (m_current != nullptr);
+	}
+
+	// Return the next buffered row of the partition being aggregated
+
+	bool getPosition(FB_UINT64& position)
+	{
+		fb_assert(m_current);
+
+		while (m_index >= m_positions.getCount())
+		{
+			if (!m_current->positions.read(m_space, m_chunk, m_positions))
+				return false;
+
+			m_chunk++;
+			m_index = 0;
+		}
+
+		position = m_positions[m_index++];
+		return true;
+	}
+
+	// Forget the groups of the current pass and switch to the next pending partition.
+	// Partitions are processed depth first, so the temporary space is reused quickly.
+
+	bool nextPartition()
+	{
+		m_count = 0;
+		m_iterator = 0;
+		memset(m_slots.begin(), 0, m_slots.getCount() * sizeof(Slot));
+
+		if (m_current)
+		{
+			m_current->positions.release(m_space);
+			delete m_current;
+			m_current = nullptr;
+		}
+
+		while (m_partitions.hasData())
+		{
+			Partition* const partition = m_partitions.pop();
+
+			if (partition->positions.isEmpty())
+				delete partition;
+			else
+				m_pending.add(partition);
+		}
+
+		if (m_pending.isEmpty())
+			return false;
+
+		m_current = m_pending.pop();
+		m_level = m_current->level + 1;
+
+		m_positions.clear();
+		m_chunk = 0;
+		m_index = 0;
+
+		return true;
+	}
+
+private:
+	TempSpace* getSpace()
+	{
+		if (!m_space)
+			m_space = FB_NEW_POOL(getPool()) TempSpace(getPool(), SCRATCH);
+
+		return m_space;
+	}
+
+	static ULONG getPartition(ULONG hash, ULONG level)
+	{
+		// Once the bits are exhausted, the partitions don't get smaller anymore,
+		// but every pass still completes the groups it has room for
+		return (hash >> ((level * PARTITION_BITS) % 32)) & (PARTITION_COUNT - 1);
+	}
+
+	ULONG getSlot(ULONG hash) const
+	{
+		// Multiplicative hashing spreads the values over the table,
+		// then the collisions are probed linearly
+		return (hash * 0x9E3779B1) >> m_shift;
+	}
+
+	UCHAR* getGroup(ULONG number) const
+	{
+		return m_blocks[number / m_blockGroups] + (number % m_blockGroups) * m_groupLength;
+	}
+
+	void insert(ULONG hash, ULONG group)
+	{
+		const ULONG mask = m_slots.getCount() - 1;
+		ULONG i = getSlot(hash);
+
+		while (m_slots[i].group)
+			i = (i + 1) & mask;
+
+		m_slots[i].hash = hash;
+		m_slots[i].group = group;
+	}
+
+	void resize(ULONG size)
+	{
+		Array<Slot> slots(getPool());
+		slots.assign(m_slots);
+
+		Slot* const buffer = m_slots.getBuffer(size, false);
+		memset(buffer, 0, size * sizeof(Slot));
+
+		m_shift = 32;
+
+		for (ULONG n = size; n > 1; n >>= 1)
+			m_shift--;
+
+		for (const auto& slot : slots)
+		{
+			if (slot.group)
+				insert(slot.hash, slot.group);
+		}
+	}
+
+	const ULONG m_groupLength;
+	const ULONG m_keyLength;
+	const ULONG m_maxGroups;
+	const ULONG m_blockGroups;
+
+	Array<UCHAR> m_key;			// key of the current row
+	Array<UCHAR*> m_blocks;
+	Array<Slot> m_slots;
+	ULONG m_shift;
+	ULONG m_count;
+	ULONG m_iterator;
+
+	AutoPtr<TempSpace> m_space;
+	Array<Partition*> m_partitions;	// filled by the current pass
+	Array<Partition*> m_pending;
+	Partition* m_current;			// being aggregated by the current pass
+	ULONG m_level;
+
+	Array<FB_UINT64> m_positions;	// chunk of the current partition
+	ULONG m_chunk;
+	ULONG m_index;
+
+	Array<UCHAR> m_partial;			// partial group read back
+};
+
+
+HashAggregatedStream::HashAggregatedStream(thread_db* tdbb, CompilerScratch* csb, StreamType stream,
+			NestValueArray* group, MapNode* map, RecordSource* next,
+			const Array<AggNode::StateArea>& stateAreas, ParallelTableScan* partialScan)
+	: BaseAggWinStream(tdbb, csb, stream, group, map, false, next),
+	  m_buffer(FB_NEW_POOL(csb->csb_pool) BufferedStream(csb, next)),
+	  m_partialScan(partialScan),
+	  m_keyLengths(csb->csb_pool),
+	  m_stateAreas(csb->csb_pool, stateAreas),
+	  m_keyLength(0)
+{
+	fb_assert(group && map);
+
+	// Every key part is prefixed with the byte telling NULL from any value
+
+	for (auto& value : *group)
+	{
+		dsc desc;
+		value->getDesc(tdbb, csb, &desc);
+
+		const ULONG keyLength = HashJoin::getKeyLength(tdbb, &desc);
+
+		m_keyLengths.add(keyLength);
+		m_keyLength += 1 + keyLength;
+	}
+
+	// Group: key, image of the aggregated record and the aggregation state
+
+	m_recordOffset = FB_ALIGN(m_keyLength, FB_ALIGNMENT);
+	m_stateOffset = m_recordOffset + FB_ALIGN(m_format->fmt_length, FB_ALIGNMENT);
+	m_groupLength = m_stateOffset;
+
+	for (const auto& area : m_stateAreas)
+		m_groupLength += FB_ALIGN(area.length, FB_ALIGNMENT);
+}
+
+void HashAggregatedStream::internalOpen(thread_db* tdbb) const
+{
+	Request* const request = tdbb->getRequest();
+	Impure* const impure = getImpure(request);
+
+	impure->irsb_flags = irsb_open;
+
+	impure->state = STATE_GROUPING;
+
+	delete impure->irsb_groups;
+	impure->irsb_groups = nullptr;
+
+	VIO_record(tdbb, &request->req_rpb[m_stream], m_format, tdbb->getDefaultPool());
+
+	// The buffer opens the underlying stream
+	m_buffer->open(tdbb);
+}
+
+void HashAggregatedStream::close(thread_db* tdbb) const
+{
+	Request* const request = tdbb->getRequest();
+
+	invalidateRecords(request);
+
+	Impure* const impure = getImpure(request);
+
+	if (impure->irsb_flags & irsb_open)
+	{
+		impure->irsb_flags &= ~irsb_open;
+
+		delete impure->irsb_groups;
+		impure->irsb_groups = nullptr;
+
+		m_buffer->close(tdbb);
+	}
+}
+
+void HashAggregatedStream::getChildren(Array<const RecordSource*>& children) const
+{
+	children.add(m_buffer);
+}
+
+void HashAggregatedStream::print(thread_db* tdbb, string& plan, bool detailed, unsigned level, bool recurse) const
+{
+	if (detailed)
+	{
+		plan += printIndent(++level) + "Hash Aggregate";
+		printOptInfo(plan);
+	}
+
+	if (recurse)
+		m_next->print(tdbb, plan, detailed, level, recurse);
+}
+
+unsigned HashAggregatedStream::maxCapacity()
+{
+	// Groups above that are likely to exceed the memory budget
+	// and be aggregated by multiple passes over the buffered rows
+	return 1024 * 1024;
+}
+
+bool HashAggregatedStream::internalGetRecord(thread_db* tdbb) const
+{
+	JRD_reschedule(tdbb);
+
+	Request* const request = tdbb->getRequest();
+	record_param* const rpb = &request->req_rpb[m_stream];
+	Impure* const impure = getImpure(request);
+
+	if (!(impure->irsb_flags & irsb_open))
+	{
+		rpb->rpb_number.setValid(false);
+		return false;
+	}
+
+	if (!impure->irsb_groups)
+	{
+		MemoryPool& pool = *tdbb->getDefaultPool();
+		impure->irsb_groups = FB_NEW_POOL(pool) GroupTable(pool, m_groupLength, m_keyLength);
+	}
+
+	GroupTable* const table = impure->irsb_groups;
+
+	while (impure->state != STATE_EOF)
+	{
+		if (impure->state == STATE_GROUPING)
+		{
+			aggregate(tdbb, request, table);
+			impure->state = STATE_FETCHED;
+		}
+
+		if (const UCHAR* const group = table->getNext())
+		{
+			loadState(request, group);
+			rpb->rpb_record->copyDataFrom(group + m_recordOffset);
+
+			aggExecute(tdbb, request, m_groupMap->sourceList, m_groupMap->targetList);
+
+			rpb->rpb_number.setValid(true);
+			return true;
+		}
+
+		// All groups of this pass are returned, aggregate the next partition
+
+		impure->state = table->nextPartition() ? STATE_GROUPING : STATE_EOF;
+	}
+
+	rpb->rpb_number.setValid(false);
+	return false;
+}
+
+// Aggregate the underlying stream, or the buffered rows of a partition on the later passes.
+// State of the group being aggregated lives in the impure areas of the aggregates,
+// the other groups keep their copies.
+
+void HashAggregatedStream::aggregate(thread_db* tdbb, Request* request, GroupTable* table) const
+{
+	if (m_partialScan && m_partialScan->isAggregating(tdbb))
+	{
+		combinePartialGroups(tdbb, request, table);
+		return;
+	}
+
+	Record* const record = request->req_rpb[m_stream].rpb_record;
+	const NestValueArray& sourceList = m_groupMap->sourceList;
+	UCHAR* current = nullptr;
+
+	while (true)
+	{
+		FB_UINT64 position = 0;
+
+		if (table->isReplaying())
+		{
+			if (!table->getPosition(position))
+				break;
+
+			m_buffer->locate(tdbb, position);
+
+			if (!m_buffer->getRecord(tdbb))
+			{
+				fb_assert(false);
+				break;
+			}
+		}
+		else if (!m_next->getRecord(tdbb))
+			break;
+
+		const ULONG hash = computeHash(tdbb, request, table->getKey());
+		UCHAR* group = table->find(hash);
+
+		if (!group)
+		{
+			group = table->add(hash);
+
+			if (!group)
+			{
+				if (!table->isReplaying())
+					position = m_buffer->storeRecord(tdbb);
+
+				table->defer(hash, position);
+				continue;
+			}
+
+			if (current)
+				saveState(request, current);
+
+			current = group;
+
+			// The first row of the group assigns its values to the aggregated record
+
+			aggInit(tdbb, request, m_groupMap);
+			aggPass(tdbb, request, sourceList, m_groupMap->targetList);
+
+			record->copyDataTo(group + m_recordOffset);
+			continue;
+		}
+
+		if (group != current)
+		{
+			if (current)
+				saveState(request, current);
+
+			loadState(request, group);
+			current = group;
+		}
+
+		for (const auto& source : sourceList)
+		{
+			if (const auto aggNode = nodeAs<AggNode>(source))
+				aggNode->aggPass(tdbb, request);
+		}
+	}
+
+	if (current)
+		saveState(request, current);
+}
+
+// Records were aggregated by the workers of the parallel scan, so the groups are got
+// by combining their partial groups. Partial groups of the groups not fitting the memory
+// are buffered and combined by the later passes.
+
+void HashAggregatedStream::combinePartialGroups(thread_db* tdbb, Request* request,
+	GroupTable* table) const
+{
+	Record* const record = request->req_rpb[m_stream].rpb_record;
+	const ULONG length = m_partialScan->getPartialLength(tdbb);
+	UCHAR* current = nullptr;
+
+	while (true)
+	{
+		FB_UINT64 position = 0;
+		const UCHAR* partial;
+
+		if (table->isReplaying())
+		{
+			if (!table->getPosition(position))
+				break;
+
+			partial = table->readPartial(position, length);
+		}
+		else if (!(partial = m_partialScan->getPartialGroup(tdbb)))
+			break;
+
+		const UCHAR* const state = m_partialScan->loadPartialGroup(tdbb, partial);
+
+		const ULONG hash = computeHash(tdbb, request, table->getKey());
+		UCHAR* group = table->find(hash);
+
+		if (!group)
+		{
+			group = table->add(hash);
+
+			if (!group)
+			{
+				if (!table->isReplaying())
+					position = table->storePartial(partial, length);
+
+				table->defer(hash, position);
+				continue;
+			}
+
+			if (current)
+				saveState(request, current);
+
+			current = group;
+
+			// The first partial group assigns its values to the aggregated record
+
+			aggInit(tdbb, request, m_groupMap);
+			aggCombine(tdbb, request, m_partialScan, m_groupMap->sourceList,
+				m_groupMap->targetList, state);
+
+			record->copyDataTo(group + m_recordOffset);
+			continue;
+		}
+
+		if (group != current)
+		{
+			if (current)
+				saveState(request, current);
+
+			loadState(request, group);
+			current = group;
+		}
+
+		m_partialScan->combine(tdbb, request, state);
+	}
+
+	if (current)
+		saveState(request, current);
+}
+
+ULONG HashAggregatedStream::computeHash(thread_db* tdbb, Request* request, UCHAR* key) const
+{
+	memset(key, 0, m_keyLength);
+
+	UCHAR* keyPtr = key;
+
+	for (FB_SIZE_T i = 0; i < m_group->getCount(); i++)
+	{
+		dsc* const desc = EVL_expr(tdbb, request, (*m_group)[i]);
+		const ULONG keyLength = m_keyLengths[i];
+
+		if (desc && !(request->req_flags & req_null))
+		{
+			*keyPtr = 1;
+			HashJoin::makeKey(tdbb, desc, keyLength, keyPtr + 1);
+		}
+
+		keyPtr += 1 + keyLength;
+	}
+
+	fb_assert(keyPtr - key == m_keyLength);
+
+	return InternalHash::hash(m_keyLength, key);
+}
+
+void HashAggregatedStream::saveState(Request* request, UCHAR* group) const
+{
+	UCHAR* ptr = group + m_stateOffset;
+
+	for (const auto& area : m_stateAreas)
+	{
+		memcpy(ptr, request->getImpure<UCHAR>(area.offset), area.length);
+		ptr += FB_ALIGN(area.length, FB_ALIGNMENT);
+	}
+}
+
+void HashAggregatedStream::loadState(Request* request, const UCHAR* group) const
+{
+	const UCHAR* ptr = group + m_stateOffset;
+
+	for (const auto& area : m_stateAreas)
+	{
+		memcpy(request->getImpure<UCHAR>(area.offset), ptr, area.length);
+		ptr += FB_ALIGN(area.length, FB_ALIGNMENT);
+	}
+}
@@ -31,6 +31,7 @@
 #include "../jrd/mov_proto.h"
 #include "../jrd/intl_proto.h"
 #include "../jrd/optimizer/Optimizer.h"
+#include "../jrd/TempSpace.h"
 
 #include "RecordSource.h"
 
@@ -43,215 +44,735 @@ using namespace Jrd;
 // Data access: hash join
 // ----------------------
 
-// NS: FIXME - Why use static hash table here??? Hash table shall support dynamic resizing
-static const ULONG HASH_SIZE = 1009;
-static const ULONG BUCKET_PREALLOCATE_SIZE = 32;	// 256 bytes per bucket
+static const char* const SCRATCH = "fb_hash_";
 
-unsigned HashJoin::maxCapacity()
-{
-	// Binary search across 1000 collisions is computationally similar to
-	// linear search across 10 collisions. We use this number as a rough
-	// estimation of whether the lookup performance is likely to be acceptable.
-	return HASH_SIZE * 1000;
-}
+static const ULONG MIN_TABLE_SIZE = 16;
+static const ULONG MAX_TABLE_SIZE = 1u << 31;
+static const ULONG MAX_PREALLOCATE_SIZE = 1024 * 1024;	// 8MB per stream
+
+// Rows of the inner streams are cached by the record buffers, which may live on disk,
+// so the memory budget is about the hash table only, up to 20 bytes per row.
+static const ULONG MAX_MEMORY_ROWS = 4 * 1024 * 1024;
+
+// Spilled rows are distributed between partitions by the bits of their hash value,
+// the next bits are used when a partition is too big and gets split.
+static const ULONG PARTITION_BITS = 4;
+static const ULONG PARTITION_COUNT = 1 << PARTITION_BITS;
+static const ULONG MAX_PARTITION_LEVEL = 4;
+
+static const ULONG SPILL_CHUNK_SIZE = 4096;		// entries written at once
+
+// Bloom filter is built for up to this number of rows, the larger tables
+// are unlikely to reject enough leader rows to pay off
+static const ULONG MAX_FILTER_ROWS = 1024 * 1024;	// 1MB of bits
+static const ULONG MIN_FILTER_WORDS = 16;
 
 
 class HashJoin::HashTable : public PermanentStorage
 {
-	class CollisionList
+	struct Entry
 	{
-		static const FB_SIZE_T INVALID_ITERATOR = FB_SIZE_T(~0);
-
-		struct Entry
-		{
-			Entry()
-				: hash(0), position(0)
-			{}
-
-			Entry(ULONG h, ULONG pos)
-				: hash(h), position(pos)
-			{}
+		ULONG hash;
+		ULONG position;
+	};
 
-			static const ULONG generate(const Entry& item)
-			{
-				return item.hash;
-			}
+	// Rows of the inner stream are hashed into an open-addressing table of distinct
+	// hash values. The table is built when the whole stream is read, so its size is
+	// known exactly. Every slot refers to the contiguous range of row positions
+	// having that hash value.
 
+	class Stream
+	{
+		struct Slot
+		{
 			ULONG hash;
-			ULONG position;
+			ULONG first;		// index of the first position
+			ULONG count;		// number of positions, zero for a free slot
 		};
 
 	public:
-		CollisionList(MemoryPool& pool)
-			: m_collisions(pool, BUCKET_PREALLOCATE_SIZE),
-			  m_iterator(INVALID_ITERATOR)
+		explicit Stream(MemoryPool& pool)
+			: m_entries(pool), m_slots(pool), m_positions(pool),
+			  m_shift(0), m_current(nullptr), m_iterator(0)
+		{}
+
+		void reserve(ULONG count)
 		{
-			m_collisions.setSortMode(FB_ARRAY_SORT_MANUAL);
+			m_entries.getBuffer(MIN(count, MAX_PREALLOCATE_SIZE), false);
+			m_entries.clear();
 		}
 
-		void sort()
+		void add(const Entry& entry)
 		{
-			m_collisions.sort();
+			m_entries.add(entry);
 		}
 
-		ULONG getCount() const
+		Array<Entry>& getEntries()
+		{
+			return m_entries;
+		}
+
+		void clear()
 		{
-			return (ULONG) m_collisions.getCount();
+			m_entries.clear();
+			m_slots.free();
+			m_positions.free();
+			m_current = nullptr;
 		}
 
-		void add(ULONG hash, ULONG position)
+		void build()
 		{
-			m_collisions.add(Entry(hash, position));
+			const ULONG count = m_entries.getCount();
+
+			// Keep the table at most half full
+
+			ULONG size = MIN_TABLE_SIZE;
+
+			while (size / 2 < count && size < MAX_TABLE_SIZE)
+				size <<= 1;
+
+			m_shift = 32;
+
+			for (ULONG n = size; n > 1; n >>= 1)
+				m_shift--;
+
+			Slot* const slots = m_slots.getBuffer(size, false);
+			memset(slots, 0, size * sizeof(Slot));
+
+			// Count the rows per hash value
+
+			for (const auto& entry : m_entries)
+			{
+				Slot* const slot = find(entry.hash);
+				slot->hash = entry.hash;
+				slot->count++;
+			}
+
+			// Assign ranges of positions to slots
+
+			ULONG first = 0;
+
+			for (ULONG i = 0; i < size; i++)
+			{
+				slots[i].first = first;
+				first += slots[i].count;
+			}
+
+			// Distribute positions, they remain ordered inside the range
+
+			ULONG* const positions = m_positions.getBuffer(count, false);
+
+			for (const auto& entry : m_entries)
+				positions[find(entry.hash)->first++] = entry.position;
+
+			for (ULONG i = 0; i < size; i++)
+				slots[i].first -= slots[i].count;
+
+#ifdef PRINT_HASH_TABLE
+			ULONG distinct = 0, max = 0;
+
+			for (ULONG i = 0; i < size; i++)
+			{
+				if (slots[i].count)
+				{
+					distinct++;
+					max = MAX(max, slots[i].count);
+				}
+			}
+
+			printf("Hash table size %u, count %u, distinct %u, max %u\n",
+				   size, count, distinct, max);
+#endif
+
+			m_entries.free();
 		}
 
 		bool locate(ULONG hash)
 		{
-			if (m_collisions.find(hash, m_iterator))
-				return true;
+			m_current = find(hash);
+			m_iterator = m_current->first;
 
-			m_iterator = INVALID_ITERATOR;
-			return false;
+			return (m_current->count != 0);
 		}
 
-		bool iterate(ULONG hash, ULONG& position)
+		void reset()
 		{
-			if (m_iterator >= m_collisions.getCount())
+			m_iterator = m_current->first;
+		}
+
+		bool iterate(ULONG& position)
+		{
+			if (m_iterator >= m_current->first + m_current->count)
 				return false;
 
-			const Entry& collision = m_collisions[m_iterator++];
+			position = m_positions[m_iterator++];
+			return true;
+		}
 
-			if (hash != collision.hash)
+	private:
+		Slot* find(ULONG hash)
+		{
+			// Multiplicative hashing spreads the values over the table,
+			// then the collisions are probed linearly
+
+			const ULONG mask = m_slots.getCount() - 1;
+			ULONG i = (hash * 0x9E3779B1) >> m_shift;
+
+			while (true)
 			{
-				m_iterator = INVALID_ITERATOR;
-				return false;
+				Slot* const slot = &m_slots[i];
+
+				if (!slot->count || slot->hash == hash)
+					return slot;
+
+				i = (i + 1) & mask;
 			}
+		}
 
-			position = collision.position;
-			return true;
+		Array<Entry> m_entries;		// rows collected before the table is built
+		Array<Slot> m_slots;
+		Array<ULONG> m_positions;
+		ULONG m_shift;
+		Slot* m_current;
+		ULONG m_iterator;
+	};
+
+	// Entries of a stream belonging to the spilled partition. They're written
+	// to the temporary space by chunks, the last incomplete chunk stays in memory.
+
+	class EntryList
+	{
+	public:
+		explicit EntryList(MemoryPool& pool)
+			: m_buffer(pool), m_chunks(pool), m_count(0)
+		{}
+
+		ULONG getCount() const
+		{
+			return m_count;
+		}
+
+		void add(TempSpace* space, const Entry& entry)
+		{
+			m_buffer.add(entry);
+			m_count++;
+
+			if (m_buffer.getCount() == SPILL_CHUNK_SIZE)
+			{
+				const FB_SIZE_T length = SPILL_CHUNK_SIZE * sizeof(Entry);
+				const offset_t offset = space->allocateSpace(length);
+				space->write(offset, m_buffer.begin(), length);
+
+				m_chunks.add(offset);
+				m_buffer.clear();
+			}
+		}
+
+		bool read(TempSpace* space, ULONG chunk, Array<Entry>& entries) const
+		{
+			if (chunk < m_chunks.getCount())
+			{
+				const FB_SIZE_T length = SPILL_CHUNK_SIZE * sizeof(Entry);
+				space->read(m_chunks[chunk], entries.getBuffer(SPILL_CHUNK_SIZE, false), length);
+				return true;
+			}
+
+			if (chunk == m_chunks.getCount() && m_buffer.hasData())
+			{
+				entries.assign(m_buffer);
+				return true;
+			}
+
+			return false;
+		}
+
+		void release(TempSpace* space)
+		{
+			for (const auto offset : m_chunks)
+				space->releaseSpace(offset, SPILL_CHUNK_SIZE * sizeof(Entry));
+
+			m_chunks.free();
+			m_buffer.free();
+			m_count = 0;
 		}
 
 	private:
-		SortedArray<Entry, EmptyStorage<Entry>, ULONG, Entry> m_collisions;
-		FB_SIZE_T m_iterator;
+		Array<Entry> m_buffer;
+		Array<offset_t> m_chunks;
+		ULONG m_count;
+	};
+
+	// Partition contains the entry lists of the inner streams followed by the list
+	// of the leader rows deferred until the partition is joined
+
+	struct Partition
+	{
+		Partition(MemoryPool& pool, ULONG listCount, ULONG aLevel)
+			: lists(pool), level(aLevel)
+		{
+			for (ULONG i = 0; i < listCount; i++)
+				lists.add();
+		}
+
+		EntryList& getLeader()
+		{
+			return lists[lists.getCount() - 1];
+		}
+
+		ObjectsArray<EntryList> lists;
+		const ULONG level;
 	};
 
 public:
-	HashTable(MemoryPool& pool, ULONG streamCount, ULONG tableSize = HASH_SIZE)
-		: PermanentStorage(pool), m_streamCount(streamCount),
-		  m_tableSize(tableSize), m_slot(0)
+	HashTable(MemoryPool& pool, ULONG streamCount, bool canSpill)
+		: PermanentStorage(pool), m_streams(pool), m_canSpill(canSpill),
+		  m_memoryRows(0), m_resident(false),
+		  m_partitions(pool), m_pending(pool), m_current(nullptr),
+		  m_leaderEntries(pool), m_leaderChunk(0), m_leaderIndex(0)
 	{
-		m_collisions = FB_NEW_POOL(pool) CollisionList*[streamCount * tableSize];
-		memset(m_collisions, 0, streamCount * tableSize * sizeof(CollisionList*));
+		for (ULONG i = 0; i < streamCount; i++)
+			m_streams.add();
 	}
 
 	~HashTable()
 	{
-		for (ULONG i = 0; i < m_streamCount * m_tableSize; i++)
-			delete m_collisions[i];
+		for (auto partition : m_partitions)
+			delete partition;
+
+		for (auto partition : m_pending)
+			delete partition;
 
-		delete[] m_collisions;
+		delete m_current;
 	}
 
-	void put(ULONG stream, ULONG hash, ULONG position)
+	void reserve(ULONG stream, ULONG count)
 	{
-		const ULONG slot = hash % m_tableSize;
+		fb_assert(stream < m_streams.getCount());
+		m_streams[stream].reserve(MIN(count, MAX_MEMORY_ROWS));
+	}
 
-		fb_assert(stream < m_streamCount);
-		fb_assert(slot < m_tableSize);
+	void put(ULONG stream, ULONG hash, ULONG position)
+	{
+		fb_assert(stream < m_streams.getCount());
 
-		CollisionList* collisions = m_collisions[stream * m_tableSize + slot];
+		const Entry entry = {hash, position};
 
-		if (!collisions)
+		if (isDeferred(hash))
 		{
-			collisions = FB_NEW_POOL(getPool()) CollisionList(getPool());
-			m_collisions[stream * m_tableSize + slot] = collisions;
+			m_partitions[getPartition(hash, 0)]->lists[stream].add(m_space, entry);
+			return;
 		}
 
-		collisions->add(hash, position);
+		m_streams[stream].add(entry);
+
+		if (++m_memoryRows > MAX_MEMORY_ROWS && m_canSpill)
+			spill();
 	}
 
 	bool setup(ULONG hash)
 	{
-		const ULONG slot = hash % m_tableSize;
+		for (auto& stream : m_streams)
+		{
+			if (!stream.locate(hash))
+				return false;
+		}
+
+		return true;
+	}
+
+	void reset(ULONG stream)
+	{
+		fb_assert(stream < m_streams.getCount());
+		m_streams[stream].reset();
+	}
+
+	bool iterate(ULONG stream, ULONG& position)
+	{
+		fb_assert(stream < m_streams.getCount());
+		return m_streams[stream].iterate(position);
+	}
+
+	void build()
+	{
+		for (auto& stream : m_streams)
+			stream.build();
+	}
+
+	bool isSpilled() const
+	{
+		return m_space.hasData();
+	}
+
+	// Leader row matches the rows of the spilled partition,
+	// so it must wait until that partition is loaded
+
+	bool isDeferred(ULONG hash) const
+	{
+		if (m_partitions.isEmpty())
+			return false;
+
+		return !(m_resident && getPartition(hash, 0) == 0);
+	}
+
+	void defer(ULONG hash, ULONG position)
+	{
+		const Entry entry = {hash, position};
+		m_partitions[getPartition(hash, 0)]->getLeader().add(m_space, entry);
+	}
 
-		for (ULONG i = 0; i < m_streamCount; i++)
+	// Return the next deferred leader row, loading the next partition
+	// into the hash table when the current one is done
+
+	bool getDeferred(ULONG& hash, ULONG& position)
+	{
+		fb_assert(isSpilled());
+
+		while (true)
 		{
-			CollisionList* const collisions = m_collisions[i * m_tableSize + slot];
+			if (m_current)
+			{
+				if (m_leaderIndex < m_leaderEntries.getCount())
+				{
+					const Entry& entry = m_leaderEntries[m_leaderIndex++];
+					hash = entry.hash;
+					position = entry.position;
+					return true;
+				}
 
-			if (!collisions)
-				return false;
+				if (m_current->getLeader().read(m_space, m_leaderChunk, m_leaderEntries))
+				{
+					m_leaderChunk++;
+					m_leaderIndex = 0;
+					continue;
+				}
+
+				release(m_current);
+				m_current = nullptr;
+			}
 
-			if (!collisions->locate(hash))
+			// The leader is read completely, the spilled partitions are pending now
+
+			while (m_partitions.hasData())
+				m_pending.add(m_partitions.pop());
+
+			if (m_pending.isEmpty())
 				return false;
+
+			Partition* const partition = m_pending.pop();
+
+			// Partition without leader rows produces nothing
+
+			if (!partition->getLeader().getCount())
+			{
+				release(partition);
+				continue;
+			}
+
+			if (!load(partition))
+				continue;
+
+			m_current = partition;
+			m_leaderEntries.clear();
+			m_leaderChunk = 0;
+			m_leaderIndex = 0;
 		}
+	}
 
-		m_slot = slot;
-		return true;
+private:
+	static ULONG getPartition(ULONG hash, ULONG level)
+	{
+		return (hash >> (level * PARTITION_BITS)) & (PARTITION_COUNT - 1);
 	}
 
-	void reset(ULONG stream, ULONG hash)
+	// Move the entries of the spilled partitions to the temporary space.
+	// The first partition remains in memory unless it's too big as well.
+
+	void spill()
 	{
-		fb_assert(stream < m_streamCount);
+		if (m_partitions.isEmpty())
+		{
+			MemoryPool& pool = getPool();
+			m_space = FB_NEW_POOL(pool) TempSpace(pool, SCRATCH);
+
+			const ULONG listCount = m_streams.getCount() + 1;
+
+			for (ULONG i = 0; i < PARTITION_COUNT; i++)
+				m_partitions.add(FB_NEW_POOL(pool) Partition(pool, listCount, 0));
 
-		CollisionList* const collisions = m_collisions[stream * m_tableSize + m_slot];
-		collisions->locate(hash);
+			m_resident = true;
+		}
+		else
+			m_resident = false;
+
+		m_memoryRows = 0;
+
+		for (FB_SIZE_T i = 0; i < m_streams.getCount(); i++)
+		{
+			Array<Entry>& entries = m_streams[i].getEntries();
+			FB_SIZE_T kept = 0;
+
+			for (const auto& entry : entries)
+			{
+				if (isDeferred(entry.hash))
+					m_partitions[getPartition(entry.hash, 0)]->lists[i].add(m_space, entry);
+				else
+					entries[kept++] = entry;
+			}
+
+			entries.shrink(kept);
+			m_memoryRows += kept;
+		}
+
+		if (m_memoryRows > MAX_MEMORY_ROWS)
+			spill();
 	}
 
-	bool iterate(ULONG stream, ULONG hash, ULONG& position)
+	// Load the inner entries of the partition and build the hash table.
+	// If they don't fit the memory budget, split the partition instead.
+
+	bool load(Partition* partition)
 	{
-		fb_assert(stream < m_streamCount);
+		const ULONG streamCount = m_streams.getCount();
+
+		FB_UINT64 count = 0;
+
+		for (ULONG i = 0; i < streamCount; i++)
+			count += partition->lists[i].getCount();
+
+		if (count > MAX_MEMORY_ROWS && partition->level + 1 < MAX_PARTITION_LEVEL)
+		{
+			split(partition);
+			return false;
+		}
 
-		CollisionList* const collisions = m_collisions[stream * m_tableSize + m_slot];
-		return collisions->iterate(hash, position);
+		Array<Entry> chunk(getPool());
+
+		for (ULONG i = 0; i < streamCount; i++)
+		{
+			Stream& stream = m_streams[i];
+			EntryList& list = partition->lists[i];
+
+			stream.clear();
+			stream.reserve(list.getCount());
+
+			for (ULONG n = 0; list.read(m_space, n, chunk); n++)
+			{
+				for (const auto& entry : chunk)
+					stream.add(entry);
+			}
+
+			list.release(m_space);
+			stream.build();
+		}
+
+		return true;
 	}
 
-	void sort()
+	void split(Partition* partition)
 	{
-		for (ULONG i = 0; i < m_streamCount * m_tableSize; i++)
+		MemoryPool& pool = getPool();
+
+		const ULONG listCount = partition->lists.getCount();
+		const ULONG level = partition->level + 1;
+
+		Partition* parts[PARTITION_COUNT];
+
+		for (ULONG i = 0; i < PARTITION_COUNT; i++)
 		{
-			if (const auto collisions = m_collisions[i])
-				collisions->sort();
+			parts[i] = FB_NEW_POOL(pool) Partition(pool, listCount, level);
+			m_pending.add(parts[i]);
 		}
 
-#ifdef PRINT_HASH_TABLE
-		FB_UINT64 total = 0;
-		ULONG min = MAX_ULONG, max = 0, count = 0;
+		Array<Entry> chunk(pool);
 
-		for (ULONG i = 0; i < m_streamCount * m_tableSize; i++)
+		for (ULONG i = 0; i < listCount; i++)
 		{
-			CollisionList* const collisions = m_collisions[i];
-			if (!collisions)
-				continue;
+			EntryList& list = partition->lists[i];
+
+			for (ULONG n = 0; list.read(m_space, n, chunk); n++)
+			{
+				for (const auto& entry : chunk)
+					parts[getPartition(entry.hash, level)]->lists[i].add(m_space, entry);
+			}
+		}
+
+		release(partition);
+	}
+
+	void release(Partition* partition)
+	{
+		for (auto& list : partition->lists)
+			list.release(m_space);
+
+		delete partition;
+	}
+
+	ObjectsArray<Stream> m_streams;
+	const bool m_canSpill;
+	ULONG m_memoryRows;				// entries kept in memory
+	bool m_resident;				// the first partition is kept in memory
+
+	AutoPtr<TempSpace> m_space;
+	Array<Partition*> m_partitions;	// partitions spilled while the leader is read
+	Array<Partition*> m_pending;	// partitions to be joined
+	Partition* m_current;			// partition being joined
+
+	Array<Entry> m_leaderEntries;	// current chunk of the deferred leader rows
+	ULONG m_leaderChunk;
+	ULONG m_leaderIndex;
+};
+
+
+// Blocked Bloom filter over the hashes of the first inner stream. Every hash sets
+// three bits inside a single 64-bit word, so the lookup touches one cache line.
+// It's evaluated by the record source of the leader reading the key stream,
+// until the hash table is built it passes every row.
+
+class HashJoin::BloomFilter final : public RecordSource
+{
+	struct Impure : public RecordSource::Impure
+	{
+		FB_UINT64* irsb_words;
+		UCHAR* irsb_key_buffer;
+		ULONG irsb_shift;
+	};
+
+public:
+	BloomFilter(CompilerScratch* csb, const HashJoin* join)
+		: RecordSource(csb), m_join(join)
+	{
+		m_impure = csb->allocImpure<Impure>();
+	}
+
+	void build(thread_db* tdbb, const Array<ULONG>& hashes) const
+	{
+		Request* const request = tdbb->getRequest();
+		Impure* const impure = request->getImpure<Impure>(m_impure);
 
-			const auto cnt = collisions->getCount();
+		reset(request);
 
-			if (cnt < min)
-				min = cnt;
-			if (cnt > max)
-				max = cnt;
-			total += cnt;
-			count++;
+		// About eight bits per row, it rejects ~97% of non-matching rows
+
+		ULONG count = MIN_FILTER_WORDS;
+		impure->irsb_shift = 32 - 4;
+
+		while (count < hashes.getCount() / 8)
+		{
+			count <<= 1;
+			impure->irsb_shift--;
 		}
 
-		if (count)
+		MemoryPool& pool = *tdbb->getDefaultPool();
+
+		impure->irsb_words = FB_NEW_POOL(pool) FB_UINT64[count];
+		memset(impure->irsb_words, 0, count * sizeof(FB_UINT64));
+
+		impure->irsb_key_buffer = FB_NEW_POOL(pool) UCHAR[m_join->m_leader.totalKeyLength];
+
+		for (const auto hash : hashes)
+			impure->irsb_words[getWord(impure, hash)] |= getMask(hash);
+	}
+
+	void reset(Request* request) const
+	{
+		Impure* const impure = request->getImpure<Impure>(m_impure);
+
+		delete[] impure->irsb_words;
+		impure->irsb_words = nullptr;
+
+		delete[] impure->irsb_key_buffer;
+		impure->irsb_key_buffer = nullptr;
+	}
+
+	void close(thread_db* /*tdbb*/) const override
+	{
+	}
+
+	bool refetchRecord(thread_db* /*tdbb*/) const override
+	{
+		return true;
+	}
+
+	WriteLockResult lockRecord(thread_db* /*tdbb*/) const override
+	{
+		status_exception::raise(Arg::Gds(isc_record_lock_not_supp));
+	}
+
+	void getChildren(Array<const RecordSource*>& /*children*/) const override
+	{
+	}
+
+	void print(thread_db* /*tdbb*/, string& plan, bool detailed, unsigned level, bool /*recurse*/) const override
+	{
+		if (detailed)
 		{
-			printf("Hash table size %u, count %u, buckets %u, min %u, max %u, avg %u\n",
-				   m_tableSize, (ULONG) total, count, min, max, (ULONG) (total / count));
+			plan += printIndent(++level) + "Bloom Filter";
 		}
-#endif
+	}
+
+	void markRecursive() override
+	{
+	}
+
+	void invalidateRecords(Request* /*request*/) const override
+	{
+	}
+
+	void findUsedStreams(StreamList& /*streams*/, bool /*expandAll*/) const override
+	{
+	}
+
+	bool isDependent(const StreamList& /*streams*/) const override
+	{
+		return false;
+	}
+
+	void nullRecords(thread_db* /*tdbb*/) const override
+	{
+	}
+
+protected:
+	void internalOpen(thread_db* /*tdbb*/) const override
+	{
+	}
+
+	// Check the current row of the key stream, false means it has no matches
+
+	bool internalGetRecord(thread_db* tdbb) const override
+	{
+		Request* const request = tdbb->getRequest();
+		Impure* const impure = request->getImpure<Impure>(m_impure);
+
+		if (!impure->irsb_words)
+			return true;
+
+		const ULONG hash =
+			m_join->computeHash(tdbb, request, m_join->m_leader, impure->irsb_key_buffer);
+
+		const FB_UINT64 mask = getMask(hash);
+		return (impure->irsb_words[getWord(impure, hash)] & mask) == mask;
 	}
 
 private:
-	const ULONG m_streamCount;
-	const ULONG m_tableSize;
-	CollisionList** m_collisions;
-	ULONG m_slot;
+	static ULONG getWord(const Impure* impure, ULONG hash)
+	{
+		return (hash * 0x9E3779B1) >> impure->irsb_shift;
+	}
+
+	static FB_UINT64 getMask(ULONG hash)
+	{
+		return (FB_UINT64(1) << (hash & 63)) |
+			(FB_UINT64(1) << ((hash >> 6) & 63)) |
+			(FB_UINT64(1) << ((hash >> 12) & 63));
+	}
+
+	const HashJoin* const m_join;
 };
 
 
 HashJoin::HashJoin(thread_db* tdbb, CompilerScratch* csb, JoinType joinType,
 				   FB_SIZE_T count, RecordSource* const* args, NestValueArray* const* keys,
-				   double selectivity)
+				   double selectivity, bool keepOrder)
 	: RecordSource(csb),
 	  m_joinType(joinType),
 	  m_boolean(nullptr),
@@ -259,7 +780,7 @@ HashJoin::HashJoin(thread_db* tdbb, CompilerScratch* csb, JoinType joinType,
 {
 	fb_assert(count >= 2);
 
-	init(tdbb, csb, count, args, keys, selectivity);
+	init(tdbb, csb, count, args, keys, selectivity, keepOrder);
 }
 
 HashJoin::HashJoin(thread_db* tdbb, CompilerScratch* csb,
@@ -271,16 +792,24 @@ HashJoin::HashJoin(thread_db* tdbb, CompilerScratch* csb,
 	  m_boolean(boolean),
 	  m_args(csb->csb_pool, 1)
 {
-	init(tdbb, csb, 2, args, keys, selectivity);
+	init(tdbb, csb, 2, args, keys, selectivity, false);
 }
 
 void HashJoin::init(thread_db* tdbb, CompilerScratch* csb, FB_SIZE_T count,
 					RecordSource* const* args, NestValueArray* const* keys,
-					double selectivity)
+					double selectivity, bool keepOrder)
 {
 	m_impure = csb->allocImpure<Impure>();
 
 	m_leader.source = args[0];
+
+	// Leader rows matching the spilled partitions are cached and joined after
+	// the others, so the join can spill only if the leader order may be broken
+
+	m_leaderBuffer = keepOrder ? nullptr :
+		FB_NEW_POOL(csb->csb_pool) BufferedStream(csb, m_leader.source);
+
+	m_filter = nullptr;
 	m_leader.keys = keys[0];
 	const FB_SIZE_T leaderKeyCount = m_leader.keys->getCount();
 	m_leader.keyLengths = FB_NEW_POOL(csb->csb_pool) ULONG[leaderKeyCount];
@@ -293,18 +822,7 @@ void HashJoin::init(thread_db* tdbb, CompilerScratch* csb, FB_SIZE_T count,
 		dsc desc;
 		(*m_leader.keys)[j]->getDesc(tdbb, csb, &desc);
 
-		USHORT keyLength = desc.isText() ? desc.getStringLength() : desc.dsc_length;
-
-		if (IS_INTL_DATA(&desc))
-			keyLength = INTL_key_length(tdbb, INTL_INDEX_TYPE(&desc), keyLength);
-		else if (desc.isTime())
-			keyLength = sizeof(ISC_TIME);
-		else if (desc.isTimeStamp())
-			keyLength = sizeof(ISC_TIMESTAMP);
-		else if (desc.dsc_dtype == dtype_dec64)
-			keyLength = Decimal64::getKeyLength();
-		else if (desc.dsc_dtype == dtype_dec128)
-			keyLength = Decimal128::getKeyLength();
+		const ULONG keyLength = getKeyLength(tdbb, &desc);
 
 		m_leader.keyLengths[j] = keyLength;
 		m_leader.totalKeyLength += keyLength;
@@ -333,18 +851,7 @@ void HashJoin::init(thread_db* tdbb, CompilerScratch* csb, FB_SIZE_T count,
 			dsc desc;
 			(*sub.keys)[j]->getDesc(tdbb, csb, &desc);
 
-			USHORT keyLength = desc.isText() ? desc.getStringLength() : desc.dsc_length;
-
-			if (IS_INTL_DATA(&desc))
-				keyLength = INTL_key_length(tdbb, INTL_INDEX_TYPE(&desc), keyLength);
-			else if (desc.isTime())
-				keyLength = sizeof(ISC_TIME);
-			else if (desc.isTimeStamp())
-				keyLength = sizeof(ISC_TIMESTAMP);
-			else if (desc.dsc_dtype == dtype_dec64)
-				keyLength = Decimal64::getKeyLength();
-			else if (desc.dsc_dtype == dtype_dec128)
-				keyLength = Decimal128::getKeyLength();
+			const ULONG keyLength = getKeyLength(tdbb, &desc);
 
 			sub.keyLengths[j] = keyLength;
 			sub.totalKeyLength += keyLength;
@@ -361,6 +868,40 @@ void HashJoin::init(thread_db* tdbb, CompilerScratch* csb, FB_SIZE_T count,
 	}
 
 	m_cardinality *= selectivity;
+
+	// Leader rows without matches are just skipped by inner and semi joins,
+	// so they can be rejected inside the leader using a Bloom filter.
+	// The keys are evaluated by the record source reading the key stream,
+	// so it's possible only if they're plain fields of a single stream.
+
+	if (m_joinType == INNER_JOIN || m_joinType == SEMI_JOIN)
+	{
+		StreamType keyStream = INVALID_STREAM;
+		bool pushable = true;
+
+		for (const auto key : *m_leader.keys)
+		{
+			const auto field = nodeAs<FieldNode>(key);
+
+			if (!field || (keyStream != INVALID_STREAM && field->fieldStream != keyStream))
+			{
+				pushable = false;
+				break;
+			}
+
+			keyStream = field->fieldStream;
+		}
+
+		if (pushable && keyStream != INVALID_STREAM)
+		{
+			const auto filter = FB_NEW_POOL(csb->csb_pool) BloomFilter(csb, this);
+
+			if (m_leader.source->pushFilter(keyStream, filter))
+				m_filter = filter;
+			else
+				delete filter;
+		}
+	}
 }
 
 void HashJoin::internalOpen(thread_db* tdbb) const
@@ -376,7 +917,15 @@ void HashJoin::internalOpen(thread_db* tdbb) const
 	delete[] impure->irsb_leader_buffer;
 	impure->irsb_leader_buffer = nullptr;
 
-	m_leader.source->open(tdbb);
+	impure->irsb_deferred = false;
+
+	if (m_filter)
+		m_filter->reset(request);
+
+	if (m_leaderBuffer)
+		m_leaderBuffer->open(tdbb);
+	else
+		m_leader.source->open(tdbb);
 }
 
 void HashJoin::close(thread_db* tdbb) const
@@ -396,10 +945,16 @@ void HashJoin::close(thread_db* tdbb) const
 		delete[] impure->irsb_leader_buffer;
 		impure->irsb_leader_buffer = nullptr;
 
+		if (m_filter)
+			m_filter->reset(request);
+
 		for (FB_SIZE_T i = 0; i < m_args.getCount(); i++)
 			m_args[i].buffer->close(tdbb);
 
-		m_leader.source->close(tdbb);
+		if (m_leaderBuffer)
+			m_leaderBuffer->close(tdbb);
+		else
+			m_leader.source->close(tdbb);
 	}
 }
 
@@ -419,17 +974,40 @@ bool HashJoin::internalGetRecord(thread_db* tdbb) const
 	{
 		if (impure->irsb_flags & irsb_mustread)
 		{
-			// Fetch the record from the leading stream
+			if (impure->irsb_deferred)
+			{
+				// Fetch the leader record deferred to the partition being joined
 
-			if (!m_leader.source->getRecord(tdbb))
-				return false;
+				ULONG position;
+				if (!impure->irsb_hash_table->getDeferred(impure->irsb_leader_hash, position))
+					return false;
 
-			if (m_boolean && !m_boolean->execute(tdbb, request))
+				m_leaderBuffer->locate(tdbb, position);
+
+				if (!m_leaderBuffer->getRecord(tdbb))
+					fb_assert(false);
+			}
+			else
 			{
-				// The boolean pertaining to the left sub-stream is false
-				// so just join sub-stream to a null valued right sub-stream
-				inner->nullRecords(tdbb);
-				return true;
+				// Fetch the record from the leading stream
+
+				if (!m_leader.source->getRecord(tdbb))
+				{
+					if (!impure->irsb_hash_table || !impure->irsb_hash_table->isSpilled())
+						return false;
+
+					// Now join the leader rows deferred to the spilled partitions
+					impure->irsb_deferred = true;
+					continue;
+				}
+
+				if (m_boolean && !m_boolean->execute(tdbb, request))
+				{
+					// The boolean pertaining to the left sub-stream is false
+					// so just join sub-stream to a null valued right sub-stream
+					inner->nullRecords(tdbb);
+					return true;
+				}
 			}
 
 			// We have something to join with, so ensure the hash table is initialized
@@ -439,11 +1017,15 @@ bool HashJoin::internalGetRecord(thread_db* tdbb) const
 				auto& pool = *tdbb->getDefaultPool();
 				const auto argCount = m_args.getCount();
 
-				impure->irsb_hash_table = FB_NEW_POOL(pool) HashTable(pool, argCount);
+				impure->irsb_hash_table = FB_NEW_POOL(pool) HashTable(pool, argCount, m_leaderBuffer != nullptr);
 				impure->irsb_leader_buffer = FB_NEW_POOL(pool) UCHAR[m_leader.totalKeyLength];
 
 				UCharBuffer buffer(pool);
 
+				// Hashes of the first inner stream for the Bloom filter
+				Array<ULONG> filterHashes(pool);
+				bool useFilter = (m_filter != nullptr);
+
 				for (FB_SIZE_T i = 0; i < argCount; i++)
 				{
 					// Read and cache the inner streams. While doing that,
@@ -454,20 +1036,52 @@ bool HashJoin::internalGetRecord(thread_db* tdbb) const
 					ULONG counter = 0;
 					const auto keyBuffer = buffer.getBuffer(m_args[i].totalKeyLength, false);
 
+					// The estimation is used to preallocate the table,
+					// it grows anyway if there are more rows
+
+					const double cardinality = m_args[i].source->getCardinality();
+					impure->irsb_hash_table->reserve(i, (ULONG) MIN(cardinality, (double) MAX_ULONG));
+
 					while (m_args[i].buffer->getRecord(tdbb))
 					{
 						const auto hash = computeHash(tdbb, request, m_args[i], keyBuffer);
 						impure->irsb_hash_table->put(i, hash, counter++);
+
+						if (i == 0 && useFilter)
+						{
+							if (filterHashes.getCount() < MAX_FILTER_ROWS)
+								filterHashes.add(hash);
+							else
+							{
+								useFilter = false;
+								filterHashes.free();
+							}
+						}
 					}
 				}
 
-				impure->irsb_hash_table->sort();
+				impure->irsb_hash_table->build();
+
+				if (useFilter)
+					m_filter->build(tdbb, filterHashes);
 			}
 
-			// Compute and hash the comparison keys
+			if (!impure->irsb_deferred)
+			{
+				// Compute and hash the comparison keys
 
-			impure->irsb_leader_hash =
-				computeHash(tdbb, request, m_leader, impure->irsb_leader_buffer);
+				impure->irsb_leader_hash =
+					computeHash(tdbb, request, m_leader, impure->irsb_leader_buffer);
+
+				// Postpone the row if its matches are spilled
+
+				if (impure->irsb_hash_table->isDeferred(impure->irsb_leader_hash))
+				{
+					const auto position = m_leaderBuffer->storeRecord(tdbb);
+					impure->irsb_hash_table->defer(impure->irsb_leader_hash, (ULONG) position);
+					continue;
+				}
+			}
 
 			// Ensure the every inner stream having matches for this hash slot.
 			// Setup the hash table for the iteration through collisions.
@@ -553,7 +1167,10 @@ WriteLockResult HashJoin::lockRecord(thread_db* tdbb) const
 
 void HashJoin::getChildren(Array<const RecordSource*>& children) const
 {
-	children.add(m_leader.source);
+	if (m_leaderBuffer)
+		children.add(m_leaderBuffer);
+	else
+		children.add(m_leader.source);
 
 	for (FB_SIZE_T i = 0; i < m_args.getCount(); i++)
 		children.add(m_args[i].source);
@@ -630,6 +1247,12 @@ void HashJoin::findUsedStreams(StreamList& streams, bool expandAll) const
 		m_args[i].source->findUsedStreams(streams, expandAll);
 }
 
+bool HashJoin::pushFilter(StreamType stream, RecordSource* filter)
+{
+	// Leader rows rejected by the filter produce nothing
+	return m_leader.source->pushFilter(stream, filter);
+}
+
 bool HashJoin::isDependent(const StreamList& streams) const
 {
 	if (m_leader.source->isDependent(streams))
@@ -660,6 +1283,84 @@ void HashJoin::nullRecords(thread_db* tdbb) const
 		m_args[i].source->nullRecords(tdbb);
 }
 
+ULONG HashJoin::getKeyLength(thread_db* tdbb, const dsc* desc)
+{
+	ULONG keyLength = desc->isText() ? desc->getStringLength() : desc->dsc_length;
+
+	if (IS_INTL_DATA(desc))
+		keyLength = INTL_key_length(tdbb, INTL_INDEX_TYPE(desc), keyLength);
+	else if (desc->isTime())
+		keyLength = sizeof(ISC_TIME);
+	else if (desc->isTimeStamp())
+		keyLength = sizeof(ISC_TIMESTAMP);
+	else if (desc->dsc_dtype == dtype_dec64)
+		keyLength = Decimal64::getKeyLength();
+	else if (desc->dsc_dtype == dtype_dec128)
+		keyLength = Decimal128::getKeyLength();
+
+	return keyLength;
+}
+
+// Put the binary comparable form of the value into the key,
+// equal values have equal keys regardless of their representation
+
+void HashJoin::makeKey(thread_db* tdbb, dsc* desc, ULONG keyLength, UCHAR* keyPtr)
+{
+	if (desc->isText())
+	{
+		dsc to;
+		to.makeText(keyLength, desc->getTextType(), keyPtr);
+
+		if (IS_INTL_DATA(desc))
+		{
+			// Convert the INTL string into the binary comparable form
+			INTL_string_to_key(tdbb, INTL_INDEX_TYPE(desc),
+							   desc, &to, INTL_KEY_UNIQUE);
+		}
+		else
+		{
+			// This call ensures that the padding bytes are appended
+			MOV_move(tdbb, desc, &to);
+		}
+	}
+	else
+	{
+		const auto data = desc->dsc_address;
+
+		if (desc->isDecFloat())
+		{
+			// Values inside our key buffer are not aligned,
+			// so ensure we satisfy our platform's alignment rules
+			OutAligner<ULONG, MAX_DEC_KEY_LONGS> key(keyPtr, keyLength);
+
+			if (desc->dsc_dtype == dtype_dec64)
+				((Decimal64*) data)->makeKey(key);
+			else if (desc->dsc_dtype == dtype_dec128)
+				((Decimal128*) data)->makeKey(key);
+			else
+				fb_assert(false);
+		}
+		else if (desc->dsc_dtype == dtype_real && *(float*) data == 0)
+		{
+			fb_assert(keyLength == sizeof(float));
+			memset(keyPtr, 0, keyLength); // positive zero in binary
+		}
+		else if (desc->dsc_dtype == dtype_double && *(double*) data == 0)
+		{
+			fb_assert(keyLength == sizeof(double));
+			memset(keyPtr, 0, keyLength); // positive zero in binary
+		}
+		else
+		{
+			// We don't enforce proper alignments inside the key buffer,
+			// so use plain byte copying instead of MOV_move() to avoid bus errors.
+			// Note: for date/time with time zone, we copy only the UTC part.
+			fb_assert(keyLength <= desc->dsc_length);
+			memcpy(keyPtr, data, keyLength);
+		}
+	}
+}
+
 ULONG HashJoin::computeHash(thread_db* tdbb,
 							Request* request,
 						    const SubStream& sub,
@@ -672,64 +1373,10 @@ ULONG HashJoin::computeHash(thread_db* tdbb,
 	for (FB_SIZE_T i = 0; i < sub.keys->getCount(); i++)
 	{
 		dsc* const desc = EVL_expr(tdbb, request, (*sub.keys)[i]);
-		const USHORT keyLength = sub.keyLengths[i];
+		const ULONG keyLength = sub.keyLengths[i];
 
 		if (desc && !(request->req_flags & req_null))
-		{
-			if (desc->isText())
-			{
-				dsc to;
-				to.makeText(keyLength, desc->getTextType(), keyPtr);
-
-				if (IS_INTL_DATA(desc))
-				{
-					// Convert the INTL string into the binary comparable form
-					INTL_string_to_key(tdbb, INTL_INDEX_TYPE(desc),
-									   desc, &to, INTL_KEY_UNIQUE);
-				}
-				else
-				{
-					// This call ensures that the padding bytes are appended
-					MOV_move(tdbb, desc, &to);
-				}
-			}
-			else
-			{
-				const auto data = desc->dsc_address;
-
-				if (desc->isDecFloat())
-				{
-					// Values inside our key buffer are not aligned,
-					// so ensure we satisfy our platform's alignment rules
-					OutAligner<ULONG, MAX_DEC_KEY_LONGS> key(keyPtr, keyLength);
-
-					if (desc->dsc_dtype == dtype_dec64)
-						((Decimal64*) data)->makeKey(key);
-					else if (desc->dsc_dtype == dtype_dec128)
-						((Decimal128*) data)->makeKey(key);
-					else
-						fb_assert(false);
-				}
-				else if (desc->dsc_dtype == dtype_real && *(float*) data == 0)
-				{
-					fb_assert(keyLength == sizeof(float));
-					memset(keyPtr, 0, keyLength); // positive zero in binary
-				}
-				else if (desc->dsc_dtype == dtype_double && *(double*) data == 0)
-				{
-					fb_assert(keyLength == sizeof(double));
-					memset(keyPtr, 0, keyLength); // positive zero in binary
-				}
-				else
-				{
-					// We don't enforce proper alignments inside the key buffer,
-					// so use plain byte copying instead of MOV_move() to avoid bus errors.
-					// Note: for date/time with time zone, we copy only the UTC part.
-					fb_assert(keyLength <= desc->dsc_length);
-					memcpy(keyPtr, data, keyLength);
-				}
-			}
-		}
+			makeKey(tdbb, desc, keyLength, keyPtr);
 
 		keyPtr += keyLength;
 	}
@@ -746,7 +1393,7 @@ bool HashJoin::fetchRecord(thread_db* tdbb, Impure* impure, FB_SIZE_T stream) co
 	const BufferedStream* const arg = m_args[stream].buffer;
 
 	ULONG position;
-	if (hashTable->iterate(stream, impure->irsb_leader_hash, position))
+	if (hashTable->iterate(stream, position))
 	{
 		arg->locate(tdbb, position);
 
@@ -762,9 +1409,9 @@ bool HashJoin::fetchRecord(thread_db* tdbb, Impure* impure, FB_SIZE_T stream) co
 		if (stream == 0 || !fetchRecord(tdbb, impure, stream - 1))
 			return false;
 
-		hashTable->reset(stream, impure->irsb_leader_hash);
+		hashTable->reset(stream);
 
-		if (hashTable->iterate(stream, impure->irsb_leader_hash, position))
+		if (hashTable->iterate(stream, position))
 		{
 			arg->locate(tdbb, position);
 
@@ -350,6 +350,22 @@ void NestedLoopJoin::nullRecords(thread_db* tdbb) const
 		arg->nullRecords(tdbb);
 }
 
+bool NestedLoopJoin::pushFilter(StreamType stream, RecordSource* filter)
+{
+	// Rows rejected from the outer stream produce nothing, but the inner streams
+	// of outer/semi/anti joins may not lose rows without changing the result
+
+	const FB_SIZE_T count = (m_joinType == INNER_JOIN) ? m_args.getCount() : 1;
+
+	for (FB_SIZE_T i = 0; i < count; i++)
+	{
+		if (m_args[i]->pushFilter(stream, filter))
+			return true;
+	}
+
+	return false;
+}
+
 bool NestedLoopJoin::fetchRecord(thread_db* tdbb, FB_SIZE_T n) const
 {
 	fb_assert(m_joinType == INNER_JOIN);
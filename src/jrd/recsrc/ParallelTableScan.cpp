@@ -0,0 +1,1714 @@
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.ibphoenix.com/main.nfs?a=ibphoenix&page=ibp_idpl.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by the Firebird Project
+ *  for the Firebird Open Source RDBMS project.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "firebird.h"
+#include "../common/classes/ClumpletWriter.h"
+#include "../common/classes/condition.h"
+#include "../common/classes/Hash.h"
+#include "../common/config/config.h"
+#include "../common/Task.h"
+#include "../jrd/jrd.h"
+#include "../jrd/req.h"
+#include "../jrd/tra.h"
+#include "../jrd/WorkerAttachment.h"
+#include "../dsql/BoolNodes.h"
+#include "../dsql/ExprNodes.h"
+#include "../jrd/cch_proto.h"
+#include "../jrd/dpm_proto.h"
+#include "../jrd/evl_proto.h"
+#include "../jrd/intl_proto.h"
+#include "../jrd/met_proto.h"
+#include "../jrd/mov_proto.h"
+#include "../jrd/rlck_proto.h"
+#include "../jrd/tra_proto.h"
+#include "../jrd/vio_proto.h"
+
+#include "RecordSource.h"
+
+using namespace Firebird;
+using namespace Jrd;
+
+// -----------------------------------------
+// Data access: parallel complete table scan
+// -----------------------------------------
+
+namespace
+{
+	// Table data per worker needed to scan in parallel
+	const FB_UINT64 MIN_PARALLEL_SCAN_SIZE = 8 * 1024 * 1024;
+
+	// Number of data pages a worker reads at once
+	const ULONG SCAN_UNIT_PAGES = 32;
+
+	// Size of block of records passed from workers to the request thread
+	const ULONG SCAN_CHUNK_SIZE = 128 * 1024;
+	const unsigned SCAN_CHUNKS_PER_WORKER = 4;
+
+	// Record stored in a chunk, followed by the record data
+	struct RecordHeader
+	{
+		SINT64 number;
+		TraNumber transaction;
+		ULONG length;
+		USHORT format;
+	};
+
+	const ULONG RECORD_HEADER_SIZE = FB_ALIGN(sizeof(RecordHeader), FB_DOUBLE_ALIGN);
+
+	// Memory used by the partial groups of a worker. When it's exhausted,
+	// the groups are passed to the request thread and the worker starts over.
+	const ULONG PARTIAL_MEMORY = 16 * 1024 * 1024;
+	const ULONG PARTIAL_BLOCK_SIZE = 64 * 1024;
+	const ULONG MIN_TABLE_SIZE = 64;
+
+	bool isPushable(const dsc* desc)
+	{
+		return (desc->isExact() && !desc->isInt128()) || desc->isApprox() ||
+			(desc->isDateTime() && !desc->isDateTimeTz());
+	}
+
+	// Partial groups of a worker. Every group is a fixed length chunk of memory starting
+	// with the group key. Groups are allocated by blocks and indexed by the open-addressing
+	// table keeping their hash values.
+
+	class PartialGroups
+	{
+		struct Slot
+		{
+			ULONG hash;
+			ULONG group;	// group number + 1, zero for a free slot
+		};
+
+	public:
+		PartialGroups(MemoryPool& pool, ULONG groupLength, ULONG keyLength)
+			: m_pool(pool), m_groupLength(groupLength), m_keyLength(keyLength),
+			  m_maxGroups(MAX(PARTIAL_MEMORY / groupLength, 1u)),
+			  m_blockGroups(MAX(PARTIAL_BLOCK_SIZE / groupLength, 1u)),
+			  m_key(pool), m_blocks(pool), m_slots(pool), m_shift(0), m_count(0)
+		{
+			m_key.getBuffer(m_keyLength);
+			resize(MIN_TABLE_SIZE);
+		}
+
+		~PartialGroups()
+		{
+			for (auto block : m_blocks)
+				delete[] block;
+		}
+
+		UCHAR* getKey()
+		{
+			return m_key.begin();
+		}
+
+		ULONG getCount() const
+		{
+			return m_count;
+		}
+
+		UCHAR* getGroup(ULONG number) const
+		{
+			return m_blocks[number / m_blockGroups] + (number % m_blockGroups) * m_groupLength;
+		}
+
+		// Find the group having the current key
+
+		UCHAR* find(ULONG hash)
+		{
+			const ULONG mask = m_slots.getCount() - 1;
+
+			for (ULONG i = getSlot(hash); m_slots[i].group; i = (i + 1) & mask)
+			{
+				const Slot& slot = m_slots[i];
+
+				if (slot.hash == hash)
+				{
+					UCHAR* const group = getGroup(slot.group - 1);
+
+					if (!memcmp(group, m_key.begin(), m_keyLength))
+						return group;
+				}
+			}
+
+			return nullptr;
+		}
+
+		// Add the group having the current key, unless the memory is exhausted
+
+		UCHAR* add(ULONG hash)
+		{
+			if (m_count == m_maxGroups)
+				return nullptr;
+
+			// Keep the table at most half full
+
+			if ((m_count + 1) * 2 > m_slots.getCount())
+				resize(m_slots.getCount() * 2);
+
+			if (m_count / m_blockGroups == m_blocks.getCount())
+				m_blocks.add(FB_NEW_POOL(m_pool) UCHAR[m_blockGroups * m_groupLength]);
+
+			UCHAR* const group = getGroup(m_count++);
+			memcpy(group, m_key.begin(), m_keyLength);
+
+			insert(hash, m_count);
+
+			return group;
+		}
+
+		// Forget the groups, the memory is kept for the next ones
+
+		void clear()
+		{
+			m_count = 0;
+			memset(m_slots.begin(), 0, m_slots.getCount() * sizeof(Slot));
+		}
+
+	private:
+		ULONG getSlot(ULONG hash) const
+		{
+			return (hash * 0x9E3779B1) >> m_shift;
+		}
+
+		void insert(ULONG hash, ULONG group)
+		{
+			const ULONG mask = m_slots.getCount() - 1;
+			ULONG i = getSlot(hash);
+
+			while (m_slots[i].group)
+				i = (i + 1) & mask;
+
+			m_slots[i].hash = hash;
+			m_slots[i].group = group;
+		}
+
+		void resize(ULONG size)
+		{
+			Array<Slot> slots(m_pool);
+			slots.assign(m_slots);
+
+			Slot* const buffer = m_slots.getBuffer(size, false);
+			memset(buffer, 0, size * sizeof(Slot));
+
+			m_shift = 32;
+
+			for (ULONG n = size; n > 1; n >>= 1)
+				m_shift--;
+
+			for (const auto& slot : slots)
+			{
+				if (slot.group)
+					insert(slot.hash, slot.group);
+			}
+		}
+
+		MemoryPool& m_pool;
+		const ULONG m_groupLength;
+		const ULONG m_keyLength;
+		const ULONG m_maxGroups;
+		const ULONG m_blockGroups;
+
+		Array<UCHAR> m_key;			// key of the current record
+		Array<UCHAR*> m_blocks;
+		Array<Slot> m_slots;
+		ULONG m_shift;
+		ULONG m_count;
+	};
+}
+
+// Parallel scan. The table is split into units of adjacent data pages. Workers
+// read the units in their own attachments and transactions started at the
+// snapshot of the request transaction, so they see the same records as the
+// request does. Records are copied into chunks which are passed to the request
+// thread. Workers are run by a separate thread, thus the request thread is free
+// to consume the chunks as soon as they are filled.
+//
+// When aggregating, workers put the records they read into partial groups and
+// the chunks carry the partial groups instead of the records. Partial group is
+// NULL flags and values of the group fields followed by the partial states of
+// the aggregates.
+
+class ParallelTableScan::ScanTask : public Task
+{
+public:
+	ScanTask(thread_db* tdbb, const ParallelTableScan* scan, unsigned workers, CommitNumber snapshot);
+
+	virtual ~ScanTask()
+	{
+		fb_assert(!m_running);
+
+		for (Item** iter = m_items.begin(); iter != m_items.end(); ++iter)
+			delete *iter;
+
+		delete[] m_buffer;
+	}
+
+	bool handler(WorkItem& _item) override;
+	bool getWorkItem(WorkItem** pItem) override;
+	bool getResult(IStatus* status) override;
+
+	int getMaxWorkers() override
+	{
+		return m_items.getCount();
+	}
+
+	void start();
+	bool waitStarted(thread_db* tdbb);
+	void stop(thread_db* tdbb);
+
+	bool getRecord(thread_db* tdbb, record_param* rpb);
+
+	bool isAggregating() const
+	{
+		return m_aggregating;
+	}
+
+	ULONG getGroupLength() const
+	{
+		return m_groupLength;
+	}
+
+	const UCHAR* getGroup(thread_db* tdbb);
+	const UCHAR* loadGroup(thread_db* tdbb, record_param* rpb, const UCHAR* group) const;
+
+private:
+	struct Chunk;
+
+	// Group field within a partial group
+	struct GroupField
+	{
+		USHORT id;
+		ULONG offset;
+		ULONG keyLength;
+	};
+
+	class Item : public Task::WorkItem
+	{
+	public:
+		Item(ScanTask* task, MemoryPool& pool)
+			: Task::WorkItem(task),
+			  m_tra(nullptr),
+			  m_free(pool),
+			  m_buffer(pool),
+			  m_values(pool),
+			  m_groups(nullptr),
+			  m_scanned(0),
+			  m_inuse(false),
+			  m_done(false)
+		{}
+
+		virtual ~Item()
+		{
+			fini();
+			delete m_groups;
+		}
+
+		ScanTask* getTask() const
+		{
+			return static_cast<ScanTask*>(m_task);
+		}
+
+		bool init(thread_db* tdbb);
+		void fini();
+
+		RefPtr<StableAttachmentPart> m_attStable;
+		jrd_tra* m_tra;
+		HalfStaticArray<Chunk*, SCAN_CHUNKS_PER_WORKER> m_free;
+		Array<UCHAR> m_buffer;			// field values converted to the current format
+		Array<UCHAR> m_values;			// group values of the current record
+		PartialGroups* m_groups;
+		ULONG m_scanned;				// records read since the groups were passed
+		bool m_inuse;
+		bool m_done;
+	};
+
+	// Records read by a worker
+	struct Chunk
+	{
+		Item* owner;
+		UCHAR* data;
+		ULONG unit;
+		ULONG length;		// bytes used by the records
+		ULONG scanned;		// records read from the table
+		bool last;			// the last chunk of the unit
+	};
+
+	static THREAD_ENTRY_DECLARE scanThread(THREAD_ENTRY_PARAM arg)
+	{
+		static_cast<ScanTask*>(arg)->run();
+		return 0;
+	}
+
+	void run();
+
+	bool getUnit(ULONG& unit);
+	void scanUnit(thread_db* tdbb, Item* item, jrd_rel* relation, ULONG unit);
+	bool checkRecord(thread_db* tdbb, Item* item, jrd_rel* relation, Record* record) const;
+	bool fetchField(thread_db* tdbb, jrd_rel* relation, Record* record,
+		USHORT id, UCHAR* buffer, dsc* desc) const;
+
+	bool prepareAggregation(thread_db* tdbb);
+	bool aggregateRecord(thread_db* tdbb, Item* item, jrd_rel* relation, Record* record);
+	bool flushGroups(thread_db* tdbb, Item* item);
+
+	Chunk* getFreeChunk(thread_db* tdbb, Item* item, ULONG unit);
+	void putChunk(Chunk* chunk);
+	Chunk* getFullChunk(thread_db* tdbb);
+	void releaseChunk(thread_db* tdbb);
+
+	// Must be called with m_mutex locked
+	void wait(thread_db* tdbb)
+	{
+		EngineCheckout cout(tdbb, FB_FUNCTION, EngineCheckout::UNNECESSARY);
+		m_cond.wait(m_mutex);
+	}
+
+	void setError(IStatus* status)
+	{
+		MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+		if (m_status.isSuccess())
+			m_status.save(status);
+
+		m_stop = true;
+		m_cond.notifyAll();
+	}
+
+	Database* const m_dbb;
+	MemoryPool* const m_pool;
+	const ParallelTableScan* const m_scan;
+	const CommitNumber m_snapshot;
+	bool m_ignoreLimbo;
+	bool m_largeScan;
+	const Format* m_format;			// current format of the relation
+	Array<PushedBoolean> m_checks;	// pushed booleans applicable to the current format
+	ULONG m_units;
+
+	// Partial aggregation
+	bool m_aggregating;
+	Array<GroupField> m_groupFields;
+	ULONG m_keyLength;
+	ULONG m_stateOffset;			// within a partial group
+	ULONG m_groupLength;			// of a partial group
+	ULONG m_bufferLength;
+	Thread m_thread;
+	bool m_running;
+
+	// Used by the request thread only
+	ULONG m_doneUnits;
+	Chunk* m_current;
+	ULONG m_offset;
+
+	Mutex m_mutex;					// protects all below
+	Condition m_cond;				// signalled when chunk is filled or released
+	HalfStaticArray<Item*, 8> m_items;
+	Array<Chunk> m_chunks;
+	HalfStaticArray<Chunk*, 16> m_full;
+	UCHAR* m_buffer;
+	StatusHolder m_status;
+	ULONG m_nextUnit;
+	bool m_started;
+	bool m_finished;
+	bool m_stop;
+};
+
+ParallelTableScan::ScanTask::ScanTask(thread_db* tdbb, const ParallelTableScan* scan,
+									  unsigned workers, CommitNumber snapshot)
+	: m_dbb(tdbb->getDatabase()),
+	  m_pool(tdbb->getDatabase()->dbb_permanent),
+	  m_scan(scan),
+	  m_snapshot(snapshot),
+	  m_ignoreLimbo(false),
+	  m_largeScan(false),
+	  m_format(nullptr),
+	  m_checks(*m_pool),
+	  m_units(0),
+	  m_aggregating(false),
+	  m_groupFields(*m_pool),
+	  m_keyLength(0),
+	  m_stateOffset(0),
+	  m_groupLength(0),
+	  m_bufferLength(0),
+	  m_running(false),
+	  m_doneUnits(0),
+	  m_current(nullptr),
+	  m_offset(0),
+	  m_items(*m_pool),
+	  m_chunks(*m_pool),
+	  m_full(*m_pool),
+	  m_buffer(nullptr),
+	  m_nextUnit(0),
+	  m_started(false),
+	  m_finished(false),
+	  m_stop(false)
+{
+	Attachment* const attachment = tdbb->getAttachment();
+	const jrd_tra* const transaction = tdbb->getRequest()->req_transaction;
+	jrd_rel* const relation = m_scan->m_relation;
+
+	m_ignoreLimbo = (transaction->tra_flags & TRA_ignore_limbo);
+
+	// See FullTableScan::internalOpen()
+
+	if (attachment != m_dbb->dbb_attachments || attachment->att_next)
+	{
+		if (attachment->isGbak() || DPM_data_pages(tdbb, relation) > m_dbb->dbb_bcb->bcb_count)
+			m_largeScan = true;
+	}
+
+	// Pushed booleans are checked for the field values converted to the current format
+
+	const Format* const format = m_format = MET_current(tdbb, relation);
+
+	for (const auto& boolean : m_scan->m_booleans)
+	{
+		if (boolean.fieldId >= format->fmt_count)
+			continue;
+
+		const dsc* const desc = &format->fmt_desc[boolean.fieldId];
+
+		if (!isPushable(desc))
+			continue;
+
+		if (desc->isDateTime() ?
+				desc->dsc_dtype == boolean.value->dsc_dtype :
+				!boolean.value->isDateTime())
+		{
+			m_checks.add(boolean);
+			m_bufferLength = MAX(m_bufferLength, (ULONG) desc->dsc_length);
+		}
+	}
+
+	if (m_scan->m_aggregating)
+		m_aggregating = prepareAggregation(tdbb);
+
+	const FB_UINT64 dataPages = (FB_UINT64) DPM_pointer_pages(tdbb, relation) * m_dbb->dbb_dp_per_pp;
+	m_units = (ULONG) ((dataPages + SCAN_UNIT_PAGES - 1) / SCAN_UNIT_PAGES);
+
+	for (unsigned i = 0; i < workers; i++)
+		m_items.add(FB_NEW_POOL(*m_pool) Item(this, *m_pool));
+
+	const FB_SIZE_T count = workers * SCAN_CHUNKS_PER_WORKER;
+	m_buffer = FB_NEW_POOL(*m_pool) UCHAR[(FB_SIZE_T) SCAN_CHUNK_SIZE * count];
+
+	Chunk* const chunks = m_chunks.getBuffer(count);
+
+	for (FB_SIZE_T i = 0; i < count; i++)
+	{
+		Item* const owner = m_items[i / SCAN_CHUNKS_PER_WORKER];
+
+		chunks[i].owner = owner;
+		chunks[i].data = m_buffer + (FB_SIZE_T) SCAN_CHUNK_SIZE * i;
+		owner->m_free.add(&chunks[i]);
+	}
+}
+
+bool ParallelTableScan::ScanTask::Item::init(thread_db* tdbb)
+{
+	FbStatusVector* const status = tdbb->tdbb_status_vector;
+	ScanTask* const task = getTask();
+	Attachment* att = nullptr;
+
+	if (!m_attStable.hasData())
+		m_attStable = WorkerAttachment::getAttachment(status, task->m_dbb);
+
+	if (m_attStable)
+		att = m_attStable->getHandle();
+
+	if (!att)
+		return false;
+
+	tdbb->setDatabase(att->att_database);
+	tdbb->setAttachment(att);
+
+	if (!m_tra)
+	{
+		try
+		{
+			WorkerContextHolder holder(tdbb, FB_FUNCTION);
+
+			ClumpletWriter tpb(ClumpletReader::Tpb, 128, isc_tpb_version3);
+			tpb.insertTag(isc_tpb_concurrency);
+			tpb.insertTag(isc_tpb_read);
+			if (task->m_ignoreLimbo)
+				tpb.insertTag(isc_tpb_ignore_limbo);
+			tpb.insertBigInt(isc_tpb_at_snapshot_number, task->m_snapshot);
+
+			m_tra = TRA_start(tdbb, tpb.getBufferLength(), tpb.getBuffer());
+		}
+		catch (const Exception& ex)
+		{
+			ex.stuffException(status);
+			return false;
+		}
+	}
+
+	tdbb->setTransaction(m_tra);
+
+	return true;
+}
+
+void ParallelTableScan::ScanTask::Item::fini()
+{
+	if (!m_attStable)
+		return;
+
+	Attachment* att = nullptr;
+	{
+		AttSyncLockGuard guard(*m_attStable->getSync(), FB_FUNCTION);
+		att = m_attStable->getHandle();
+	}
+
+	FbLocalStatus status;
+
+	if (att)
+	{
+		fb_assert(att->att_use_count > 0);
+
+		if (m_tra)
+		{
+			BackgroundContextHolder tdbb(att->att_database, att, &status, FB_FUNCTION);
+			TRA_commit(tdbb, m_tra, false);
+		}
+
+		WorkerAttachment::releaseAttachment(&status, m_attStable);
+	}
+
+	m_tra = nullptr;
+	m_attStable = nullptr;
+}
+
+bool ParallelTableScan::ScanTask::handler(WorkItem& _item)
+{
+	Item* const item = static_cast<Item*>(&_item);
+	item->m_done = true;
+
+	{	// scope
+		MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+		if (m_stop || m_nextUnit >= m_units)
+			return true;
+	}
+
+	ThreadContextHolder tdbb(nullptr);
+
+	// Failure to get an attachment is not an error, other workers
+	// or the serial scan will do the job
+
+	if (!item->init(tdbb))
+		return true;
+
+	{	// scope
+		MutexLockGuard guard(m_mutex, FB_FUNCTION);
+		m_started = true;
+		m_cond.notifyAll();
+	}
+
+	try
+	{
+		WorkerContextHolder holder(tdbb, FB_FUNCTION);
+
+		jrd_rel* const relation = MET_relation(tdbb, m_scan->m_relation->rel_id);
+		if (!(relation->rel_flags & REL_scanned))
+			MET_scan_relation(tdbb, relation);
+
+		item->m_buffer.getBuffer(m_bufferLength);
+
+		if (m_aggregating && !item->m_groups)
+		{
+			item->m_values.getBuffer(m_stateOffset);
+			item->m_groups = FB_NEW_POOL(*m_pool) PartialGroups(*m_pool,
+				FB_ALIGN(m_keyLength, FB_ALIGNMENT) + m_groupLength, m_keyLength);
+		}
+
+		ULONG unit;
+		while (getUnit(unit))
+			scanUnit(tdbb, item, relation, unit);
+
+		// Groups still kept by the worker are complete now
+
+		if (m_aggregating)
+			flushGroups(tdbb, item);
+	}
+	catch (const Exception& ex)
+	{
+		FbLocalStatus status;
+		ex.stuffException(&status);
+		setError(&status);
+		return false;
+	}
+
+	return true;
+}
+
+bool ParallelTableScan::ScanTask::getWorkItem(WorkItem** pItem)
+{
+	Item* item = static_cast<Item*>(*pItem);
+
+	MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+	if (!item)
+	{
+		for (Item** iter = m_items.begin(); iter != m_items.end(); ++iter)
+		{
+			if (!(*iter)->m_inuse)
+			{
+				item = *iter;
+				break;
+			}
+		}
+
+		if (!item)
+			return false;
+
+		item->m_inuse = true;
+		*pItem = item;
+	}
+
+	return !item->m_done && !m_stop;
+}
+
+bool ParallelTableScan::ScanTask::getResult(IStatus* status)
+{
+	if (status)
+	{
+		status->init();
+		status->setErrors(m_status.getErrors());
+	}
+
+	return m_status.isSuccess();
+}
+
+void ParallelTableScan::ScanTask::start()
+{
+	Thread::start(scanThread, this, THREAD_medium, &m_thread);
+	m_running = true;
+}
+
+bool ParallelTableScan::ScanTask::waitStarted(thread_db* tdbb)
+{
+	MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+	while (!m_started && !m_finished)
+		wait(tdbb);
+
+	return m_started;
+}
+
+void ParallelTableScan::ScanTask::stop(thread_db* tdbb)
+{
+	if (!m_running)
+		return;
+
+	{	// scope
+		MutexLockGuard guard(m_mutex, FB_FUNCTION);
+		m_stop = true;
+		m_cond.notifyAll();
+	}
+
+	{	// scope
+		EngineCheckout cout(tdbb, FB_FUNCTION, EngineCheckout::UNNECESSARY);
+		m_thread.waitForCompletion();
+	}
+
+	m_running = false;
+}
+
+void ParallelTableScan::ScanTask::run()
+{
+	try
+	{
+		Coordinator coord(m_pool);
+		coord.runSync(this);
+	}
+	catch (const Exception& ex)
+	{
+		FbLocalStatus status;
+		ex.stuffException(&status);
+		setError(&status);
+	}
+
+	// Worker transactions must be finished before the request goes away
+
+	for (Item** iter = m_items.begin(); iter != m_items.end(); ++iter)
+		(*iter)->fini();
+
+	MutexLockGuard guard(m_mutex, FB_FUNCTION);
+	m_finished = true;
+	m_cond.notifyAll();
+}
+
+bool ParallelTableScan::ScanTask::getUnit(ULONG& unit)
+{
+	MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+	if (m_stop || m_nextUnit >= m_units)
+		return false;
+
+	unit = m_nextUnit++;
+	return true;
+}
+
+void ParallelTableScan::ScanTask::scanUnit(thread_db* tdbb, Item* item, jrd_rel* relation, ULONG unit)
+{
+	jrd_tra* const transaction = tdbb->getTransaction();
+	const SINT64 unitRecords = (SINT64) SCAN_UNIT_PAGES * m_dbb->dbb_max_records;
+
+	record_param rpb;
+	rpb.rpb_relation = relation;
+	rpb.rpb_record = nullptr;
+	rpb.getWindow(tdbb).win_flags = 0;
+
+	if (m_largeScan)
+	{
+		rpb.getWindow(tdbb).win_flags = WIN_large_scan;
+		rpb.rpb_org_scans = relation->rel_scan_count++;
+	}
+
+	rpb.rpb_number.setValue(unit * unitRecords - 1);	// position prior to the unit start
+
+	RecordNumber upper;
+	upper.setValue((unit + 1) * unitRecords - 1);
+
+	Chunk* chunk = nullptr;
+
+	try
+	{
+		if (m_aggregating)
+		{
+			while (VIO_next_record(tdbb, &rpb, transaction, transaction->tra_pool, DPM_next_all, &upper))
+			{
+				JRD_reschedule(tdbb);
+
+				item->m_scanned++;
+
+				Record* const record = rpb.rpb_record;
+
+				if (checkRecord(tdbb, item, relation, record) &&
+					!aggregateRecord(tdbb, item, relation, record))
+				{
+					break;
+				}
+			}
+		}
+		else
+			chunk = getFreeChunk(tdbb, item, unit);
+
+		while (chunk && VIO_next_record(tdbb, &rpb, transaction, transaction->tra_pool, DPM_next_all, &upper))
+		{
+			JRD_reschedule(tdbb);
+
+			chunk->scanned++;
+
+			Record* const record = rpb.rpb_record;
+
+			if (!checkRecord(tdbb, item, relation, record))
+				continue;
+
+			const ULONG length = record->getLength();
+			const ULONG size = RECORD_HEADER_SIZE + FB_ALIGN(length, FB_DOUBLE_ALIGN);
+
+			if (chunk->length + size > SCAN_CHUNK_SIZE)
+			{
+				putChunk(chunk);
+
+				if (!(chunk = getFreeChunk(tdbb, item, unit)))
+					break;
+			}
+
+			RecordHeader* const header = reinterpret_cast<RecordHeader*>(chunk->data + chunk->length);
+			header->number = rpb.rpb_number.getValue();
+			header->transaction = rpb.rpb_transaction_nr;
+			header->length = length;
+			header->format = rpb.rpb_format_number;
+
+			record->copyDataTo(chunk->data + chunk->length + RECORD_HEADER_SIZE);
+			chunk->length += size;
+		}
+
+		// Even an empty unit must be reported to the request thread
+
+		if (chunk)
+		{
+			chunk->last = true;
+			putChunk(chunk);
+		}
+	}
+	catch (const Exception&)
+	{
+		if (chunk)
+		{
+			MutexLockGuard guard(m_mutex, FB_FUNCTION);
+			item->m_free.push(chunk);
+		}
+
+		delete rpb.rpb_record;
+
+		if (m_largeScan && relation->rel_scan_count)
+			relation->rel_scan_count--;
+
+		throw;
+	}
+
+	delete rpb.rpb_record;
+
+	if (m_largeScan && relation->rel_scan_count)
+		relation->rel_scan_count--;
+}
+
+// Check the pushed booleans, records failing them are not passed to the request thread.
+// Unless the records are aggregated, the request thread evaluates the complete boolean anyway.
+bool ParallelTableScan::ScanTask::checkRecord(thread_db* tdbb, Item* item, jrd_rel* relation,
+	Record* record) const
+{
+	for (const auto& check : m_checks)
+	{
+		dsc desc;
+
+		if (!fetchField(tdbb, relation, record, check.fieldId, item->m_buffer.begin(), &desc))
+			return false;
+
+		const int result = MOV_compare(tdbb, &desc, check.value);
+
+		switch (check.blrOp)
+		{
+			case blr_eql:
+				if (result != 0)
+					return false;
+				break;
+
+			case blr_gtr:
+				if (result <= 0)
+					return false;
+				break;
+
+			case blr_geq:
+				if (result < 0)
+					return false;
+				break;
+
+			case blr_lss:
+				if (result >= 0)
+					return false;
+				break;
+
+			case blr_leq:
+				if (result > 0)
+					return false;
+				break;
+
+			case blr_neq:
+				if (result == 0)
+					return false;
+				break;
+
+			default:
+				fb_assert(false);
+		}
+	}
+
+	return true;
+}
+
+// Fetch the field converted to the current format of the relation, as FieldNode does
+bool ParallelTableScan::ScanTask::fetchField(thread_db* tdbb, jrd_rel* relation, Record* record,
+	USHORT id, UCHAR* buffer, dsc* desc) const
+{
+	if (!EVL_field(relation, record, id, desc))
+		return false;
+
+	if (record->getFormat()->fmt_version != m_format->fmt_version)
+	{
+		dsc from = *desc;
+
+		*desc = m_format->fmt_desc[id];
+		desc->dsc_address = buffer;
+
+		MOV_move(tdbb, &from, desc);
+	}
+
+	return true;
+}
+
+// Workers may aggregate the records if the current format has every field they use
+// and a partial group fits a chunk
+bool ParallelTableScan::ScanTask::prepareAggregation(thread_db* tdbb)
+{
+	if (m_checks.getCount() != m_scan->m_booleans.getCount())
+		return false;
+
+	ULONG length = m_scan->m_groupFields.getCount();	// NULL flags
+
+	for (const auto id : m_scan->m_groupFields)
+	{
+		if (id >= m_format->fmt_count)
+			return false;
+
+		const dsc* const desc = &m_format->fmt_desc[id];
+
+		if (desc->isUnknown() || desc->isBlob() || desc->dsc_dtype == dtype_array)
+			return false;
+
+		GroupField field;
+		field.id = id;
+		field.offset = FB_ALIGN(length, FB_ALIGNMENT);
+		field.keyLength = HashJoin::getKeyLength(tdbb, desc);
+		m_groupFields.add(field);
+
+		length = field.offset + desc->dsc_length;
+		m_keyLength += 1 + field.keyLength;
+	}
+
+	for (const auto& aggregate : m_scan->m_aggregates)
+	{
+		if (aggregate.fieldId < 0)
+			continue;
+
+		if (aggregate.fieldId >= m_format->fmt_count)
+			return false;
+
+		const dsc* const desc = &m_format->fmt_desc[aggregate.fieldId];
+
+		if (!isPushable(desc))
+			return false;
+
+		m_bufferLength = MAX(m_bufferLength, (ULONG) desc->dsc_length);
+	}
+
+	m_stateOffset = FB_ALIGN(length, FB_ALIGNMENT);
+	m_groupLength = FB_ALIGN(m_stateOffset + m_scan->m_stateLength, FB_DOUBLE_ALIGN);
+
+	return (m_groupLength <= SCAN_CHUNK_SIZE);
+}
+
+// Put the record into its partial group. False is returned if the scan is stopped.
+bool ParallelTableScan::ScanTask::aggregateRecord(thread_db* tdbb, Item* item, jrd_rel* relation,
+	Record* record)
+{
+	PartialGroups* const groups = item->m_groups;
+	UCHAR* const values = item->m_values.begin();
+	UCHAR* keyPtr = groups->getKey();
+
+	memset(keyPtr, 0, m_keyLength);
+	memset(values, 0, m_stateOffset);
+
+	// Every key part is prefixed with the byte telling NULL from any value
+
+	for (FB_SIZE_T i = 0; i < m_groupFields.getCount(); i++)
+	{
+		const GroupField& field = m_groupFields[i];
+		UCHAR* const value = values + field.offset;
+		dsc desc;
+
+		if (fetchField(tdbb, relation, record, field.id, value, &desc))
+		{
+			if (desc.dsc_address != value)
+			{
+				memcpy(value, desc.dsc_address, desc.dsc_length);
+				desc.dsc_address = value;
+			}
+
+			if (desc.dsc_dtype == dtype_text)
+				INTL_adjust_text_descriptor(tdbb, &desc);
+
+			values[i] = 1;
+			*keyPtr = 1;
+			HashJoin::makeKey(tdbb, &desc, field.keyLength, keyPtr + 1);
+		}
+
+		keyPtr += 1 + field.keyLength;
+	}
+
+	const ULONG hash = InternalHash::hash(m_keyLength, groups->getKey());
+	const ULONG groupOffset = FB_ALIGN(m_keyLength, FB_ALIGNMENT);
+
+	UCHAR* group = groups->find(hash);
+
+	if (!group)
+	{
+		if (!(group = groups->add(hash)))
+		{
+			if (!flushGroups(tdbb, item))
+				return false;
+
+			group = groups->add(hash);
+			fb_assert(group);
+		}
+
+		memcpy(group + groupOffset, values, m_stateOffset);
+
+		for (const auto& aggregate : m_scan->m_aggregates)
+			aggregate.node->partialInit(tdbb, group + groupOffset + m_stateOffset + aggregate.offset);
+	}
+
+	UCHAR* const state = group + groupOffset + m_stateOffset;
+
+	for (const auto& aggregate : m_scan->m_aggregates)
+	{
+		if (aggregate.fieldId < 0)
+		{
+			aggregate.node->partialPass(tdbb, state + aggregate.offset, nullptr);
+			continue;
+		}
+
+		dsc desc;
+
+		if (fetchField(tdbb, relation, record, aggregate.fieldId, item->m_buffer.begin(), &desc))
+			aggregate.node->partialPass(tdbb, state + aggregate.offset, &desc);
+	}
+
+	return true;
+}
+
+// Pass the partial groups of the worker to the request thread. The first chunk
+// also reports the records read, even if there are no groups.
+bool ParallelTableScan::ScanTask::flushGroups(thread_db* tdbb, Item* item)
+{
+	PartialGroups* const groups = item->m_groups;
+	const ULONG groupOffset = FB_ALIGN(m_keyLength, FB_ALIGNMENT);
+
+	Chunk* chunk = getFreeChunk(tdbb, item, 0);
+
+	if (!chunk)
+		return false;
+
+	chunk->scanned = item->m_scanned;
+	item->m_scanned = 0;
+
+	for (ULONG i = 0; i < groups->getCount(); i++)
+	{
+		if (chunk->length + m_groupLength > SCAN_CHUNK_SIZE)
+		{
+			putChunk(chunk);
+
+			if (!(chunk = getFreeChunk(tdbb, item, 0)))
+				return false;
+		}
+
+		memcpy(chunk->data + chunk->length, groups->getGroup(i) + groupOffset, m_groupLength);
+		chunk->length += m_groupLength;
+	}
+
+	putChunk(chunk);
+	groups->clear();
+
+	return true;
+}
+
+ParallelTableScan::ScanTask::Chunk* ParallelTableScan::ScanTask::getFreeChunk(thread_db* tdbb,
+	Item* item, ULONG unit)
+{
+	MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+	while (!m_stop && item->m_free.isEmpty())
+		wait(tdbb);
+
+	if (m_stop)
+		return nullptr;
+
+	Chunk* const chunk = item->m_free.pop();
+	chunk->unit = unit;
+	chunk->length = 0;
+	chunk->scanned = 0;
+	chunk->last = false;
+
+	return chunk;
+}
+
+void ParallelTableScan::ScanTask::putChunk(Chunk* chunk)
+{
+	MutexLockGuard guard(m_mutex, FB_FUNCTION);
+	m_full.add(chunk);
+	m_cond.notifyAll();
+}
+
+ParallelTableScan::ScanTask::Chunk* ParallelTableScan::ScanTask::getFullChunk(thread_db* tdbb)
+{
+	MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+	while (true)
+	{
+		if (!m_status.isSuccess())
+		{
+			FbLocalStatus status;
+			getResult(&status);
+			status.raise();
+		}
+
+		// In the ordered mode units are returned one by one. Chunks of
+		// a unit are queued by its worker in the order they are filled.
+
+		for (FB_SIZE_T i = 0; i < m_full.getCount(); i++)
+		{
+			Chunk* const chunk = m_full[i];
+
+			if (!m_scan->m_ordered || chunk->unit == m_doneUnits)
+			{
+				m_full.remove(i);
+				return chunk;
+			}
+		}
+
+		// Records are awaited until every unit is read, but the number
+		// of chunks with partial groups is known only in the end
+
+		if (m_finished)
+		{
+			fb_assert(m_aggregating);
+			return nullptr;
+		}
+
+		wait(tdbb);
+	}
+}
+
+void ParallelTableScan::ScanTask::releaseChunk(thread_db* tdbb)
+{
+	Chunk* const chunk = m_current;
+	m_current = nullptr;
+
+	tdbb->bumpRelStats(RuntimeStatistics::RECORD_SEQ_READS, m_scan->m_relation->rel_id, chunk->scanned);
+
+	if (chunk->last)
+		m_doneUnits++;
+
+	MutexLockGuard guard(m_mutex, FB_FUNCTION);
+	chunk->owner->m_free.push(chunk);
+	m_cond.notifyAll();
+}
+
+bool ParallelTableScan::ScanTask::getRecord(thread_db* tdbb, record_param* rpb)
+{
+	Request* const request = tdbb->getRequest();
+
+	while (true)
+	{
+		if (m_current && m_offset < m_current->length)
+		{
+			const UCHAR* const data = m_current->data + m_offset;
+			const RecordHeader* const header = reinterpret_cast<const RecordHeader*>(data);
+
+			const Format* const format = MET_format(tdbb, m_scan->m_relation, header->format);
+			Record* const record = VIO_record(tdbb, rpb, format, request->req_pool);
+			fb_assert(record->getLength() == header->length);
+			record->copyDataFrom(data + RECORD_HEADER_SIZE);
+
+			rpb->rpb_number.setValue(header->number);
+			rpb->rpb_number.setValid(true);
+			rpb->rpb_transaction_nr = header->transaction;
+			rpb->rpb_format_number = header->format;
+			rpb->rpb_runtime_flags &= ~RPB_CLEAR_FLAGS;
+
+			m_offset += RECORD_HEADER_SIZE + FB_ALIGN(header->length, FB_DOUBLE_ALIGN);
+			return true;
+		}
+
+		if (m_current)
+			releaseChunk(tdbb);
+
+		if (m_doneUnits >= m_units)
+			return false;
+
+		if (!(m_current = getFullChunk(tdbb)))
+			return false;
+
+		m_offset = 0;
+	}
+}
+
+
+const UCHAR* ParallelTableScan::ScanTask::getGroup(thread_db* tdbb)
+{
+	fb_assert(m_aggregating);
+
+	while (true)
+	{
+		if (m_current && m_offset < m_current->length)
+		{
+			const UCHAR* const group = m_current->data + m_offset;
+			m_offset += m_groupLength;
+			return group;
+		}
+
+		if (m_current)
+			releaseChunk(tdbb);
+
+		if (!(m_current = getFullChunk(tdbb)))
+			return nullptr;
+
+		m_offset = 0;
+	}
+}
+
+// Make the record having the group values of the partial group, other fields are NULL.
+// Return the partial states of the aggregates.
+const UCHAR* ParallelTableScan::ScanTask::loadGroup(thread_db* tdbb, record_param* rpb,
+	const UCHAR* group) const
+{
+	Request* const request = tdbb->getRequest();
+
+	Record* const record = VIO_record(tdbb, rpb, m_format, request->req_pool);
+	record->nullify();
+
+	for (FB_SIZE_T i = 0; i < m_groupFields.getCount(); i++)
+	{
+		if (!group[i])
+			continue;
+
+		const GroupField& field = m_groupFields[i];
+		const dsc* const desc = &m_format->fmt_desc[field.id];
+
+		memcpy(record->getData() + (IPTR) desc->dsc_address, group + field.offset, desc->dsc_length);
+		record->clearNull(field.id);
+	}
+
+	rpb->rpb_number.setValid(true);
+	rpb->rpb_format_number = m_format->fmt_version;
+	rpb->rpb_runtime_flags &= ~RPB_CLEAR_FLAGS;
+
+	return group + m_stateOffset;
+}
+
+
+ParallelTableScan::ParallelTableScan(CompilerScratch* csb, const string& alias,
+									 StreamType stream, jrd_rel* relation, RecordSource* next,
+									 BoolExprNode* boolean, unsigned workers, bool ordered)
+	: RecordStream(csb, stream),
+	  m_alias(csb->csb_pool, alias),
+	  m_relation(relation),
+	  m_next(next),
+	  m_boolean(boolean),
+	  m_booleans(csb->csb_pool),
+	  m_exact(true),
+	  m_workers(workers),
+	  m_ordered(ordered),
+	  m_groupFields(csb->csb_pool),
+	  m_aggregates(csb->csb_pool)
+{
+	fb_assert(m_next);
+
+	m_impure = csb->allocImpure<Impure>();
+	m_cardinality = next->getCardinality();
+
+	if (boolean)
+		m_exact = pushBoolean(boolean);
+}
+
+void ParallelTableScan::internalOpen(thread_db* tdbb) const
+{
+	Request* const request = tdbb->getRequest();
+	Impure* const impure = request->getImpure<Impure>(m_impure);
+
+	impure->irsb_flags = irsb_open;
+	impure->irsb_task = nullptr;
+
+	const unsigned workers = m_recursive ? 1 : getWorkers(tdbb);
+	const CommitNumber snapshot = (workers > 1) ? getSnapshot(tdbb) : 0;
+
+	if (snapshot)
+	{
+		RLCK_reserve_relation(tdbb, request->req_transaction, m_relation, false);
+
+		AutoPtr<ScanTask> task(FB_NEW_POOL(*tdbb->getDatabase()->dbb_permanent)
+			ScanTask(tdbb, this, workers, snapshot));
+
+		task->start();
+
+		if (task->waitStarted(tdbb))
+		{
+			record_param* const rpb = &request->req_rpb[m_stream];
+			rpb->rpb_number.setValue(BOF_NUMBER);
+
+			impure->irsb_task = task.release();
+			return;
+		}
+
+		// No worker could attach, read the table serially
+
+		task->stop(tdbb);
+	}
+
+	m_next->open(tdbb);
+}
+
+void ParallelTableScan::close(thread_db* tdbb) const
+{
+	Request* const request = tdbb->getRequest();
+
+	invalidateRecords(request);
+
+	Impure* const impure = request->getImpure<Impure>(m_impure);
+
+	if (impure->irsb_flags & irsb_open)
+	{
+		impure->irsb_flags &= ~irsb_open;
+
+		if (impure->irsb_task)
+		{
+			impure->irsb_task->stop(tdbb);
+			delete impure->irsb_task;
+			impure->irsb_task = nullptr;
+		}
+		else
+			m_next->close(tdbb);
+	}
+}
+
+bool ParallelTableScan::internalGetRecord(thread_db* tdbb) const
+{
+	JRD_reschedule(tdbb);
+
+	Request* const request = tdbb->getRequest();
+	record_param* const rpb = &request->req_rpb[m_stream];
+	Impure* const impure = request->getImpure<Impure>(m_impure);
+
+	if (!(impure->irsb_flags & irsb_open))
+	{
+		rpb->rpb_number.setValid(false);
+		return false;
+	}
+
+	ScanTask* const task = impure->irsb_task;
+
+	if (!task)
+		return m_next->getRecord(tdbb);
+
+	while (task->getRecord(tdbb, rpb))
+	{
+		if (m_filter && !m_filter->getRecord(tdbb))
+			continue;
+
+		return true;
+	}
+
+	rpb->rpb_number.setValid(false);
+	return false;
+}
+
+void ParallelTableScan::markRecursive()
+{
+	RecordStream::markRecursive();
+	m_next->markRecursive();
+}
+
+void ParallelTableScan::getChildren(Array<const RecordSource*>& children) const
+{
+	children.add(m_next);
+}
+
+void ParallelTableScan::print(thread_db* tdbb, string& plan, bool detailed, unsigned level, bool recurse) const
+{
+	const unsigned workers = detailed ? getWorkers(tdbb) : 1;
+
+	if (workers > 1)
+	{
+		string extras;
+		extras.printf(" (workers: %u%s)", workers,
+			m_ordered ? ", ordered" : m_aggregating ? ", partial aggregation" : "");
+
+		plan += printIndent(++level) + "Parallel Gather" + extras;
+		printOptInfo(plan);
+	}
+
+	m_next->print(tdbb, plan, detailed, level, recurse);
+}
+
+bool ParallelTableScan::pushFilter(StreamType stream, RecordSource* filter)
+{
+	// The serial scan applies the filter by itself
+
+	if (!m_next->pushFilter(stream, filter))
+		return false;
+
+	m_filter = filter;
+	return true;
+}
+
+ParallelTableScan* ParallelTableScan::getPartialSource(const BoolExprNode* boolean)
+{
+	// Aggregating workers must check the boolean completely and
+	// no record may be rejected after them
+
+	if (m_ordered || m_filter || boolean != m_boolean || !m_exact)
+		return nullptr;
+
+	return this;
+}
+
+// Let the workers aggregate the records they read. Group keys and arguments of the
+// aggregates should be fields of the table and the aggregates should be able to
+// combine their partial states.
+bool ParallelTableScan::setAggregation(thread_db* tdbb, CompilerScratch* csb,
+									   NestValueArray* group, MapNode* map)
+{
+	fb_assert(!m_aggregating);
+
+	Array<USHORT> groupFields(csb->csb_pool);
+
+	if (group)
+	{
+		for (auto& value : *group)
+		{
+			if (!isTableField(value))
+				return false;
+
+			dsc desc;
+			value->getDesc(tdbb, csb, &desc);
+
+			if (desc.isBlob() || desc.dsc_dtype == dtype_array)
+				return false;
+
+			groupFields.add(nodeAs<FieldNode>(value)->fieldId);
+		}
+	}
+
+	Array<PartialAggregate> aggregates(csb->csb_pool);
+	Array<AggNode::StateArea> areas;
+	ULONG stateLength = 0;
+
+	for (auto& source : map->sourceList)
+	{
+		const auto aggNode = nodeAs<AggNode>(source);
+
+		if (!aggNode)
+			continue;
+
+		areas.clear();
+
+		if (!aggNode->canCombine() || !aggNode->getStateAreas(tdbb, csb, areas))
+			return false;
+
+		SSHORT fieldId = -1;
+
+		if (aggNode->arg)
+		{
+			if (!isTableField(aggNode->arg))
+				return false;
+
+			dsc desc;
+			aggNode->arg->getDesc(tdbb, csb, &desc);
+
+			if (!isPushable(&desc))
+				return false;
+
+			fieldId = nodeAs<FieldNode>(aggNode->arg)->fieldId;
+		}
+
+		aggregates.add({aggNode, fieldId, stateLength});
+
+		for (const auto& area : areas)
+			stateLength += FB_ALIGN(area.length, FB_ALIGNMENT);
+	}
+
+	m_groupFields.assign(groupFields);
+	m_aggregates.assign(aggregates);
+	m_stateLength = stateLength;
+	m_aggregating = true;
+
+	return true;
+}
+
+bool ParallelTableScan::isAggregating(thread_db* tdbb) const
+{
+	const Impure* const impure = tdbb->getRequest()->getImpure<Impure>(m_impure);
+
+	return (impure->irsb_flags & irsb_open) && impure->irsb_task &&
+		impure->irsb_task->isAggregating();
+}
+
+ULONG ParallelTableScan::getPartialLength(thread_db* tdbb) const
+{
+	const Impure* const impure = tdbb->getRequest()->getImpure<Impure>(m_impure);
+	fb_assert(impure->irsb_task);
+
+	return impure->irsb_task->getGroupLength();
+}
+
+// Return the next partial group computed by workers, or nullptr when there are no more
+const UCHAR* ParallelTableScan::getPartialGroup(thread_db* tdbb) const
+{
+	JRD_reschedule(tdbb);
+
+	const Impure* const impure = tdbb->getRequest()->getImpure<Impure>(m_impure);
+	fb_assert(impure->irsb_task);
+
+	return impure->irsb_task->getGroup(tdbb);
+}
+
+// Put the group values of the partial group into the record of the stream,
+// return the partial states to be combined
+const UCHAR* ParallelTableScan::loadPartialGroup(thread_db* tdbb, const UCHAR* group) const
+{
+	Request* const request = tdbb->getRequest();
+	const Impure* const impure = request->getImpure<Impure>(m_impure);
+	fb_assert(impure->irsb_task);
+
+	return impure->irsb_task->loadGroup(tdbb, &request->req_rpb[m_stream], group);
+}
+
+void ParallelTableScan::combine(thread_db* tdbb, Request* request, const UCHAR* state) const
+{
+	for (const auto& aggregate : m_aggregates)
+		aggregate.node->aggCombine(tdbb, request, state + aggregate.offset);
+}
+
+// Collect comparisons of fields with literals, workers use them to skip records early.
+// Return true if the boolean is pushed completely.
+bool ParallelTableScan::pushBoolean(BoolExprNode* boolean)
+{
+	if (const auto binaryNode = nodeAs<BinaryBoolNode>(boolean))
+	{
+		if (binaryNode->blrOp == blr_and)
+		{
+			const bool exact1 = pushBoolean(binaryNode->arg1);
+			const bool exact2 = pushBoolean(binaryNode->arg2);
+			return exact1 && exact2;
+		}
+
+		return false;
+	}
+
+	const auto cmpNode = nodeAs<ComparativeBoolNode>(boolean);
+
+	if (!cmpNode || cmpNode->arg3)
+		return false;
+
+	UCHAR blrOp = cmpNode->blrOp;
+
+	switch (blrOp)
+	{
+		case blr_eql:
+		case blr_gtr:
+		case blr_geq:
+		case blr_lss:
+		case blr_leq:
+		case blr_neq:
+			break;
+
+		default:
+			return false;
+	}
+
+	auto fieldNode = nodeAs<FieldNode>(cmpNode->arg1);
+	auto literalNode = nodeAs<LiteralNode>(cmpNode->arg2);
+
+	if (!fieldNode || !literalNode)
+	{
+		fieldNode = nodeAs<FieldNode>(cmpNode->arg2);
+		literalNode = nodeAs<LiteralNode>(cmpNode->arg1);
+
+		switch (blrOp)
+		{
+			case blr_gtr:
+				blrOp = blr_lss;
+				break;
+
+			case blr_geq:
+				blrOp = blr_leq;
+				break;
+
+			case blr_lss:
+				blrOp = blr_gtr;
+				break;
+
+			case blr_leq:
+				blrOp = blr_geq;
+				break;
+		}
+	}
+
+	if (!fieldNode || !literalNode ||
+		fieldNode->fieldStream != m_stream || fieldNode->cursorNumber.specified)
+	{
+		return false;
+	}
+
+	const dsc* const desc = &literalNode->litDesc;
+
+	if (!isPushable(desc))
+		return false;
+
+	m_booleans.add({fieldNode->fieldId, blrOp, desc});
+	return true;
+}
+
+bool ParallelTableScan::isTableField(const ValueExprNode* value) const
+{
+	const auto fieldNode = nodeAs<FieldNode>(value);
+
+	return fieldNode && fieldNode->fieldStream == m_stream && !fieldNode->cursorNumber.specified;
+}
+
+unsigned ParallelTableScan::getWorkers(thread_db* tdbb) const
+{
+	// Scan in parallel if allowed by the statement or ParallelWorkers
+	// and if every worker gets enough data to make it worth
+
+	const Attachment* const attachment = tdbb ? tdbb->getAttachment() : nullptr;
+
+	if (!attachment)
+		return 1;
+
+	const Database* const dbb = tdbb->getDatabase();
+
+	// Classic in single-user shutdown mode can't create additional worker attachments
+	if ((dbb->dbb_ast_flags & DBB_shutdown_single) && !(dbb->dbb_flags & DBB_shared))
+		return 1;
+
+	unsigned workers = m_workers ?
+		MIN(m_workers, (unsigned) Config::getMaxParallelWorkers()) :
+		(unsigned) MAX(attachment->att_parallel_workers, 0);
+
+	if (workers <= 1)
+		return 1;
+
+	const FB_UINT64 size = (FB_UINT64) DPM_data_pages(tdbb, m_relation) * dbb->dbb_page_size;
+	workers = (unsigned) MIN(size / MIN_PARALLEL_SCAN_SIZE, (FB_UINT64) workers);
+
+	return (workers < 2) ? 1 : workers;
+}
+
+CommitNumber ParallelTableScan::getSnapshot(thread_db* tdbb) const
+{
+	// Workers read the table in their own transactions started at the snapshot
+	// of the request transaction. They can't see changes made by the request
+	// transaction, so the table is read serially if there are any.
+
+	const Request* const request = tdbb->getRequest();
+	const jrd_tra* const transaction = request->req_transaction;
+
+	if (!transaction || (transaction->tra_flags & (TRA_system | TRA_write)) ||
+		transaction->tra_commit_sub_trans)
+	{
+		return 0;
+	}
+
+	if (!(transaction->tra_flags & TRA_read_committed))
+		return transaction->tra_snapshot_number;
+
+	if (!(transaction->tra_flags & TRA_read_consistency))
+		return 0;
+
+	const Request* const owner = request->req_snapshot.m_owner;
+
+	if (!owner || (owner->req_flags & req_update_conflict))
+		return 0;
+
+	return owner->req_snapshot.m_number;
+}
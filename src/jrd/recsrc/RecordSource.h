@@ -42,6 +42,7 @@ namespace Jrd
 	class BoolExprNode;
 	class DeclareLocalTableNode;
 	class Sort;
+	class PartitionedSort;
 	class CompilerScratch;
 	class BtrPageGCLock;
 	struct index_desc;
@@ -50,6 +51,7 @@ namespace Jrd
 	struct win;
 	class BaseBufferedStream;
 	class BufferedStream;
+	class ParallelTableScan;
 
 	enum JoinType { INNER_JOIN, OUTER_JOIN, SEMI_JOIN, ANTI_JOIN };
 
@@ -102,6 +104,21 @@ namespace Jrd
 			fb_assert(false);
 		}
 
+		// Accept the runtime filter rejecting rows of the given stream as early as possible.
+		// It's a record source returning false for rows to be skipped.
+		virtual bool pushFilter(StreamType /*stream*/, RecordSource* /*filter*/)
+		{
+			return false;
+		}
+
+		// Return the parallel scan delivering exactly the records of this source, so the
+		// records may be aggregated by the scan workers. The boolean is the one checked
+		// by the caller for every record.
+		virtual ParallelTableScan* getPartialSource(const BoolExprNode* /*boolean*/)
+		{
+			return nullptr;
+		}
+
 		static bool rejectDuplicate(const UCHAR* /*data1*/, const UCHAR* /*data2*/, void* /*userArg*/)
 		{
 			return true;
@@ -180,6 +197,56 @@ namespace Jrd
 	};
 
 
+	// Simple conjuncts of the stream boolean (comparisons of table fields with literals
+	// or parameters, IN lists, IS [NOT] NULL and BETWEEN) checked by the table scan over
+	// batches of records. Records failing them never become the record of the stream.
+	// The complete boolean is still evaluated by FilteredStream.
+
+	class BatchBoolean
+	{
+	public:
+		class Batch;
+
+		static BatchBoolean* create(CompilerScratch* csb, StreamType stream, BoolExprNode* boolean);
+
+		Batch* open(thread_db* tdbb, jrd_rel* relation, record_param* rpb) const;
+		bool getRecord(thread_db* tdbb, Batch* batch, record_param* rpb, const RecordNumber* upper) const;
+		static void close(record_param* rpb, Batch* batch);
+
+	private:
+		enum Kind : UCHAR
+		{
+			KIND_COMPARE,
+			KIND_BETWEEN,
+			KIND_IN_LIST,
+			KIND_MISSING,
+			KIND_NOT_MISSING
+		};
+
+		struct Condition
+		{
+			Kind kind;
+			UCHAR blrOp;			// for KIND_COMPARE
+			USHORT fieldId;
+			FB_SIZE_T firstValue;	// in m_values
+			FB_SIZE_T valueCount;
+		};
+
+		BatchBoolean(MemoryPool& pool, StreamType stream);
+
+		void addConjuncts(BoolExprNode* boolean);
+		bool addCondition(Kind kind, UCHAR blrOp, const ValueExprNode* field,
+			const ValueExprNode* const* values, FB_SIZE_T count);
+
+		void prepare(thread_db* tdbb, Batch* batch) const;
+		void evaluate(Batch* batch) const;
+
+		const StreamType m_stream;
+		Firebird::Array<Condition> m_conditions;
+		Firebird::Array<const ValueExprNode*> m_values;
+	};
+
+
 	// Primary (table scan) access methods
 
 	class FullTableScan final : public RecordStream
@@ -188,6 +255,7 @@ namespace Jrd
 		{
 			RecordNumber irsb_lower;
 			RecordNumber irsb_upper;
+			BatchBoolean::Batch* irsb_batch;
 		};
 
 	public:
@@ -202,6 +270,13 @@ namespace Jrd
 		void print(thread_db* tdbb, Firebird::string& plan,
 				   bool detailed, unsigned level, bool recurse) const override;
 
+		bool pushFilter(StreamType stream, RecordSource* filter) override;
+
+		void setBatchBoolean(BatchBoolean* batchBoolean)
+		{
+			m_batchBoolean = batchBoolean;
+		}
+
 	protected:
 		void internalOpen(thread_db* tdbb) const override;
 		bool internalGetRecord(thread_db* tdbb) const override;
@@ -210,6 +285,86 @@ namespace Jrd
 		const Firebird::string m_alias;
 		jrd_rel* const m_relation;
 		Firebird::Array<DbKeyRangeNode*> m_dbkeyRanges;
+		RecordSource* m_filter = nullptr;
+		BatchBoolean* m_batchBoolean = nullptr;
+	};
+
+	class ParallelTableScan final : public RecordStream
+	{
+		class ScanTask;
+
+		struct Impure : public RecordSource::Impure
+		{
+			ScanTask* irsb_task;
+		};
+
+		// Comparison of a field with a literal, checked by workers
+		struct PushedBoolean
+		{
+			USHORT fieldId;
+			UCHAR blrOp;
+			const dsc* value;
+		};
+
+		// Aggregate computed by workers
+		struct PartialAggregate
+		{
+			const AggNode* node;
+			SSHORT fieldId;		// argument, -1 if there's none
+			ULONG offset;		// of the state within the partial state of the group
+		};
+
+	public:
+		ParallelTableScan(CompilerScratch* csb, const Firebird::string& alias,
+						  StreamType stream, jrd_rel* relation, RecordSource* next,
+						  BoolExprNode* boolean, unsigned workers, bool ordered);
+
+		void close(thread_db* tdbb) const override;
+
+		void markRecursive() override;
+
+		void getChildren(Firebird::Array<const RecordSource*>& children) const override;
+
+		void print(thread_db* tdbb, Firebird::string& plan,
+				   bool detailed, unsigned level, bool recurse) const override;
+
+		bool pushFilter(StreamType stream, RecordSource* filter) override;
+		ParallelTableScan* getPartialSource(const BoolExprNode* boolean) override;
+
+		// Two-phase aggregation. Workers aggregate the records they read into partial groups,
+		// the aggregated stream combines the partial groups having the same key.
+		bool setAggregation(thread_db* tdbb, CompilerScratch* csb,
+							NestValueArray* group, MapNode* map);
+
+		bool isAggregating(thread_db* tdbb) const;
+		ULONG getPartialLength(thread_db* tdbb) const;
+		const UCHAR* getPartialGroup(thread_db* tdbb) const;
+		const UCHAR* loadPartialGroup(thread_db* tdbb, const UCHAR* group) const;
+		void combine(thread_db* tdbb, Request* request, const UCHAR* state) const;
+
+	protected:
+		void internalOpen(thread_db* tdbb) const override;
+		bool internalGetRecord(thread_db* tdbb) const override;
+
+	private:
+		bool pushBoolean(BoolExprNode* boolean);
+		bool isTableField(const ValueExprNode* value) const;
+		unsigned getWorkers(thread_db* tdbb) const;
+		CommitNumber getSnapshot(thread_db* tdbb) const;
+
+		const Firebird::string m_alias;
+		jrd_rel* const m_relation;
+		NestConst<RecordSource> m_next;		// serial scan
+		const BoolExprNode* const m_boolean;
+		Firebird::Array<PushedBoolean> m_booleans;
+		bool m_exact;						// the boolean is checked by workers completely
+		const unsigned m_workers;			// requested by the statement, 0 - not specified
+		const bool m_ordered;				// return records in the order of serial scan
+		RecordSource* m_filter = nullptr;
+		bool m_aggregating = false;
+		Firebird::Array<USHORT> m_groupFields;
+		Firebird::Array<PartialAggregate> m_aggregates;
+		ULONG m_stateLength = 0;
 	};
 
 	class BitmapTableScan final : public RecordStream
@@ -217,6 +372,7 @@ namespace Jrd
 		struct Impure : public RecordSource::Impure
 		{
 			RecordBitmap** irsb_bitmap;
+			RecordNumber irsb_prefetch_number;			// record to issue next read-ahead at
 		};
 
 	public:
@@ -231,6 +387,8 @@ namespace Jrd
 		void print(thread_db* tdbb, Firebird::string& plan,
 				   bool detailed, unsigned level, bool recurse) const override;
 
+		bool pushFilter(StreamType stream, RecordSource* filter) override;
+
 	protected:
 		void internalOpen(thread_db* tdbb) const override;
 		bool internalGetRecord(thread_db* tdbb) const override;
@@ -239,6 +397,7 @@ namespace Jrd
 		const Firebird::string m_alias;
 		jrd_rel* const m_relation;
 		NestConst<InversionNode> const m_inversion;
+		RecordSource* m_filter = nullptr;
 	};
 
 	class IndexTableScan final : public RecordStream
@@ -586,6 +745,9 @@ namespace Jrd
 			m_ansiNot = ansiNot;
 		}
 
+		bool pushFilter(StreamType stream, RecordSource* filter) override;
+		ParallelTableScan* getPartialSource(const BoolExprNode* boolean) override;
+
 	protected:
 		FilteredStream(CompilerScratch* csb, RecordSource* next, BoolExprNode* boolean);
 
@@ -603,6 +765,7 @@ namespace Jrd
 		bool m_ansiAny = false;
 		bool m_ansiAll = false;
 		bool m_ansiNot = false;
+		RecordSource* m_filter = nullptr;
 	};
 
 	class PreFilteredStream : public FilteredStream
@@ -616,9 +779,12 @@ namespace Jrd
 
 	class SortedStream : public RecordSource
 	{
+		class SortTask;
+
 		struct Impure : public RecordSource::Impure
 		{
 			Sort* irsb_sort;
+			PartitionedSort* irsb_merge;	// merge of partitions sorted in parallel
 		};
 
 	public:
@@ -715,6 +881,13 @@ namespace Jrd
 
 		bool compareKeys(const UCHAR* p, const UCHAR* q) const;
 
+		// FIRST and SKIP applied to the sorted records make it Top-N sort
+		void setLimit(ValueExprNode* first, ValueExprNode* skip)
+		{
+			m_first = first;
+			m_skip = skip;
+		}
+
 		UCHAR* getData(thread_db* tdbb) const;
 		void mapData(thread_db* tdbb, Request* request, UCHAR* data) const;
 
@@ -737,9 +910,15 @@ namespace Jrd
 
 	private:
 		Sort* init(thread_db* tdbb) const;
+		PartitionedSort* initParallel(thread_db* tdbb, unsigned workers) const;
+		void mapRecord(thread_db* tdbb, Request* request, UCHAR* data) const;
+		unsigned getWorkers(thread_db* tdbb) const;
+		FB_UINT64 getLimit(thread_db* tdbb, Request* request) const;
 
 		NestConst<RecordSource> m_next;
 		const SortMap* const m_map;
+		NestConst<ValueExprNode> m_first;
+		NestConst<ValueExprNode> m_skip;
 	};
 
 	// Make moves in a window without going out of partition boundaries.
@@ -865,6 +1044,9 @@ namespace Jrd
 		void aggExecute(thread_db* tdbb, Request* request,
 			const NestValueArray& sourceList, const NestValueArray& targetList) const;
 		void aggFinish(thread_db* tdbb, Request* request, const MapNode* map) const;
+		void aggCombine(thread_db* tdbb, Request* request, const ParallelTableScan* scan,
+			const NestValueArray& sourceList, const NestValueArray& targetList,
+			const UCHAR* state) const;
 
 		// Cache the values of a group/order in the impure.
 		template <typename AdjustFunctor>
@@ -911,7 +1093,8 @@ namespace Jrd
 	{
 	public:
 		AggregatedStream(thread_db* tdbb, CompilerScratch* csb, StreamType stream,
-			const NestValueArray* group, MapNode* map, RecordSource* next);
+			const NestValueArray* group, MapNode* map, RecordSource* next,
+			ParallelTableScan* partialScan = nullptr);
 
 	public:
 		void getChildren(Firebird::Array<const RecordSource*>& children) const override;
@@ -920,6 +1103,64 @@ namespace Jrd
 	protected:
 		bool internalGetRecord(thread_db* tdbb) const override;
 
+	private:
+		bool combinePartialGroups(thread_db* tdbb) const;
+
+		ParallelTableScan* const m_partialScan;		// aggregates the records by itself
+	};
+
+	// Aggregation of the unsorted stream, the groups are kept in a hash table.
+	// Rows of the groups not fitting the memory are buffered and aggregated
+	// by the next passes, partitioned by their hash values.
+
+	class HashAggregatedStream final : public BaseAggWinStream<HashAggregatedStream, RecordSource>
+	{
+		class GroupTable;
+
+	public:
+		struct Impure final : public BaseAggWinStream::Impure
+		{
+			GroupTable* irsb_groups;
+		};
+
+	public:
+		HashAggregatedStream(thread_db* tdbb, CompilerScratch* csb, StreamType stream,
+			NestValueArray* group, MapNode* map, RecordSource* next,
+			const Firebird::Array<AggNode::StateArea>& stateAreas,
+			ParallelTableScan* partialScan = nullptr);
+
+	public:
+		void close(thread_db* tdbb) const override;
+
+		void getChildren(Firebird::Array<const RecordSource*>& children) const override;
+		void print(thread_db* tdbb, Firebird::string& plan, bool detailed, unsigned level, bool recurse) const override;
+
+		static unsigned maxCapacity();
+
+	protected:
+		void internalOpen(thread_db* tdbb) const override;
+		bool internalGetRecord(thread_db* tdbb) const override;
+
+		Impure* getImpure(Request* request) const
+		{
+			return request->getImpure<Impure>(m_impure);
+		}
+
+	private:
+		void aggregate(thread_db* tdbb, Request* request, GroupTable* table) const;
+		void combinePartialGroups(thread_db* tdbb, Request* request, GroupTable* table) const;
+		ULONG computeHash(thread_db* tdbb, Request* request, UCHAR* key) const;
+		void saveState(Request* request, UCHAR* group) const;
+		void loadState(Request* request, const UCHAR* group) const;
+
+		BufferedStream* const m_buffer;		// rows of the groups not fitting the memory
+		ParallelTableScan* const m_partialScan;	// aggregates the records by itself
+		Firebird::Array<ULONG> m_keyLengths;
+		Firebird::Array<AggNode::StateArea> m_stateAreas;
+		ULONG m_keyLength;
+		ULONG m_recordOffset;
+		ULONG m_stateOffset;
+		ULONG m_groupLength;
 	};
 
 	class WindowedStream : public RecordSource
@@ -1117,11 +1358,15 @@ namespace Jrd
 			return impure->irsb_position;
 		}
 
+		FB_UINT64 storeRecord(thread_db* tdbb) const;
+
 	protected:
 		void internalOpen(thread_db* tdbb) const override;
 		bool internalGetRecord(thread_db* tdbb) const override;
 
 	private:
+		FB_UINT64 store(thread_db* tdbb, Request* request, Impure* impure) const;
+
 		NestConst<RecordSource> m_next;
 		Firebird::HalfStaticArray<FieldMap, OPT_STATIC_ITEMS> m_map;
 		const Format* m_format;
@@ -1154,6 +1399,8 @@ namespace Jrd
 		bool isDependent(const StreamList& streams) const override;
 		void nullRecords(thread_db* tdbb) const override;
 
+		bool pushFilter(StreamType stream, RecordSource* filter) override;
+
 	protected:
 		void internalOpen(thread_db* tdbb) const override;
 		bool internalGetRecord(thread_db* tdbb) const override;
@@ -1203,6 +1450,7 @@ namespace Jrd
 	class HashJoin : public RecordSource
 	{
 		class HashTable;
+		class BloomFilter;
 
 		struct SubStream
 		{
@@ -1222,12 +1470,13 @@ namespace Jrd
 			HashTable* irsb_hash_table;
 			UCHAR* irsb_leader_buffer;
 			ULONG irsb_leader_hash;
+			bool irsb_deferred;
 		};
 
 	public:
 		HashJoin(thread_db* tdbb, CompilerScratch* csb, JoinType joinType,
 				 FB_SIZE_T count, RecordSource* const* args, NestValueArray* const* keys,
-				 double selectivity = 0);
+				 double selectivity = 0, bool keepOrder = false);
 		HashJoin(thread_db* tdbb, CompilerScratch* csb,
 				 BoolExprNode* boolean,
 				 RecordSource* const* args, NestValueArray* const* keys,
@@ -1250,7 +1499,10 @@ namespace Jrd
 		bool isDependent(const StreamList& streams) const override;
 		void nullRecords(thread_db* tdbb) const override;
 
-		static unsigned maxCapacity();
+		bool pushFilter(StreamType stream, RecordSource* filter) override;
+
+		static ULONG getKeyLength(thread_db* tdbb, const dsc* desc);
+		static void makeKey(thread_db* tdbb, dsc* desc, ULONG keyLength, UCHAR* key);
 
 	protected:
 		void internalOpen(thread_db* tdbb) const override;
@@ -1259,7 +1511,7 @@ namespace Jrd
 	private:
 		void init(thread_db* tdbb, CompilerScratch* csb, FB_SIZE_T count,
 				  RecordSource* const* args, NestValueArray* const* keys,
-				  double selectivity);
+				  double selectivity, bool keepOrder);
 		ULONG computeHash(thread_db* tdbb, Request* request,
 						  const SubStream& sub, UCHAR* buffer) const;
 		bool fetchRecord(thread_db* tdbb, Impure* impure, FB_SIZE_T stream) const;
@@ -1269,73 +1521,8 @@ namespace Jrd
 
 		SubStream m_leader;
 		Firebird::Array<SubStream> m_args;
-	};
-
-	class MergeJoin : public RecordSource
-	{
-		struct MergeFile
-		{
-			TempSpace* mfb_space;				// merge file uses SORT I/O routines
-			ULONG mfb_equal_records;			// equality group cardinality
-			ULONG mfb_record_size;				// matches sort map length
-			ULONG mfb_current_block;			// current merge block in buffer
-			ULONG mfb_block_size;				// merge block I/O size
-			ULONG mfb_blocking_factor;			// merge equality records per block
-			UCHAR* mfb_block_data;				// merge block I/O buffer
-		};
-
-		struct Impure : public RecordSource::Impure
-		{
-			// CVC: should this value exist for compatibility? It's not used.
-			USHORT irsb_mrg_count;				// next stream in group
-			struct irsb_mrg_repeat
-			{
-				SLONG irsb_mrg_equal;			// queue of equal records
-				SLONG irsb_mrg_equal_end;		// end of the equal queue
-				SLONG irsb_mrg_equal_current;	// last fetched record from equal queue
-				SLONG irsb_mrg_last_fetched;	// first sort merge record of next group
-				SSHORT irsb_mrg_order;			// logical merge order by substream
-				MergeFile irsb_mrg_file;		// merge equivalence file
-			} irsb_mrg_rpt[1];
-		};
-
-		static const FB_SIZE_T MERGE_BLOCK_SIZE = 65536;
-
-	public:
-		MergeJoin(CompilerScratch* csb, FB_SIZE_T count,
-				  SortedStream* const* args,
-				  const NestValueArray* const* keys);
-
-		void close(thread_db* tdbb) const override;
-
-		bool refetchRecord(thread_db* tdbb) const override;
-		WriteLockResult lockRecord(thread_db* tdbb) const override;
-
-		void getChildren(Firebird::Array<const RecordSource*>& children) const override;
-
-		void print(thread_db* tdbb, Firebird::string& plan,
-				   bool detailed, unsigned level, bool recurse) const override;
-
-		void markRecursive() override;
-		void invalidateRecords(Request* request) const override;
-
-		void findUsedStreams(StreamList& streams, bool expandAll = false) const override;
-		bool isDependent(const StreamList& streams) const override;
-		void nullRecords(thread_db* tdbb) const override;
-
-	protected:
-		void internalOpen(thread_db* tdbb) const override;
-		bool internalGetRecord(thread_db* tdbb) const override;
-
-	private:
-		int compare(thread_db* tdbb, const NestValueArray* node1,
-			const NestValueArray* node2) const;
-		UCHAR* getData(thread_db* tdbb, MergeFile* mfb, SLONG record) const;
-		SLONG getRecordByIndex(thread_db* tdbb, FB_SIZE_T index) const;
-		bool fetchRecord(thread_db* tdbb, FB_SIZE_T index) const;
-
-		Firebird::Array<NestConst<SortedStream> > m_args;
-		Firebird::Array<const NestValueArray*> m_keys;
+		BufferedStream* m_leaderBuffer;		// leader rows deferred to spilled partitions
+		BloomFilter* m_filter;				// filter of the join keys pushed to the leader
 	};
 
 	class LocalTableStream final : public RecordStream
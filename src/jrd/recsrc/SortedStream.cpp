@@ -22,6 +22,7 @@
 #include "../jrd/btr.h"
 #include "../jrd/intl.h"
 #include "../jrd/req.h"
+#include "../jrd/sort.h"
 #include "../jrd/tra.h"
 #include "../dsql/ExprNodes.h"
 #include "../jrd/cch_proto.h"
@@ -33,6 +34,8 @@
 #include "../jrd/mov_proto.h"
 #include "../jrd/vio_proto.h"
 #include "../jrd/optimizer/Optimizer.h"
+#include "../common/Task.h"
+#include "../common/classes/condition.h"
 
 #include "RecordSource.h"
 
@@ -43,6 +46,328 @@ using namespace Jrd;
 // Data access: external sorting
 // -----------------------------
 
+namespace
+{
+	// Sorted data per worker needed to sort in parallel
+	const double MIN_PARALLEL_SORT_SIZE = 4 * 1024 * 1024;
+
+	// Size of block of records passed to sort workers
+	const ULONG SORT_CHUNK_SIZE = 64 * 1024;
+	const unsigned SORT_CHUNKS_PER_WORKER = 2;
+}
+
+// Parallel sort. The request thread reads the input stream and maps its records
+// into chunks, workers put the chunks into their own partitions of the sort and
+// sort the partitions. The request thread is a worker too, it fills its partition
+// when other workers are busy and while it waits for the input to end. Worker
+// threads don't need an attachment, all the work which needs it is done by the
+// request thread.
+
+class SortedStream::SortTask : public Task
+{
+public:
+	SortTask(thread_db* tdbb, const SortedStream* stream, const HalfStaticArray<Sort*, 8>& parts)
+		: m_tdbb(tdbb),
+		  m_dbb(tdbb->getDatabase()),
+		  m_pool(tdbb->getDatabase()->dbb_permanent),
+		  m_stream(stream),
+		  m_producer(Thread::getCurrentThreadId()),
+		  m_items(*m_pool),
+		  m_chunks(*m_pool),
+		  m_free(*m_pool),
+		  m_full(*m_pool),
+		  m_buffer(nullptr),
+		  m_eof(false),
+		  m_stop(false)
+	{
+		const ULONG length = m_stream->m_map->length;
+		m_chunkRecords = MAX(SORT_CHUNK_SIZE / length, 1);
+
+		for (Sort* const* iter = parts.begin(); iter != parts.end(); ++iter)
+			m_items.add(FB_NEW_POOL(*m_pool) Item(this, *iter));
+
+		const FB_SIZE_T count = parts.getCount() * SORT_CHUNKS_PER_WORKER;
+		m_buffer = FB_NEW_POOL(*m_pool) UCHAR[(FB_SIZE_T) m_chunkRecords * length * count];
+
+		Chunk* const chunks = m_chunks.getBuffer(count);
+
+		for (FB_SIZE_T i = 0; i < count; i++)
+		{
+			chunks[i].data = m_buffer + (FB_SIZE_T) m_chunkRecords * length * i;
+			chunks[i].count = 0;
+			m_free.add(&chunks[i]);
+		}
+	}
+
+	virtual ~SortTask()
+	{
+		for (Item** iter = m_items.begin(); iter != m_items.end(); ++iter)
+			delete *iter;
+
+		delete[] m_buffer;
+	}
+
+	bool handler(WorkItem& _item) override;
+	bool getWorkItem(WorkItem** pItem) override;
+	bool getResult(IStatus* status) override;
+
+	int getMaxWorkers() override
+	{
+		return m_items.getCount();
+	}
+
+private:
+	class Item : public Task::WorkItem
+	{
+	public:
+		Item(SortTask* task, Sort* sort)
+			: Task::WorkItem(task),
+			  m_sort(sort),
+			  m_inuse(false),
+			  m_done(false)
+		{}
+
+		Sort* const m_sort;
+		bool m_inuse;
+		bool m_done;
+	};
+
+	// Records mapped by the request thread
+	struct Chunk
+	{
+		UCHAR* data;
+		ULONG count;
+	};
+
+	bool produce(Item* item);
+	bool consume(thread_db* tdbb, Item* item);
+	void putChunk(thread_db* tdbb, Sort* sort, Chunk* chunk);
+
+	// Must be called with m_mutex locked
+	void wait(thread_db* tdbb)
+	{
+		EngineCheckout cout(tdbb, FB_FUNCTION, EngineCheckout::UNNECESSARY);
+		m_cond.wait(m_mutex);
+	}
+
+	void setError(IStatus* status)
+	{
+		MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+		if (m_status.isSuccess())
+			m_status.save(status);
+
+		m_stop = true;
+		m_cond.notifyAll();
+	}
+
+	thread_db* const m_tdbb;		// request thread context
+	Database* const m_dbb;
+	MemoryPool* const m_pool;
+	const SortedStream* const m_stream;
+	const ThreadId m_producer;
+	ULONG m_chunkRecords;
+
+	Mutex m_mutex;					// protects all below
+	Condition m_cond;				// signalled when chunk is filled or released
+	HalfStaticArray<Item*, 8> m_items;
+	Array<Chunk> m_chunks;
+	HalfStaticArray<Chunk*, 16> m_free;
+	HalfStaticArray<Chunk*, 16> m_full;
+	UCHAR* m_buffer;
+	StatusHolder m_status;
+	bool m_eof;
+	bool m_stop;
+};
+
+bool SortedStream::SortTask::handler(WorkItem& _item)
+{
+	Item* const item = static_cast<Item*>(&_item);
+	item->m_done = true;
+
+	if (item == m_items[0])
+		return produce(item);
+
+	ThreadContextHolder tdbb(m_dbb, nullptr);
+	return consume(tdbb, item);
+}
+
+bool SortedStream::SortTask::getWorkItem(WorkItem** pItem)
+{
+	Item* item = static_cast<Item*>(*pItem);
+
+	MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+	if (!item)
+	{
+		// The first item is served by the request thread only
+
+		if (Thread::getCurrentThreadId() == m_producer)
+			item = m_items[0];
+		else
+		{
+			for (FB_SIZE_T i = 1; i < m_items.getCount(); i++)
+			{
+				if (!m_items[i]->m_inuse)
+				{
+					item = m_items[i];
+					break;
+				}
+			}
+		}
+
+		if (!item || item->m_inuse)
+			return false;
+
+		item->m_inuse = true;
+		*pItem = item;
+	}
+
+	return !item->m_done && !m_stop;
+}
+
+bool SortedStream::SortTask::getResult(IStatus* status)
+{
+	if (status)
+	{
+		status->init();
+		status->setErrors(m_status.getErrors());
+	}
+
+	return m_status.isSuccess();
+}
+
+bool SortedStream::SortTask::produce(Item* item)
+{
+	thread_db* const tdbb = m_tdbb;
+	Request* const request = tdbb->getRequest();
+	const ULONG length = m_stream->m_map->length;
+
+	try
+	{
+		bool eof = false;
+
+		while (!eof)
+		{
+			Chunk* chunk = nullptr;
+			Chunk* full = nullptr;
+
+			{	// scope
+				MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+				while (!m_stop && m_free.isEmpty() && m_full.isEmpty())
+					wait(tdbb);
+
+				if (m_stop)
+					return false;
+
+				if (m_free.hasData())
+					chunk = m_free.pop();
+				else
+					full = m_full.pop();
+			}
+
+			// Workers are behind, help them
+
+			if (full)
+			{
+				putChunk(tdbb, item->m_sort, full);
+				continue;
+			}
+
+			chunk->count = 0;
+
+			while (chunk->count < m_chunkRecords)
+			{
+				if (!m_stream->m_next->getRecord(tdbb))
+				{
+					eof = true;
+					break;
+				}
+
+				m_stream->mapRecord(tdbb, request, chunk->data + chunk->count * length);
+				chunk->count++;
+			}
+
+			MutexLockGuard guard(m_mutex, FB_FUNCTION);
+			m_full.push(chunk);
+			m_cond.notifyAll();
+		}
+
+		{	// scope
+			MutexLockGuard guard(m_mutex, FB_FUNCTION);
+			m_eof = true;
+			m_cond.notifyAll();
+		}
+	}
+	catch (const Exception& ex)
+	{
+		FbLocalStatus status;
+		ex.stuffException(&status);
+		setError(&status);
+		return false;
+	}
+
+	return consume(tdbb, item);
+}
+
+bool SortedStream::SortTask::consume(thread_db* tdbb, Item* item)
+{
+	try
+	{
+		while (true)
+		{
+			Chunk* chunk = nullptr;
+
+			{	// scope
+				MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+				while (!m_stop && !m_eof && m_full.isEmpty())
+					wait(tdbb);
+
+				if (m_stop)
+					return false;
+
+				if (m_full.isEmpty())
+					break;
+
+				chunk = m_full.pop();
+			}
+
+			putChunk(tdbb, item->m_sort, chunk);
+		}
+
+		item->m_sort->sort(tdbb);
+	}
+	catch (const Exception& ex)
+	{
+		FbLocalStatus status;
+		ex.stuffException(&status);
+		setError(&status);
+		return false;
+	}
+
+	return true;
+}
+
+void SortedStream::SortTask::putChunk(thread_db* tdbb, Sort* sort, Chunk* chunk)
+{
+	const ULONG length = m_stream->m_map->length;
+	const UCHAR* data = chunk->data;
+
+	for (ULONG i = 0; i < chunk->count; i++, data += length)
+	{
+		UCHAR* record = nullptr;
+		sort->put(tdbb, reinterpret_cast<ULONG**>(&record));
+		memcpy(record, data, length);
+	}
+
+	MutexLockGuard guard(m_mutex, FB_FUNCTION);
+	m_free.push(chunk);
+	m_cond.notifyAll();
+}
+
+
 SortedStream::SortedStream(CompilerScratch* csb, RecordSource* next, SortMap* map)
 	: RecordSource(csb),
 	  m_next(next),
@@ -65,11 +390,18 @@ void SortedStream::internalOpen(thread_db* tdbb) const
 	impure->irsb_flags = irsb_open;
 
 	// Get rid of the old sort areas if this request has been used already.
-	// Null the pointer before calling init() because it may throw.
+	// Null the pointers before calling init() because it may throw.
 	delete impure->irsb_sort;
 	impure->irsb_sort = nullptr;
+	delete impure->irsb_merge;
+	impure->irsb_merge = nullptr;
 
-	impure->irsb_sort = init(tdbb);
+	const unsigned workers = getWorkers(tdbb);
+
+	if (workers > 1)
+		impure->irsb_merge = initParallel(tdbb, workers);
+	else
+		impure->irsb_sort = init(tdbb);
 }
 
 void SortedStream::close(thread_db* tdbb) const
@@ -86,6 +418,8 @@ void SortedStream::close(thread_db* tdbb) const
 
 		delete impure->irsb_sort;
 		impure->irsb_sort = nullptr;
+		delete impure->irsb_merge;
+		impure->irsb_merge = nullptr;
 
 		m_next->close(tdbb);
 	}
@@ -132,14 +466,25 @@ void SortedStream::print(thread_db* tdbb, string& plan,
 	if (detailed)
 	{
 		string extras;
-		extras.printf(" (record length: %" ULONGFORMAT", key length: %" ULONGFORMAT")",
+		extras.printf(" (record length: %" ULONGFORMAT", key length: %" ULONGFORMAT,
 					  m_map->length, m_map->keyLength);
 
+		const unsigned workers = getWorkers(tdbb);
+
+		if (workers > 1)
+		{
+			string workersInfo;
+			workersInfo.printf(", workers: %u", workers);
+			extras += workersInfo;
+		}
+
+		extras += ")";
+
 		if (m_map->flags & FLAG_REFETCH)
 			plan += printIndent(++level) + "Refetch";
 
 		plan += printIndent(++level) +
-			((m_map->flags & FLAG_PROJECT) ? "Unique Sort" : "Sort") + extras;
+			((m_map->flags & FLAG_PROJECT) ? "Unique Sort" : m_first ? "Top-N Sort" : "Sort") + extras;
 		printOptInfo(plan);
 
 		if (recurse)
@@ -192,14 +537,13 @@ Sort* SortedStream::init(thread_db* tdbb) const
 		Sort(tdbb->getDatabase(), &request->req_sorts,
 			 m_map->length, m_map->keyItems.getCount(), m_map->keyItems.getCount(),
 			 m_map->keyItems.begin(),
-			 ((m_map->flags & FLAG_PROJECT) ? rejectDuplicate : nullptr), 0));
+			 ((m_map->flags & FLAG_PROJECT) ? rejectDuplicate : nullptr), 0,
+			 getLimit(tdbb, request)));
 
 	// Pump the input stream dry while pushing records into sort. For
 	// each record, map all fields into the sort record. The reverse
 	// mapping is done in get_sort().
 
-	dsc to, temp;
-
 	while (m_next->getRecord(tdbb))
 	{
 		// "Put" a record to sort. Actually, get the address of a place
@@ -208,79 +552,182 @@ Sort* SortedStream::init(thread_db* tdbb) const
 		UCHAR* data = nullptr;
 		scb->put(tdbb, reinterpret_cast<ULONG**>(&data));
 
-		// Zero out the sort key. This solves a multitude of problems.
+		mapRecord(tdbb, request, data);
+	}
 
-		memset(data, 0, m_map->length);
+	scb->sort(tdbb);
 
-		// Loop thru all field (keys and hangers on) involved in the sort.
-		// Be careful to null field all unused bytes in the sort key.
+	return scb.release();
+}
 
-		const SortMap::Item* const end_item = m_map->items.begin() + m_map->items.getCount();
-		for (const SortMap::Item* item = m_map->items.begin(); item < end_item; item++)
-		{
-			to = item->desc;
-			to.dsc_address = data + (IPTR) to.dsc_address;
-			bool flag = false;
-			dsc* from = nullptr;
+PartitionedSort* SortedStream::initParallel(thread_db* tdbb, unsigned workers) const
+{
+	Database* const dbb = tdbb->getDatabase();
+	Request* const request = tdbb->getRequest();
 
-			if (item->node)
-			{
-				from = EVL_expr(tdbb, request, item->node);
-				if (request->req_flags & req_null)
-					flag = true;
-			}
-			else
-			{
-				from = &temp;
+	m_next->open(tdbb);
 
-				record_param* const rpb = &request->req_rpb[item->stream];
+	// Partitions are created here as the sort owner is not expected to be
+	// used by different threads for anything but their buffers
 
-				if (item->fieldId < 0)
-				{
-					switch (item->fieldId)
-					{
-					case ID_TRANS:
-						*reinterpret_cast<SINT64*>(to.dsc_address) = rpb->rpb_transaction_nr;
-						break;
-					case ID_DBKEY:
-						*reinterpret_cast<SINT64*>(to.dsc_address) = rpb->rpb_number.getValue();
-						break;
-					case ID_DBKEY_VALID:
-						*to.dsc_address = (UCHAR) rpb->rpb_number.isValid();
-						break;
-					default:
-						fb_assert(false);
-					}
-					continue;
-				}
+	MemoryPool& pool = request->req_sorts.getPool();
 
-				if (!EVL_field(rpb->rpb_relation, rpb->rpb_record, item->fieldId, from))
-					flag = true;
-			}
+	AutoPtr<PartitionedSort> merge(FB_NEW_POOL(pool)
+		PartitionedSort(dbb, &request->req_sorts, true));
 
-			*(data + item->flagOffset) = flag ? TRUE : FALSE;
+	HalfStaticArray<Sort*, 8> parts;
 
-			if (!flag)
-			{
-				// If an INTL string is moved into the key portion of the sort record,
-				// then we want to sort by language dependent order
+	for (unsigned i = 0; i < workers; i++)
+	{
+		AutoPtr<Sort> scb(FB_NEW_POOL(pool)
+			Sort(dbb, &request->req_sorts,
+				 m_map->length, m_map->keyItems.getCount(), m_map->keyItems.getCount(),
+				 m_map->keyItems.begin(),
+				 ((m_map->flags & FLAG_PROJECT) ? rejectDuplicate : nullptr), 0));
+
+		merge->addPartition(scb);
+		parts.add(scb.release());
+	}
 
-				if (IS_INTL_DATA(&item->desc) && isKey(&item->desc))
-				{
-					INTL_string_to_key(tdbb, INTL_INDEX_TYPE(&item->desc), from, &to,
-						(m_map->flags & FLAG_UNIQUE ? INTL_KEY_UNIQUE : INTL_KEY_SORT));
-				}
-				else
+	SortTask task(tdbb, this, parts);
+	Coordinator coord(dbb->dbb_permanent);
+
+	coord.runSync(&task);
+
+	FbLocalStatus status;
+	if (!task.getResult(&status))
+		status.raise();
+
+	// Partitions of workers whose threads failed to start are empty,
+	// but they must be sorted before the merge too
+
+	for (Sort** iter = parts.begin(); iter != parts.end(); ++iter)
+	{
+		if (!(*iter)->isSorted())
+			(*iter)->sort(tdbb);
+	}
+
+	merge->buildMergeTree();
+
+	return merge.release();
+}
+
+void SortedStream::mapRecord(thread_db* tdbb, Request* request, UCHAR* data) const
+{
+	dsc to, temp;
+
+	// Zero out the sort key. This solves a multitude of problems.
+
+	memset(data, 0, m_map->length);
+
+	// Loop thru all field (keys and hangers on) involved in the sort.
+	// Be careful to null field all unused bytes in the sort key.
+
+	const SortMap::Item* const end_item = m_map->items.begin() + m_map->items.getCount();
+	for (const SortMap::Item* item = m_map->items.begin(); item < end_item; item++)
+	{
+		to = item->desc;
+		to.dsc_address = data + (IPTR) to.dsc_address;
+		bool flag = false;
+		dsc* from = nullptr;
+
+		if (item->node)
+		{
+			from = EVL_expr(tdbb, request, item->node);
+			if (request->req_flags & req_null)
+				flag = true;
+		}
+		else
+		{
+			from = &temp;
+
+			record_param* const rpb = &request->req_rpb[item->stream];
+
+			if (item->fieldId < 0)
+			{
+				switch (item->fieldId)
 				{
-					MOV_move(tdbb, from, &to);
+				case ID_TRANS:
+					*reinterpret_cast<SINT64*>(to.dsc_address) = rpb->rpb_transaction_nr;
+					break;
+				case ID_DBKEY:
+					*reinterpret_cast<SINT64*>(to.dsc_address) = rpb->rpb_number.getValue();
+					break;
+				case ID_DBKEY_VALID:
+					*to.dsc_address = (UCHAR) rpb->rpb_number.isValid();
+					break;
+				default:
+					fb_assert(false);
 				}
+				continue;
+			}
+
+			if (!EVL_field(rpb->rpb_relation, rpb->rpb_record, item->fieldId, from))
+				flag = true;
+		}
+
+		*(data + item->flagOffset) = flag ? TRUE : FALSE;
+
+		if (!flag)
+		{
+			// If an INTL string is moved into the key portion of the sort record,
+			// then we want to sort by language dependent order
+
+			if (IS_INTL_DATA(&item->desc) && isKey(&item->desc))
+			{
+				INTL_string_to_key(tdbb, INTL_INDEX_TYPE(&item->desc), from, &to,
+					(m_map->flags & FLAG_UNIQUE ? INTL_KEY_UNIQUE : INTL_KEY_SORT));
+			}
+			else
+			{
+				MOV_move(tdbb, from, &to);
 			}
 		}
 	}
+}
 
-	scb->sort(tdbb);
+unsigned SortedStream::getWorkers(thread_db* tdbb) const
+{
+	// Sort in parallel if allowed by ParallelWorkers and if every
+	// worker gets enough data to make it worth
 
-	return scb.release();
+	const Attachment* const attachment = tdbb ? tdbb->getAttachment() : nullptr;
+
+	if (!attachment || attachment->att_parallel_workers <= 1 || m_first)
+		return 1;
+
+	const double size = m_next->getCardinality() * m_map->length;
+	const double workers = MIN(size / MIN_PARALLEL_SORT_SIZE, (double) attachment->att_parallel_workers);
+
+	return (workers < 2) ? 1 : (unsigned) workers;
+}
+
+FB_UINT64 SortedStream::getLimit(thread_db* tdbb, Request* request) const
+{
+	// FIRST and SKIP are already validated by the streams above,
+	// the sort has to keep FIRST + SKIP records
+
+	if (!m_first)
+		return 0;
+
+	const dsc* desc = EVL_expr(tdbb, request, m_first);
+	const SINT64 first = (desc && !(request->req_flags & req_null)) ? MOV_get_int64(tdbb, desc, 0) : 0;
+
+	if (first <= 0)
+		return 0;
+
+	SINT64 skip = 0;
+
+	if (m_skip)
+	{
+		desc = EVL_expr(tdbb, request, m_skip);
+		skip = (desc && !(request->req_flags & req_null)) ? MOV_get_int64(tdbb, desc, 0) : 0;
+
+		if (skip < 0 || skip > MAX_SINT64 - first)
+			return 0;
+	}
+
+	return first + skip;
 }
 
 bool SortedStream::compareKeys(const UCHAR* p, const UCHAR* q) const
@@ -330,7 +777,11 @@ UCHAR* SortedStream::getData(thread_db* tdbb) const
 	Impure* const impure = request->getImpure<Impure>(m_impure);
 
 	ULONG* data = nullptr;
-	impure->irsb_sort->get(tdbb, &data);
+
+	if (impure->irsb_merge)
+		impure->irsb_merge->get(tdbb, &data);
+	else
+		impure->irsb_sort->get(tdbb, &data);
 
 	return reinterpret_cast<UCHAR*>(data);
 }
@@ -148,6 +148,7 @@ RELATION(nam_relations, rel_relations, ODS_8_0, rel_persistent)
 	FIELD(f_rel_flags, nam_flags, fld_flag_nullable, 0, ODS_8_0)
 	FIELD(f_rel_type, nam_r_type, fld_r_type, 0, ODS_11_1)
 	FIELD(f_rel_sql_security, nam_sql_security, fld_b_sql_security, 1, ODS_13_0)
+	FIELD(f_rel_extent_size, nam_extent_size, fld_extent_size, 1, ODS_13_2)
 END_RELATION
 
 // Relation 7 (RDB$VIEW_RELATIONS)
@@ -323,6 +324,7 @@ RELATION(nam_gens, rel_gens, ODS_8_0, rel_persistent)
 	FIELD(f_gen_owner, nam_owner, fld_user, 1, ODS_12_0)
 	FIELD(f_gen_init_val, nam_init_val, fld_gen_val, 1, ODS_12_0)
 	FIELD(f_gen_increment, nam_gen_increment, fld_gen_increment, 1, ODS_12_0)
+	FIELD(f_gen_cache, nam_gen_cache, fld_gen_cache, 1, ODS_13_2)
 END_RELATION
 
 // Relation 21 (RDB$FIELD_DIMENSIONS)
@@ -501,6 +503,12 @@ RELATION(nam_mon_database, rel_mon_database, ODS_11_1, rel_virtual)
 	FIELD(f_mon_db_na, nam_mon_na, fld_att_id, 0, ODS_13_0)
 	FIELD(f_mon_db_ns, nam_mon_ns, fld_stmt_id, 0, ODS_13_0)
 	FIELD(f_mon_db_repl_mode, nam_mon_repl_mode, fld_repl_mode, 0, ODS_13_0)
+	FIELD(f_mon_db_cache_load_pages, nam_mon_cache_load_pages, fld_counter, 0, ODS_13_2)
+	FIELD(f_mon_db_cache_loaded_pages, nam_mon_cache_loaded_pages, fld_counter, 0, ODS_13_2)
+	FIELD(f_mon_db_group_commits, nam_mon_group_commits, fld_counter, 0, ODS_13_2)
+	FIELD(f_mon_db_group_commit_trans, nam_mon_group_commit_trans, fld_counter, 0, ODS_13_2)
+	FIELD(f_mon_db_group_commit_max, nam_mon_group_commit_max, fld_counter, 0, ODS_13_2)
+	FIELD(f_mon_db_group_commit_time, nam_mon_group_commit_time, fld_counter, 0, ODS_13_2)
 END_RELATION
 
 // Relation 34 (MON$ATTACHMENTS)
@@ -590,6 +598,10 @@ RELATION(nam_mon_io_stats, rel_mon_io_stats, ODS_11_1, rel_virtual)
 	FIELD(f_mon_io_page_writes, nam_mon_page_writes, fld_counter, 0, ODS_11_1)
 	FIELD(f_mon_io_page_fetches, nam_mon_page_fetches, fld_counter, 0, ODS_11_1)
 	FIELD(f_mon_io_page_marks, nam_mon_page_marks, fld_counter, 0, ODS_11_1)
+	FIELD(f_mon_io_page_hot_hits, nam_mon_page_hot_hits, fld_counter, 0, ODS_13_2)
+	FIELD(f_mon_io_page_cold_hits, nam_mon_page_cold_hits, fld_counter, 0, ODS_13_2)
+	FIELD(f_mon_io_page_promotions, nam_mon_page_promotions, fld_counter, 0, ODS_13_2)
+	FIELD(f_mon_io_page_write_calls, nam_mon_page_write_calls, fld_counter, 0, ODS_13_2)
 END_RELATION
 
 // Relation 39 (MON$RECORD_STATS)
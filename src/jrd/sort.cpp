@@ -31,11 +31,15 @@
 #include "firebird.h"
 #include <errno.h>
 #include <string.h>
+#include <algorithm>
 #include "../jrd/jrd.h"
 #include "../jrd/sort.h"
 #include "iberror.h"
 #include "../jrd/intl.h"
 #include "../common/TimeZoneUtil.h"
+#include "../common/ThreadStart.h"
+#include "../common/StatusHolder.h"
+#include "../common/classes/condition.h"
 #include "../common/gdsassert.h"
 #include "../jrd/req.h"
 #include "../jrd/val.h"
@@ -79,6 +83,12 @@ using namespace Firebird;
 const ULONG MAX_SORT_BUFFER_SIZE = 1024 * 128;	// 128KB
 const ULONG MIN_RECORDS_TO_ALLOC = 8;
 
+// Top-N sort keeps all its records in memory, bigger ones are done the usual way
+const ULONG MAX_TOP_N_BUFFER_SIZE = 1024 * 1024 * 4;	// 4MB
+
+// Run buffers are read ahead by halves, smaller halves are read synchronously
+const ULONG MIN_READ_AHEAD_SIZE = 1024 * 8;	// 8KB
+
 // the size of sr_bckptr (everything before sort_record) in bytes
 #define SIZEOF_SR_BCKPTR offsetof(sr, sr_sort_record)
 // the size of sr_bckptr in # of 32 bit longwords
@@ -147,9 +157,237 @@ namespace
 		*a = *b;
 		*b = temp;
 	}
+
+	// Entry of the radix sort, record pointer with the prefix of its key
+
+	struct SortEntry
+	{
+		FB_UINT64 prefix;	// first two longwords of the record
+		SORTP* record;
+	};
+
+	class SortEntryLess
+	{
+	public:
+		explicit SortEntryLess(ULONG length)
+			: m_length(length)
+		{}
+
+		bool operator()(const SortEntry& a, const SortEntry& b) const
+		{
+			if (a.prefix != b.prefix)
+				return a.prefix < b.prefix;
+
+			for (ULONG i = 2; i < m_length; i++)
+			{
+				if (a.record[i] != b.record[i])
+					return a.record[i] < b.record[i];
+			}
+
+			return false;
+		}
+
+	private:
+		const ULONG m_length;	// record length in longwords
+	};
+
+	const ULONG RADIX_MIN_GROUP = 64;	// smaller groups are sorted by comparison
+
+	void radixPass(SortEntry* entries, SortEntry* temp, ULONG count, int shift,
+		const SortEntryLess& less)
+	{
+		while (count >= RADIX_MIN_GROUP && shift >= 0)
+		{
+			ULONG counts[256];
+			memset(counts, 0, sizeof(counts));
+
+			for (ULONG i = 0; i < count; i++)
+				counts[(entries[i].prefix >> shift) & 0xFF]++;
+
+			// If all entries have the same byte, go to the next one
+
+			if (counts[(entries[0].prefix >> shift) & 0xFF] == count)
+			{
+				shift -= 8;
+				continue;
+			}
+
+			ULONG offsets[256];
+			ULONG offset = 0;
+
+			for (unsigned b = 0; b < 256; b++)
+			{
+				offsets[b] = offset;
+				offset += counts[b];
+			}
+
+			for (ULONG i = 0; i < count; i++)
+				temp[offsets[(entries[i].prefix >> shift) & 0xFF]++] = entries[i];
+
+			memcpy(entries, temp, count * sizeof(SortEntry));
+
+			// Sort every bucket by the following bytes
+
+			offset = 0;
+
+			for (unsigned b = 0; b < 256; b++)
+			{
+				if (counts[b] > 1)
+					radixPass(entries + offset, temp + offset, counts[b], shift - 8, less);
+
+				offset += counts[b];
+			}
+
+			return;
+		}
+
+		// Small group or the whole prefix is the same
+
+		std::sort(entries, entries + count, less);
+	}
+
+	// Compare diddled keys of two records
+	inline int compareKeys(const sort_record* a, const sort_record* b, ULONG length)
+	{
+		const SORTP* p = a->sort_record_key;
+		const SORTP* q = b->sort_record_key;
+
+		for (; length; length--, p++, q++)
+		{
+			if (*p != *q)
+				return (*p > *q) ? 1 : -1;
+		}
+
+		return 0;
+	}
 } // namespace
 
 
+// RunIO -- background thread reading and writing the work file while runs are
+// merged, so the merge doesn't wait for every block of the runs. Requests are
+// performed in order they are made. TempSpace is not thread-safe, thus once
+// RunIO is started every access to the work file during the merge goes through it.
+
+class Jrd::RunIO
+{
+public:
+	RunIO(MemoryPool& pool, TempSpace* space)
+		: m_space(space), m_queue(pool), m_busy(false), m_stop(false)
+	{
+		Thread::start(ioThread, this, THREAD_medium, &m_thread);
+	}
+
+	~RunIO()
+	{
+		{	// scope
+			MutexLockGuard guard(m_mutex, FB_FUNCTION);
+			m_stop = true;
+			m_cond.notifyAll();
+		}
+
+		m_thread.waitForCompletion();
+	}
+
+	void start(run_io* io)
+	{
+		fb_assert(io->rio_length);
+
+		MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+		io->rio_done = false;
+		m_queue.add(io);
+		m_cond.notifyAll();
+	}
+
+	void wait(run_io* io)
+	{
+		MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+		while (!io->rio_done)
+			m_cond.wait(m_mutex);
+
+		m_status.check();
+	}
+
+	void execute(run_io* io)
+	{
+		start(io);
+		wait(io);
+	}
+
+	// Wait for all requests, used when merge is abandoned
+	void drain()
+	{
+		MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+		while (m_busy || m_queue.hasData())
+			m_cond.wait(m_mutex);
+	}
+
+private:
+	static THREAD_ENTRY_DECLARE ioThread(THREAD_ENTRY_PARAM arg)
+	{
+		static_cast<RunIO*>(arg)->process();
+		return 0;
+	}
+
+	void process()
+	{
+		MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+		while (true)
+		{
+			while (!m_stop && m_queue.isEmpty())
+				m_cond.wait(m_mutex);
+
+			if (m_stop)
+				break;
+
+			run_io* const io = m_queue[0];
+			m_queue.remove((FB_SIZE_T) 0);
+			m_busy = true;
+
+			FbLocalStatus status;
+
+			{	// scope
+				MutexUnlockGuard unlock(m_mutex, FB_FUNCTION);
+
+				try
+				{
+					if (io->rio_write)
+						Sort::writeBlock(m_space, io->rio_seek, io->rio_address, io->rio_length);
+					else
+						Sort::readBlock(m_space, io->rio_seek, io->rio_address, io->rio_length);
+				}
+				catch (const Exception& ex)
+				{
+					ex.stuffException(&status);
+				}
+			}
+
+			if (status->getState() & IStatus::STATE_ERRORS)
+			{
+				if (m_status.isSuccess())
+					m_status.save(&status);
+			}
+
+			io->rio_done = true;
+			m_busy = false;
+			m_cond.notifyAll();
+		}
+	}
+
+	TempSpace* const m_space;
+	Thread m_thread;
+	Mutex m_mutex;					// protects all below
+	Condition m_cond;				// signalled when request is added or done
+	Array<run_io*> m_queue;			// requests in order they are made
+	StatusHolder m_status;			// first error
+	bool m_busy;					// request is being performed
+	bool m_stop;
+};
+
+
 Sort::Sort(Database* dbb,
 		   SortOwner* owner,
 		   ULONG record_length,
@@ -161,7 +399,7 @@ Sort::Sort(Database* dbb,
 		   FB_UINT64 max_records)
 	: m_dbb(dbb), m_owner(owner),
 	  m_last_record(NULL), m_next_pointer(NULL), m_records(0),
-	  m_runs(NULL), m_merge(NULL), m_free_runs(NULL),
+	  m_runs(NULL), m_merge(NULL), m_free_runs(NULL), m_io(NULL),
 	  m_flags(0), m_merge_pool(NULL),
 	  m_description(m_owner->getPool(), keys)
 {
@@ -179,6 +417,9 @@ Sort::Sort(Database* dbb,
  *		  compared. This is used at creation of unique index since sort key
  *		  includes index key (which must be unique) and record numbers.
  *
+ * If max_records is given, only that many records with the least keys
+ * are returned. If they fit in memory, the others are dropped at once.
+ *
  **************************************/
 	fb_assert(m_owner);
 	fb_assert(unique_keys <= keys);
@@ -218,10 +459,29 @@ Sort::Sort(Database* dbb,
 
 		m_unique_length = ROUNDUP(p->getSkdOffset() + p->getSkdLength(), sizeof(SLONG)) >> SHIFTLONG;
 
+		// Top-N sort needs room for the kept records, one more record being put
+		// and their pointers surrounded by the low and high keys
+
+		FB_UINT64 top_size = 0;
+
+		if (m_max_records && m_max_records < MAX_TOP_N_BUFFER_SIZE && !m_dup_callback)
+		{
+			top_size = (m_max_records + 1) * record_size +
+				(m_max_records + 2) * sizeof(sort_record*);
+
+			if (top_size <= MAX_TOP_N_BUFFER_SIZE)
+				m_max_alloc_size = MAX(m_max_alloc_size, (ULONG) top_size);
+			else
+				top_size = 0;
+		}
+
 		// Next, try to allocate a "big block". How big? Big enough!
 
 		allocateBuffer(pool);
 
+		if (top_size && top_size <= m_size_memory)
+			m_flags |= scb_top_n;
+
 		m_end_memory = m_memory + m_size_memory;
 		m_first_pointer = (sort_record**) m_memory;
 
@@ -263,6 +523,9 @@ Sort::~Sort()
 	// Unlink the sort
 	m_owner->unlinkSort(this);
 
+	// Stop the background I/O before its buffers and work file are released
+	delete m_io;
+
 	// Release the temporary space
 	delete m_space;
 
@@ -355,6 +618,21 @@ void Sort::put(thread_db* tdbb, ULONG** record_address)
 			diddleKey((UCHAR*) (record->sr_sort_record.sort_record_key), true, false);
 		}
 
+		if (m_flags & scb_top_n)
+		{
+			// Keep the previous record if it's among the top ones and reuse memory
+			// of the record which is not. Otherwise take the next free record.
+
+			SR* const free = (record != (SR*) m_end_memory) ? pushTop(record) : NULL;
+
+			record = free ? free :
+				(SR*) ((SORTP*) m_end_memory - (m_records + 1) * m_longs);
+
+			m_last_record = record;
+			*record_address = (ULONG*) record->sr_sort_record.sort_record_key;
+			return;
+		}
+
 		// If there isn't room for the record, sort and write the run.
 		// Check that we are not at the beginning of the buffer in addition
 		// to checking for space for the record. This avoids the pointer
@@ -424,6 +702,9 @@ void Sort::sort(thread_db* tdbb)
 		if (m_last_record != (SR*) m_end_memory)
 		{
 			diddleKey((UCHAR*) KEYOF(m_last_record), true, false);
+
+			if (m_flags & scb_top_n)
+				pushTop(m_last_record);
 		}
 
 		// If there aren't any runs, things fit nicely in memory. Just sort the mess
@@ -586,6 +867,7 @@ void Sort::sort(thread_db* tdbb)
 		}
 
 		sortRunsBySeek(run_count);
+		readAhead(run_count);
 
 		m_flags |= scb_sorted;
 	}
@@ -1185,7 +1467,6 @@ sort_record* Sort::getMerge(merge_control* merge)
 	SORTP *p;				// no more than 1 SORTP* to a line
 	SORTP *q;				// no more than 1 SORTP* to a line
 	ULONG l;
-	ULONG n;
 
 	sort_record* record = NULL;
 	bool eof = false;
@@ -1214,18 +1495,20 @@ sort_record* Sort::getMerge(merge_control* merge)
 
 			if ((record = (sort_record*) run->run_record) < (sort_record*) run->run_end_buffer)
 			{
+				// Entering the half of double buffer being read ahead
+
+				if (record == run->run_wait)
+					waitRun(run);
+
 				run->run_record = reinterpret_cast<sort_record*>(NEXT_RUN_RECORD(run->run_record));
 				--run->run_records;
 				continue;
 			}
 
 			// There are records remaining, but the buffer is full.
-			// Read a buffer full.
+			// Read a buffer full, or wait for the read ahead data.
 
-			l = (ULONG) (run->run_end_buffer - run->run_buffer);
-			n = run->run_records * m_longs * sizeof(ULONG);
-			l = MIN(l, n);
-			run->run_seek = readBlock(m_space, run->run_seek, run->run_buffer, l);
+			readRun(run);
 
 			record = reinterpret_cast<sort_record*>(run->run_buffer);
 			run->run_record =
@@ -1635,32 +1918,90 @@ void Sort::mergeRuns(USHORT n)
 	// Merge records into run
 	CHECK_FILE(NULL);
 
-	sort_record* q = reinterpret_cast<sort_record*>(temp_run.run_buffer);
 	FB_UINT64 seek = temp_run.run_seek = m_space->allocateSpace(temp_run.run_size);
 	temp_run.run_records = 0;
 
 	CHECK_FILE(&temp_run);
 
-	const sort_record* p;
-	while ( (p = getMerge(merge)) )
+	// With the background I/O the new run is written by halves of its buffer,
+	// one half is filled while another is being written
+
+	ULONG part = (ULONG) (temp_run.run_end_buffer - temp_run.run_buffer);
+	const ULONG half = part / rec_size / 2 * rec_size;
+	const bool halves = (half >= MIN_READ_AHEAD_SIZE);
+
+	run_io writes[2];
+	writes[0].rio_length = writes[1].rio_length = 0;
+	int w = 0;
+
+	try
 	{
-		if (q >= (sort_record*) temp_run.run_end_buffer)
+		readAhead(n);
+
+		if (!m_io && halves && !m_space->inMemory(temp_run.run_seek, temp_run.run_size))
+			m_io = FB_NEW_POOL(m_owner->getPool()) RunIO(m_owner->getPool(), m_space);
+
+		if (m_io && halves)
+			part = half;
+
+		UCHAR* out_buffer = temp_run.run_buffer;
+		sort_record* q = reinterpret_cast<sort_record*>(out_buffer);
+		const sort_record* out_end = reinterpret_cast<sort_record*>(out_buffer + part);
+
+		const sort_record* p;
+		while ( (p = getMerge(merge)) )
 		{
-			size = (UCHAR*) q - temp_run.run_buffer;
-			seek = writeBlock(m_space, seek, temp_run.run_buffer, size);
-			q = reinterpret_cast<sort_record*>(temp_run.run_buffer);
+			if (q >= out_end)
+			{
+				size = (UCHAR*) q - out_buffer;
+				seek = writeRun(&writes[w], seek, out_buffer, size);
+
+				if (m_io)
+				{
+					if (halves)
+					{
+						w = 1 - w;
+						out_buffer = temp_run.run_buffer + w * part;
+						out_end = reinterpret_cast<sort_record*>(out_buffer + part);
+					}
+
+					// Wait until the buffer is written before it's filled again
+
+					if (writes[w].rio_length)
+					{
+						m_io->wait(&writes[w]);
+						writes[w].rio_length = 0;
+					}
+				}
+
+				q = reinterpret_cast<sort_record*>(out_buffer);
+			}
+			ULONG longs_count = m_longs;
+			do {
+				*q++ = *p++;
+			} while (--longs_count);
+			++temp_run.run_records;
 		}
-		ULONG longs_count = m_longs;
-		do {
-			*q++ = *p++;
-		} while (--longs_count);
-		++temp_run.run_records;
-	}
 
-	// Write the tail of the new run and return any unused space
+		// Write the tail of the new run and return any unused space
 
-	if ( (size = (UCHAR*) q - temp_run.run_buffer) )
-		seek = writeBlock(m_space, seek, temp_run.run_buffer, size);
+		if ( (size = (UCHAR*) q - out_buffer) )
+			seek = writeRun(&writes[w], seek, out_buffer, size);
+
+		for (w = 0; w < 2; w++)
+		{
+			if (writes[w].rio_length)
+				m_io->wait(&writes[w]);
+		}
+	}
+	catch (const Exception&)
+	{
+		// Requests refer to the local data
+		if (m_io)
+			m_io->drain();
+
+		throw;
+	}
 
 	// If the records did not fill the allocated run (such as when duplicates are
 	// rejected), then free the remainder and diminish the size of the run accordingly
@@ -1955,7 +2296,8 @@ void Sort::orderAndSave(thread_db* tdbb)
  * scratch file as one big chunk
  *
  **************************************/
-	EngineCheckout cout(tdbb, FB_FUNCTION);
+	// Partitions of parallel sort are filled by threads without attachment
+	EngineCheckout cout(tdbb, FB_FUNCTION, EngineCheckout::UNNECESSARY);
 
 	run_control* run = m_runs;
 	run->run_records = 0;
@@ -2004,6 +2346,77 @@ void Sort::orderAndSave(thread_db* tdbb)
 }
 
 
+SR* Sort::pushTop(SR* record)
+{
+/**************************************
+ *
+ * Add the record to the top records of Top-N sort. They are kept as
+ * a heap with the greatest key in the root. If the heap is full, the
+ * record either replaces the root or is rejected. Return the record
+ * which left the heap, if any, its memory is reused for the next record.
+ *
+ **************************************/
+	sort_record* const key = &record->sr_sort_record;
+	sort_record** const heap = m_first_pointer;	// heap[0] is the low key
+	ULONG i;
+
+	if (m_records < m_max_records)
+	{
+		// Sift the new record up
+
+		i = (ULONG) ++m_records;
+
+		while (i > 1 && compareKeys(heap[i / 2], key, m_key_length) < 0)
+		{
+			setTopPointer(i, heap[i / 2]);
+			i /= 2;
+		}
+
+		setTopPointer(i, key);
+		m_next_pointer = heap + m_records + 1;
+
+		return NULL;
+	}
+
+	// Keep the record only if it's less than the greatest one
+
+	if (compareKeys(key, heap[1], m_key_length) >= 0)
+		return record;
+
+	SR* const released = (SR*) ((SORTP*) heap[1] - SIZEOF_SR_BCKPTR_IN_LONGS);
+
+	// Sift the new record down from the root
+
+	const ULONG count = (ULONG) m_records;
+	i = 1;
+
+	while (i * 2 <= count)
+	{
+		ULONG child = i * 2;
+
+		if (child < count && compareKeys(heap[child + 1], heap[child], m_key_length) > 0)
+			child++;
+
+		if (compareKeys(heap[child], key, m_key_length) <= 0)
+			break;
+
+		setTopPointer(i, heap[child]);
+		i = child;
+	}
+
+	setTopPointer(i, key);
+
+	return released;
+}
+
+
+void Sort::setTopPointer(ULONG slot, sort_record* key)
+{
+	m_first_pointer[slot] = key;
+	((SR*) ((SORTP*) key - SIZEOF_SR_BCKPTR_IN_LONGS))->sr_bckptr = &m_first_pointer[slot];
+}
+
+
 void Sort::putRun(thread_db* tdbb)
 {
 /**************************************
@@ -2041,51 +2454,184 @@ void Sort::putRun(thread_db* tdbb)
 }
 
 
+void Sort::readAhead(ULONG n)
+{
+/**************************************
+ *
+ * Start reading of first n runs ahead of the merge.
+ * Buffer of run big enough is split into halves: while
+ * one of them is consumed by the merge, another one is
+ * filled by the background I/O thread.
+ *
+ **************************************/
+	const ULONG rec_size = m_longs << SHIFTLONG;
+	run_control* run = m_runs;
+
+	for (ULONG count = 0; count < n; run = run->run_next, count++)
+	{
+		// Runs in memory are not read at all
+
+		if (run->run_buff_cache || !run->run_records)
+			continue;
+
+		const ULONG half = (ULONG) (run->run_end_buffer - run->run_buffer) / rec_size / 2 * rec_size;
+
+		if (half < MIN_READ_AHEAD_SIZE)
+			continue;
+
+		if (!m_io)
+			m_io = FB_NEW_POOL(m_owner->getPool()) RunIO(m_owner->getPool(), m_space);
+
+		run->run_end_buffer = run->run_buffer + half * 2;
+		run->run_record = reinterpret_cast<sort_record*>(run->run_buffer);
+		run->run_wait = run->run_record;
+
+		const FB_UINT64 unread = (FB_UINT64) run->run_records * rec_size;
+		startRead(run, 0, unread);
+		startRead(run, 1, unread - run->run_reads[0].rio_length);
+	}
+}
+
+
+void Sort::startRead(run_control* run, int half, FB_UINT64 unread)
+{
+/**************************************
+ *
+ * Start reading of the next block of run into
+ * the given half of its double buffer.
+ *
+ **************************************/
+	const ULONG length = (ULONG) (run->run_end_buffer - run->run_buffer) / 2;
+	run_io* const io = &run->run_reads[half];
+
+	io->rio_length = (ULONG) MIN(length, unread);
+
+	if (!io->rio_length)
+		return;
+
+	io->rio_address = run->run_buffer + half * length;
+	io->rio_seek = run->run_seek;
+	io->rio_write = false;
+	run->run_seek += io->rio_length;
+
+	m_io->start(io);
+}
+
+
+void Sort::waitRun(run_control* run)
+{
+/**************************************
+ *
+ * The merge reached the half of double buffer
+ * being read ahead. Wait for its data and start
+ * reading into another half, which is consumed.
+ *
+ **************************************/
+	const ULONG rec_size = m_longs << SHIFTLONG;
+	const ULONG length = (ULONG) (run->run_end_buffer - run->run_buffer) / 2;
+	const int half = (run->run_wait == reinterpret_cast<sort_record*>(run->run_buffer)) ? 0 : 1;
+	run_io* const io = &run->run_reads[half];
+
+	fb_assert(io->rio_length);
+	m_io->wait(io);
+
+	const FB_UINT64 unread = (FB_UINT64) run->run_records * rec_size - io->rio_length;
+	io->rio_length = 0;
+
+	// Both halves are read before the merge starts, don't read
+	// another one until it's consumed
+
+	if (!run->run_reads[1 - half].rio_length)
+		startRead(run, 1 - half, unread);
+
+	run->run_wait = reinterpret_cast<sort_record*>(run->run_buffer + (1 - half) * length);
+}
+
+
+FB_UINT64 Sort::writeRun(run_io* io, FB_UINT64 seek, UCHAR* address, ULONG length)
+{
+/**************************************
+ *
+ * Write block of merged run, in background if possible.
+ *
+ **************************************/
+	if (!m_io)
+		return writeBlock(m_space, seek, address, length);
+
+	io->rio_address = address;
+	io->rio_seek = seek;
+	io->rio_length = length;
+	io->rio_write = true;
+	m_io->start(io);
+
+	return seek + length;
+}
+
+
+void Sort::readRun(run_control* run)
+{
+/**************************************
+ *
+ * The buffer of run is consumed, get the next block of run.
+ *
+ **************************************/
+	if (run->run_wait)
+	{
+		// Double buffer is consumed up to its end, continue from its beginning
+
+		fb_assert(run->run_wait == reinterpret_cast<sort_record*>(run->run_buffer));
+		waitRun(run);
+		return;
+	}
+
+	ULONG l = (ULONG) (run->run_end_buffer - run->run_buffer);
+	const ULONG n = run->run_records * m_longs * sizeof(ULONG);
+	l = MIN(l, n);
+
+	if (m_io)
+	{
+		run_io io;
+		io.rio_address = run->run_buffer;
+		io.rio_seek = run->run_seek;
+		io.rio_length = l;
+		io.rio_write = false;
+
+		m_io->execute(&io);
+		run->run_seek += l;
+	}
+	else
+		run->run_seek = readBlock(m_space, run->run_seek, run->run_buffer, l);
+}
+
+
 void Sort::sortBuffer(thread_db* tdbb)
 {
 /**************************************
  *
- * Set up for and call quick sort.  Quicksort, by design, doesn't
- * order partitions of length 2, so make a pass thru the data to
- * straighten out pairs.  While we at it, if duplicate handling has
- * been requested, detect and handle them.
+ * Set up for and call the sort kernel.  While we at it, if duplicate
+ * handling has been requested, detect and handle them.
  *
  **************************************/
-	EngineCheckout cout(tdbb, FB_FUNCTION);
+	EngineCheckout cout(tdbb, FB_FUNCTION, EngineCheckout::UNNECESSARY);
 
 	// First, insert a pointer to the high key
 
 	*m_next_pointer = reinterpret_cast<sort_record*>(high_key);
 
-	// Next, call QuickSort. Keep in mind that the first pointer is the
+	// Next, sort the pointers. Keep in mind that the first pointer is the
 	// low key and not a record.
 
 	SORTP** j = (SORTP**) (m_first_pointer) + 1;
 	const ULONG n = (SORTP**) (m_next_pointer) - j;	// calculate # of records
 
-	quick(n, j, m_longs);
-
-	// Scream through and correct any out of order pairs
-	// hvlad: don't compare user keys against high_key
-	while (j < (SORTP**) m_next_pointer - 1)
+	try
 	{
-		SORTP** i = j;
-		j++;
-		if (**i >= **j)
-		{
-			const SORTP* p = *i;
-			const SORTP* q = *j;
-			ULONG tl = m_longs - 1;
-			while (tl && *p == *q)
-			{
-				p++;
-				q++;
-				tl--;
-			}
-			if (tl && *p > *q) {
-				swap(i, j);
-			}
-		}
+		radixSort(m_owner->getPool(), n, j, m_longs);
+	}
+	catch (const BadAlloc&)
+	{
+		// No memory for the radix sort entries, sort the pointers in place
+		quickSort(n, j, m_longs);
 	}
 
 	// If duplicate handling hasn't been requested, we're done
@@ -2134,6 +2680,80 @@ void Sort::sortBuffer(thread_db* tdbb)
 }
 
 
+void Sort::quickSort(ULONG size, SORTP** pointers, ULONG longs)
+{
+/**************************************
+ *
+ * Call quick sort.  Quicksort, by design, doesn't order partitions of
+ * length 2, so make a pass thru the data to straighten out pairs.
+ *
+ **************************************/
+	quick(size, pointers, longs);
+
+	// Scream through and correct any out of order pairs
+	// hvlad: don't compare user keys against high_key
+	SORTP** j = pointers;
+	SORTP** const end = pointers + size;
+
+	while (j < end - 1)
+	{
+		SORTP** i = j;
+		j++;
+		if (**i >= **j)
+		{
+			const SORTP* p = *i;
+			const SORTP* q = *j;
+			ULONG tl = longs - 1;
+			while (tl && *p == *q)
+			{
+				p++;
+				q++;
+				tl--;
+			}
+			if (tl && *p > *q) {
+				swap(i, j);
+			}
+		}
+	}
+}
+
+
+void Sort::radixSort(MemoryPool& pool, ULONG size, SORTP** pointers, ULONG longs)
+{
+/**************************************
+ *
+ * Sort an array of record pointers.  Every pointer gets the first two
+ * longwords of its record as the key prefix, the entries are sorted by
+ * the prefix bytes using MSD radix sort, so records are dereferenced
+ * only to compare records having the same prefix.  Small groups are
+ * sorted by comparison.
+ *
+ **************************************/
+	if (size < 2)
+		return;
+
+	const ULONG length = longs - SIZEOF_SR_BCKPTR_IN_LONGS;
+
+	Array<SortEntry> entries(pool);
+	SortEntry* const buffer = entries.getBuffer(size * 2);
+
+	for (ULONG i = 0; i < size; i++)
+	{
+		SORTP* const record = pointers[i];
+		buffer[i].prefix = ((FB_UINT64) record[0] << 32) | (length > 1 ? record[1] : 0);
+		buffer[i].record = record;
+	}
+
+	radixPass(buffer, buffer + size, size, 56, SortEntryLess(length));
+
+	for (ULONG i = 0; i < size; i++)
+	{
+		pointers[i] = buffer[i].record;
+		((SORTP***) pointers[i])[BACK_OFFSET] = pointers + i;
+	}
+}
+
+
 void Sort::sortRunsBySeek(int n)
 {
 /**************************************
@@ -2167,6 +2787,8 @@ void Sort::sortRunsBySeek(int n)
 
 UCHAR* SortOwner::allocateBuffer()
 {
+	MutexLockGuard ownerGuard(mutex, FB_FUNCTION);
+
 	if (buffers.hasData())
 		return buffers.pop();
 
@@ -2184,6 +2806,8 @@ UCHAR* SortOwner::allocateBuffer()
 
 void SortOwner::releaseBuffer(UCHAR* memory)
 {
+	MutexLockGuard guard(mutex, FB_FUNCTION);
+
 	buffers.push(memory);
 }
 
@@ -2213,18 +2837,22 @@ void SortOwner::unlinkAll()
 /// class PartitionedSort
 
 
-PartitionedSort::PartitionedSort(Database* dbb, SortOwner* owner) :
+PartitionedSort::PartitionedSort(Database* dbb, SortOwner* owner, bool ownParts) :
 	m_owner(owner),
 	m_parts(owner->getPool()),
 	m_nodes(owner->getPool()),
-	m_merge(NULL)
+	m_merge(NULL),
+	m_ownParts(ownParts)
 {
 }
 
 PartitionedSort::~PartitionedSort()
 {
-//	for (ULONG p = 0; p < m_parts.getCount(); p++)
-//		delete m_parts[p].srt_sort;
+	if (m_ownParts)
+	{
+		for (ULONG p = 0; p < m_parts.getCount(); p++)
+			delete m_parts[p].srt_sort;
+	}
 }
 
 void PartitionedSort::buildMergeTree()
@@ -2286,15 +2914,31 @@ void PartitionedSort::get(thread_db* tdbb, ULONG** record_address)
 {
 	sort_record* record = NULL;
 
-	if (!m_merge)
-		record = m_parts[0].srt_sort->getRecord();
-	else
-		record = getMerge();
+	try
+	{
+		if (!m_merge)
+			record = m_parts[0].srt_sort->getRecord();
+		else
+			record = getMerge();
 
-	*record_address = (ULONG*)record;
+		*record_address = (ULONG*)record;
 
-	if (record)
-		m_parts[0].srt_sort->diddleKey((UCHAR*)record->sort_record_key, false, true);
+		// Restore the keys the same way Sort::get() does, separated data of
+		// decfloat keys is needed by the callers of the query sorts
+
+		if (record)
+			m_parts[0].srt_sort->diddleKey((UCHAR*)record->sort_record_key, false, false);
+	}
+	catch (const BadAlloc&)
+	{
+		Firebird::Arg::Gds(isc_sort_mem_err).raise();
+	}
+	catch (const status_exception& ex)
+	{
+		Firebird::Arg::Gds status(isc_sort_err);
+		status.append(Firebird::Arg::StatusVector(ex.value()));
+		status.raise();
+	}
 }
 
 sort_record* PartitionedSort::getMerge()
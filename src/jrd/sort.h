@@ -26,6 +26,7 @@
 
 #include "../include/fb_blk.h"
 #include "../common/DecFloat.h"
+#include "../common/classes/locks.h"
 #include "../jrd/TempSpace.h"
 #include "../jrd/align.h"
 
@@ -35,6 +36,7 @@ namespace Jrd {
 class Attachment;
 class Sort;
 class SortOwner;
+class RunIO;
 struct merge_control;
 
 // SORTP is used throughout sort.c as a pointer into arrays of
@@ -225,6 +227,17 @@ const int RMH_TYPE_MRG	= 1;
 const int RMH_TYPE_SORT = 2;
 
 
+// Request of asynchronous read or write of work file, see RunIO in sort.cpp
+
+struct run_io
+{
+	UCHAR*			rio_address;		// Buffer
+	FB_UINT64		rio_seek;			// Offset in work file
+	ULONG			rio_length;			// Length, 0 if not requested
+	bool			rio_write;			// Write request
+	bool			rio_done;			// Request is completed
+};
+
 // Run control block
 
 struct run_control
@@ -242,6 +255,8 @@ struct run_control
 	bool			run_buff_cache;		// run buffer is already in cache
 	FB_UINT64		run_mem_seek;		// position of run's buffer in in-memory part of sort file
 	ULONG			run_mem_size;		// size of run's buffer in in-memory part of sort file
+	sort_record*	run_wait;			// half of double buffer being read ahead, if any
+	run_io			run_reads[2];		// reads into halves of double buffer
 };
 
 // Merge control block
@@ -272,6 +287,7 @@ typedef bool (*FPTR_REJECT_DUP_CALLBACK)(const UCHAR*, const UCHAR*, void*);
 
 const int scb_sorted		= 1;	// stream has been sorted
 const int scb_reuse_buffer	= 2;	// reuse buffer if possible
+const int scb_top_n			= 4;	// only m_max_records records are kept in memory
 
 class Sort
 {
@@ -291,6 +307,12 @@ public:
 		return m_flags & scb_sorted;
 	}
 
+	// In-memory sort of record pointers, "longs" is the record length
+	// including the back pointer. The quick sort expects pointers to
+	// the low and high keys just before and after the array.
+	static void quickSort(ULONG size, SORTP** pointers, ULONG longs);
+	static void radixSort(MemoryPool& pool, ULONG size, SORTP** pointers, ULONG longs);
+
 	static FB_UINT64 readBlock(TempSpace* space, FB_UINT64 seek, UCHAR* address, ULONG length)
 	{
 		const size_t bytes = space->read(seek, address, length);
@@ -317,7 +339,14 @@ private:
 	void mergeRuns(USHORT);
 	ULONG order();
 	void orderAndSave(Jrd::thread_db*);
+	SR* pushTop(SR*);
+	void setTopPointer(ULONG, sort_record*);
 	void putRun(Jrd::thread_db*);
+	void readAhead(ULONG);
+	void startRead(run_control*, int, FB_UINT64);
+	void waitRun(run_control*);
+	void readRun(run_control*);
+	FB_UINT64 writeRun(run_io*, FB_UINT64, UCHAR*, ULONG);
 	void sortBuffer(Jrd::thread_db*);
 	void sortRunsBySeek(int);
 
@@ -339,11 +368,12 @@ private:
 	ULONG m_key_length;							// Key length
 	ULONG m_unique_length;						// Unique key length, used when duplicates eliminated
 	FB_UINT64 m_records;						// Number of records
-	FB_UINT64 m_max_records;					// Maximum number of records to store, assigned but unused.
+	FB_UINT64 m_max_records;					// Number of records needed by caller, 0 - all
 	TempSpace* m_space;							// temporary space for scratch file
 	run_control* m_runs;						// ALLOC: Run on scratch file, if any
 	merge_control* m_merge;						// Top level merge block
 	run_control* m_free_runs;					// ALLOC: Currently unused run blocks
+	RunIO* m_io;								// ALLOC: Background I/O of merged runs
 	ULONG m_flags;								// see flag bits below
 	FPTR_REJECT_DUP_CALLBACK m_dup_callback;	// Duplicate handling callback
 	void* m_dup_callback_arg;					// Duplicate handling callback arg
@@ -359,7 +389,7 @@ private:
 class PartitionedSort
 {
 public:
-	PartitionedSort(Database*, SortOwner*);
+	PartitionedSort(Database*, SortOwner*, bool ownParts = false);
 	~PartitionedSort();
 
 	void get(Jrd::thread_db*, ULONG**);
@@ -383,6 +413,7 @@ private:
 	Firebird::HalfStaticArray<sort_control, 8> m_parts;
 	Firebird::HalfStaticArray<merge_control, 8> m_nodes;	// nodes of merge tree
 	merge_control* m_merge;				// root of merge tree
+	const bool m_ownParts;				// partitions are deleted with the merge
 };
 
 
@@ -404,6 +435,8 @@ public:
 	{
 		fb_assert(scb);
 
+		Firebird::MutexLockGuard guard(mutex, FB_FUNCTION);
+
 		if (!sorts.exist(scb))
 		{
 			sorts.add(scb);
@@ -414,6 +447,8 @@ public:
 	{
 		fb_assert(scb);
 
+		Firebird::MutexLockGuard guard(mutex, FB_FUNCTION);
+
 		FB_SIZE_T pos;
 		if (sorts.find(scb, pos))
 		{
@@ -432,6 +467,7 @@ public:
 private:
 	MemoryPool& pool;
 	Database* const dbb;
+	Firebird::Mutex mutex;		// partitions of parallel sort are filled by different threads
 	Firebird::SortedArray<Sort*> sorts;
 	Firebird::HalfStaticArray<UCHAR*, 4> buffers;
 };
@@ -514,6 +514,66 @@ UCHAR* Compressor::unpack(ULONG inLength, const UCHAR* input,
 	return output;
 }
 
+void Compressor::unpack(ULONG inLength, const UCHAR* input,
+						ULONG outLength, UCHAR* output,
+						ULONG limit, ULONG& inOffset, ULONG& outOffset)
+{
+/**************************************
+ *
+ *	Resume decompression of a compressed string at the given offsets
+ *	and stop as soon as the output reaches the limit. Runs are never
+ *	split, so the output may go past the limit. Return the offsets
+ *	where the decompression stopped.
+ *
+ **************************************/
+	const auto end = input + inLength;
+	const auto output_end = output + outLength;
+	const auto output_limit = output + MIN(limit, outLength);
+
+	auto in = input + inOffset;
+	auto out = output + outOffset;
+
+	while (in < end && out < output_limit)
+	{
+		const int length = (signed char) *in++;
+
+		if (length < 0)
+		{
+			auto zipLength = (unsigned) -length;
+
+			if (length == -1)
+			{
+				zipLength = get_short(in);
+				in += sizeof(USHORT);
+			}
+			else if (length == -2)
+			{
+				zipLength = get_long(in);
+				in += sizeof(ULONG);
+			}
+
+			if (in >= end || out + zipLength > output_end)
+				BUGCHECK(179);	// msg 179 decompression overran buffer
+
+			const auto c = *in++;
+			memset(out, c, zipLength);
+			out += zipLength;
+		}
+		else
+		{
+			if (in + length > end || out + length > output_end)
+				BUGCHECK(179);	// msg 179 decompression overran buffer
+
+			memcpy(out, in, length);
+			out += length;
+			in += length;
+		}
+	}
+
+	inOffset = in - input;
+	outOffset = out - output;
+}
+
 ULONG Difference::apply(ULONG diffLength, ULONG outLength, UCHAR* const output)
 {
 /**************************************
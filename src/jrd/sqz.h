@@ -54,6 +54,9 @@ namespace Jrd
 		static ULONG getUnpackedLength(ULONG inLength, const UCHAR* input);
 		static UCHAR* unpack(ULONG inLength, const UCHAR* input,
 							 ULONG outLength, UCHAR* output);
+		static void unpack(ULONG inLength, const UCHAR* input,
+						   ULONG outLength, UCHAR* output,
+						   ULONG limit, ULONG& inOffset, ULONG& outOffset);
 
 	private:
 		unsigned nonCompressableRun(unsigned length);
@@ -0,0 +1,232 @@
+#include "firebird.h"
+#include "boost/test/unit_test.hpp"
+#include "../jrd/jrd.h"
+#include "../jrd/sort.h"
+#include <chrono>
+#include <stddef.h>
+
+using namespace Firebird;
+using namespace Jrd;
+
+namespace
+{
+	// Records laid out as in the sort buffer: back pointer followed by the key,
+	// the array of pointers to the keys is surrounded by the low and high keys.
+
+	class SortData
+	{
+	public:
+		SortData(ULONG count, ULONG keyLongs, ULONG distinct, ULONG seed)
+			: m_count(count),
+			  m_keyLongs(keyLongs),
+			  m_longs(FB_ALIGN((BACK_LONGS + keyLongs) * sizeof(SORTP), FB_ALIGNMENT) / sizeof(SORTP)),
+			  m_records(*getDefaultMemoryPool()),
+			  m_pointers(*getDefaultMemoryPool()),
+			  m_lowKey(*getDefaultMemoryPool()),
+			  m_highKey(*getDefaultMemoryPool())
+		{
+			// Quick sort may look past the key of the last record
+			m_records.resize((m_count + 1) * m_longs, 0);
+			m_pointers.getBuffer(m_count + 2);
+
+			SORTP* const records = m_records.begin();
+
+			m_lowKey.resize(m_keyLongs, 0);
+			m_highKey.resize(m_keyLongs, MAX_ULONG);
+
+			for (ULONG i = 0; i < m_count; i++)
+			{
+				SORTP* const key = records + i * m_longs + BACK_LONGS;
+
+				// Few values in the first longword, like null flags or short
+				// numbers have, so the prefix is often the same
+
+				key[0] = random(seed) % 4;
+
+				for (ULONG j = 1; j < m_keyLongs; j++)
+					key[j] = random(seed) % distinct;
+			}
+
+			reset();
+		}
+
+		// Restore the original order of records
+		void reset()
+		{
+			SORTP* const records = m_records.begin();
+
+			m_pointers[0] = m_lowKey.begin();
+			m_pointers[m_count + 1] = m_highKey.begin();
+
+			for (ULONG i = 0; i < m_count; i++)
+			{
+				SORTP* const key = records + i * m_longs + BACK_LONGS;
+				m_pointers[i + 1] = key;
+				*reinterpret_cast<SORTP***>(key - BACK_LONGS) = &m_pointers[i + 1];
+			}
+		}
+
+		SORTP** getPointers()
+		{
+			return m_pointers.begin() + 1;
+		}
+
+		ULONG getCount() const
+		{
+			return m_count;
+		}
+
+		ULONG getLongs() const
+		{
+			return m_longs;
+		}
+
+		int compare(const SORTP* p, const SORTP* q) const
+		{
+			for (ULONG i = 0; i < m_keyLongs; i++)
+			{
+				if (p[i] != q[i])
+					return (p[i] > q[i]) ? 1 : -1;
+			}
+
+			return 0;
+		}
+
+		bool isSorted()
+		{
+			SORTP** const pointers = getPointers();
+
+			for (ULONG i = 0; i < m_count; i++)
+			{
+				if (*reinterpret_cast<SORTP***>(pointers[i] - BACK_LONGS) != &pointers[i])
+					return false;
+
+				if (i && compare(pointers[i - 1], pointers[i]) > 0)
+					return false;
+			}
+
+			return true;
+		}
+
+	private:
+		static ULONG random(ULONG& seed)
+		{
+			seed = seed * 1103515245 + 12345;
+			return (seed >> 8) ^ (seed << 13);
+		}
+
+		static const ULONG BACK_LONGS = offsetof(SR, sr_sort_record) / sizeof(SORTP);
+
+		const ULONG m_count;
+		const ULONG m_keyLongs;
+		const ULONG m_longs;
+		Array<SORTP> m_records;
+		Array<SORTP*> m_pointers;
+		Array<SORTP> m_lowKey;
+		Array<SORTP> m_highKey;
+	};
+
+	double measure(SortData& data, bool radix, unsigned passes)
+	{
+		double total = 0;
+
+		for (unsigned i = 0; i < passes; i++)
+		{
+			data.reset();
+
+			const auto start = std::chrono::steady_clock::now();
+
+			if (radix)
+				Sort::radixSort(*getDefaultMemoryPool(), data.getCount(), data.getPointers(), data.getLongs());
+			else
+				Sort::quickSort(data.getCount(), data.getPointers(), data.getLongs());
+
+			const std::chrono::duration<double, std::milli> elapsed =
+				std::chrono::steady_clock::now() - start;
+
+			total += elapsed.count();
+		}
+
+		return total;
+	}
+}
+
+
+BOOST_AUTO_TEST_SUITE(EngineSuite)
+BOOST_AUTO_TEST_SUITE(SortSuite)
+
+
+BOOST_AUTO_TEST_SUITE(SortKernelTests)
+
+BOOST_AUTO_TEST_CASE(RadixSortTest)
+{
+	const ULONG counts[] = {0, 1, 2, 63, 64, 65, 1000, 20000};
+	const ULONG distincts[] = {1, 3, 1000, MAX_ULONG};
+
+	for (const auto count : counts)
+	{
+		for (const auto distinct : distincts)
+		{
+			SortData data(count, 4, distinct, count + distinct);
+
+			Sort::radixSort(*getDefaultMemoryPool(), data.getCount(), data.getPointers(), data.getLongs());
+			BOOST_TEST(data.isSorted());
+		}
+	}
+
+	// Key of a single longword
+
+	SortData data(5000, 1, MAX_ULONG, 1);
+
+	Sort::radixSort(*getDefaultMemoryPool(), data.getCount(), data.getPointers(), data.getLongs());
+	BOOST_TEST(data.isSorted());
+}
+
+BOOST_AUTO_TEST_CASE(SameOrderTest)
+{
+	SortData quickData(10000, 4, 100, 2);
+	SortData radixData(10000, 4, 100, 2);
+
+	Sort::quickSort(quickData.getCount(), quickData.getPointers(), quickData.getLongs());
+	Sort::radixSort(*getDefaultMemoryPool(), radixData.getCount(), radixData.getPointers(), radixData.getLongs());
+
+	BOOST_TEST(quickData.isSorted());
+	BOOST_TEST(radixData.isSorted());
+
+	for (ULONG i = 0; i < quickData.getCount(); i++)
+		BOOST_TEST(quickData.compare(quickData.getPointers()[i], radixData.getPointers()[i]) == 0);
+}
+
+// Micro-benchmark of the sort kernels. It's disabled by default, run it with
+// --run_test=EngineSuite/SortSuite/SortKernelTests/SortKernelBenchmark
+// --log_level=message to see results.
+// 4096 records are about a sort buffer, the bigger arrays are sorted by Top-N and
+// by the buffers grown for big sorts.
+
+BOOST_AUTO_TEST_CASE(SortKernelBenchmark, *boost::unit_test::disabled())
+{
+	const ULONG counts[] = {4096, 262144};
+	const ULONG distincts[] = {16, MAX_ULONG};
+
+	for (const auto count : counts)
+	{
+		for (const auto distinct : distincts)
+		{
+			SortData data(count, 4, distinct, 3);
+			const unsigned passes = 4194304 / count;
+
+			const double quickTime = measure(data, false, passes);
+			const double radixTime = measure(data, true, passes);
+
+			BOOST_TEST(data.isSorted());
+			BOOST_TEST_MESSAGE("records: " << count << ", distinct: " << distinct <<
+				", passes: " << passes << ", quick: " << quickTime << " ms, radix: " << radixTime << " ms");
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()	// SortKernelTests
+
+
+BOOST_AUTO_TEST_SUITE_END()	// SortSuite
+BOOST_AUTO_TEST_SUITE_END()	// EngineSuite
@@ -1158,8 +1158,9 @@ TraNumber TipCache::generateTransactionId()
 	fb_assert(m_tpcHeader);
 	GlobalTpcHeader* header = m_tpcHeader->getHeader();
 
-	// No barrier here, because inconsistency in transaction number order does not matter
-	// for read-only databases where this function is used.
+	// No barrier here. For read-write databases the caller holds TraNumberGuard
+	// (see tra.cpp) which orders allocation of numbers, and inconsistency in
+	// transaction number order does not matter for read-only databases.
 	TraNumber transaction_id = header->latest_transaction_id++ + 1;
 	return transaction_id;
 }
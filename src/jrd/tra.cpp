@@ -90,7 +90,7 @@ typedef Firebird::GenericMap<Firebird::Pair<Firebird::NonPooled<USHORT, UCHAR> >
 #ifdef SUPERSERVER_V2
 static TraNumber bump_transaction_id(thread_db*, WIN*);
 #else
-static header_page* bump_transaction_id(thread_db*, WIN*, bool);
+static TraNumber allocate_transaction_id(thread_db*, bool);
 #endif
 static void retain_context(thread_db* tdbb, jrd_tra* transaction, bool commit, int state);
 static void expand_view_lock(thread_db* tdbb, jrd_tra*, jrd_rel*, UCHAR lock_type,
@@ -1922,6 +1922,11 @@ void TRA_sweep(thread_db* tdbb)
 				Ods::writeOIT(header, MIN(active, transaction_oldest_active));
 			}
 
+			// Starting transactions take OIT from the cache, not from header page
+
+			if (Ods::getOIT(header) > dbb->dbb_oldest_transaction)
+				dbb->dbb_oldest_transaction = Ods::getOIT(header);
+
 			traceSweep.update(header);
 
 			CCH_RELEASE(tdbb, &window);
@@ -2078,32 +2083,98 @@ static TraNumber bump_transaction_id(thread_db* tdbb, WIN* window)
 #else
 
 
-static header_page* bump_transaction_id(thread_db* tdbb, WIN* window, bool dontWrite)
+// Serializes allocation of transaction number with taking the lock of new
+// transaction. Thus transactions starting concurrently never see a number
+// allocated but not locked yet and never consider such transaction dead.
+// Within a process it's done by dbb_tra_start_sync, among processes by the
+// lock manager. Not needed for read-only database.
+
+class TraNumberGuard
+{
+public:
+	explicit TraNumberGuard(thread_db* tdbb)
+		: m_tdbb(tdbb),
+		  m_sync(&tdbb->getDatabase()->dbb_tra_start_sync, FB_FUNCTION),
+		  m_active(false)
+	{
+		Database* const dbb = tdbb->getDatabase();
+
+		if (dbb->readOnly())
+			return;
+
+		m_sync.lock(SYNC_EXCLUSIVE);
+		m_active = true;
+
+		if (!(dbb->dbb_flags & DBB_shared))
+		{
+			if (!dbb->dbb_tra_start_lock)
+			{
+				dbb->dbb_tra_start_lock = FB_NEW_RPT(*dbb->dbb_permanent, 0)
+					Lock(tdbb, 0, LCK_tra_start);
+			}
+
+			if (!LCK_lock(tdbb, dbb->dbb_tra_start_lock, LCK_EX, LCK_WAIT))
+			{
+				release();
+				ERR_punt();
+			}
+		}
+	}
+
+	~TraNumberGuard()
+	{
+		release();
+	}
+
+	void release()
+	{
+		if (!m_active)
+			return;
+
+		m_active = false;
+
+		Database* const dbb = m_tdbb->getDatabase();
+
+		if (dbb->dbb_tra_start_lock && dbb->dbb_tra_start_lock->lck_logical != LCK_none)
+			LCK_release(m_tdbb, dbb->dbb_tra_start_lock);
+
+		m_sync.unlock();
+	}
+
+private:
+	thread_db* const m_tdbb;
+	Sync m_sync;
+	bool m_active;
+};
+
+
+static void reserve_transaction_ids(thread_db* tdbb, TraNumber number, bool dontWrite)
 {
 /**************************************
  *
- *	b u m p _ t r a n s a c t i o n _ i d
+ *	r e s e r v e _ t r a n s a c t i o n _ i d s
  *
  **************************************
  *
  * Functional description
- *	Fetch header and bump next transaction id.  If necessary,
- *	extend TIP.
+ *	Fetch header and reserve a block of transaction ids
+ *	starting with given one, unless another process did it
+ *	already. If necessary, extend TIP.
  *
  **************************************/
 	SET_TDBB(tdbb);
 	Database* dbb = tdbb->getDatabase();
 	CHECK_DBB(dbb);
 
-	window->win_page = HEADER_PAGE_NUMBER;
-	header_page* header = (header_page*) CCH_FETCH(tdbb, window, LCK_write, pag_header);
+	WIN window(HEADER_PAGE_NUMBER);
+	header_page* header = (header_page*) CCH_FETCH(tdbb, &window, LCK_write, pag_header);
 
 	const TraNumber next_transaction = Ods::getNT(header);
 	const TraNumber oldest_active = Ods::getOAT(header);
 	const TraNumber oldest_transaction = Ods::getOIT(header);
 	const TraNumber oldest_snapshot = Ods::getOST(header);
 
-	// Before incrementing the next transaction Id, make sure the current one is valid
+	// Before reserving transaction Ids, make sure the current ones are valid
 	if (next_transaction)
 	{
 		if (oldest_active > next_transaction)
@@ -2113,45 +2184,65 @@ static header_page* bump_transaction_id(thread_db* tdbb, WIN* window, bool dontW
 			BUGCHECK(267);		// next transaction older than oldest transaction
 	}
 
-	if (next_transaction >= MAX_TRA_NUMBER - 1)
+	// Pick up counters advanced by other processes
+
+	if (oldest_active > dbb->dbb_oldest_active)
+		dbb->dbb_oldest_active = oldest_active;
+
+	if (oldest_transaction > dbb->dbb_oldest_transaction)
+		dbb->dbb_oldest_transaction = oldest_transaction;
+
+	if (next_transaction >= number)
 	{
-		CCH_RELEASE(tdbb, window);
+		// Reserved by another process
+		dbb->dbb_reserved_transaction = next_transaction;
+		CCH_RELEASE(tdbb, &window);
+		return;
+	}
+
+	if (number > MAX_TRA_NUMBER - 1)
+	{
+		CCH_RELEASE(tdbb, &window);
 		ERR_post(Arg::Gds(isc_imp_exc) <<
 				 Arg::Gds(isc_tra_num_exc));
 	}
 
-	const TraNumber number = next_transaction + 1;
+	const TraNumber reserve = dbb->dbb_config->getTransactionIdReserve();
+	const TraNumber last = MIN(number + reserve - 1, MAX_TRA_NUMBER - 1);
 
-	// If this is the first transaction on a TIP, allocate the TIP now.
+	// Allocate TIPs for the first transactions on them now.
 	// Note, first TIP page is created with the database itself,
 	// see JProvider::createDatabase.
 
-	const bool new_tip = ((number % dbb->dbb_page_manager.transPerTIP) == 0);
+	const ULONG transPerTIP = dbb->dbb_page_manager.transPerTIP;
+	bool new_tip = false;
 
-	if (new_tip)
+	for (TraNumber first = (next_transaction / transPerTIP + 1) * transPerTIP;
+		 first <= last; first += transPerTIP)
 	{
 		try
 		{
-			TRA_extend_tip(tdbb, (number / dbb->dbb_page_manager.transPerTIP)); //, window);
+			TRA_extend_tip(tdbb, first / transPerTIP); //, window);
 		}
 		catch (Exception&)
 		{
-			CCH_RELEASE(tdbb, window);
+			CCH_RELEASE(tdbb, &window);
 			throw;
 		}
+
+		new_tip = true;
 	}
 
-	// Extend, if necessary, has apparently succeeded.  Next, update header page
+	// Extend, if necessary, has apparently succeeded.  Next, update header page.
+	// Reserved ids must be on disk before any of them is used, unless the only
+	// one is used by read-only transaction.
 
-	if (dontWrite && !new_tip)
-		CCH_MARK(tdbb, window);
+	if (dontWrite && !new_tip && last == number)
+		CCH_MARK(tdbb, &window);
 	else
-		CCH_MARK_MUST_WRITE(tdbb, window);
-
-	//dbb->assignLatestTransactionId(number);
-	dbb->dbb_next_transaction = number;
+		CCH_MARK_MUST_WRITE(tdbb, &window);
 
-	Ods::writeNT(header, number);
+	Ods::writeNT(header, last);
 
 	if (dbb->dbb_oldest_active > oldest_active)
 		Ods::writeOAT(header, dbb->dbb_oldest_active);
@@ -2162,7 +2253,40 @@ static header_page* bump_transaction_id(thread_db* tdbb, WIN* window, bool dontW
 	if (dbb->dbb_oldest_snapshot > oldest_snapshot)
 		Ods::writeOST(header, dbb->dbb_oldest_snapshot);
 
-	return header;
+	dbb->dbb_reserved_transaction = last;
+
+	CCH_RELEASE(tdbb, &window);
+}
+
+
+static TraNumber allocate_transaction_id(thread_db* tdbb, bool dontWrite)
+{
+/**************************************
+ *
+ *	a l l o c a t e _ t r a n s a c t i o n _ i d
+ *
+ **************************************
+ *
+ * Functional description
+ *	Allocate next transaction id. Ids are handed out
+ *	from the block reserved on the header page, the
+ *	header is fetched only when the block is exhausted.
+ *	Caller holds TraNumberGuard.
+ *
+ **************************************/
+	SET_TDBB(tdbb);
+	Database* dbb = tdbb->getDatabase();
+	CHECK_DBB(dbb);
+
+	const TraNumber number = dbb->generateTransactionId();
+
+	if (number > dbb->dbb_reserved_transaction)
+		reserve_transaction_ids(tdbb, number, dontWrite);
+
+	if (number > dbb->dbb_next_transaction)
+		dbb->dbb_next_transaction = number;
+
+	return number;
 }
 #endif
 
@@ -2609,11 +2733,13 @@ static void retain_context(thread_db* tdbb, jrd_tra* transaction, bool commit, i
 
 	// Create a new transaction lock, inheriting oldest active from transaction being committed.
 
-	WIN window(DB_PAGE_SPACE, -1);
 	TraNumber new_number;
 #ifdef SUPERSERVER_V2
+	WIN window(DB_PAGE_SPACE, -1);
 	new_number = bump_transaction_id(tdbb, &window);
 #else
+	TraNumberGuard numberGuard(tdbb);
+
 	if (dbb->readOnly())
 		new_number = dbb->generateTransactionId();
 	else
@@ -2621,8 +2747,7 @@ static void retain_context(thread_db* tdbb, jrd_tra* transaction, bool commit, i
 		const bool dontWrite = (dbb->dbb_flags & DBB_shared) &&
 			(transaction->tra_flags & TRA_readonly);
 
-		const header_page* const header = bump_transaction_id(tdbb, &window, dontWrite);
-		new_number = Ods::getNT(header);
+		new_number = allocate_transaction_id(tdbb, dontWrite);
 	}
 #endif
 
@@ -2635,18 +2760,11 @@ static void retain_context(thread_db* tdbb, jrd_tra* transaction, bool commit, i
 		new_lock->lck_data = transaction->tra_lock->lck_data;
 
 		if (!LCK_lock(tdbb, new_lock, LCK_write, LCK_WAIT))
-		{
-#ifndef SUPERSERVER_V2
-			if (!dbb->readOnly())
-				CCH_RELEASE(tdbb, &window);
-#endif
 			ERR_post(Arg::Gds(isc_lock_conflict));
-		}
 	}
 
 #ifndef SUPERSERVER_V2
-	if (!dbb->readOnly())
-		CCH_RELEASE(tdbb, &window);
+	numberGuard.release();
 #endif
 
 	// Update database notion of the youngest commit retaining
@@ -3521,40 +3639,41 @@ static void transaction_start(thread_db* tdbb, jrd_tra* trans)
 	SET_TDBB(tdbb);
 	Database* const dbb = tdbb->getDatabase();
 	Jrd::Attachment* const attachment = tdbb->getAttachment();
-	WIN window(DB_PAGE_SPACE, -1);
 
 	Lock* lock = FB_NEW_RPT(*tdbb->getDefaultPool(), 0) Lock(tdbb, sizeof(TraNumber), LCK_tra);
 
-	// Read header page and allocate transaction number.  Since
-	// the transaction inventory page was initialized to zero, it
-	// transaction is automatically marked active.
+	// Allocate transaction number.  Since the transaction inventory
+	// page was initialized to zero, it transaction is automatically
+	// marked active.
 
 	TraNumber oldest, number, active, oldest_active;
 
 #ifdef SUPERSERVER_V2
+	WIN window(DB_PAGE_SPACE, -1);
 	number = bump_transaction_id(tdbb, &window);
 	oldest = dbb->dbb_oldest_transaction;
 	active = MAX(dbb->dbb_oldest_active, dbb->dbb_oldest_transaction);
 	oldest_active = dbb->dbb_oldest_active;
 
 #else // SUPERSERVER_V2
+	TraNumberGuard numberGuard(tdbb);
+
 	if (dbb->readOnly())
-	{
 		number = dbb->generateTransactionId();
-		oldest = dbb->dbb_oldest_transaction;
-		oldest_active = dbb->dbb_oldest_active;
-	}
 	else
 	{
 		const bool dontWrite = (dbb->dbb_flags & DBB_shared) &&
 			(trans->tra_flags & TRA_readonly);
 
-		const header_page* header = bump_transaction_id(tdbb, &window, dontWrite);
-		number = Ods::getNT(header);
-		oldest = Ods::getOIT(header);
-		oldest_active = Ods::getOAT(header);
+		number = allocate_transaction_id(tdbb, dontWrite);
 	}
 
+	// Cached counters are refreshed from the header page whenever
+	// transaction ids are reserved there
+
+	oldest = dbb->dbb_oldest_transaction;
+	oldest_active = dbb->dbb_oldest_active;
+
 	// oldest (OIT) > oldest_active (OAT) if OIT was advanced by sweep
 	// and no transactions was started after the sweep starts
 	active = MAX(oldest_active, oldest);
@@ -3588,24 +3707,17 @@ static void transaction_start(thread_db* tdbb, jrd_tra* trans)
 	lock->lck_object = trans;
 
 	if (!LCK_lock(tdbb, lock, LCK_write, LCK_WAIT))
-	{
-#ifndef SUPERSERVER_V2
-		if (!dbb->readOnly())
-			CCH_RELEASE(tdbb, &window);
-#endif
 		ERR_post(Arg::Gds(isc_lock_conflict));
-	}
 
 	// Link the transaction to the attachment block before releasing
-	// header page for handling signals.
+	// transaction number guard for handling signals.
 
 	trans->linkToAttachment(attachment);
 
 	try
 	{
 #ifndef SUPERSERVER_V2
-		if (!dbb->readOnly())
-			CCH_RELEASE(tdbb, &window);
+		numberGuard.release();
 #endif
 
 		if (dbb->readOnly())
@@ -155,6 +155,7 @@ static void list_staying(thread_db*, record_param*, RecordStack&, int flags = 0)
 static void list_staying_fast(thread_db*, record_param*, RecordStack&, record_param* = NULL, int flags = 0);
 static void notify_garbage_collector(thread_db* tdbb, record_param* rpb,
 	TraNumber tranid = MAX_TRA_NUMBER);
+static bool packed_data(thread_db*, record_param*, MemoryPool*);
 
 enum class PrepareResult
 {
@@ -2976,7 +2977,7 @@ bool VIO_get(thread_db* tdbb, record_param* rpb, jrd_tra* transaction, MemoryPoo
 			rpb->rpb_address = NULL;
 			rpb->rpb_length = 0;
 		}
-		else
+		else if (!(rpb->rpb_stream_flags & RPB_s_lazy) || !packed_data(tdbb, rpb, pool))
 			VIO_data(tdbb, rpb, pool);
 	}
 
@@ -3833,7 +3834,7 @@ bool VIO_next_record(thread_db* tdbb,
 			rpb->rpb_address = NULL;
 			rpb->rpb_length = 0;
 		}
-		else
+		else if (!(rpb->rpb_stream_flags & RPB_s_lazy) || !packed_data(tdbb, rpb, pool))
 			VIO_data(tdbb, rpb, pool);
 	}
 
@@ -6050,6 +6051,55 @@ static void notify_garbage_collector(thread_db* tdbb, record_param* rpb, TraNumb
 }
 
 
+static bool packed_data(thread_db* tdbb, record_param* rpb, MemoryPool* pool)
+{
+/**************************************
+ *
+ *	p a c k e d _ d a t a
+ *
+ **************************************
+ *
+ * Functional description
+ *	Given an active record parameter block of a read-only stream,
+ *	keep the packed image of the record instead of decoding it.
+ *	Fields are decoded when they are referenced, so the tail of the
+ *	record nobody looks at is never decoded.  Delta versions, fragmented
+ *	and not packed records are left for VIO_data, return false for them.
+ *
+ **************************************/
+	if ((rpb->rpb_flags & (rpb_incomplete | rpb_not_packed)) ||
+		((rpb->rpb_flags & rpb_chained) && rpb->rpb_prior))
+	{
+		return false;
+	}
+
+	Record* const record = VIO_record(tdbb, rpb, NULL, pool);
+	const Format* const format = record->getFormat();
+
+	// The length is checked now, as VIO_data does, while the page is still there
+
+	const ULONG length = Compressor::getUnpackedLength(rpb->rpb_length, rpb->rpb_address);
+
+	if (!length)
+		BUGCHECK(179);			// msg 179 decompression overran buffer
+
+	if (length != format->fmt_length)
+		BUGCHECK(183);			// msg 183 wrong record length
+
+	record->setTransactionNumber(rpb->rpb_transaction_nr);
+	record->setPacked(rpb->rpb_length, rpb->rpb_address);
+
+	rpb->rpb_prior = (rpb->rpb_b_page && (rpb->rpb_flags & rpb_delta)) ? record : NULL;
+
+	CCH_RELEASE(tdbb, &rpb->getWindow(tdbb));
+
+	rpb->rpb_address = NULL;
+	rpb->rpb_length = 0;
+
+	return true;
+}
+
+
 static PrepareResult prepare_update(thread_db* tdbb, jrd_tra* transaction, TraNumber commit_tid_read,
 	record_param* rpb, record_param* temp, record_param* new_rpb, PageStack& stack, bool writelock)
 {
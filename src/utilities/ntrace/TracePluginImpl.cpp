@@ -662,6 +662,18 @@ void TracePluginImpl::appendGlobalCounts(const PerformanceInfo* info)
 		record.append(temp);
 	}
 
+	if ((cnt = info->pin_counters[PerformanceInfo::PREFETCHES]) != 0)
+	{
+		temp.printf(", %" QUADFORMAT"d prefetch(es)", cnt);
+		record.append(temp);
+	}
+
+	if ((cnt = info->pin_counters[PerformanceInfo::PREFETCH_WASTED]) != 0)
+	{
+		temp.printf(", %" QUADFORMAT"d wasted prefetch(es)", cnt);
+		record.append(temp);
+	}
+
 	record.append(NEWLINE);
 }
 